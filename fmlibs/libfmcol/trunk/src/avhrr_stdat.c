@@ -39,6 +39,7 @@
  * ystein Gody, met.no/FOU, 22.12.2004
  * Changed data structure that holds data to reflect actual channels...
  * ystein Gody, METNO/FOU, 26.04.2007: Adapted for libfmutil/libfmio.
+ * METNO/FOU, 17.10.2026: Calibration using fmio_calplan lookup tables.
  *
  * CVS_ID:
  * $Id$
@@ -55,7 +56,7 @@ int avhrr_stdat(fmgeopos gpos, fmprojspec myproj, fmio_img img, as_data *a) {
     int nodata = 0;
     fmtime timeid, mytime;
     fmsubtrack st;
-    fmscale byte2float;
+    fmio_calplan plan;
     fmangreq angreq;
     fmangles ang;
     fmucspos tgxy;
@@ -75,7 +76,6 @@ int avhrr_stdat(fmgeopos gpos, fmprojspec myproj, fmio_img img, as_data *a) {
     rim.ih = img.ih;
     sprintf((*a).source,"%s", img.sa);
     fm_img2fmtime(img,&timeid);
-    fm_img2slopes(img,&byte2float);
     (*a).nav.Ax = img.Ax;
     (*a).nav.Ay = img.Ay;
 
@@ -162,6 +162,17 @@ int avhrr_stdat(fmgeopos gpos, fmprojspec myproj, fmio_img img, as_data *a) {
     dx = (int) floorf((float) (*a).nav.iw/2.);
     dy = (int) floorf((float) (*a).nav.ih/2.);
 
+    /*
+     * Bind the channels to reflectance or temperature according to the
+     * channel id once, calibrated values are then found in tables.
+     */
+    fm_calplan_init(&plan);
+    if (fm_img2calplan(img, &plan)) {
+	fmerrmsg(where,"Could not set up calibration of channels.");
+	fm_calplan_free(&plan);
+	return(FM_VAROUTOFSCOPE_ERR);
+    }
+
     /*
      * Collect the actual data.
      */
@@ -181,19 +192,20 @@ int avhrr_stdat(fmgeopos gpos, fmprojspec myproj, fmio_img img, as_data *a) {
 		    if (img.image[3][l] == 0) nodata++;
 		} else {
 		    if (img.ch[m] == 1) {
-			(*a).ch1[k] = fm_byte2float(img.image[m][l],byte2float,"Reflectance");
+			(*a).ch1[k] = plan.lut[m][img.image[m][l]];
 		    } else if (img.ch[m] == 2) {
-			(*a).ch2[k] = fm_byte2float(img.image[m][l],byte2float,"Reflectance");
+			(*a).ch2[k] = plan.lut[m][img.image[m][l]];
 		    } else if (img.ch[m] == 6) {
-			(*a).ch3a[k] = fm_byte2float(img.image[m][l],byte2float,"Reflectance");
+			(*a).ch3a[k] = plan.lut[m][img.image[m][l]];
 		    } else if (img.ch[m] == 3) {
-			(*a).ch3b[k] = fm_byte2float(img.image[m][l],byte2float,"Temperature");
+			(*a).ch3b[k] = plan.lut[m][img.image[m][l]];
 		    } else if (img.ch[m] == 4) {
-			(*a).ch4[k] = fm_byte2float(img.image[m][l],byte2float,"Temperature");
+			(*a).ch4[k] = plan.lut[m][img.image[m][l]];
 		    } else if (img.ch[m] == 5) {
-			(*a).ch5[k] = fm_byte2float(img.image[m][l],byte2float,"Temperature");
+			(*a).ch5[k] = plan.lut[m][img.image[m][l]];
 		    } else {
 			fmerrmsg(where,"Could not recognise channel id.");
+			fm_calplan_free(&plan);
 			return(1);
 		    }
 		}
@@ -202,6 +214,8 @@ int avhrr_stdat(fmgeopos gpos, fmprojspec myproj, fmio_img img, as_data *a) {
 	}
     }
 
+    fm_calplan_free(&plan);
+
     /*
      * If all pixels are unprocessed this is likely to be out of coverage,
      * return code to indicate this...
@@ -16,6 +16,7 @@
  * MODIFIED:
  * ystein Gody, met.no/FOU, 30.09.2004 
  * Removed a possible memory leak by implementing free(infile).
+ * METNO/FOU, 17.10.2026: The header is initialised by fm_init_fmio_img.
  */
 
 #include <fmcol.h>
@@ -40,12 +41,8 @@ int check_avhrr(char *ipath, char *basename, fstruct *avhrr_f,
 
     /*
      * Initialize the imgh structure to avoid memory leakage in fm_readheader
-     * This is only required for the parts that might be allocated below
      */
-    header.track = NULL;
-    for (i=0;i<FMIO_NCHAN;i++) {
-	header.image[i] = NULL;
-    }
+    fm_init_fmio_img(&header);
 
     /*
      * Split basename if several substrings are specified
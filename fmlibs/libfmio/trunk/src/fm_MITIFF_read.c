@@ -22,7 +22,10 @@
  * negative value : an error occured
  *
  * NOTES:
- * At present only single strip images are supported.
+ * Images in several strips and compressed images are read by
+ * fm_MITIFF_read and fm_MITIFF_read_imagepal. fm_MITIFF_read_window
+ * reads only the strips, or for uncompressed images the rows, holding
+ * the window.
  *
  * BUGS:
  * NA
@@ -40,6 +43,10 @@
  * ystein Gody, METNO/FOU, 16.10.2006: Modified name space for libfmio.
  * ystein Gody, METNO/FOU, 22.02.2008: Some bugfixing reading headers.
  * ystein Gody, METNO/FOU, 16.10.2008: Changes in reading headers.
+ * METNO/FOU, 17.10.2026: Header decoding moved to fm_MITIFF_readhead.
+ * METNO/FOU, 17.10.2026: Images in several strips and compressed images
+ * are read by fm_MITIFF_readstrips.
+ * METNO/FOU, 17.10.2026: Added fm_MITIFF_read_window.
  *
  * ID:
  * $Id$
@@ -48,14 +55,15 @@
 #include <fmio.h>
 #ifdef FMIO_HAVE_LIBTIFF
 #include <tiffio.h>
+#include <unistd.h>
 
-int fm_MITIFF_read(char *infile, unsigned char *image[], 
-    fmio_mihead *ginfo) {
+/*
+ * Decode the information header of an open multichannel image.
+ */
+static int fm_MITIFF_readhead(TIFF *in, fmio_mihead *ginfo) {
     
     char *where="MITIFF_read";
-    TIFF *in;
-    int i, status, size;
-    short pmi;
+    int i;
     unsigned int fieldlen, currlen, nextlen, taglen;
     char *description, *o_description;
     char *currfield, *nextfield, *field, *pt;
@@ -82,25 +90,6 @@ int fm_MITIFF_read(char *infile, unsigned char *image[],
 	"Calibration"
     };
 
-    /*
-     * Open TIFF files and initialize IFD
-     */
-    
-    in=TIFFOpen(infile, "rc");
-    if (!in) {
-	printf(" This is no TIFF file! \n");
-	return(FM_IO_ERR);
-    }
-
-    /*
-     * Test whether this is a color palette image or not. If so another
-     * function should be used.
-     */
-    status = TIFFGetField(in, 262, &pmi);
-    if (pmi == 3) {
-	return(FM_IO_ERR);
-    }
-
     description = (char *) malloc(1024*sizeof(char));
     if (!description) fmerrmsg(where,"Memory allocation failed");
     o_description = description;
@@ -134,11 +123,150 @@ int fm_MITIFF_read(char *infile, unsigned char *image[],
     free(o_nextfield);
     free(o_description); 
     
+    TIFFGetField(in, 256, &ginfo->xsize);
+    TIFFGetField(in, 257, &ginfo->ysize);
+
+    return(FM_OK);
+}
+
+/*
+ * Read the image of the current directory into image, which has room
+ * for size pixels. A single uncompressed strip is read as it is stored,
+ * otherwise the strips are decoded by libtiff one by one.
+ */
+static int fm_MITIFF_readstrips(TIFF *in, unsigned char *image, int size) {
+
+    char *where="MITIFF_readstrips";
+    uint16 compression;
+    tstrip_t s, nstrips;
+    tsize_t n, pos;
+
+    compression = COMPRESSION_NONE;
+    TIFFGetField(in, 259, &compression);
+    nstrips = TIFFNumberOfStrips(in);
+    if (compression == COMPRESSION_NONE && nstrips == 1) {
+	if (TIFFReadRawStrip(in, 0, image, size) == -1) return(FM_IO_ERR);
+	return(FM_OK);
+    }
+
+    pos = 0;
+    for (s=0; s<nstrips && pos<size; s++) {
+	n = TIFFReadEncodedStrip(in, s, image+pos, size-pos);
+	if (n == -1) {
+	    fmerrmsg(where,"Could not decode strip %d", s);
+	    return(FM_IO_ERR);
+	}
+	pos += n;
+    }
+    if (pos != size) {
+	fmerrmsg(where,"Strips hold %ld of %d pixels", (long) pos, size);
+	return(FM_IO_ERR);
+    }
+
+    return(FM_OK);
+}
+
+/*
+ * Read window win of the image of the current directory, which is xsize
+ * pixels wide, into image. Rows of uncompressed images are read directly
+ * from their position in the file, otherwise the strips overlapping the
+ * window are decoded one by one. Strips outside the window are not read.
+ */
+static int fm_MITIFF_readwindow(TIFF *in, unsigned char *image, int xsize,
+	fmio_window win) {
+
+    char *where="MITIFF_readwindow";
+    uint16 compression;
+    uint32 rps;
+    toff_t *offsets;
+    tstrip_t s, nstrips;
+    tsize_t n;
+    unsigned char *buf;
+    int r, r0, r1;
+
+    compression = COMPRESSION_NONE;
+    TIFFGetField(in, 259, &compression);
+    if (!TIFFGetField(in, TIFFTAG_ROWSPERSTRIP, &rps) || rps == 0) {
+	rps = win.row+win.ny;
+    }
+    nstrips = TIFFNumberOfStrips(in);
+
+    if (compression == COMPRESSION_NONE) {
+	if (!TIFFGetField(in, TIFFTAG_STRIPOFFSETS, &offsets)) {
+	    fmerrmsg(where,"Strip offsets are missing");
+	    return(FM_IO_ERR);
+	}
+	for (r=0; r<win.ny; r++) {
+	    s = (win.row+r)/rps;
+	    if (s >= nstrips || pread(TIFFFileno(in), image+r*win.nx, win.nx,
+			offsets[s]+((win.row+r)%rps)*xsize+win.col) != win.nx) {
+		fmerrmsg(where,"Could not read row %d", win.row+r);
+		return(FM_IO_ERR);
+	    }
+	}
+	return(FM_OK);
+    }
+
+    buf = (unsigned char *) malloc(TIFFStripSize(in));
+    if (!buf) {
+	fmerrmsg(where,"Memory allocation failed");
+	return(FM_MEMALL_ERR);
+    }
+    for (s=win.row/rps; s<=(win.row+win.ny-1)/rps; s++) {
+	r0 = s*rps;
+	r1 = r0+rps;
+	if (r0 < win.row) r0 = win.row;
+	if (r1 > win.row+win.ny) r1 = win.row+win.ny;
+	n = TIFFReadEncodedStrip(in, s, buf, -1);
+	if (n < (tsize_t) (r1-s*rps)*xsize) {
+	    fmerrmsg(where,"Could not decode strip %d", s);
+	    free(buf);
+	    return(FM_IO_ERR);
+	}
+	for (r=r0; r<r1; r++) {
+	    memcpy(image+(r-win.row)*win.nx, buf+(r-s*rps)*xsize+win.col,
+		    win.nx);
+	}
+    }
+    free(buf);
+
+    return(FM_OK);
+}
+
+int fm_MITIFF_read(char *infile, unsigned char *image[], 
+    fmio_mihead *ginfo) {
+    
+    char *where="MITIFF_read";
+    TIFF *in;
+    int i, status, size;
+    short pmi;
+
+    /*
+     * Open TIFF files and initialize IFD
+     */
+    
+    in=TIFFOpen(infile, "rc");
+    if (!in) {
+	printf(" This is no TIFF file! \n");
+	return(FM_IO_ERR);
+    }
+
+    /*
+     * Test whether this is a color palette image or not. If so another
+     * function should be used.
+     */
+    if (TIFFGetField(in, 262, &pmi) && pmi == 3) {
+	TIFFClose(in);
+	return(FM_IO_ERR);
+    }
+
+    if (fm_MITIFF_readhead(in, ginfo)) {
+	return(FM_IO_ERR);
+    }
+
     /*
      * Read image data into matrix.
      */
-    TIFFGetField(in, 256, &ginfo->xsize);
-    TIFFGetField(in, 257, &ginfo->ysize);
     size = ginfo->xsize*ginfo->ysize;
   
     /*
@@ -152,8 +280,8 @@ int fm_MITIFF_read(char *infile, unsigned char *image[],
     for (i=0; i<ginfo->zsize; i++) {
 	image[i] = (unsigned char *) malloc((size+1)*sizeof(char));
 	if (!image[i]) fmerrmsg(where,"Memory allocation failed");
-	status = TIFFReadRawStrip(in, 0, image[i], size);
-	if (status == -1) return(FM_IO_ERR);
+	status = fm_MITIFF_readstrips(in, image[i], size);
+	if (status) return(FM_IO_ERR);
 	if (TIFFReadDirectory(in) == 0) break;
     }
 
@@ -166,6 +294,86 @@ int fm_MITIFF_read(char *infile, unsigned char *image[],
     return(FM_OK);
 }
 
+/*
+ * PURPOSE:
+ * As fm_MITIFF_read, but only the pixels within win are read. ginfo
+ * describes the window, xsize and ysize are those of the window and Bx,
+ * By the position of its upper left pixel. The window is clipped to the
+ * image, it is an error if it does not overlap the image.
+ *
+ * RETURN VALUES:
+ * As fm_MITIFF_read, nothing is allocated on failure.
+ *
+ * AUTHOR:
+ * METNO/FOU, 17.10.2026
+ */
+int fm_MITIFF_read_window(char *infile, unsigned char *image[], 
+    fmio_mihead *ginfo, fmio_window win) {
+    
+    char *where="MITIFF_read_window";
+    TIFF *in;
+    int i, k, status;
+    short pmi;
+
+    in=TIFFOpen(infile, "rc");
+    if (!in) {
+	printf(" This is no TIFF file! \n");
+	return(FM_IO_ERR);
+    }
+
+    if ((TIFFGetField(in, 262, &pmi) && pmi == 3) ||
+	    fm_MITIFF_readhead(in, ginfo)) {
+	TIFFClose(in);
+	return(FM_IO_ERR);
+    }
+    if (ginfo->zsize > FMIO_MAXCHANNELS) {
+	printf("\n\tNOT ENOUGH POINTERS AVAILABLE TO HOLD DATA!\n");
+	TIFFClose(in);
+	return(FM_IO_ERR);
+    }
+    if (fm_clipwindow(ginfo->xsize, ginfo->ysize, &win)) {
+	fmerrmsg(where,"Window is not within %s", infile);
+	TIFFClose(in);
+	return(FM_VAROUTOFSCOPE_ERR);
+    }
+
+    status = FM_OK;
+    for (i=0; i<ginfo->zsize; i++) {
+	image[i] = (unsigned char *) malloc(win.nx*win.ny*sizeof(char));
+	if (!image[i]) {
+	    fmerrmsg(where,"Memory allocation failed");
+	    status = FM_MEMALL_ERR;
+	    break;
+	}
+	status = fm_MITIFF_readwindow(in, image[i], ginfo->xsize, win);
+	if (status) {
+	    i++;
+	    break;
+	}
+	if (i+1 < ginfo->zsize && TIFFReadDirectory(in) == 0) {
+	    printf("\n\tERROR READING MULTIPLE SUBFILES!\n");
+	    status = FM_IO_ERR;
+	    i++;
+	    break;
+	}
+    }
+    TIFFClose(in);
+    if (status) {
+	for (k=0; k<i; k++) {
+	    free(image[k]);
+	    image[k] = NULL;
+	}
+	return(status);
+    }
+
+    ginfo->Bx += win.col*ginfo->Ax;
+    ginfo->By -= win.row*ginfo->Ay;
+    ginfo->xsize = win.nx;
+    ginfo->ysize = win.ny;
+
+    return(FM_OK);
+}
+
 /*
  * PURPOSE:
  * To read DNMI/TIFF palette color files containing either classed satellite
@@ -337,8 +545,8 @@ int fm_MITIFF_read_imagepal(char *infile, unsigned char *image[],
     for (i=0; i<ginfo->zsize; i++) {
 	image[i] = (unsigned char *) malloc((size+1)*sizeof(char));
 	if (!image[i]) fmerrmsg(where,"Memory allocation failed");
-	status = TIFFReadRawStrip(in, 0, *image, size);
-	if (status == -1) return(FM_IO_ERR);
+	status = fm_MITIFF_readstrips(in, image[i], size);
+	if (status) return(FM_IO_ERR);
 	if (TIFFReadDirectory(in) == 0) break;
     }
 
@@ -2,6 +2,11 @@
  * NAME:
  * fm_MITIFF_write
  * fm_MITIFF_write_rgb
+ * fm_MITIFF_write_opts
+ * fm_MITIFF_write_imagepal_opts
+ * fm_MITIFF_open_imagepal_bands
+ * fm_MITIFF_write_band
+ * fm_MITIFF_close_bands
  * 
  * PURPOSE:
  * Writes image data on TIFF formatted file, ready for visualization
@@ -26,15 +31,54 @@
  * Cleaning of code, removed some parts not used...
  * ystein Gody, METNO/FOU, 16.10.2006
  * Modified name space for libfmio.
+ * METNO/FOU, 17.10.2026
+ * Added fm_MITIFF_write_opts and fm_MITIFF_write_imagepal_opts, writing
+ * compressed images in several strips.
+ * METNO/FOU, 17.10.2026
+ * Added fm_MITIFF_open_imagepal_bands, fm_MITIFF_write_band and
+ * fm_MITIFF_close_bands, writing palette images band by band.
  *
  * ID:
  * $Id$
  */
  
 #include <fmio.h>
+#include <strings.h>
+
+/*
+ * PURPOSE:
+ * Set the options of the MITIFF writers to those of fm_MITIFF_write,
+ * one uncompressed strip.
+ */
+void fm_tiffopts_init(fmio_tiffopts *opts) {
+
+    opts->rowsperstrip = 0;
+    opts->compression = FMIO_COMPRESSION_NONE;
+    opts->predictor = FMFALSE;
+    opts->nthreads = 1;
+}
+
+/*
+ * PURPOSE:
+ * Decode the name of a compression method, "none", "lzw" or "deflate"
+ * in any case.
+ *
+ * RETURN VALUES:
+ * The FMIO_COMPRESSION_* value, or -1 if the name is not recognised.
+ */
+int fm_tiffopts_compression(char *name) {
+
+    if (strncasecmp(name,"none",4) == 0) return(FMIO_COMPRESSION_NONE);
+    if (strncasecmp(name,"lzw",3) == 0) return(FMIO_COMPRESSION_LZW);
+    if (strncasecmp(name,"deflate",7) == 0) return(FMIO_COMPRESSION_DEFLATE);
+
+    return(-1);
+}
 
 #ifdef FMIO_HAVE_LIBTIFF
 #include <tiffio.h>
+#include <zlib.h>
+#include <pthread.h>
 
 int fm_MITIFF_write(char *outfile, unsigned char *image, char newhead[], 
     fmio_mihead ginfo) {
@@ -261,4 +305,495 @@ int fm_MITIFF_write_multi(char *outfile, unsigned char *image[],
     return(FM_OK);
 }
 
+/*
+ * A strip of an image compressed by fm_MITIFF_deflate_strip.
+ */
+typedef struct {
+    unsigned char *data; /* first pixel of strip in image */
+    unsigned int xsize; /* pixels in a row */
+    unsigned int nrows; /* rows of strip */
+    fmbool predictor;
+    unsigned char *buf; /* compressed strip */
+    uLongf len; /* bytes in buf */
+    int status;
+} fmio_tiffstrip;
+
+/*
+ * Strips first, first+step, ... are compressed by a thread.
+ */
+typedef struct {
+    fmio_tiffstrip *strip;
+    int nstrips;
+    int first;
+    int step;
+} fmio_tiffworker;
+
+/*
+ * Compress a strip as a zlib stream, as the Deflate codec of libtiff
+ * does. Horizontal differencing (predictor 2) is done on a copy of the
+ * strip, kept after the compressed data in buf.
+ */
+static void fm_MITIFF_deflate_strip(fmio_tiffstrip *s) {
+
+    unsigned char *src, *p;
+    unsigned int i, j;
+    uLong n;
+
+    n = (uLong) s->xsize*s->nrows;
+    src = s->data;
+    s->len = compressBound(n);
+    s->buf = (unsigned char *) malloc(s->len+(s->predictor ? n : 0));
+    if (!s->buf) {
+	s->status = FM_MEMALL_ERR;
+	return;
+    }
+    if (s->predictor) {
+	src = s->buf+s->len;
+	memcpy(src, s->data, n);
+	for (j=0; j<s->nrows; j++) {
+	    p = src+j*s->xsize;
+	    for (i=s->xsize-1; i>0; i--) p[i] -= p[i-1];
+	}
+    }
+    if (compress2(s->buf, &(s->len), src, n, Z_DEFAULT_COMPRESSION) != Z_OK) {
+	s->status = FM_IO_ERR;
+	return;
+    }
+    s->status = FM_OK;
+}
+
+static void *fm_MITIFF_deflate_thread(void *arg) {
+
+    fmio_tiffworker *w = (fmio_tiffworker *) arg;
+    int i;
+
+    for (i=w->first; i<w->nstrips; i+=w->step) {
+	fm_MITIFF_deflate_strip(&(w->strip[i]));
+    }
+
+    return(NULL);
+}
+
+/*
+ * Compress the strips of image, which holds ysize rows starting at strip
+ * first, on opts.nthreads threads, and write them in order when all are
+ * compressed. The file is the same whatever the number of threads.
+ */
+static int fm_MITIFF_deflate_strips(TIFF *out, unsigned char *image,
+    unsigned int xsize, unsigned int ysize, int rows, int first,
+    fmio_tiffopts opts) {
+
+    char *where="fm_MITIFF_deflate_strips";
+    fmio_tiffstrip *strip;
+    fmio_tiffworker *worker;
+    pthread_t *tid;
+    short *started;
+    int i, nstrips, nthreads, status;
+
+    nstrips = (ysize+rows-1)/rows;
+    nthreads = opts.nthreads;
+    if (nthreads > FMIO_MAXTHREADS) nthreads = FMIO_MAXTHREADS;
+    if (nthreads > nstrips) nthreads = nstrips;
+    if (nthreads < 1) nthreads = 1;
+
+    strip = (fmio_tiffstrip *) malloc(nstrips*sizeof(fmio_tiffstrip));
+    worker = (fmio_tiffworker *) malloc(nthreads*sizeof(fmio_tiffworker));
+    tid = (pthread_t *) malloc(nthreads*sizeof(pthread_t));
+    started = (short *) malloc(nthreads*sizeof(short));
+    if (!strip || !worker || !tid || !started) {
+	fmerrmsg(where,"Could not allocate memory for %d strips", nstrips);
+	if (strip) free(strip);
+	if (worker) free(worker);
+	if (tid) free(tid);
+	if (started) free(started);
+	return(FM_MEMALL_ERR);
+    }
+
+    for (i=0; i<nstrips; i++) {
+	strip[i].data = image+(size_t) i*rows*xsize;
+	strip[i].xsize = xsize;
+	strip[i].nrows = rows;
+	if ((i+1)*rows > ysize) strip[i].nrows = ysize-i*rows;
+	strip[i].predictor = opts.predictor;
+	strip[i].buf = NULL;
+	strip[i].len = 0;
+	strip[i].status = FM_IO_ERR;
+    }
+    for (i=0; i<nthreads; i++) {
+	worker[i].strip = strip;
+	worker[i].nstrips = nstrips;
+	worker[i].first = i;
+	worker[i].step = nthreads;
+	started[i] = 0;
+    }
+
+    if (nthreads == 1) {
+	fm_MITIFF_deflate_thread(&worker[0]);
+    } else {
+	for (i=0; i<nthreads; i++) {
+	    if (pthread_create(&tid[i], NULL, fm_MITIFF_deflate_thread,
+			&worker[i])) {
+		fmerrmsg(where,
+			"Could not start thread %d, compressing its strips serially",
+			i);
+		continue;
+	    }
+	    started[i] = 1;
+	}
+	for (i=0; i<nthreads; i++) {
+	    if (!started[i]) fm_MITIFF_deflate_thread(&worker[i]);
+	}
+	for (i=0; i<nthreads; i++) {
+	    if (started[i]) pthread_join(tid[i], NULL);
+	}
+    }
+
+    status = FM_OK;
+    for (i=0; i<nstrips; i++) {
+	if (status == FM_OK) {
+	    if (strip[i].status != FM_OK) {
+		fmerrmsg(where,"Could not compress strip %d", first+i);
+		status = strip[i].status;
+	    } else if (TIFFWriteRawStrip(out, first+i, strip[i].buf,
+			strip[i].len) == -1) {
+		fmerrmsg(where,"Error in TIFFWriteRawStrip for strip %d",
+			first+i);
+		status = FM_IO_ERR;
+	    }
+	}
+	if (strip[i].buf) free(strip[i].buf);
+    }
+
+    free(strip);
+    free(worker);
+    free(tid);
+    free(started);
+
+    return(status);
+}
+
+/*
+ * Write the strips of image, which holds ysize rows starting at strip
+ * first. LZW strips are encoded serially by libtiff.
+ */
+static int fm_MITIFF_encode_strips(TIFF *out, unsigned char *image,
+    unsigned int xsize, unsigned int ysize, int rows, int first,
+    fmio_tiffopts opts) {
+
+    char *where="fm_MITIFF_encode_strips";
+    int i, nstrips, size;
+
+    if (opts.compression == FMIO_COMPRESSION_DEFLATE) {
+	return(fm_MITIFF_deflate_strips(out, image, xsize, ysize, rows, first,
+		    opts));
+    }
+
+    nstrips = (ysize+rows-1)/rows;
+    for (i=0; i<nstrips; i++) {
+	size = rows*xsize;
+	if ((i+1)*rows > ysize) size = (ysize-i*rows)*xsize;
+	if (TIFFWriteEncodedStrip(out, first+i, image+(size_t) i*rows*xsize,
+		    size) == -1) {
+	    fmerrmsg(where,"Error in TIFFWriteEncodedStrip for strip %d",
+		    first+i);
+	    return(FM_IO_ERR);
+	}
+    }
+
+    return(FM_OK);
+}
+
+/*
+ * Set the tags of strips of rows rows and of the compression.
+ */
+static int fm_MITIFF_set_strips(TIFF *out, fmio_mihead ginfo, int rows,
+    fmio_tiffopts opts) {
+
+    char *where="fm_MITIFF_set_strips";
+    uint16 predictor;
+
+    if (ginfo.xsize < 1 || ginfo.ysize < 1) {
+	fmerrmsg(where,"Empty image (%ux%u)", ginfo.xsize, ginfo.ysize);
+	return(FM_IO_ERR);
+    }
+    if (opts.compression != FMIO_COMPRESSION_NONE &&
+	    opts.compression != FMIO_COMPRESSION_LZW &&
+	    opts.compression != FMIO_COMPRESSION_DEFLATE) {
+	fmerrmsg(where,"Compression %d is not supported", opts.compression);
+	return(FM_IO_ERR);
+    }
+    if (TIFFSetField(out, 259, opts.compression) != 1 ||
+	    TIFFSetField(out, 278, rows) != 1) {
+	fmerrmsg(where,"Error in TIFFSetField");
+	return(FM_IO_ERR);
+    }
+    if (opts.predictor && opts.compression != FMIO_COMPRESSION_NONE) {
+	predictor = PREDICTOR_HORIZONTAL;
+	if (TIFFSetField(out, 317, predictor) != 1) {
+	    fmerrmsg(where,"Error in TIFFSetField");
+	    return(FM_IO_ERR);
+	}
+    }
+
+    return(FM_OK);
+}
+
+/*
+ * Set the tags of the strips and compression and write image.
+ */
+static int fm_MITIFF_write_strips(TIFF *out, unsigned char *image,
+    fmio_mihead ginfo, fmio_tiffopts opts) {
+
+    int rows;
+
+    rows = opts.rowsperstrip;
+    if (rows < 1 || rows > ginfo.ysize) rows = ginfo.ysize;
+    if (fm_MITIFF_set_strips(out, ginfo, rows, opts)) return(FM_IO_ERR);
+
+    return(fm_MITIFF_encode_strips(out, image, ginfo.xsize, ginfo.ysize,
+		rows, 0, opts));
+}
+
+/*
+ * PURPOSE:
+ * As fm_MITIFF_write, but the image is written in strips of
+ * opts.rowsperstrip rows compressed by opts.compression. The header
+ * text is the same. With the options of fm_tiffopts_init the file is
+ * written by fm_MITIFF_write.
+ *
+ * AUTHOR:
+ * METNO/FOU, 17.10.2026
+ */
+int fm_MITIFF_write_opts(char *outfile, unsigned char *image, 
+    char newhead[], fmio_mihead ginfo, fmio_tiffopts opts) {
+
+    char *where="fm_MITIFF_write_opts";
+    int ret, status;
+    TIFF *out;
+
+    if (opts.compression == FMIO_COMPRESSION_NONE &&
+	    (opts.rowsperstrip < 1 || opts.rowsperstrip >= ginfo.ysize)) {
+	return(fm_MITIFF_write(outfile, image, newhead, ginfo));
+    }
+
+    out = TIFFOpen(outfile, "wc");
+    if (!out) {
+	fmerrmsg(where,"Couldn't open TIFF file for writing...");
+	return(FM_IO_ERR);
+    }
+    ret = TIFFSetField(out, 256, ginfo.xsize);
+    if (ret != 1) fmerrmsg(where,"Error in TIFFSetField");
+    ret = TIFFSetField(out, 257, ginfo.ysize);
+    if (ret != 1) fmerrmsg(where,"Error in TIFFSetField");
+    ret = TIFFSetField(out, 258, 8);
+    if (ret != 1) fmerrmsg(where,"Error in TIFFSetField");
+    ret = TIFFSetField(out, 262, 1);
+    if (ret != 1) fmerrmsg(where,"Error in TIFFSetField");
+    ret = TIFFSetField(out, 270, newhead);
+    if (ret != 1) fmerrmsg(where,"Error in TIFFSetField");
+    ret=TIFFSetField(out, 274, 1);
+    if (ret != 1) fmerrmsg(where,"Error in TIFFSetField");
+    ret=TIFFSetField(out, 277, 1);
+    if (ret != 1) fmerrmsg(where,"Error in TIFFSetField");
+    ret = TIFFSetField(out, 284, 1);
+    if (ret != 1) fmerrmsg(where,"Error in TIFFSetField");
+
+    status = fm_MITIFF_write_strips(out, image, ginfo, opts);
+
+    TIFFClose(out);
+    return(status);
+}
+
+/*
+ * PURPOSE:
+ * As fm_MITIFF_write_imagepal, but the image is written in strips of
+ * opts.rowsperstrip rows compressed by opts.compression. The header
+ * text and colour map are the same. With the options of
+ * fm_tiffopts_init the file is written by fm_MITIFF_write_imagepal.
+ *
+ * AUTHOR:
+ * METNO/FOU, 17.10.2026
+ */
+/*
+ * Open outfile and set the tags of a palette image other than those of
+ * the strips.
+ */
+static TIFF *fm_MITIFF_open_imagepal(char *outfile, char newhead[],
+    fmio_mihead ginfo, unsigned short cmap[3][256]) {
+
+    char *where="MITIFF_write_imagepal_opts";
+    int ret;
+    unsigned short bps=8, pmi=3;
+    TIFF *out;
+
+    out = TIFFOpen(outfile, "wc");
+    if (!out) {
+	fmerrmsg(where,"Couldn't open TIFF file for writing...");
+	return(NULL);
+    }
+  
+    ret = TIFFSetField(out, 256, ginfo.xsize);
+    if (ret != 1) fmerrmsg(where,"Error in TIFFSetField");
+    ret = TIFFSetField(out, 257, ginfo.ysize);
+    if (ret != 1) fmerrmsg(where,"Error in TIFFSetField");
+    ret = TIFFSetField(out, 258, bps);
+    if (ret != 1) fmerrmsg(where,"Error in TIFFSetField");
+    ret = TIFFSetField(out, 262, pmi);
+    if (ret != 1) fmerrmsg(where,"Error in TIFFSetField");
+    ret = TIFFSetField(out, 270, newhead);
+    if (ret != 1) fmerrmsg(where,"Error in TIFFSetField");
+    ret = TIFFSetField(out, 284, 1);
+    if (ret != 1) fmerrmsg(where,"Error in TIFFSetField");
+    ret = TIFFSetField(out, 320, cmap[0], cmap[1], cmap[2]);
+    if (ret != 1) fmerrmsg(where,"Error in TIFFSetField");
+
+    return(out);
+}
+
+int fm_MITIFF_write_imagepal_opts(char *outfile, unsigned char *class, 
+    char newhead[], fmio_mihead ginfo, unsigned short cmap[3][256],
+    fmio_tiffopts opts) {
+    
+    int status;
+    TIFF *out;
+
+    if (opts.compression == FMIO_COMPRESSION_NONE &&
+	    (opts.rowsperstrip < 1 || opts.rowsperstrip >= ginfo.ysize)) {
+	return(fm_MITIFF_write_imagepal(outfile, class, newhead, ginfo,
+		    cmap));
+    }
+
+    out = fm_MITIFF_open_imagepal(outfile, newhead, ginfo, cmap);
+    if (!out) return(FM_IO_ERR);
+
+    status = fm_MITIFF_write_strips(out, class, ginfo, opts);
+
+    TIFFClose(out);
+    return(status);
+}
+
+/*
+ * PURPOSE:
+ * To write a palette image as fm_MITIFF_write_imagepal_opts does, but
+ * band by band, the image is opened by fm_MITIFF_open_imagepal_bands,
+ * the rows are given from the top by fm_MITIFF_write_band in bands of
+ * any number of rows, and the file is completed by
+ * fm_MITIFF_close_bands. Strips are written as soon as all their rows
+ * are given, thus only the rows of one strip are held by b. Strips are
+ * of FMIO_BANDROWSPERSTRIP rows if opts.rowsperstrip is not set.
+ *
+ * RETURN VALUES:
+ * FM_OK, or FM_IO_ERR or FM_MEMALL_ERR on failure. If
+ * fm_MITIFF_open_imagepal_bands fails nothing is left to close, b must
+ * be closed after failures of fm_MITIFF_write_band.
+ *
+ * AUTHOR:
+ * METNO/FOU, 17.10.2026
+ */
+int fm_MITIFF_open_imagepal_bands(char *outfile, char newhead[], 
+    fmio_mihead ginfo, unsigned short cmap[3][256], fmio_tiffopts opts,
+    fmio_tiffband *b) {
+
+    char *where="MITIFF_open_imagepal_bands";
+    TIFF *out;
+
+    b->tif = NULL;
+    b->buf = NULL;
+    b->xsize = ginfo.xsize;
+    b->ysize = ginfo.ysize;
+    b->rowsperstrip = opts.rowsperstrip;
+    if (b->rowsperstrip < 1) b->rowsperstrip = FMIO_BANDROWSPERSTRIP;
+    if (b->rowsperstrip > b->ysize) b->rowsperstrip = b->ysize;
+    b->opts = opts;
+    b->rows = 0;
+    b->nbuf = 0;
+
+    out = fm_MITIFF_open_imagepal(outfile, newhead, ginfo, cmap);
+    if (!out) return(FM_IO_ERR);
+    if (fm_MITIFF_set_strips(out, ginfo, b->rowsperstrip, opts)) {
+	TIFFClose(out);
+	return(FM_IO_ERR);
+    }
+    b->buf = (unsigned char *) malloc((size_t) b->rowsperstrip*b->xsize);
+    if (!b->buf) {
+	fmerrmsg(where,"Could not allocate memory for a strip");
+	TIFFClose(out);
+	return(FM_MEMALL_ERR);
+    }
+    b->tif = (void *) out;
+
+    return(FM_OK);
+}
+
+int fm_MITIFF_write_band(fmio_tiffband *b, unsigned char *image, int nrows) {
+
+    char *where="MITIFF_write_band";
+    TIFF *out = (TIFF *) b->tif;
+    int n, status;
+
+    if (nrows < 0 || b->rows+b->nbuf+nrows > b->ysize) {
+	fmerrmsg(where,"%d rows given after %u of %u rows", nrows,
+		b->rows+b->nbuf, b->ysize);
+	return(FM_IO_ERR);
+    }
+
+    /*
+     * Complete the strip held
+     */
+    if (b->nbuf > 0) {
+	n = b->rowsperstrip-b->nbuf;
+	if (n > nrows) n = nrows;
+	memcpy(b->buf+(size_t) b->nbuf*b->xsize, image, (size_t) n*b->xsize);
+	b->nbuf += n;
+	image += (size_t) n*b->xsize;
+	nrows -= n;
+	if (b->nbuf < b->rowsperstrip && b->rows+b->nbuf < b->ysize) {
+	    return(FM_OK);
+	}
+	status = fm_MITIFF_encode_strips(out, b->buf, b->xsize, b->nbuf,
+		b->rowsperstrip, b->rows/b->rowsperstrip, b->opts);
+	b->rows += b->nbuf;
+	b->nbuf = 0;
+	if (status) return(status);
+    }
+
+    /*
+     * Whole strips are written from image, the rest is held
+     */
+    n = nrows-nrows%b->rowsperstrip;
+    if (b->rows+nrows == b->ysize) n = nrows;
+    if (n > 0) {
+	status = fm_MITIFF_encode_strips(out, image, b->xsize, n,
+		b->rowsperstrip, b->rows/b->rowsperstrip, b->opts);
+	b->rows += n;
+	image += (size_t) n*b->xsize;
+	nrows -= n;
+	if (status) return(status);
+    }
+    if (nrows > 0) {
+	memcpy(b->buf, image, (size_t) nrows*b->xsize);
+	b->nbuf = nrows;
+    }
+
+    return(FM_OK);
+}
+
+int fm_MITIFF_close_bands(fmio_tiffband *b) {
+
+    char *where="MITIFF_close_bands";
+    int status;
+
+    status = FM_OK;
+    if (b->rows != b->ysize) {
+	fmerrmsg(where,"Only %u of %u rows are written", b->rows, b->ysize);
+	status = FM_IO_ERR;
+    }
+    if (b->tif) TIFFClose((TIFF *) b->tif);
+    if (b->buf) free(b->buf);
+    b->tif = NULL;
+    b->buf = NULL;
+
+    return(status);
+}
+
 #endif
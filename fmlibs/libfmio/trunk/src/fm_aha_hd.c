@@ -8,6 +8,7 @@
  * fm_split_chrarr
  * fm_split_intarr
  * fm_fill_aha_hd
+ * fm_fill_aha_hd_fp
  * 
  * PURPOSE:
  * NA
@@ -33,6 +34,9 @@
  * Added filling orbit_no into aha header.
  * ystein Gody, METNO/FOU, 16.10.2006
  * Modified name space for libfmio.
+ * METNO/FOU, 17.10.2026
+ * Added fm_get_aha_hsa_fp and fm_fill_aha_hd_fp, reading the header from
+ * a file already opened.
  *
  * ID:
  * $Id$
@@ -41,16 +45,19 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <fmutil.h>
 #include <fm_aha_hd.h>
 
-/* Read in the header and store as a string array */
-int fm_get_aha_hsa(char *fname,char hsa[FMIO_MAXHDLINES][FMIO_STRMAXCHARS]) {
-    char *where="fm_get_aha_hsa";
-    FILE *f1;
-    int i, j;
+/* 
+ * Read in the header from the current position of an open file up to
+ * and including EOH, and store as a string array. The file is left
+ * positioned after EOH.
+ */
+int fm_get_aha_hsa_fp(FILE *f1,char hsa[FMIO_MAXHDLINES][FMIO_STRMAXCHARS]) {
+    char *where="fm_get_aha_hsa_fp";
+    int i;
     char line[FMIO_STRMAXCHARS]="";
 
-    f1=fopen(fname,"r");
     i=0;
     while ((strncmp(line,"EOH",3)!=0) && !feof(f1) && (i<FMIO_MAXHDLINES)){ 
 	if (fgets(line,FMIO_STRMAXCHARS,f1) == NULL) {
@@ -63,6 +70,21 @@ int fm_get_aha_hsa(char *fname,char hsa[FMIO_MAXHDLINES][FMIO_STRMAXCHARS]) {
     printf(">>i: %d\n",i);
     for (j=0;j<i;j++) printf("%02d %s",j,hsa[j]);
     */
+    return(i);
+}
+
+/* Read in the header and store as a string array */
+int fm_get_aha_hsa(char *fname,char hsa[FMIO_MAXHDLINES][FMIO_STRMAXCHARS]) {
+    char *where="fm_get_aha_hsa";
+    FILE *f1;
+    int i;
+
+    f1=fopen(fname,"r");
+    if (!f1) {
+	fmerrmsg(where,"Could not open %s",fname);
+	return(0);
+    }
+    i=fm_get_aha_hsa_fp(f1,hsa);
     fclose(f1);
     return(i);
 }
@@ -157,18 +179,15 @@ void fm_split_intarr(int intarr[FMIO_MAXNLAY], int n, char buf[FMIO_STRMAXCHARS]
 }
 
 
-int fm_fill_aha_hd(char *fname,ahahd *header) {
+/* Decode the header stored as a string array */
+static void fm_fill_aha_hd_hsa(char hsa[FMIO_MAXHDLINES][FMIO_STRMAXCHARS],
+	int nhsa,ahahd *header) {
 
-    char hsa[FMIO_MAXHDLINES][FMIO_STRMAXCHARS],buf[FMIO_STRMAXCHARS];
-    int i,j,nhsa,pos;
+    char buf[FMIO_STRMAXCHARS];
+    int i,j,pos;
     double dtmp;
     ahahd h;
 
-    if (!(nhsa=fm_get_aha_hsa(fname, hsa))) {
-	fprintf(stderr,"Error: Could not read header from file %s\n",fname);
-	return FMIO_FALSE;
-    }
-
     /* First get number of layers to be ready to split string arrays */
     h.layers=fm_iget_hd_from_hsa(hsa,nhsa,"layers");
 
@@ -235,6 +254,38 @@ int fm_fill_aha_hd(char *fname,ahahd *header) {
     fm_get_hd_from_hsa(hsa,nhsa,"comment",h.comment);
 
     *header=h;
+}
+
+
+int fm_fill_aha_hd(char *fname,ahahd *header) {
+
+    char hsa[FMIO_MAXHDLINES][FMIO_STRMAXCHARS];
+    int nhsa;
+
+    if (!(nhsa=fm_get_aha_hsa(fname, hsa))) {
+	fprintf(stderr,"Error: Could not read header from file %s\n",fname);
+	return FMIO_FALSE;
+    }
+    fm_fill_aha_hd_hsa(hsa,nhsa,header);
+
+    return FMIO_TRUE;
+}
+
+/* 
+ * As fm_fill_aha_hd, but reading the header from the current position of
+ * an open file, which is left positioned after EOH.
+ */
+int fm_fill_aha_hd_fp(FILE *f1,ahahd *header) {
+
+    char hsa[FMIO_MAXHDLINES][FMIO_STRMAXCHARS];
+    int nhsa;
+
+    if (!(nhsa=fm_get_aha_hsa_fp(f1, hsa))) {
+	fprintf(stderr,"Error: Could not read header\n");
+	return FMIO_FALSE;
+    }
+    fm_fill_aha_hd_hsa(hsa,nhsa,header);
+
     return FMIO_TRUE;
 }
 
@@ -24,6 +24,8 @@
  * Added parameter orbit_no in struct ahahd.
  * ystein Gody, METNO/FOU, 16.10.2006
  * Modified name space for libfmio.
+ * METNO/FOU, 17.10.2026
+ * Added fm_fill_aha_hd_fp and fm_get_aha_hsa_fp.
  *
  * ID:
  * $Id$
@@ -104,10 +106,12 @@ typedef struct {
 } ahahd;
 
 int fm_fill_aha_hd(char *fname,ahahd *header);
+int fm_fill_aha_hd_fp(FILE *f1,ahahd *header);
 void fm_split_intarr(int intarr[FMIO_MAXNLAY], int n, char buf[FMIO_STRMAXCHARS]);
 void fm_split_chrarr(char chrarr[FMIO_MAXNLAY], int n, char buf[FMIO_STRMAXCHARS]);
 void fm_split_strarr(char strarr[FMIO_MAXNLAY][FMIO_STRMAXCHARS], int n, char buf[FMIO_STRMAXCHARS]);
 int fm_iget_hd_from_hsa(char hsa[FMIO_MAXHDLINES][FMIO_STRMAXCHARS],int nhsa,char key[FMIO_STRMAXCHARS]);
 int fm_get_hd_from_hsa(char hsa[FMIO_MAXHDLINES][FMIO_STRMAXCHARS],int nhsa,char key[FMIO_STRMAXCHARS],char hd[FMIO_STRMAXCHARS]);
 int fm_get_aha_hsa(char *fname,char hsa[FMIO_MAXHDLINES][FMIO_STRMAXCHARS]);
+int fm_get_aha_hsa_fp(FILE *f1,char hsa[FMIO_MAXHDLINES][FMIO_STRMAXCHARS]);
 
@@ -0,0 +1,185 @@
+/*
+ * NAME:
+ * fm_calplan
+ *
+ * PURPOSE:
+ * To convert packed satellite data to float values using a calibration
+ * plan. The slope of each channel is resolved once per scene, and the
+ * unpacked value of every possible count is tabulated, thus converting a
+ * pixel is a single table lookup instead of a call to fm_byte2float for
+ * each channel of each pixel.
+ *
+ * REQUIREMENTS:
+ * NA
+ *
+ * INPUT:
+ * plan: the calibration plan
+ * chan: index of the channel in the image data
+ * byte2float: a structure containing slope and intercept values for
+ * visible end thermal infrared channels.
+ * keyword: Reflectance or Temperature, as for fm_byte2float
+ *
+ * OUTPUT:
+ * NA
+ *
+ * NOTES:
+ * Tabulated values are computed by the same expression as in
+ * fm_byte2float and are identical to those. Each table holds
+ * FMIO_CALPLANSIZE floats (256 kB). The plan is read only after it is
+ * bound, and may be used by several threads.
+ *
+ * BUGS:
+ * NA
+ *
+ * AUTHOR:
+ * METNO/FOU, 17.10.2026
+ *
+ * MODIFIED:
+ * NA
+ *
+ * ID:
+ * $Id$
+ */
+#include <fmio.h>
+
+/*
+ * NAME:
+ * fm_calplan_init
+ *
+ * PURPOSE:
+ * Initialise an empty plan, no channels are bound.
+ */
+int fm_calplan_init(fmio_calplan *plan) {
+    int i;
+
+    for (i=0;i<FMIO_NCHAN;i++) {
+	plan->gain[i] = 0.;
+	plan->intercept[i] = 0.;
+	plan->lut[i] = NULL;
+    }
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * fm_calplan_bind
+ *
+ * PURPOSE:
+ * Bind channel chan to the slope of byte2float described by keyword and
+ * tabulate the unpacked values.
+ *
+ * RETURN VALUES:
+ * FM_OK on success, FM_SYNTAX_ERR if byte2float is not as expected,
+ * FM_VAROUTOFSCOPE_ERR if chan is not valid, FM_IO_ERR if no slope
+ * matches keyword and FM_MEMALL_ERR on memory trouble.
+ */
+int fm_calplan_bind(fmio_calplan *plan, int chan, fmscale byte2float,
+	char *keyword) {
+
+    char *where="fm_calplan_bind";
+    int i, match;
+    float gain, intercept;
+
+    if (chan < 0 || chan >= FMIO_NCHAN) {
+	fmerrmsg(where,"Channel index %d is not valid", chan);
+	return(FM_VAROUTOFSCOPE_ERR);
+    }
+    if (byte2float.nslopes != 2) {
+	fmerrmsg(where,"Wrong nslopes value within fmscale input");
+	return(FM_SYNTAX_ERR);
+    }
+
+    /*
+     * The last matching slope is used, as in fm_byte2float.
+     */
+    match = 0;
+    for (i=0;i<byte2float.nslopes;i++) {
+	if (strstr(byte2float.slope[i].description,keyword)) {
+	    gain = byte2float.slope[i].gain;
+	    intercept = byte2float.slope[i].intercept;
+	    match = 1;
+	}
+    }
+    if (! match) {
+	fmerrmsg(where,"No slope matching %s for channel %d", keyword, chan);
+	return(FM_IO_ERR);
+    }
+
+    if (! plan->lut[chan]) {
+	plan->lut[chan] = (float *) malloc(FMIO_CALPLANSIZE*sizeof(float));
+	if (! plan->lut[chan]) {
+	    fmerrmsg(where,"Could not allocate lookup table");
+	    return(FM_MEMALL_ERR);
+	}
+    }
+    plan->gain[chan] = gain;
+    plan->intercept[chan] = intercept;
+    for (i=0;i<FMIO_CALPLANSIZE;i++) {
+	plan->lut[chan][i] = intercept+(gain*((unsigned short) i));
+    }
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * fm_img2calplan
+ *
+ * PURPOSE:
+ * Bind all channels of an image according to the AVHRR channel id given
+ * in the header, channels 1, 2 and 3A (6) as Reflectance and 3B, 4 and 5
+ * as Temperature. The plan must have been initialised by
+ * fm_calplan_init.
+ *
+ * RETURN VALUES:
+ * FM_OK on success, FM_VAROUTOFSCOPE_ERR if a channel id is not
+ * recognised, otherwise as fm_calplan_bind.
+ */
+int fm_img2calplan(fmio_img imghead, fmio_calplan *plan) {
+
+    char *where="fm_img2calplan";
+    fmscale byte2float;
+    int i, status;
+
+    if (imghead.z > FMIO_NCHAN) {
+	fmerrmsg(where,"Too many channels (%d)", imghead.z);
+	return(FM_VAROUTOFSCOPE_ERR);
+    }
+    if (fm_img2slopes(imghead, &byte2float)) {
+	fmerrmsg(where,"Could not get slopes");
+	return(FM_MEMALL_ERR);
+    }
+
+    status = FM_OK;
+    for (i=0;i<imghead.z && status == FM_OK;i++) {
+	if (imghead.ch[i] == 1 || imghead.ch[i] == 2 || imghead.ch[i] == 6) {
+	    status = fm_calplan_bind(plan, i, byte2float, "Reflectance");
+	} else if (imghead.ch[i] >= 3 && imghead.ch[i] <= 5) {
+	    status = fm_calplan_bind(plan, i, byte2float, "Temperature");
+	} else {
+	    fmerrmsg(where,"Could not recognise channel id %d", imghead.ch[i]);
+	    status = FM_VAROUTOFSCOPE_ERR;
+	}
+    }
+    free(byte2float.slope);
+
+    return(status);
+}
+
+/*
+ * NAME:
+ * fm_calplan_free
+ *
+ * PURPOSE:
+ * Release the lookup tables, the plan is empty afterwards.
+ */
+int fm_calplan_free(fmio_calplan *plan) {
+    int i;
+
+    for (i=0;i<FMIO_NCHAN;i++) {
+	if (plan->lut[i]) free(plan->lut[i]);
+    }
+
+    return(fm_calplan_init(plan));
+}
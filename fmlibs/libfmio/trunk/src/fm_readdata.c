@@ -27,6 +27,9 @@
  * ystein Gody, METNO/FOU, 16.10.2006: Modified name space for libfmio.
  * ystein Gody, METNO/FOU, 22.06.2007: Typo corrected when calling
  * fm_readMETSATdata.
+ * METNO/FOU, 17.10.2026: HDF5 scenes are read by fm_readMETSATdata_h5.
+ * METNO/FOU, 17.10.2026: Added fm_readdata_window, fm_clipwindow and
+ * fm_ucs2window.
  *
  * ID:
  * $Id$
@@ -38,7 +41,10 @@
 #include <hdf5.h>
 #endif
 
-int fm_readdata(char *filename, fmio_img *h) {
+/*
+ * Read filename into h. If win is not NULL only this window is read.
+ */
+static int fm_readdata_mode(char *filename, fmio_img *h, fmio_window *win) {
 
     int typefile, ret;
     char buf[FMIO_STRMAXCHARS];
@@ -82,15 +88,23 @@ int fm_readdata(char *filename, fmio_img *h) {
 #endif
 
     if (typefile == 1) {
-	if (fm_readMETSATdata(filename, h)) {
+	if (win) {
+	    if (fm_readMETSATdata_window(filename, h, *win)) {
+		return(FM_IO_ERR);
+	    }
+	} else if (fm_readMETSATdata(filename, h)) {
 	    return(FM_IO_ERR);
 	}
     } else if (typefile == 2) {
-	/*
-	if (readMIHDF5data(filename, h)) {
+#ifdef FMIO_HAVE_LIBHDF5
+	if (win) {
+	    if (fm_readMETSATdata_h5_window(filename, h, *win)) {
+		return(FM_IO_ERR);
+	    }
+	} else if (fm_readMETSATdata_h5(filename, h)) {
 	    return(FM_IO_ERR);
 	}
-	*/
+#endif
     }  else if (typefile == -1) {
 	fprintf(stderr,
 		"\n  Could not open file or does not exist, %s \n",filename);
@@ -115,3 +129,100 @@ int fm_readdata(char *filename, fmio_img *h) {
     return(FM_OK);
 }
 
+int fm_readdata(char *filename, fmio_img *h) {
+
+    return(fm_readdata_mode(filename, h, NULL));
+}
+
+/*
+ * NAME:
+ * fm_readdata_window
+ *
+ * PURPOSE:
+ * As fm_readdata, but only the pixels within win are read. The header
+ * of h describes the window, iw, ih and size are those of the window
+ * and Bx, By the UCS position of its upper left pixel. Rows and
+ * columns outside the window are not read from the file, AHA_METSAT
+ * channels are read row by row and HDF5 channels by one hyperslab each.
+ *
+ * NOTES:
+ * The window is clipped to the scene, it is an error if it does not
+ * overlap the scene. The subsatellite track is that of the full scene.
+ */
+int fm_readdata_window(char *filename, fmio_img *h, fmio_window win) {
+
+    return(fm_readdata_mode(filename, h, &win));
+}
+
+/*
+ * NAME:
+ * fm_clipwindow
+ *
+ * PURPOSE:
+ * Clip win to an image of xsize columns and ysize rows.
+ *
+ * RETURN VALUES:
+ * FM_OK, or FM_VAROUTOFSCOPE_ERR if win does not overlap the image.
+ */
+int fm_clipwindow(int xsize, int ysize, fmio_window *win) {
+
+    char *where="fm_clipwindow";
+    int col1, row1;
+
+    col1 = win->col+win->nx;
+    row1 = win->row+win->ny;
+    if (win->col < 0) win->col = 0;
+    if (win->row < 0) win->row = 0;
+    if (col1 > xsize) col1 = xsize;
+    if (row1 > ysize) row1 = ysize;
+    if (win->col >= col1 || win->row >= row1) {
+	fmerrmsg(where,"Window %dx%d at (%d,%d) is outside the %dx%d image",
+		win->nx, win->ny, win->col, win->row, xsize, ysize);
+	return(FM_VAROUTOFSCOPE_ERR);
+    }
+    win->nx = col1-win->col;
+    win->ny = row1-win->row;
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * fm_ucs2window
+ *
+ * PURPOSE:
+ * Find the window of pixels covering the UCS rectangle with corners ul
+ * and lr (in any order) in the image described by ref. Pixels are
+ * located as in fmucs2ind, the window is not clipped to the image.
+ *
+ * RETURN VALUES:
+ * FM_OK, or FM_VAROUTOFSCOPE_ERR if ref has no pixel size.
+ */
+int fm_ucs2window(fmucsref ref, fmucspos ul, fmucspos lr, 
+	fmio_window *win) {
+
+    char *where="fm_ucs2window";
+    int col0, col1, row0, row1, tmp;
+
+    if (ref.Ax <= 0 || ref.Ay <= 0) {
+	fmerrmsg(where,"Pixel size %.3fx%.3f is not valid", ref.Ax, ref.Ay);
+	return(FM_VAROUTOFSCOPE_ERR);
+    }
+    col0 = (int) rint((ul.eastings-ref.Bx)/ref.Ax);
+    col1 = (int) rint((lr.eastings-ref.Bx)/ref.Ax);
+    row0 = (int) rint((ref.By-ul.northings)/ref.Ay);
+    row1 = (int) rint((ref.By-lr.northings)/ref.Ay);
+    if (col1 < col0) {
+	tmp = col0; col0 = col1; col1 = tmp;
+    }
+    if (row1 < row0) {
+	tmp = row0; row0 = row1; row1 = tmp;
+    }
+    win->col = col0;
+    win->row = row0;
+    win->nx = col1-col0+1;
+    win->ny = row1-row0+1;
+
+    return(FM_OK);
+}
+
@@ -6,8 +6,13 @@
  * fm_caldat
  * fm_get_subtrack
  * fm_get_channeldata
+ * fm_open_aha
+ * fm_read_aha_channels
+ * fm_read_aha_subtrack
+ * fm_map_aha
  * fm_cnvtm
  * fm_readdataMETSAT
+ * fm_readMETSATdata_window
  * fm_readheaderMETSAT
  *
  * PURPOSE: 
@@ -52,6 +57,17 @@
  * Modified name space for libfmio.
  * Mari Anne Killie, METNO/FOU, 08.05.2009
  * Added Metop
+ * METNO/FOU, 17.10.2026
+ * fm_readdataMETSAT and fm_readheaderMETSAT open the file once and read
+ * header, channels and subtrack in one sequential pass. Channels are
+ * byte swapped and converted to unsigned in the image buffers.
+ * METNO/FOU, 17.10.2026
+ * Added fm_readMETSATdata_window, fm_read_aha_channels reads a window
+ * of each channel.
+ * METNO/FOU, 17.10.2026
+ * Added fm_map_aha, channels are converted from a read only mapping of
+ * the file into the image buffers, rows outside the window are not
+ * touched.
  *
  * ID:
  * $Id$
@@ -59,6 +75,8 @@
 
 #include <fmio.h>
 #include <fm_aha_hd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #define SIGN2UNSIGN 32768
 
@@ -276,6 +294,229 @@ void fm_get_channeldata(char *filename,ahahd h, int layer, unsigned short *img,
     free(tmpimg);
 }
 
+/*
+ * Open an AHA_METSAT file and read the header. The position of the data
+ * in the file and their size are returned, and the file is left
+ * positioned after the header.
+ */
+static FILE *fm_open_aha(char *filename, ahahd *ha, long *datapos,
+        long *dtsz) {
+
+    char *where="fm_open_aha";
+    int hdsz,dsz;
+    FILE *f1;
+    char buf[FMIO_STRMAXCHARS];
+
+    f1=fopen(filename,"r");
+    if (!f1) {
+        fmerrmsg(where,"Could not open %s",filename);
+        return(NULL);
+    }
+    if (fgets(buf,FMIO_STRMAXCHARS,f1) == NULL ||
+            sscanf(buf,"AHA_METSAT %d %d",&hdsz,&dsz) != 2) {
+        fmerrmsg(where,"%s is not an AHA_METSAT file",filename);
+        fclose(f1);
+        return(NULL);
+    }
+    *datapos=ftell(f1)+hdsz;
+    *dtsz=dsz;
+    if (!(fm_fill_aha_hd_fp(f1,ha))) {
+        fmerrmsg(where,"Could not read header of %s",filename);
+        fclose(f1);
+        return(NULL);
+    }
+
+    return(f1);
+}
+
+/*
+ * Byte swap and convert stored signed values to unsigned in place.
+ */
+static void fm_aha_sign2unsign(unsigned short *img, long imgsize, int doswap) {
+
+    long n;
+    signed short *simg;
+
+    if (doswap) {
+        fm_swap_dmi((void *)img,sizeof(unsigned short),imgsize);
+    }
+    simg=(signed short *) img;
+    for (n=0;n<imgsize;n++) {
+        img[n] = (unsigned short) (simg[n] + SIGN2UNSIGN);
+    }
+}
+
+/*
+ * As fm_aha_sign2unsign, but converting imgsize values from src, which
+ * need not be aligned, into img.
+ */
+static void fm_aha_copy_sign2unsign(const unsigned char *src,
+        unsigned short *img, long imgsize, int doswap) {
+
+    long n;
+    unsigned short uval;
+
+    for (n=0;n<imgsize;n++) {
+        memcpy(&uval,src+2*n,sizeof(unsigned short));
+        if (doswap) {
+            uval = (unsigned short) ((uval >> 8) | (uval << 8));
+        }
+        img[n] = (unsigned short) (((signed short) uval) + SIGN2UNSIGN);
+    }
+}
+
+/*
+ * Order of the channels by their position in the file.
+ */
+static void fm_aha_order(ahahd ha, int ch_lays[], int nch, int order[]) {
+
+    int i,j;
+
+    for (i=0;i<nch;i++) {
+        for (j=i;j>0 && 
+                ha.start_byte[ch_lays[order[j-1]]] > ha.start_byte[ch_lays[i]];
+                j--) {
+            order[j]=order[j-1];
+        }
+        order[j]=i;
+    }
+}
+
+/*
+ * Read the channels of an open AHA_METSAT file in the order they are
+ * stored, window win of layer ch_lays[k] into image[k]. Windows of full
+ * rows are read in one piece, otherwise row by row seeking past the
+ * columns outside the window. Values are byte swapped and converted
+ * from signed to unsigned in place. pos is the current position in the
+ * file, and is updated. If map is not NULL it is the file mapped by
+ * fm_map_aha, and values are converted from it instead of being read,
+ * within the dtsz bytes of data.
+ */
+static int fm_read_aha_channels(FILE *f1, const unsigned char *map,
+        ahahd ha, long datapos, long dtsz, int ch_lays[], int nch,
+        unsigned short *image[], fmio_window win, int doswap, long *pos) {
+
+    char *where="fm_read_aha_channels";
+    int order[FMIO_MAXNLAY],i,k,r,nrows;
+    long start,len,imgsize;
+
+    imgsize=(long) win.nx*win.ny;
+    if (win.nx == ha.xsize) {
+        nrows=1;
+        len=imgsize;
+    } else {
+        nrows=win.ny;
+        len=win.nx;
+    }
+    fm_aha_order(ha,ch_lays,nch,order);
+    for (i=0;i<nch;i++) {
+        k=order[i];
+        start=datapos+ha.start_byte[ch_lays[k]]+
+            ((long) win.row*ha.xsize+win.col)*sizeof(unsigned short);
+        if (map) {
+            if (start < datapos || start+((long) (win.ny-1)*ha.xsize+
+                        win.nx)*sizeof(unsigned short) > datapos+dtsz) {
+                fmerrmsg(where,"Channel %d is not within the data",k+1);
+                return(-1);
+            }
+            for (r=0;r<nrows;r++) {
+                fm_aha_copy_sign2unsign(map+start,image[k]+r*len,len,doswap);
+                start+=(long) ha.xsize*sizeof(unsigned short);
+            }
+            continue;
+        }
+        for (r=0;r<nrows;r++) {
+            if (start != *pos && fseek(f1,start,SEEK_SET)) {
+                fmerrmsg(where,"Could not find channel %d",k+1);
+                return(-1);
+            }
+            *pos=start;
+            if (fread(image[k]+r*len,sizeof(unsigned short),len,f1) != len) {
+                fmerrmsg(where,"Could not read channel %d",k+1);
+                return(-1);
+            }
+            *pos+=len*sizeof(unsigned short);
+            start+=(long) ha.xsize*sizeof(unsigned short);
+        }
+
+        fm_aha_sign2unsign(image[k],imgsize,doswap);
+    }
+
+    return(0);
+}
+
+/*
+ * As fm_get_subtrack, but reading from an open AHA_METSAT file where the
+ * subtrack starts at trackpos. pos is the current position in the file,
+ * and is updated.
+ */
+static int fm_read_aha_subtrack(FILE *f1, long trackpos, fmio_subtrack **st,
+        int doswap, long *pos) {
+
+    char *where="fm_read_aha_subtrack";
+    int numtrack,numread,k;
+
+    if (*st) {
+        free(*st);
+        *st = NULL;
+    }
+
+    if (trackpos != *pos && fseek(f1,trackpos,SEEK_SET)) {
+        fmerrmsg(where,"Could not find sat_track records");
+        return(-1);
+    }
+    *pos=trackpos;
+    if (fread(&numtrack,sizeof(numtrack),1,f1) != 1) {
+        fmerrmsg(where,"Could not read number of sat_track records");
+        return(-1);
+    }
+    if (doswap) { fm_swap_dmi((void *)&numtrack,sizeof(int),1); }
+    *st = (fmio_subtrack *) malloc(numtrack*sizeof(fmio_subtrack));
+    if (*st == NULL) {
+        fmerrmsg(where,"Memory allocation failed");
+        return(-1);
+    }
+    numread = fread(*st,sizeof(fmio_subtrack),numtrack,f1);
+    *pos+=sizeof(numtrack)+numread*sizeof(fmio_subtrack);
+    if (numread != numtrack) {
+        fmerrmsg(where,"%s (%d %d)",
+                "Could not read all sat_track records",
+                numread,numtrack);
+        return(-1);
+    }
+    if (doswap) {
+        for (k=0;k<numtrack;k++) {
+            fm_swap_dmi((void *)&(((*st)[k]).latitude),sizeof(float),1);
+            fm_swap_dmi((void *)&(((*st)[k]).longitude),sizeof(float),1);
+        }
+    }
+
+    return numtrack;
+}
+
+/*
+ * Map the AHA_METSAT file f1 read only into memory, if the data of dtsz
+ * bytes at datapos are within it. NULL is returned if the file can not
+ * be mapped, the size of the mapping is returned in mapsize.
+ */
+static unsigned char *fm_map_aha(FILE *f1, long datapos, long dtsz,
+        size_t *mapsize) {
+
+    struct stat st;
+    void *map;
+
+    if (fstat(fileno(f1),&st) || datapos+dtsz > st.st_size || dtsz <= 0) {
+        return(NULL);
+    }
+    map=mmap(NULL,(size_t) st.st_size,PROT_READ,MAP_PRIVATE,fileno(f1),0);
+    if (map == MAP_FAILED) {
+        return(NULL);
+    }
+    *mapsize=(size_t) st.st_size;
+
+    return((unsigned char *) map);
+}
+
 void fm_cnvtm(int data_first_year,int data_first_dayofyear, double
         data_first_secofday,unsigned short int *dd, unsigned short int *mm,
         unsigned short int *yy, unsigned short int *ho, unsigned short int *mi) {
@@ -293,20 +534,30 @@ void fm_cnvtm(int data_first_year,int data_first_dayofyear, double
     *mi=(unsigned short int)( (data_first_secofday-(double)(*ho)*3600.0)/60);
 }
 
-int fm_readMETSATdata(char *filename, fmio_img *h) {
+/*
+ * Read an AHA_METSAT file into h. If win is not NULL only this window is
+ * read, and the header describes the window.
+ */
+static int fm_readMETSAT(char *filename, fmio_img *h, fmio_window *win) {
 
     char *where="fm_readdataMETSAT",mymsg[255];
     ahahd ha;
     int ch_lays[FMIO_MAXNLAY],i,k,doswap;
     char *pt,buf[FMIO_STRMAXCHARS],chr;
+    long datapos,dtsz,pos;
+    size_t mapsize;
+    unsigned char *map;
+    fmio_window cwin;
+    FILE *f1;
 
 
     /* Read the AHA header info */
-    if (!(fm_fill_aha_hd(filename,&ha))) {
+    if ((f1=fm_open_aha(filename,&ha,&datapos,&dtsz)) == NULL) {
         sprintf(mymsg,"%s %s","Error could not read file",filename);
         fmerrmsg(where,mymsg);
         return(-1);
     }
+    pos=ftell(f1);
 
     doswap = 0;
     if ( (fm_little_end() && ha.little_end == 'T') || /* bigend file, little_end machine */
@@ -362,35 +613,85 @@ int fm_readMETSATdata(char *filename, fmio_img *h) {
     h->size=h->iw*h->ih;
     h->outofimageval = 0; /* Not robust... FIXME */
 
-    h->numtrack=fm_get_subtrack(filename,&(h->track),doswap);
+    cwin.col=cwin.row=0;
+    cwin.nx=ha.xsize;
+    cwin.ny=ha.ysize;
+    if (win) {
+        cwin=*win;
+        if (fm_clipwindow(ha.xsize,ha.ysize,&cwin)) {
+            fmerrmsg(where,"Window is not within %s",filename);
+            fclose(f1);
+            return(-1);
+        }
+        h->Bx+=cwin.col*h->Ax;
+        h->By-=cwin.row*h->Ay;
+        h->iw=cwin.nx;
+        h->ih=cwin.ny;
+        h->size=h->iw*h->ih;
+    }
 
     for (k=0;k<h->z;k++) {
         h->image[k]=(unsigned short *) malloc(h->size*sizeof(unsigned short));
         if (h->image[k] == NULL) {
             fmerrmsg(where,"Allocation error in readdataMETSAT.c");
+            fclose(f1);
             return(-1);
         }
-        fm_get_channeldata(filename,ha,ch_lays[k],h->image[k],doswap);
     }
 
+    /*
+     * Channels and subtrack are read in one pass through the file. The
+     * channels are converted straight from a mapping of the file if it
+     * can be mapped.
+     */
+    map=fm_map_aha(f1,datapos,dtsz,&mapsize);
+    if (fm_read_aha_channels(f1,map,ha,datapos,dtsz,ch_lays,h->z,h->image,
+                cwin,doswap,&pos)) {
+        fmerrmsg(where,"Could not read channels of %s",filename);
+        if (map) munmap(map,mapsize);
+        fclose(f1);
+        return(-1);
+    }
+    if (map) munmap(map,mapsize);
+    h->numtrack=fm_read_aha_subtrack(f1,datapos+dtsz,&(h->track),doswap,&pos);
+
+    fclose(f1);
     return(0);
 }
 
+int fm_readMETSATdata(char *filename, fmio_img *h) {
+
+    return(fm_readMETSAT(filename,h,NULL));
+}
+
+/*
+ * As fm_readMETSATdata, but only window win of the channels is read and
+ * the header of h describes the window (see fm_readdata_window). Rows
+ * outside the window are never read from the file.
+ */
+int fm_readMETSATdata_window(char *filename, fmio_img *h, fmio_window win) {
+
+    return(fm_readMETSAT(filename,h,&win));
+}
+
 int fm_readMETSATheader(char *filename, fmio_img *h) {
 
     char *where="fm_readMETSATheader",mymsg[255];
     ahahd ha;
     int ch_lays[FMIO_MAXNLAY],i,k,doswap;
     char *pt,buf[FMIO_STRMAXCHARS],chr;
+    long datapos,dtsz,pos;
+    FILE *f1;
 
 
     /* Read the AHA header info */
-    if (!(fm_fill_aha_hd(filename,&ha))) {
+    if ((f1=fm_open_aha(filename,&ha,&datapos,&dtsz)) == NULL) {
         sprintf(mymsg,"%s %s",
                 "Error could not read file",filename);
         fmerrmsg(where,mymsg);
         return(-1);
     }
+    pos=ftell(f1);
 
     /*
      * First check if this is a big endian file being used on a little
@@ -447,7 +748,8 @@ int fm_readMETSATheader(char *filename, fmio_img *h) {
     h->ih=(unsigned short int) ha.ysize;
     h->size=h->iw*h->ih;
 
-    h->numtrack=fm_get_subtrack(filename,&(h->track),doswap);
+    h->numtrack=fm_read_aha_subtrack(f1,datapos+dtsz,&(h->track),doswap,&pos);
 
+    fclose(f1);
     return(0);
 }
@@ -15,21 +15,24 @@
 #define PPSCMDATASETS 2
 #define GACDATASETS 4
 
-//Internal functions
-int fm_readH5data(char *filename, fmdataset *d, fmbool headeronly);
-int fm_create_hdf5_string(hid_t *str, size_t size);
-int fm_create_hdf5_vlstring(hid_t *str);
-int fm_extracthow(hid_t grp, fmheader *h);
-int fm_extractwhat(hid_t grp, fmheader *h);
-int fm_extractwhere(hid_t grp, fmheader *h);
-int fm_extractimagedata(hid_t file_id, fmdataset *d);
-int fmget_hdf5_int_att(hid_t grp_id, char *attname, int *outbuf);
-int fmget_hdf5_long_att(hid_t grp_id, char *attname, long *outbuf);
-int fmget_hdf5_ulong_att(hid_t grp_id, char *attname, unsigned long long *outbuf);
-int fmget_hdf5_string_att(hid_t grp_id, char *attname, char *outbuf);
-int fm_extractppsdata(hid_t file_id, fmdataset *d);
-int fm_extractppsregion(hid_t file_id, fmheader *h);
-int fm_extractppsvaltab(hid_t dset_id, fmdatafield *d);
+//Internal functions, static as fm_readHLHDFdata.c has functions of the same names
+static int fm_readH5data(char *filename, fmdataset *d, fmbool headeronly);
+static int fm_create_hdf5_string(hid_t *str, size_t size);
+static int fm_create_hdf5_vlstring(hid_t *str);
+static int fm_extracthow(hid_t grp, fmheader *h);
+static int fm_extractwhat(hid_t grp, fmheader *h);
+static int fm_extractwhere(hid_t grp, fmheader *h);
+static int fm_extractimagedata(hid_t file_id, fmdataset *d, fmbool native);
+static int fmget_hdf5_int_att(hid_t grp_id, char *attname, int *outbuf);
+static int fmget_hdf5_long_att(hid_t grp_id, char *attname, long *outbuf);
+static int fmget_hdf5_ulong_att(hid_t grp_id, char *attname, unsigned long long *outbuf);
+static int fmget_hdf5_string_att(hid_t grp_id, char *attname, char *outbuf);
+static int fm_extractppsdata(hid_t file_id, fmdataset *d);
+static int fm_extractppsregion(hid_t file_id, fmheader *h);
+static int fm_extractppsvaltab(hid_t dset_id, fmdatafield *d);
+static void fm_h5_platform2sa(char *platform, char *sa, size_t size);
+static int fm_h5_readlayer(hid_t loc_id, char *name, int xsize, int ysize,
+        fmdatafield *f);
 
 typedef struct {
     double area_extent[4];
@@ -47,7 +50,13 @@ typedef struct {
 } ppsregion;
 
 
-int fm_readMETSATdata_swath(char *filename, fmdataset *fd) {
+/*
+ * Read filename into fd, layers are held in their storage type in one
+ * contiguous block each if native is set, else as int rows. Only the
+ * header is read if headeronly is set.
+ */
+static int fm_readswath(char *filename, fmdataset *fd, fmbool native,
+        fmbool headeronly) {
 	//Input: File name, struct fd to be filled
 
     char *where="fm_readdataMETSATswath",mymsg[255];
@@ -126,7 +135,7 @@ int fm_readMETSATdata_swath(char *filename, fmdataset *fd) {
 
 
     	//Read actual data content (the channel/image data), variable number of channels/images
-    	if (fm_extractimagedata(file, fd)) {
+    	if (!headeronly && fm_extractimagedata(file, fd, native)) {
     		fmerrmsg(where,"Could not decode image data");
     		return(FM_IO_ERR);
     	}
@@ -134,17 +143,9 @@ int fm_readMETSATdata_swath(char *filename, fmdataset *fd) {
 
     	//Check which satellite/instrument
     	if (strstr(fd->h.sensor_name,"avhrr") || strstr(fd->h.sensor_name,"viirs")) {
-    		if (strstr(fd->h.platform_name,"noaa")) {
-    			char name[6]; strncpy(name,fd->h.platform_name,6);
-    			sprintf(fd->h.platform_name, "NOAA-%s",&(name[4])); //Re-spell name (e.g. NOAA-18)
-    		}
-    		if (strstr(fd->h.platform_name,"npp")) {
-    			sprintf(fd->h.platform_name, "NPP"); //Re-spell name
-    		}
-    		if (strstr(fd->h.platform_name,"metop")) {
-    			char name[7]; strncpy(name,fd->h.platform_name,7);
-    			sprintf(fd->h.platform_name, "MetOp-0%s",&(name[6])); //Re-spell name (e.g. MetOp-01)
-    		}
+    		char name[FMIMAGESTR25];
+    		strcpy(name,fd->h.platform_name);
+    		fm_h5_platform2sa(name,fd->h.platform_name,FMIMAGESTR25); //Re-spell name (e.g. NOAA-18, MetOp-01)
     		fmlogmsg(where,"This is a H5 file containing data from %s: %s",fd->h.platform_name,fd->h.sensor_name);
     	}    else { fmerrmsg(where, "Do not recognize instrument, bailing out!"); return(FM_OTHER_ERR); }
 
@@ -175,7 +176,7 @@ int fm_readMETSATdata_swath(char *filename, fmdataset *fd) {
     	fd->h.layers = 2; //There are two data sets (fracofland and the palette) in this file that we want to read into a datafield struct.
 
 
-    	dataset = H5Dopen(file,"fracofland"); //Open dataset "fracofland"
+    	dataset = headeronly ? -1 : H5Dopen(file,"fracofland"); //Open dataset "fracofland"
     	if(dataset >= 0) { //Physiography file
     		fmlogmsg(where,"Physiography file detected.");
 
@@ -189,48 +190,57 @@ int fm_readMETSATdata_swath(char *filename, fmdataset *fd) {
     			fmerrmsg(where,"Could not allocate the necessary number of layers");
     			return(FM_MEMALL_ERR);
     		}
-    		if (fmalloc_int_2d(&((fd->d)[0].intarray),fd->h.ysize,fd->h.xsize)) {
-    			fmerrmsg(where,"Could not allocate data array");
-    			return(FM_MEMALL_ERR);
-    		}
-//    		if (fmalloc_int_vector(&mydata, (fd->h.xsize*fd->h.ysize))) {
-    		if (fmalloc_uchar_vector(&mydata, (fd->h.xsize*fd->h.ysize))) {
-    			fmerrmsg(where,"Could not allocate data array");
-    			return(FM_MEMALL_ERR);
-    		}
-
-
-    		fd->d[0].dtype = FMINT; //The data type is int
+    		if (native) { //Read fracofland as stored (uint8)
+    			H5Dclose(dataset);
+    			H5Sclose(dataspace);
+    			if (fm_h5_readlayer(file,"fracofland",fd->h.xsize,fd->h.ysize,&((fd->d)[0]))) {
+    				fmerrmsg(where,"Could not read data field");
+    				return(FM_IO_ERR);
+    			}
+    		} else {
+    			if (fmalloc_int_2d(&((fd->d)[0].intarray),fd->h.ysize,fd->h.xsize)) {
+    				fmerrmsg(where,"Could not allocate data array");
+    				return(FM_MEMALL_ERR);
+    			}
+//    			if (fmalloc_int_vector(&mydata, (fd->h.xsize*fd->h.ysize))) {
+    			if (fmalloc_uchar_vector(&mydata, (fd->h.xsize*fd->h.ysize))) {
+    				fmerrmsg(where,"Could not allocate data array");
+    				return(FM_MEMALL_ERR);
+    			}
 
-    		//Read data into temp 1d array mydata
-    		status = H5Dread(dataset, H5T_STD_U8LE, H5S_ALL, H5S_ALL, H5P_DEFAULT,mydata);
-    		if (status < 0) {
-    			fmerrmsg(where,"Could not read data field");
-    			return(FM_IO_ERR);
-    		};
-    		status = H5Dclose(dataset);
-    		if (status < 0) {
-    			fmerrmsg(where,"Could not close dataset in HDF5 file");
-    			return(FM_IO_ERR);
-    		};
-    		status = H5Sclose(dataspace);
-    		if (status < 0) {
-    			fmerrmsg(where,"Could not close field dataspace in HDF5 file");
-    			return(FM_IO_ERR);
-    		};
 
-    		//Transfer data from temporary array to data field in struct
-    		int j,k;
-    		for (j=0;j<fd->h.ysize; j++) {
-    			for (k=0;k<fd->h.xsize; k++) {
-    				(fd->d)[0].intarray[j][k] = +mydata[fmivec(k, j, fd->h.xsize)];
+    			fd->d[0].dtype = FMINT; //The data type is int
+
+    			//Read data into temp 1d array mydata
+    			status = H5Dread(dataset, H5T_STD_U8LE, H5S_ALL, H5S_ALL, H5P_DEFAULT,mydata);
+    			if (status < 0) {
+    				fmerrmsg(where,"Could not read data field");
+    				return(FM_IO_ERR);
+    			};
+    			status = H5Dclose(dataset);
+    			if (status < 0) {
+    				fmerrmsg(where,"Could not close dataset in HDF5 file");
+    				return(FM_IO_ERR);
+    			};
+    			status = H5Sclose(dataspace);
+    			if (status < 0) {
+    				fmerrmsg(where,"Could not close field dataspace in HDF5 file");
+    				return(FM_IO_ERR);
+    			};
+
+    			//Transfer data from temporary array to data field in struct
+    			int j,k;
+    			for (j=0;j<fd->h.ysize; j++) {
+    				for (k=0;k<fd->h.xsize; k++) {
+    					(fd->d)[0].intarray[j][k] = +mydata[fmivec(k, j, fd->h.xsize)];
+    				}
     			}
-    		}
 
-    		//Free the temporary array
-    		if (fmfree_uchar_vector(mydata)) {
-    			fmerrmsg(where,"Could not free mydata");
-    			return(FM_MEMALL_ERR);
+    			//Free the temporary array
+    			if (fmfree_uchar_vector(mydata)) {
+    				fmerrmsg(where,"Could not free mydata");
+    				return(FM_MEMALL_ERR);
+    			}
     		}
 
 
@@ -303,7 +313,544 @@ int fm_readMETSATdata_swath(char *filename, fmdataset *fd) {
     return(0);
 }
 
-int fm_readH5data(char *filename, fmdataset *d, fmbool headeronly) {
+int fm_readMETSATdata_swath(char *filename, fmdataset *fd) {
+
+    return(fm_readswath(filename, fd, FMFALSE, FMFALSE));
+}
+
+/*
+ * NAME:
+ * fm_readMETSATdata_swath_native
+ *
+ * PURPOSE:
+ * As fm_readMETSATdata_swath, but each layer, including latitude and
+ * longitude, is held in its storage type (e.g. unsigned short, short or
+ * unsigned char for fracofland) in one contiguous block with row views,
+ * instead of being widened to int rows. The dtype of each layer tells
+ * which array holds it, layers are released by free_fmdatafield.
+ */
+int fm_readMETSATdata_swath_native(char *filename, fmdataset *fd) {
+
+    return(fm_readswath(filename, fd, FMTRUE, FMFALSE));
+}
+
+/*
+ * NAME:
+ * fm_readheaderMETSATswath
+ *
+ * PURPOSE:
+ * As fm_readMETSATdata_swath, but only the header is read, no layers are
+ * allocated. Of the datasets only the first latitude and longitude values
+ * are read (see fm_extractwhere), which makes it cheap to inspect scenes.
+ */
+int fm_readheaderMETSATswath(char *filename, fmdataset *fd) {
+
+    return(fm_readswath(filename, fd, FMFALSE, FMTRUE));
+}
+
+static int fmget_hdf5_float_att(hid_t grp_id, char *attname, float *outbuf) {
+    char *where="fmget_hdf5_float_att";
+    hid_t attr_id;
+    herr_t status;
+
+    attr_id = H5Aopen_name(grp_id,attname);
+    if (attr_id < 0) {
+        fmerrmsg(where,"Could not open attribute %s", attname);
+        return(FM_IO_ERR);
+    }
+    status = H5Aread(attr_id,H5T_NATIVE_FLOAT,outbuf);
+    H5Aclose(attr_id);
+    if (status < 0) {
+        fmerrmsg(where,"Could not read attribute %s", attname);
+        return(FM_IO_ERR);
+    }
+    return(FM_OK);
+}
+
+/*
+ * Respell HDF5 platform names (e.g. noaa18) as in AHA_METSAT (NOAA-18).
+ */
+static void fm_h5_platform2sa(char *platform, char *sa, size_t size) {
+
+    if (strstr(platform,"noaa") && strlen(platform) > 4) {
+        snprintf(sa,size,"NOAA-%s",&(platform[4]));
+    } else if (strstr(platform,"npp")) {
+        snprintf(sa,size,"NPP");
+    } else if (strstr(platform,"metop") && strlen(platform) > 6) {
+        snprintf(sa,size,"MetOp-0%s",&(platform[6]));
+    } else {
+        snprintf(sa,size,"%s",platform);
+    }
+}
+
+/*
+ * Position of an AVHRR channel given its description (e.g. "AVHRR ch3b")
+ * in fmio_img, -1 if not an AVHRR channel.
+ */
+static int fm_h5_channelpos(char *description) {
+    char *pt;
+    int k;
+
+    pt = strstr(description,"ch");
+    if (!pt || !isdigit(pt[2])) return(-1);
+    k = pt[2]-'0';
+    if (k == 3 && pt[3] == 'b') k = 3;
+    else if (k == 3 && pt[3] == 'a') k = 6;
+    if (k < 1 || k > FMIO_MAXCHANNELS) return(-1);
+
+    return(k-1);
+}
+
+/*
+ * Read window win of dataset data of an image group, which holds ysize
+ * rows of xsize values, into image by one hyperslab read. offset is set
+ * to the value added to convert signed data to unsigned. If image is
+ * NULL the dataset is only checked and offset set.
+ */
+static int fm_h5_readchannel(hid_t grp_id, int xsize, int ysize,
+        fmio_window win, unsigned short *image, int *offset) {
+    char *where="fm_h5_readchannel";
+    hid_t dataset, dtype, filespace, memspace, memtype;
+    hsize_t dims[2], start[2], count[2];
+    herr_t status;
+    int i;
+
+    dataset = H5Dopen(grp_id,"data");
+    if (dataset < 0) {
+        fmerrmsg(where,"Could not open dataset data");
+        return(FM_IO_ERR);
+    }
+    dtype = H5Dget_type(dataset);
+    filespace = H5Dget_space(dataset);
+    if (dtype < 0 || filespace < 0) {
+        fmerrmsg(where,"Could not get type or dataspace of dataset data");
+        H5Dclose(dataset);
+        return(FM_IO_ERR);
+    }
+    if (H5Tget_class(dtype) != H5T_INTEGER || H5Tget_size(dtype) > 2 ||
+            H5Sget_simple_extent_ndims(filespace) != 2) {
+        fmerrmsg(where,"Dataset data is not a 2D array of 8 or 16 bit integers");
+        H5Tclose(dtype); H5Sclose(filespace); H5Dclose(dataset);
+        return(FM_IO_ERR);
+    }
+    H5Sget_simple_extent_dims(filespace,dims,NULL);
+    if (dims[0] != ysize || dims[1] != xsize) {
+        fmerrmsg(where,"Dataset data is %dx%d, expected %dx%d",
+                (int) dims[1], (int) dims[0], xsize, ysize);
+        H5Tclose(dtype); H5Sclose(filespace); H5Dclose(dataset);
+        return(FM_IO_ERR);
+    }
+
+    if (H5Tget_sign(dtype) == H5T_SGN_2) {
+        memtype = H5T_NATIVE_SHORT;
+        *offset = 32768;
+    } else {
+        memtype = H5T_NATIVE_USHORT;
+        *offset = 0;
+    }
+    H5Tclose(dtype);
+    if (!image) {
+        H5Sclose(filespace);
+        H5Dclose(dataset);
+        return(FM_OK);
+    }
+
+    start[0] = win.row;
+    start[1] = win.col;
+    count[0] = win.ny;
+    count[1] = win.nx;
+    memspace = H5Screate_simple(2,count,NULL);
+    status = H5Sselect_hyperslab(filespace,H5S_SELECT_SET,start,NULL,count,NULL);
+    if (memspace < 0 || status < 0) {
+        fmerrmsg(where,"Could not select hyperslab");
+        H5Sclose(filespace); H5Dclose(dataset);
+        return(FM_IO_ERR);
+    }
+    status = H5Dread(dataset,memtype,memspace,filespace,H5P_DEFAULT,image);
+    H5Sclose(memspace);
+    H5Sclose(filespace);
+    H5Dclose(dataset);
+    if (status < 0) {
+        fmerrmsg(where,"Could not read dataset data");
+        return(FM_IO_ERR);
+    }
+
+    if (*offset) {
+        for (i=0;i<win.nx*win.ny;i++) {
+            image[i] = (unsigned short) (((short *) image)[i]+32768);
+        }
+    }
+
+    return(FM_OK);
+}
+
+/*
+ * Read dataset name at loc_id, holding ysize rows of xsize values, into
+ * layer f by one read in the storage type of the dataset. Integers of up
+ * to 16 bits keep their size (signed bytes become short), larger integers
+ * are read as int and floating point as float or double.
+ */
+static int fm_h5_readlayer(hid_t loc_id, char *name, int xsize, int ysize,
+        fmdatafield *f) {
+    char *where="fm_h5_readlayer";
+    hid_t dataset, dtype, filespace, memtype;
+    hsize_t dims[2];
+    H5T_class_t tclass;
+    fmdatatype fmtype;
+    size_t tsize;
+    fmbool issigned;
+    herr_t status;
+    void *block;
+
+    dataset = H5Dopen(loc_id,name);
+    if (dataset < 0) {
+        fmerrmsg(where,"Could not open dataset %s", name);
+        return(FM_IO_ERR);
+    }
+    dtype = H5Dget_type(dataset);
+    filespace = H5Dget_space(dataset);
+    if (dtype < 0 || filespace < 0) {
+        fmerrmsg(where,"Could not get type or dataspace of dataset %s", name);
+        H5Dclose(dataset);
+        return(FM_IO_ERR);
+    }
+    tclass = H5Tget_class(dtype);
+    tsize = H5Tget_size(dtype);
+    issigned = (tclass == H5T_INTEGER && H5Tget_sign(dtype) == H5T_SGN_2);
+    H5Tclose(dtype);
+    if (H5Sget_simple_extent_ndims(filespace) != 2 ||
+            H5Sget_simple_extent_dims(filespace,dims,NULL) < 0 ||
+            dims[0] != ysize || dims[1] != xsize) {
+        fmerrmsg(where,"Dataset %s is not %dx%d", name, xsize, ysize);
+        H5Sclose(filespace); H5Dclose(dataset);
+        return(FM_IO_ERR);
+    }
+    H5Sclose(filespace);
+
+    if (tclass == H5T_INTEGER && tsize == 1 && !issigned) {
+        memtype = H5T_NATIVE_UCHAR;
+        fmtype = FMUCHAR;
+    } else if (tclass == H5T_INTEGER && tsize <= 2 && issigned) {
+        memtype = H5T_NATIVE_SHORT;
+        fmtype = FMSHORT;
+    } else if (tclass == H5T_INTEGER && tsize == 2) {
+        memtype = H5T_NATIVE_USHORT;
+        fmtype = FMUSHORT;
+    } else if (tclass == H5T_INTEGER) {
+        memtype = H5T_NATIVE_INT;
+        fmtype = FMINT;
+    } else if (tclass == H5T_FLOAT && tsize <= 4) {
+        memtype = H5T_NATIVE_FLOAT;
+        fmtype = FMFLOAT;
+    } else if (tclass == H5T_FLOAT) {
+        memtype = H5T_NATIVE_DOUBLE;
+        fmtype = FMDOUBLE;
+    } else {
+        fmerrmsg(where,"Dataset %s is not of a numerical type", name);
+        H5Dclose(dataset);
+        return(FM_IO_ERR);
+    }
+
+    block = malloc((size_t) xsize*ysize*H5Tget_size(memtype));
+    if (!block) {
+        fmerrmsg(where,"Could not allocate dataset %s", name);
+        H5Dclose(dataset);
+        return(FM_MEMALL_ERR);
+    }
+    status = H5Dread(dataset,memtype,H5S_ALL,H5S_ALL,H5P_DEFAULT,block);
+    H5Dclose(dataset);
+    if (status < 0) {
+        fmerrmsg(where,"Could not read dataset %s", name);
+        free(block);
+        return(FM_IO_ERR);
+    }
+    if (fmdatafield_setblock(f,fmtype,block,ysize,xsize)) {
+        free(block);
+        return(FM_MEMALL_ERR);
+    }
+
+    return(FM_OK);
+}
+
+/*
+ * Set calibration gain and intercept of a kind of channels, or check that
+ * it matches the calibration set by an earlier channel of the same kind.
+ */
+static int fm_h5_setcal(float *g, float *i, fmbool *isset, float gain,
+        float intercept) {
+
+    if (*isset) {
+        return((*g == gain && *i == intercept) ? FM_OK : FM_IO_ERR);
+    }
+    *g = gain;
+    *i = intercept;
+    *isset = FMTRUE;
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * fm_readMETSATdata_h5
+ * fm_readMETSATdata_h5_window
+ * fm_readMETSATheader_h5
+ *
+ * PURPOSE:
+ * To read AVHRR scenes delivered as HDF5 (groups how, what, where and
+ * image1..imageN as read by fm_readMETSATdata_swath) into the fmio_img
+ * structure used for AHA_METSAT files, so that these scenes can be
+ * processed without being converted to AHA_METSAT first.
+ *
+ * REQUIREMENTS:
+ * NA
+ *
+ * INPUT:
+ * filename - HDF5 file to read
+ *
+ * OUTPUT:
+ * h - header and channels, channels are allocated and released by
+ *     fm_clear_fmio_img
+ *
+ * NOTES:
+ * Each channel is read by one hyperslab read typed as unsigned short
+ * directly into its image buffer, signed data are read as short and
+ * shifted to unsigned like AHA_METSAT channels. Channels are stored in
+ * the same positions as AHA_METSAT channels (ch3b third, ch3a sixth),
+ * z covers the last channel found, scenes where a channel before it is
+ * missing are rejected, thus image[0..z-1] are all read.
+ * Only window win is read if it is not NULL, see fm_readdata_window.
+ * If headeronly is set channels are not read and image is NULL.
+ * fmio_img holds one calibration for reflectances and one for
+ * temperatures, scenes where channels of the same kind are packed
+ * differently are rejected. Layers that are not AVHRR channels are
+ * skipped.
+ *
+ * BUGS:
+ * NA
+ *
+ * AUTHOR:
+ * METNO/FOU, 17.10.2026
+ *
+ * MODIFIED:
+ * METNO/FOU, 17.10.2026: Reads a window of the channels if win is given.
+ * METNO/FOU, 17.10.2026: Added headeronly.
+ * METNO/FOU, 17.10.2026: Scenes missing a channel before the last one
+ * are rejected.
+ */
+static int fm_readh5img(char *filename, fmio_img *h, fmio_window *win,
+        fmbool headeronly) {
+    char *where="fm_readMETSATdata_h5";
+    char groupname[FMSTRING32], description[FMSTRING128];
+    char quantity[FMSTRING128];
+    hid_t file, grp, grp2;
+    fmheader fh;
+    unsigned short *image[FMIO_NCHAN];
+    fmbool visset = FMFALSE, irset = FMFALSE, isvis;
+    float gain, intercept;
+    int i, k, nch = 0, nodata, offset, status;
+    unsigned int found = 0;
+    fmio_window cwin;
+
+    H5Eset_auto(NULL,NULL);
+
+    file = H5Fopen(filename, H5F_ACC_RDONLY, H5P_DEFAULT);
+    if (file < 0) {
+        fmerrmsg(where,"Could not open %s", filename);
+        return(FM_IO_ERR);
+    }
+    memset(&fh,0,sizeof(fmheader));
+    for (k=0;k<FMIO_NCHAN;k++) {
+        image[k] = NULL;
+    }
+
+    /*
+     * Header information
+     */
+    status = FM_OK;
+    grp = H5Gopen(file,"how");
+    if (grp < 0 || fm_extracthow(grp, &fh)) status = FM_IO_ERR;
+    if (grp >= 0) H5Gclose(grp);
+    if (status == FM_OK) {
+        grp = H5Gopen(file,"what");
+        if (grp < 0 || fm_extractwhat(grp, &fh)) status = FM_IO_ERR;
+        if (grp >= 0) H5Gclose(grp);
+    }
+    if (status == FM_OK) {
+        grp = H5Gopen(file,"where");
+        if (grp < 0 || fm_extractwhere(grp, &fh)) status = FM_IO_ERR;
+        if (grp >= 0) H5Gclose(grp);
+    }
+    if (status != FM_OK) {
+        fmerrmsg(where,"Could not decode groups how, what and where in %s",
+                filename);
+        H5Fclose(file);
+        return(FM_IO_ERR);
+    }
+    if (!strstr(fh.sensor_name,"avhrr")) {
+        fmerrmsg(where,"%s does not contain AVHRR data", filename);
+        H5Fclose(file);
+        return(FM_IO_ERR);
+    }
+    if (fh.xsize <= 0 || fh.ysize <= 0 ||
+            fh.xsize*fh.ysize > FMIO_MAXIMGSIZE) {
+        fmerrmsg(where,"Image size %dx%d is not supported",
+                fh.xsize, fh.ysize);
+        H5Fclose(file);
+        return(FM_IO_ERR);
+    }
+
+    fm_h5_platform2sa(fh.platform_name, h->sa, sizeof(h->sa));
+    h->orbit_no = fh.orbit_no;
+    h->yy = (unsigned short) fh.valid_time.fm_year;
+    h->mm = (unsigned short) fh.valid_time.fm_mon;
+    h->dd = (unsigned short) fh.valid_time.fm_mday;
+    h->ho = (unsigned short) fh.valid_time.fm_hour;
+    h->mi = (unsigned short) fh.valid_time.fm_min;
+    h->Ax = (float) fh.ucs.Ax;
+    h->Ay = (float) fh.ucs.Ay;
+    h->Bx = (float) fh.ucs.Bx;
+    h->By = (float) fh.ucs.By;
+    cwin.col = cwin.row = 0;
+    cwin.nx = fh.xsize;
+    cwin.ny = fh.ysize;
+    if (win) {
+        cwin = *win;
+        if (fm_clipwindow(fh.xsize, fh.ysize, &cwin)) {
+            fmerrmsg(where,"Window is not within %s", filename);
+            H5Fclose(file);
+            return(FM_VAROUTOFSCOPE_ERR);
+        }
+        h->Bx += cwin.col*h->Ax;
+        h->By -= cwin.row*h->Ay;
+    }
+    h->iw = cwin.nx;
+    h->ih = cwin.ny;
+    h->size = h->iw*h->ih;
+    h->outofimageval = 0;
+    h->numtrack = 0;
+    h->track = NULL;
+    h->z = 0;
+
+    /*
+     * Channels
+     */
+    for (i=0;i<fh.layers && status == FM_OK;i++) {
+        sprintf(groupname,"image%d",i+1);
+        grp = H5Gopen(file,groupname);
+        if (grp < 0) {
+            fmerrmsg(where,"Could not find group %s", groupname);
+            status = FM_IO_ERR;
+            break;
+        }
+        if (fmget_hdf5_string_att(grp,"description",description) ||
+                (k = fm_h5_channelpos(description)) < 0) {
+            fmlogmsg(where,"Skipping %s, not an AVHRR channel", groupname);
+            H5Gclose(grp);
+            continue;
+        }
+        if (found & (1 << k)) {
+            fmerrmsg(where,"Channel %s is stored twice", description);
+            status = FM_IO_ERR;
+        }
+        grp2 = H5Gopen(grp,"what");
+        if (status == FM_OK && (grp2 < 0 ||
+                fmget_hdf5_string_att(grp2,"quantity",quantity) ||
+                fmget_hdf5_float_att(grp2,"gain",&gain) ||
+                fmget_hdf5_float_att(grp2,"offset",&intercept) ||
+                fmget_hdf5_int_att(grp2,"nodata",&nodata))) {
+            fmerrmsg(where,"Could not decode group what in %s", groupname);
+            status = FM_IO_ERR;
+        }
+        if (grp2 >= 0) H5Gclose(grp2);
+        if (status == FM_OK && !headeronly) {
+            image[k] = malloc(h->size*sizeof(unsigned short));
+            if (!image[k]) {
+                fmerrmsg(where,"Could not allocate channel %s", description);
+                status = FM_MEMALL_ERR;
+            }
+        }
+        if (status == FM_OK &&
+                fm_h5_readchannel(grp,fh.xsize,fh.ysize,cwin,image[k],
+                    &offset)) {
+            fmerrmsg(where,"Could not read channel %s", description);
+            status = FM_IO_ERR;
+        }
+        H5Gclose(grp);
+        if (status != FM_OK) break;
+
+        /*
+         * Values are unsigned in fmio_img, the intercept is moved
+         * accordingly
+         */
+        intercept -= gain*(float) offset;
+        isvis = (strstr(quantity,"REFL") != NULL);
+        if ((isvis && fm_h5_setcal(&(h->rga),&(h->ria),&visset,gain,intercept))
+                || (!isvis && fm_h5_setcal(&(h->rgt),&(h->rit),&irset,gain,intercept))) {
+            fmerrmsg(where,
+                    "Channel %s is not packed as other %s channels",
+                    description, isvis ? "reflectance" : "temperature");
+            status = FM_IO_ERR;
+            break;
+        }
+        if (nch == 0) h->outofimageval = (unsigned short) (nodata+offset);
+        found |= (1 << k);
+        nch++;
+        if (k >= h->z) h->z = k+1;
+    }
+
+    H5Fclose(file);
+
+    if (status == FM_OK && nch == 0) {
+        fmerrmsg(where,"No AVHRR channels found in %s", filename);
+        status = FM_IO_ERR;
+    }
+    if (status == FM_OK && found != (1U << h->z)-1) {
+        for (k=0;found & (1 << k);k++);
+        fmerrmsg(where,"Channel %d is missing in %s", k+1, filename);
+        status = FM_IO_ERR;
+    }
+    if (status != FM_OK) {
+        for (k=0;k<FMIO_NCHAN;k++) {
+            if (image[k]) free(image[k]);
+        }
+        h->z = 0;
+        return(status);
+    }
+    for (k=0;k<FMIO_NCHAN;k++) {
+        h->image[k] = image[k];
+        h->ch[k] = (k < h->z) ? k+1 : 0;
+    }
+    fmlogmsg(where,"%s %d AVHRR channels of %s from %s",
+            headeronly ? "Found" : "Read", nch, h->sa, filename);
+
+    return(FM_OK);
+}
+
+int fm_readMETSATdata_h5(char *filename, fmio_img *h) {
+
+    return(fm_readh5img(filename, h, NULL, FMFALSE));
+}
+
+/*
+ * As fm_readMETSATdata_h5, but only window win of the channels is read
+ * and the header of h describes the window (see fm_readdata_window).
+ */
+int fm_readMETSATdata_h5_window(char *filename, fmio_img *h,
+        fmio_window win) {
+
+    return(fm_readh5img(filename, h, &win, FMFALSE));
+}
+
+/*
+ * As fm_readMETSATdata_h5, but only the header is read, the channels
+ * found are listed but not read.
+ */
+int fm_readMETSATheader_h5(char *filename, fmio_img *h) {
+
+    return(fm_readh5img(filename, h, NULL, FMTRUE));
+}
+
+static int fm_readH5data(char *filename, fmdataset *d, fmbool headeronly) {
 
 
 	char *where="fm_readHLHDFdata";
@@ -465,7 +1012,7 @@ int fm_readH5data(char *filename, fmdataset *d, fmbool headeronly) {
      * If data are requested, we also read the data content
      */
     if (isavhrr || isangles) {
-        if (fm_extractimagedata(file, d)) {
+        if (fm_extractimagedata(file, d, FMFALSE)) {
             fmerrmsg(where,"Could not decode image data");
             return(FM_IO_ERR);
         }
@@ -495,7 +1042,7 @@ int fm_readH5data(char *filename, fmdataset *d, fmbool headeronly) {
     return(FM_OK);
 }
 
-int fm_create_hdf5_string(hid_t *str, size_t size) {
+static int fm_create_hdf5_string(hid_t *str, size_t size) {
     char *where="fm_create_hdf5_string";
     herr_t status;
 
@@ -518,7 +1065,7 @@ int fm_create_hdf5_string(hid_t *str, size_t size) {
     return(FM_OK);
 }
 
-int fm_create_hdf5_vlstring(hid_t *str) {
+static int fm_create_hdf5_vlstring(hid_t *str) {
     char *where="fm_create_hdf5_vlstring";
     herr_t status;
 
@@ -542,19 +1089,70 @@ int fm_create_hdf5_vlstring(hid_t *str) {
 }
 
 /*
- * Missing geographical positions so far, but that is part of the data and
- * not the header...
+ * Read the first value of dataset data in group name of the where group,
+ * unpacked by gain and offset of its what subgroup. Only this value is
+ * read, by a hyperslab selection.
  */
-int fm_extractwhere(hid_t grp, fmheader *h) {
-    char *where="fm_extractwhere";
-    hid_t attr_id, grp_id, grp_id2;
-    hid_t str;
+static int fm_h5_wheresample(hid_t grp, char *name, double *value) {
+    char *where="fm_h5_wheresample";
+    hid_t grp_id, grp_id2, dataset, filespace, memspace;
+    hsize_t start[2] = {0,0}, count[2] = {1,1};
     herr_t status;
     float gain, offset;
-    hid_t dataspace, dataset;
-    H5A_info_t ainfo;
-    hsize_t dsd_d[2];
-    int i, j, k, *mydata;
+    int val;
+
+    grp_id = H5Gopen(grp,name);
+    if (grp_id < 0) {
+        fmerrmsg(where,"Could not find group %s in group WHERE", name);
+        return(FM_IO_ERR);
+    }
+    grp_id2 = H5Gopen(grp_id,"what");
+    if (grp_id2 < 0 || fmget_hdf5_float_att(grp_id2,"gain",&gain) ||
+            fmget_hdf5_float_att(grp_id2,"offset",&offset)) {
+        fmerrmsg(where,"Could not decode group what in %s", name);
+        if (grp_id2 >= 0) H5Gclose(grp_id2);
+        H5Gclose(grp_id);
+        return(FM_IO_ERR);
+    }
+    H5Gclose(grp_id2);
+
+    dataset = H5Dopen(grp_id,"data");
+    if (dataset < 0) {
+        fmerrmsg(where,"Could not open dataset data in %s", name);
+        H5Gclose(grp_id);
+        return(FM_IO_ERR);
+    }
+    filespace = H5Dget_space(dataset);
+    memspace = H5Screate_simple(2,count,NULL);
+    status = -1;
+    if (filespace >= 0 && memspace >= 0 &&
+            H5Sget_simple_extent_ndims(filespace) == 2 &&
+            H5Sselect_hyperslab(filespace,H5S_SELECT_SET,start,NULL,count,NULL) >= 0) {
+        status = H5Dread(dataset,H5T_NATIVE_INT,memspace,filespace,
+                H5P_DEFAULT,&val);
+    }
+    if (memspace >= 0) H5Sclose(memspace);
+    if (filespace >= 0) H5Sclose(filespace);
+    H5Dclose(dataset);
+    H5Gclose(grp_id);
+    if (status < 0) {
+        fmerrmsg(where,"Could not read first value of %s", name);
+        return(FM_IO_ERR);
+    }
+    *value = val*gain + offset;
+
+    return(FM_OK);
+}
+
+/*
+ * Decodes size and nominal grid size. The upper left corner is taken
+ * from the first latitude and longitude values, the remaining positions
+ * are part of the data (see fm_extractimagedata) and not the header.
+ */
+static int fm_extractwhere(hid_t grp, fmheader *h) {
+    char *where="fm_extractwhere";
+    hid_t attr_id;
+    herr_t status;
 
 
     /*
@@ -631,242 +1229,26 @@ int fm_extractwhere(hid_t grp, fmheader *h) {
 
 
     /*
-     * Decode position of upper left corner
-     * Read latitude
+     * Decode position of upper left corner, only the first value of the
+     * latitude and longitude datasets is read
      */
-    grp_id = H5Gopen(grp,"lat");
-    if (grp_id < 0) {fmlogmsg(where,"Could not find group LAT in group WHERE."); return(FM_IO_ERR);}
-
-    grp_id2 = H5Gopen(grp_id,"what");
-    if (grp_id2 < 0) {
-    	fmerrmsg(where,
-    			"Could not find group what in LAT");
-    	return(FM_IO_ERR);
-    };
-
-    attr_id = H5Aopen_name(grp_id2,"gain");
-    if (attr_id < 0) {
-    	fmerrmsg(where,"Could not open attribute gain.");
-    	return(FM_IO_ERR);
-    }
-    status = H5Aread(attr_id,H5T_NATIVE_FLOAT,&gain);
-    if (status < 0) {
-    	fmerrmsg(where,"Could not read attribute gain.");
-    	return(FM_IO_ERR);
-    }
-    status = H5Aclose(attr_id);
-    if (status < 0) {
-    	fmerrmsg(where,
-    			"Could not close attribute gain, bailing out!");
-    	return(FM_IO_ERR);
-    }
-    attr_id = H5Aopen_name(grp_id2,"offset");
-    if (attr_id < 0) {
-    	fmerrmsg(where,"Could not open attribute offset.");
-    	return(FM_IO_ERR);
-    }
-    status = H5Aread(attr_id,H5T_NATIVE_FLOAT,&offset);
-    if (status < 0) {
-    	fmerrmsg(where,"Could not read attribute offset.");
-    	return(FM_IO_ERR);
-    }
-    status = H5Aclose(attr_id);
-    if (status < 0) {
-    	fmerrmsg(where,
-    			"Could not close attribute offset, bailing out!");
-    	return(FM_IO_ERR);
-    }
-
-    status = H5Gclose(grp_id2);
-    if (status < 0) {
-    	fmerrmsg(where,"Could not close group WHAT");
-    	return(FM_IO_ERR);
-    };
-
-    /*
-     * Read the actual data
-     */
-    dsd_d[0] = h->xsize;
-    dsd_d[1] = h->ysize;
-    dataspace = H5Screate_simple(2, dsd_d, NULL);
-    if (dataspace < 0) {
-    	fmerrmsg(where,"Could not create dataspace");
-    	return(FM_IO_ERR);
-    };
-
-    dataset = H5Dopen(grp_id,"data");
-
-    if (dataset < 0) {
-    	fmerrmsg(where,"Could not open dataset data [%d]", dataset);
-    	return(FM_IO_ERR);
-    };
-
-    if (fmalloc_int_vector(&mydata, (h->xsize*h->ysize))) {
-    	fmerrmsg(where,"Could not allocate data array");
-    	return(FM_MEMALL_ERR);
+    if (fm_h5_wheresample(grp,"lat",&(h->ucs.Bx))) {
+        fmerrmsg(where,"Could not read upper left corner of LAT in WHERE.");
+        return(FM_IO_ERR);
     }
-
-
-    status = H5Dread(dataset,
-    		H5T_NATIVE_INT, H5S_ALL, H5S_ALL, H5P_DEFAULT,
-    		mydata);
-
-
-    if (status < 0) {
-    	fmerrmsg(where,"Could not read data field");
-    	return(FM_IO_ERR);
-    };
-
-    status = H5Dclose(dataset);
-    if (status < 0) {
-    	fmerrmsg(where,"Could not close dataset in HDF5 file");
-    	return(FM_IO_ERR);
-    };
-    status = H5Sclose(dataspace);
-    if (status < 0) {
-    	fmerrmsg(where,"Could not close field dataspace in HDF5 file");
-    	return(FM_IO_ERR);
-    };
-
-    h->ucs.Bx = mydata[0]*gain + offset;
-    float delta1 = (mydata[1]*gain + offset) - (mydata[0]*gain + offset);
-
-
-    if (fmfree_int_vector(mydata)) {
-    	fmerrmsg(where,"Could not free mydata");
-    	return(FM_MEMALL_ERR);
+    if (fm_h5_wheresample(grp,"lon",&(h->ucs.By))) {
+        fmerrmsg(where,"Could not read upper left corner of LON in WHERE.");
+        return(FM_IO_ERR);
     }
 
-
-    status = H5Gclose(grp_id);
-    if (status < 0) {
-    	fmerrmsg(where,"Could not close group LAT");
-    	return(FM_IO_ERR);
-    };
-
-    /*
-     * Read longitude
-     */
-
-    grp_id = H5Gopen(grp,"lon");
-        if (grp_id < 0) {fmlogmsg(where,"Could not find group LAT in group WHERE."); return(FM_IO_ERR);}
-
-        grp_id2 = H5Gopen(grp_id,"what");
-        if (grp_id2 < 0) {
-        	fmerrmsg(where,
-        	    			"Could not find group what in LON");
-        	    	return(FM_IO_ERR);
-        };
-
-        attr_id = H5Aopen_name(grp_id2,"gain");
-        if (attr_id < 0) {
-        	fmerrmsg(where,"Could not open attribute gain.");
-        	return(FM_IO_ERR);
-        }
-        status = H5Aread(attr_id,H5T_NATIVE_FLOAT,&gain);
-        if (status < 0) {
-        	fmerrmsg(where,"Could not read attribute gain.");
-        	return(FM_IO_ERR);
-        }
-        status = H5Aclose(attr_id);
-        if (status < 0) {
-        	fmerrmsg(where,
-        			"Could not close attribute gain, bailing out!");
-        	return(FM_IO_ERR);
-        }
-        attr_id = H5Aopen_name(grp_id2,"offset");
-        if (attr_id < 0) {
-        	fmerrmsg(where,"Could not open attribute offset.");
-        	return(FM_IO_ERR);
-        }
-        status = H5Aread(attr_id,H5T_NATIVE_FLOAT,&offset);
-        if (status < 0) {
-        	fmerrmsg(where,"Could not read attribute offset.");
-        	return(FM_IO_ERR);
-        }
-        status = H5Aclose(attr_id);
-        if (status < 0) {
-        	fmerrmsg(where,
-        			"Could not close attribute offset, bailing out!");
-        	return(FM_IO_ERR);
-        }
-
-        status = H5Gclose(grp_id2);
-        if (status < 0) {
-        	fmerrmsg(where,"Could not close group WHAT");
-        	return(FM_IO_ERR);
-        };
-
-        /*
-         * Read the actual data
-         */
-        dsd_d[0] = h->xsize;
-        dsd_d[1] = h->ysize;
-        dataspace = H5Screate_simple(2, dsd_d, NULL);
-        if (dataspace < 0) {
-        	fmerrmsg(where,"Could not create dataspace");
-        	return(FM_IO_ERR);
-        };
-
-        dataset = H5Dopen(grp_id,"data");
-
-        if (dataset < 0) {
-        	fmerrmsg(where,"Could not open dataset data [%d]", dataset);
-        	return(FM_IO_ERR);
-        };
-
-        if (fmalloc_int_vector(&mydata, (h->xsize*h->ysize))) {
-        	fmerrmsg(where,"Could not allocate data array");
-        	return(FM_MEMALL_ERR);
-        }
-
-        status = H5Dread(dataset,
-        		H5T_NATIVE_INT, H5S_ALL, H5S_ALL, H5P_DEFAULT,
-        		mydata);
-
-        if (status < 0) {
-        	fmerrmsg(where,"Could not read data field");
-        	return(FM_IO_ERR);
-        };
-
-        status = H5Dclose(dataset);
-        if (status < 0) {
-        	fmerrmsg(where,"Could not close dataset in HDF5 file");
-        	return(FM_IO_ERR);
-        };
-        status = H5Sclose(dataspace);
-        if (status < 0) {
-        	fmerrmsg(where,"Could not close field dataspace in HDF5 file");
-        	return(FM_IO_ERR);
-        };
-
-        h->ucs.By = mydata[0]*gain + offset;
-        float delta2 = mydata[1]-mydata[0];
-
-        if (fmfree_int_vector(mydata)) {
-        	fmerrmsg(where,"Could not free mydata");
-        	return(FM_MEMALL_ERR);
-        }
-
-
-        status = H5Gclose(grp_id);
-        if (status < 0) {
-        	fmerrmsg(where,"Could not close group LAT");
-        	return(FM_IO_ERR);
-        };
-
-
-        h->ucs.Ax = h->nominal_grid_resolution_x*0.001;
-        h->ucs.Ay = h->nominal_grid_resolution_y*0.001;
-
-//
-//        fprintf(stdout,"UCS: %f %f %f %f %f %f\n",h->ucs.Ax,h->ucs.Ay,h->ucs.Bx,h->ucs.By,delta1,delta2);
+    h->ucs.Ax = h->nominal_grid_resolution_x*0.001;
+    h->ucs.Ay = h->nominal_grid_resolution_y*0.001;
 
 
     return(FM_OK);
 }
 
-int fm_extractwhat(hid_t grp, fmheader *h) {
+static int fm_extractwhat(hid_t grp, fmheader *h) {
     char *where="fm_extractwhat";
     hid_t attr_id;
     hid_t str;
@@ -956,7 +1338,7 @@ int fm_extractwhat(hid_t grp, fmheader *h) {
 /*
  * Missing yaw, pitch and roll mainly...
  */
-int fm_extracthow(hid_t grp, fmheader *h) {
+static int fm_extracthow(hid_t grp, fmheader *h) {
     char *where="fm_extracthow";
     hid_t attr_id;
     hid_t str;
@@ -1122,8 +1504,12 @@ int fm_extracthow(hid_t grp, fmheader *h) {
  * group. In order to fit the data model, these data are added as extra
  * layers to the layers read from the image groups. To support this, the
  * layers value is increased by two and extra layers are allocated.
+ *
+ * If native is set, each layer (including positions) is read by a single
+ * read in its storage type into one contiguous block with row views (see
+ * fm_h5_readlayer), else into int rows.
  */
-int (fm_extractimagedata(hid_t file_id, fmdataset *d)) {
+static int (fm_extractimagedata(hid_t file_id, fmdataset *d, fmbool native)) {
     char *where="fm_extract_imagedata";
     char *groupname,*quantity, *product;
     char *wheresets[2]={"lat","lon"};
@@ -1291,6 +1677,18 @@ int (fm_extractimagedata(hid_t file_id, fmdataset *d)) {
         /*
          * Read the actual data
          */
+        if (native) {
+            if (fm_h5_readlayer(grp_id,"data",d->h.xsize,d->h.ysize,&((d->d)[i]))) {
+                fmerrmsg(where,"Could not read data of %s", groupname);
+                return(FM_IO_ERR);
+            }
+            status = H5Gclose(grp_id);
+            if (status < 0) {
+                fmerrmsg(where,"Could not close group %s", groupname);
+                return(FM_IO_ERR);
+            };
+            continue;
+        }
         dsd_d[0] = d->h.xsize;
         dsd_d[1] = d->h.ysize;
         dataspace = H5Screate_simple(2, dsd_d, NULL);
@@ -1385,41 +1783,48 @@ int (fm_extractimagedata(hid_t file_id, fmdataset *d)) {
             "Could not find group %s", wheresets[i]);
             return(FM_IO_ERR);
         };
-        dataset = H5Dopen(grp_id2,"data");
-        if (dataset < 0) {
-            fmerrmsg(where,"Could not open dataset data [%d]", dataset);
-            return(FM_IO_ERR);
-        };
-        (d->d)[d->h.layers-2+i].dtype = FMINT;
-        if (fmalloc_int_2d(&(((d->d)[d->h.layers-2+i]).intarray),d->h.ysize,d->h.xsize)) {
-            fmerrmsg(where,"Could not allocate data array");
-            return(FM_MEMALL_ERR);
-        }
-        if (fmalloc_int_vector(&mydata, (d->h.xsize*d->h.ysize))) {
-            fmerrmsg(where,"Could not allocate data array");
-            return(FM_MEMALL_ERR);
-        }
-        status = H5Dread(dataset,
-                H5T_NATIVE_INT, H5S_ALL, H5S_ALL, H5P_DEFAULT,
-                mydata);
-        if (status < 0) {
-            fmerrmsg(where,"Could not read data field");
-            return(FM_IO_ERR);
-        };
-        status = H5Dclose(dataset);
-        if (status < 0) {
-            fmerrmsg(where,"Could not close dataset in HDF5 file");
-            return(FM_IO_ERR);
-        };
+        if (native) {
+            if (fm_h5_readlayer(grp_id2,"data",d->h.xsize,d->h.ysize,&((d->d)[d->h.layers-2+i]))) {
+                fmerrmsg(where,"Could not read data of %s", wheresets[i]);
+                return(FM_IO_ERR);
+            }
+        } else {
+            dataset = H5Dopen(grp_id2,"data");
+            if (dataset < 0) {
+                fmerrmsg(where,"Could not open dataset data [%d]", dataset);
+                return(FM_IO_ERR);
+            };
+            (d->d)[d->h.layers-2+i].dtype = FMINT;
+            if (fmalloc_int_2d(&(((d->d)[d->h.layers-2+i]).intarray),d->h.ysize,d->h.xsize)) {
+                fmerrmsg(where,"Could not allocate data array");
+                return(FM_MEMALL_ERR);
+            }
+            if (fmalloc_int_vector(&mydata, (d->h.xsize*d->h.ysize))) {
+                fmerrmsg(where,"Could not allocate data array");
+                return(FM_MEMALL_ERR);
+            }
+            status = H5Dread(dataset,
+                    H5T_NATIVE_INT, H5S_ALL, H5S_ALL, H5P_DEFAULT,
+                    mydata);
+            if (status < 0) {
+                fmerrmsg(where,"Could not read data field");
+                return(FM_IO_ERR);
+            };
+            status = H5Dclose(dataset);
+            if (status < 0) {
+                fmerrmsg(where,"Could not close dataset in HDF5 file");
+                return(FM_IO_ERR);
+            };
 
-        for (j=0;j<d->h.ysize; j++) {
-            for (k=0;k<d->h.xsize; k++) {
-                ((d->d)[d->h.layers-2+i]).intarray[j][k] = mydata[fmivec(k, j, d->h.xsize)];
+            for (j=0;j<d->h.ysize; j++) {
+                for (k=0;k<d->h.xsize; k++) {
+                    ((d->d)[d->h.layers-2+i]).intarray[j][k] = mydata[fmivec(k, j, d->h.xsize)];
+                }
+            }
+            if (fmfree_int_vector(mydata)) {
+                fmerrmsg(where,"Could not free mydata");
+                return(FM_MEMALL_ERR);
             }
-        }
-        if (fmfree_int_vector(mydata)) {
-            fmerrmsg(where,"Could not free mydata");
-            return(FM_MEMALL_ERR);
         }
         grp_id3 = H5Gopen(grp_id2,"what");
         if (grp_id3 < 0) {
@@ -1535,7 +1940,7 @@ int (fm_extractimagedata(hid_t file_id, fmdataset *d)) {
     return(FM_OK);
 }
 
-int fmget_hdf5_int_att(hid_t grp_id, char *attname, int *outbuf) {
+static int fmget_hdf5_int_att(hid_t grp_id, char *attname, int *outbuf) {
     char *where="fmget_hdf5_int_att";
     hid_t attr_id, attr_type;
     H5A_info_t ainfo;
@@ -1569,7 +1974,7 @@ int fmget_hdf5_int_att(hid_t grp_id, char *attname, int *outbuf) {
     return(FM_OK);
 }
 
-int fmget_hdf5_long_att(hid_t grp_id, char *attname, long *outbuf) {
+static int fmget_hdf5_long_att(hid_t grp_id, char *attname, long *outbuf) {
     char *where="fmget_hdf5_long_att";
     hid_t attr_id, attr_type;
     H5A_info_t ainfo;
@@ -1603,7 +2008,7 @@ int fmget_hdf5_long_att(hid_t grp_id, char *attname, long *outbuf) {
     return(FM_OK);
 }
 
-int fmget_hdf5_ulong_att(hid_t grp_id, char *attname, unsigned long long *outbuf) {
+static int fmget_hdf5_ulong_att(hid_t grp_id, char *attname, unsigned long long *outbuf) {
     char *where="fmget_hdf5_ulong_att";
     hid_t attr_id, attr_type;
     H5A_info_t ainfo;
@@ -1638,7 +2043,7 @@ int fmget_hdf5_ulong_att(hid_t grp_id, char *attname, unsigned long long *outbuf
     return(FM_OK);
 }
 
-int fmget_hdf5_string_att(hid_t grp_id, char *attname, char *outbuf) {
+static int fmget_hdf5_string_att(hid_t grp_id, char *attname, char *outbuf) {
 	char *where="fmget_hdf5_string_att";
     hid_t attr_id;
     hid_t str;
@@ -1693,7 +2098,7 @@ int fmget_hdf5_string_att(hid_t grp_id, char *attname, char *outbuf) {
  * description of map projection, date etc and must be handled with
  * care... Øystein Godøy, METNO/FOU, 2011-12-16
  */
-int fm_extractppsdata(hid_t file_id, fmdataset *d) {
+static int fm_extractppsdata(hid_t file_id, fmdataset *d) {
     char *where="fm_extractppsdata";
     char *groupname,*quantity, *product;
     char *datasets[5]={"cloudtype","cloudmask","phase_flag","quality_flag","test_flag"};
@@ -1880,7 +2285,7 @@ int fm_extractppsdata(hid_t file_id, fmdataset *d) {
  * quality_flag and test_flag. This should work as it adapts to the size
  * of strings in file.
  */
-int fm_extractppsvaltab(hid_t dset_id, fmdatafield *d) {
+static int fm_extractppsvaltab(hid_t dset_id, fmdatafield *d) {
     char *where="fm_extractppsvaltab";
     hid_t dataset, datatype, arraytype;
     hid_t attr_id, arrayid, dataspaceid;
@@ -1962,7 +2367,7 @@ int fm_extractppsvaltab(hid_t dset_id, fmdatafield *d) {
     return(FM_OK);
 }
 
-int fm_extractppsregion(hid_t file_id, fmheader *h) {
+static int fm_extractppsregion(hid_t file_id, fmheader *h) {
     char *where="fm_extractppsregion";
     hid_t str64, str128, dataset, datatype, arraytype;
     hid_t arrayid;
@@ -25,7 +25,8 @@
  * Øystein Godøy, METNO/FOU, 2011-11-10 
  *
  * MODIFIED:
- * NA
+ * METNO/FOU, 17.10.2026: AHA_METSAT files are read through fmio_img and
+ * HDF5 files by fm_readHLHDFdata.
  *
  * ID:
  * $Id$
@@ -37,6 +38,82 @@
 #include <hdf5.h>
 #endif
 
+/*
+ * Transfer header and, unless headeronly, channels of an AHA_METSAT scene
+ * read into img to d. Channels become packed unsigned short layers.
+ */
+static int fm_img2fmdataset(fmio_img *img, fmdataset *d, fmbool headeronly) {
+
+    char *where="fm_img2fmdataset";
+    int i, j;
+    fmbool isvis;
+
+    snprintf(d->h.platform_name,FMIMAGESTR25,"%s",img->sa);
+    sprintf(d->h.sensor_name,"avhrr");
+    snprintf(d->h.area_description,FMIMAGESTR25,"%s",img->area);
+    d->h.orbit_no = img->orbit_no;
+    d->h.map_projected = FMTRUE;
+    d->h.ucs_positioned = FMTRUE;
+    d->h.xsize = img->iw;
+    d->h.ysize = img->ih;
+    d->h.nominal_grid_resolution_x = img->Ax*1000.;
+    d->h.nominal_grid_resolution_y = img->Ay*1000.;
+    fm_img2fmtime(*img, &(d->h.valid_time));
+    fm_img2fmucsref(*img, &(d->h.ucs));
+    d->h.layers = img->z;
+
+    if (img->numtrack > 0) {
+	d->h.subtrack.gpos = malloc(img->numtrack*sizeof(fmgeopos));
+	if (!d->h.subtrack.gpos) {
+	    fmerrmsg(where,"Could not allocate subsatellite track");
+	    return(FM_MEMALL_ERR);
+	}
+	for (i=0;i<img->numtrack;i++) {
+	    d->h.subtrack.gpos[i].lat = img->track[i].latitude;
+	    d->h.subtrack.gpos[i].lon = img->track[i].longitude;
+	}
+	d->h.subtrack.npoints = img->numtrack;
+	d->h.subtrack_added = FMTRUE;
+    }
+
+    if (headeronly) return(FM_OK);
+
+    if (allocate_fmdatafield(&(d->d),d->h.layers)) {
+	fmerrmsg(where,"Could not allocate the necessary number of layers");
+	return(FM_MEMALL_ERR);
+    }
+    for (i=0;i<d->h.layers;i++) {
+	/* positions of ch1, ch2 and ch3a, see fm_readMETSATdata */
+	isvis = (i == 0 || i == 1 || i == 5);
+	sprintf(d->d[i].description,"AVHRR ch%d",img->ch[i]);
+	sprintf(d->d[i].unit,"%s", isvis ?
+		"bidirectional reflectivity as percentage" :
+		"brightness temperature in Kelvin");
+	d->d[i].dtype = FMUSHORT;
+	d->d[i].missingdatavalue = img->outofimageval;
+	d->d[i].nodatavalue = img->outofimageval;
+	d->d[i].packed = FMTRUE;
+	d->d[i].scalefactor.nslopes = 1;
+	d->d[i].scalefactor.slope = malloc(sizeof(fmslope));
+	if (!d->d[i].scalefactor.slope) {
+	    fmerrmsg(where,"Could not allocate scalefactor for layer %d", i);
+	    return(FM_MEMALL_ERR);
+	}
+	d->d[i].scalefactor.slope[0].gain = isvis ? img->rga : img->rgt;
+	d->d[i].scalefactor.slope[0].intercept = isvis ? img->ria : img->rit;
+	if (fmalloc_ushort_2d(&(d->d[i].ushortarray),img->ih,img->iw)) {
+	    fmerrmsg(where,"Could not allocate data array");
+	    return(FM_MEMALL_ERR);
+	}
+	for (j=0;j<img->ih;j++) {
+	    memcpy(d->d[i].ushortarray[j],&(img->image[i][j*img->iw]),
+		    img->iw*sizeof(unsigned short));
+	}
+    }
+
+    return(FM_OK);
+}
+
 int fm_readfmdataset(char *filename, fmdataset *d, fmbool headeronly) {
 
     int typefile, ret;
@@ -45,7 +122,7 @@ int fm_readfmdataset(char *filename, fmdataset *d, fmbool headeronly) {
     htri_t this_is_hdf5;
 #endif
     FILE *fpi;
-    int i, valpix;
+    fmio_img img;
 
     ret = 0;
     typefile = 0;
@@ -81,14 +158,25 @@ int fm_readfmdataset(char *filename, fmdataset *d, fmbool headeronly) {
 #endif
 
     if (typefile == 1) {
-        return(FM_IO_ERR); /* while testing */
-	if (fm_readMETSATdata(filename, d)) {
+	fm_init_fmio_img(&img);
+	if (headeronly) {
+	    ret = fm_readheader(filename, &img);
+	} else {
+	    ret = fm_readMETSATdata(filename, &img);
+	}
+	if (ret == FM_OK) {
+	    ret = fm_img2fmdataset(&img, d, headeronly);
+	}
+	fm_clear_fmio_img(&img);
+	if (ret) {
 	    return(FM_IO_ERR);
 	}
     } else if (typefile == 2) {
-	if (fm_readCMSAFdata(filename, d, headeronly)) {
+#ifdef FMIO_HAVE_LIBHDF5
+	if (fm_readHLHDFdata(filename, d, headeronly)) {
 	    return(FM_IO_ERR);
 	}
+#endif
     }  else if (typefile == -1) {
 	fprintf(stderr,
 		"\n  Could not open file or does not exist, %s \n",filename);
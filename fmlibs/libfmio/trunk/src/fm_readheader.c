@@ -25,6 +25,7 @@
  *
  * MODIFIED:
  * ystein Gody, METNO/FOU, 16.10.2006: Modified name space for libfmio.
+ * METNO/FOU, 17.10.2026: Reads headers of HDF5 files.
  *
  * ID:
  * $Id$
@@ -80,9 +81,9 @@ int fm_readheader(char *filename, fmio_img *h) {
 	    return(FM_IO_ERR);
 	}
     } else if (typefile == 2) {
-	/*
-	ret = readMIHDF5header(filename, h);
-	*/
+	if (fm_readMETSATheader_h5(filename, h)) {
+	    return(FM_IO_ERR);
+	}
     } else if (typefile == -1) {
 	fprintf(stderr,"\n\tERROR! File %s does not exist.\n",filename);
 	return(FM_IO_ERR);
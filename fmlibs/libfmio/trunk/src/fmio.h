@@ -7,6 +7,7 @@
  *
  * REQUIREMENTS:
  * o libfmutil
+ * o zlib and pthreads, for compressed MITIFF files
  *
  * INPUT:
  * NA
@@ -28,6 +29,19 @@
  * Thomas Lavergne, METNO/FOU, ??: Something??
  * �ystein God�y, METNO/FOU, 2011-01-21: Added orbit_no to fmio_mihead and
  * added fm_img2mihead.
+ * METNO/FOU, 17.10.2026: Added fmio_calplan.
+ * METNO/FOU, 17.10.2026: Added fmio_tiffopts, fm_MITIFF_write_opts and
+ * fm_MITIFF_write_imagepal_opts.
+ * METNO/FOU, 17.10.2026: Added fm_readMETSATdata_h5.
+ * METNO/FOU, 17.10.2026: Added fm_readMETSATdata_swath_native.
+ * METNO/FOU, 17.10.2026: Added fm_readheaderMETSATswath.
+ * METNO/FOU, 17.10.2026: Added fmio_window and the window readers
+ * fm_readdata_window, fm_readMETSATdata_window,
+ * fm_readMETSATdata_h5_window and fm_MITIFF_read_window.
+ * METNO/FOU, 17.10.2026: Added fmio_tiffband and the band writer
+ * fm_MITIFF_open_imagepal_bands, fm_MITIFF_write_band and
+ * fm_MITIFF_close_bands.
+ * METNO/FOU, 17.10.2026: Added fm_readMETSATheader_h5.
  *
  * ID:
  * $Id$
@@ -57,6 +71,23 @@
 #define FMIO_MAXIMGSIZE 25000000
 #define FMIO_TIFFHEAD 1024
 #define FMIO_FIELDS 19
+#define FMIO_CALPLANSIZE 65536 /* entries in calibration lookup tables */
+#define FMIO_COMPRESSION_NONE 1 /* values of TIFF tag 259 */
+#define FMIO_COMPRESSION_LZW 5
+#define FMIO_COMPRESSION_DEFLATE 8
+#define FMIO_MAXTHREADS 64
+#define FMIO_BANDROWSPERSTRIP 64 /* strip rows of images written by bands */
+
+/*
+ * Rectangle of pixels within a scene, column and row of the upper left
+ * pixel and the number of columns (nx) and rows (ny).
+ */
+typedef struct fmio_window_ {
+    int col;
+    int row;
+    int nx;
+    int ny;
+} fmio_window;
 
 typedef struct fmio_subtrack_ {
     float latitude;
@@ -130,9 +161,55 @@ typedef struct fmio_mihead_pal_ {
     unsigned short cmap[3][256];
 } fmio_mihead_pal;
 
+/*
+ * Calibration plan, the slope of each channel is resolved once and
+ * unpacked values for all unsigned short counts are tabulated, thus
+ * lut[channel][count] gives the value of a pixel. Channels not bound
+ * have lut NULL.
+ */
+typedef struct fmio_calplan_ {
+    float gain[FMIO_NCHAN];
+    float intercept[FMIO_NCHAN];
+    float *lut[FMIO_NCHAN];
+} fmio_calplan;
+
+/*
+ * Options of the MITIFF writers. Images are written in strips of
+ * rowsperstrip rows, a single strip if 0, compressed by one of the
+ * FMIO_COMPRESSION_* methods, with horizontal differencing before
+ * compression if predictor is set. Deflate strips are compressed by
+ * nthreads threads.
+ */
+typedef struct fmio_tiffopts_ {
+    int rowsperstrip;
+    int compression;
+    fmbool predictor;
+    int nthreads;
+} fmio_tiffopts;
+
+/*
+ * MITIFF image being written band by band, see
+ * fm_MITIFF_open_imagepal_bands. rows rows are written, and the next
+ * nbuf rows are held in buf until their strip is complete.
+ */
+typedef struct fmio_tiffband_ {
+    void *tif; /* TIFF being written */
+    unsigned int xsize;
+    unsigned int ysize;
+    int rowsperstrip;
+    fmio_tiffopts opts;
+    unsigned int rows;
+    int nbuf;
+    unsigned char *buf;
+} fmio_tiffband;
+
+void fm_tiffopts_init(fmio_tiffopts *opts);
+int fm_tiffopts_compression(char *name);
 #ifdef FMIO_HAVE_LIBTIFF
 int fm_MITIFF_read(char *infile, unsigned char *image[], 
     fmio_mihead *ginfo); 
+int fm_MITIFF_read_window(char *infile, unsigned char *image[], 
+	fmio_mihead *ginfo, fmio_window win);
 int fm_MITIFF_read_imagepal(char *infile, unsigned char *image[], 
     fmio_mihead *ginfo, fmio_mihead_pal *palinfo); 
 int fm_MITIFF_write(char *outfile, unsigned char *image, char newhead[], 
@@ -141,6 +218,16 @@ int fm_MITIFF_write_rgb(char *outfile, unsigned char *image[], char newhead[],
     fmio_mihead ginfo); 
 int fm_MITIFF_write_imagepal(char *outfile, unsigned char *class, 
     char newhead[], fmio_mihead ginfo, unsigned short cmap[3][256]); 
+int fm_MITIFF_write_opts(char *outfile, unsigned char *image, 
+    char newhead[], fmio_mihead ginfo, fmio_tiffopts opts); 
+int fm_MITIFF_write_imagepal_opts(char *outfile, unsigned char *class, 
+    char newhead[], fmio_mihead ginfo, unsigned short cmap[3][256],
+    fmio_tiffopts opts); 
+int fm_MITIFF_open_imagepal_bands(char *outfile, char newhead[], 
+	fmio_mihead ginfo, unsigned short cmap[3][256], fmio_tiffopts opts,
+	fmio_tiffband *b);
+int fm_MITIFF_write_band(fmio_tiffband *b, unsigned char *image, int nrows);
+int fm_MITIFF_close_bands(fmio_tiffband *b);
 int fm_MITIFF_write_multi(char *outfile, unsigned char *image[], 
     char newhead[], fmio_mihead ginfo);
 int fm_MITIFF_fillhead(char *asciifield, char *tag, fmio_mihead *ginfo); 
@@ -157,14 +244,30 @@ int fm_init_fmio_img(fmio_img *h);
 int fm_clear_fmio_img(fmio_img *h);
 int fm_readheader(char *filename, fmio_img *h); 
 int fm_readheaderMETSAT(char *filename, fmio_img *h); 
-//int fm_readheaderMETSATswath(char *filename, fmdataset *fd);
+int fm_readheaderMETSATswath(char *filename, fmdataset *fd);
 int fm_readdata(char *satfile, fmio_img *h);
+int fm_readdata_window(char *satfile, fmio_img *h, fmio_window win);
+int fm_clipwindow(int xsize, int ysize, fmio_window *win);
+int fm_ucs2window(fmucsref ref, fmucspos ul, fmucspos lr, fmio_window *win);
 int fm_readdataMETSAT(char *satfile, fmio_img *h);
+int fm_readMETSATdata(char *satfile, fmio_img *h);
+int fm_readMETSATdata_window(char *satfile, fmio_img *h, fmio_window win);
 int fm_readMETSATdata_swath(char *satfile, fmdataset *fd);
+int fm_readMETSATdata_swath_native(char *satfile, fmdataset *fd);
+#ifdef FMIO_HAVE_LIBHDF5
+int fm_readMETSATdata_h5(char *satfile, fmio_img *h);
+int fm_readMETSATdata_h5_window(char *satfile, fmio_img *h, fmio_window win);
+int fm_readMETSATheader_h5(char *satfile, fmio_img *h);
+#endif
 int fm_img2slopes(fmio_img imghead, fmscale *newcal);
 int fm_img2fmtime(fmio_img imghead, fmtime *newdate);
 int fm_img2fmucsref(fmio_img imghead, fmucsref *refucs);
 float fm_byte2float(unsigned short value, fmscale byte2float, char *keyword);
+int fm_calplan_init(fmio_calplan *plan);
+int fm_calplan_bind(fmio_calplan *plan, int chan, fmscale byte2float,
+    char *keyword);
+int fm_img2calplan(fmio_img imghead, fmio_calplan *plan);
+int fm_calplan_free(fmio_calplan *plan);
 int fm_img2mihead(fmio_img orgimg, fmio_mihead *newhead); 
 int fm_readfmdataset(char *filename, fmdataset *d, fmbool headeronly); 
 
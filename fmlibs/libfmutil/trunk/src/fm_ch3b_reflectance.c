@@ -10,6 +10,9 @@
  * 	o fm_rad2temp
  * 	o fm_findsollum
  * 	o fm_ch3b_identsat
+ * 	o fm_ch3b_findsat
+ * 	o fm_ch3b_open
+ * 	o fm_ch3brefl_scene
  *
  * REQUIREMENTS:
  * NA
@@ -39,6 +42,8 @@
  * 'solrad' values for NOAA-19 and all values for MetOP-02.
  * Mari Anne Killie, METNO/FOU, 13.02.2013: MetOP-01 added,
  * temporarily borrowing values from MetOP-02.
+ * METNO/FOU, 17.10.2026: Added fm_ch3b_open and fm_ch3brefl_scene to
+ * identify the satellite once for a scene.
  *
  * ID:
  * $Id$
@@ -51,6 +56,8 @@
 #include <string.h>
 #include <fmutil.h> 
 
+static void fm_ch3b_setscene(fm_ch3b_scene *scene, int doy);
+
 /*
  * NAME:
 
@@ -88,6 +95,8 @@
  * implementation within libfmutil.
  * Mari Anne Killie, METNO/FOU, 22.10.2007: Adjustments so that the TOA
  * solar radiance depends on the instrument response function.
+ * METNO/FOU, 17.10.2026: The satellite is identified once, computation
+ * moved to fm_ch3brefl_scene.
  *
  * ID:
  * $Id$
@@ -95,36 +104,12 @@
 
 float fm_ch3brefl(float bt3b, float bt4, float solang, char *satname,int doy) {
 
-    float ch3brefl, ch3bthermrad;
-    float lumch3b, lumsolar;
-
-    /*
-     * The measured radiance in CH3B
-     */
-    lumch3b= fm_temp2rad(bt3b,satname); 
+    fm_ch3b_scene scene;
 
-    /*
-     * The "real" thermal radiance from CH3B, assuming the same temperature
-     * as in CH4
-     */
-    ch3bthermrad = fm_temp2rad(bt4,satname); 
-
-    /*
-     * Get the solar radiance
-     */
-    lumsolar = fm_findsollum(solang,satname,doy);
-
-    /*
-     * Estimate the reflectivity
-     */
-    ch3brefl = (lumch3b - ch3bthermrad)/(lumsolar - ch3bthermrad);
-
-    /*
-     * Convert value to %, the same as for the values in CH1 and CH2!
-     */
-    ch3brefl *= 100.; 
+    scene.sat = fm_ch3b_identsat(satname);
+    fm_ch3b_setscene(&scene,doy);
 
-    return(ch3brefl); 
+    return(fm_ch3brefl_scene(&scene,bt3b,bt4,solang)); 
 } 
 
 /*
@@ -337,8 +322,8 @@ float fm_findsollum(float solang, char *satname, int doy) {
  * NB2: MetOP-01 temporarily use the same values as MetOP-02.
  *
  * BUGS:
- * Should not exit if satellite is not found, change in time... ystein
- * Gody, METNO/FOU, 2013-02-12 
+ * Exits if the satellite is not found, use fm_ch3b_findsat or
+ * fm_ch3b_open to get an error return instead.
  *
  * AUTHOR:
  * Mari Anne Killie, METNO/FOU, 18.06.2007 
@@ -368,114 +353,306 @@ float fm_findsollum(float solang, char *satname, int doy) {
  * less when using central wave number corresponding to (230-270)K for
  * temperatures in the (270-310)K range. MetOP-01 still borrows from
  * MetOP-02.
+ * METNO/FOU, 17.10.2026: Identification moved to fm_ch3b_findsat.
  *
  * ID:
  * $Id$
  */
 
 fm_ch3b_const fm_ch3b_identsat(char *satname) {
-    fm_ch3b_const satCs = {0,0,0,0,"",0};
-    char *where="fm_ch3b_identsat";
-    char what[FMSTRING256];
-
-    sprintf(satCs.satID,"%s",satname);
-
-    if (strcasestr(satCs.satID,"NOAA-7")){  
-        satCs.avhrr3 = 0;
-        satCs.Aval= 0.;
-        satCs.Bval= 1.;
-        satCs.cwn= 2670.3; /*using that for 225-275 (K) temp. range*/
-        satCs.solrad= 5.112;
+    fm_ch3b_const satCs;
+
+    if (fm_ch3b_findsat(satname,&satCs)) {
+        exit(0); /* change behaviour in time... */
     }
-    else if (strcasestr(satCs.satID,"NOAA-9")){  
-        satCs.avhrr3 = 0;
-	satCs.Aval= 0.;
-        satCs.Bval= 1.;
-        satCs.cwn= 2674.81; /*using that for 225-275 (K) temp. range*/
-        satCs.solrad= 5.112;
+
+    return(satCs);
+}
+
+/*
+ * NAME:
+ * fm_ch3b_findsat
+ *
+ * PURPOSE:
+ * As fm_ch3b_identsat, but returns an error if the satellite is not
+ * recognised.
+ *
+ * REQUIREMENTS:
+ * NA
+ *
+ * INPUT:
+ * o satellite identification (NOAA-??)
+ *
+ * OUTPUT:
+ * o the constants of the satellite, see fm_ch3b_identsat
+ *
+ * RETURN VALUES:
+ * FM_OK on success, FM_VAROUTOFSCOPE_ERR if the satellite is not
+ * recognised.
+ *
+ * NOTES:
+ * Moved from fm_ch3b_identsat. The satellite name is matched in full,
+ * satID holds as much of it as there is room for.
+ *
+ * BUGS:
+ * NA
+ *
+ * AUTHOR:
+ * METNO/FOU, 17.10.2026.
+ *
+ * MODIFIED:
+ * NA
+ *
+ * ID:
+ * $Id$
+ */
+
+int fm_ch3b_findsat(char *satname, fm_ch3b_const *satCs) {
+    fm_ch3b_const nosat = {0,0,0,0,"",0};
+    char *where="fm_ch3b_findsat";
+
+    *satCs = nosat;
+    snprintf(satCs->satID,sizeof(satCs->satID),"%s",satname);
+
+    if (strcasestr(satname,"NOAA-7")){  
+        satCs->avhrr3 = 0;
+        satCs->Aval= 0.;
+        satCs->Bval= 1.;
+        satCs->cwn= 2670.3; /*using that for 225-275 (K) temp. range*/
+        satCs->solrad= 5.112;
+    }
+    else if (strcasestr(satname,"NOAA-9")){  
+        satCs->avhrr3 = 0;
+	satCs->Aval= 0.;
+        satCs->Bval= 1.;
+        satCs->cwn= 2674.81; /*using that for 225-275 (K) temp. range*/
+        satCs->solrad= 5.112;
     }
-    else if (strcasestr(satCs.satID,"NOAA-10")){  
-        satCs.avhrr3 = 0;
-	satCs.Aval= 0.;
-        satCs.Bval= 1.;
-        satCs.cwn= 2657.60; /*using that for 225-275 (K) temp. range*/
-        satCs.solrad= 5.112;
+    else if (strcasestr(satname,"NOAA-10")){  
+        satCs->avhrr3 = 0;
+	satCs->Aval= 0.;
+        satCs->Bval= 1.;
+        satCs->cwn= 2657.60; /*using that for 225-275 (K) temp. range*/
+        satCs->solrad= 5.112;
     }
-    else if (strcasestr(satCs.satID,"NOAA-11")){  
-        satCs.avhrr3 = 0;
-        satCs.Aval= 0.;
-        satCs.Bval= 1.;
-        satCs.cwn= 2668.15; /*using that for 225-275 (K) temp. range*/
-        satCs.solrad= 5.112;
+    else if (strcasestr(satname,"NOAA-11")){  
+        satCs->avhrr3 = 0;
+        satCs->Aval= 0.;
+        satCs->Bval= 1.;
+        satCs->cwn= 2668.15; /*using that for 225-275 (K) temp. range*/
+        satCs->solrad= 5.112;
     }
-    else if (strcasestr(satCs.satID,"NOAA-12")){ 
-        satCs.avhrr3 = 0;
-        satCs.Aval= 0.;
-        satCs.Bval= 1.;
-	satCs.cwn= 2636.669; /*using that for 230-270 (K) temp. range*/
-        satCs.solrad= 4.983;
+    else if (strcasestr(satname,"NOAA-12")){ 
+        satCs->avhrr3 = 0;
+        satCs->Aval= 0.;
+        satCs->Bval= 1.;
+	satCs->cwn= 2636.669; /*using that for 230-270 (K) temp. range*/
+        satCs->solrad= 4.983;
     }
-    else if (strcasestr(satCs.satID,"NOAA-14")){ 
-        satCs.avhrr3 = 0;
-        satCs.Aval= 0.;
-        satCs.Bval= 1.;
-        satCs.cwn= 2642.807; /*using that for 230-270 (K) temp. range*/
-        satCs.solrad= 5.016;
+    else if (strcasestr(satname,"NOAA-14")){ 
+        satCs->avhrr3 = 0;
+        satCs->Aval= 0.;
+        satCs->Bval= 1.;
+        satCs->cwn= 2642.807; /*using that for 230-270 (K) temp. range*/
+        satCs->solrad= 5.016;
     }
-    else if (strcasestr(satCs.satID,"NOAA-15")){  
-        satCs.avhrr3 = 1;
-        satCs.Aval= 1.621256;
-        satCs.Bval= 0.998015;
-        satCs.cwn= 2695.9743;
-        satCs.solrad= 5.153;
+    else if (strcasestr(satname,"NOAA-15")){  
+        satCs->avhrr3 = 1;
+        satCs->Aval= 1.621256;
+        satCs->Bval= 0.998015;
+        satCs->cwn= 2695.9743;
+        satCs->solrad= 5.153;
     }
-    else if (strcasestr(satCs.satID,"NOAA-16")){ 
-        satCs.avhrr3 = 1;
-        satCs.Aval= 1.592459;
-        satCs.Bval= 0.998147;
-        satCs.cwn= 2700.1148;
-        satCs.solrad= 5.099;
+    else if (strcasestr(satname,"NOAA-16")){ 
+        satCs->avhrr3 = 1;
+        satCs->Aval= 1.592459;
+        satCs->Bval= 0.998147;
+        satCs->cwn= 2700.1148;
+        satCs->solrad= 5.099;
     }
-    else if (strcasestr(satCs.satID,"NOAA-17")){ 
-        satCs.avhrr3 = 1;
-	satCs.Aval= 1.702380;
-        satCs.Bval= 0.997378;
-        satCs.cwn= 2669.3554;
-        satCs.solrad= 5.070;
+    else if (strcasestr(satname,"NOAA-17")){ 
+        satCs->avhrr3 = 1;
+	satCs->Aval= 1.702380;
+        satCs->Bval= 0.997378;
+        satCs->cwn= 2669.3554;
+        satCs->solrad= 5.070;
     }
-    else if (strcasestr(satCs.satID,"NOAA-18")){ 
-        satCs.avhrr3 = 1;
-        satCs.Aval= 1.698704;
-        satCs.Bval= 0.996960;
-        satCs.cwn= 2659.7952;
-        satCs.solrad= 5.043;
+    else if (strcasestr(satname,"NOAA-18")){ 
+        satCs->avhrr3 = 1;
+        satCs->Aval= 1.698704;
+        satCs->Bval= 0.996960;
+        satCs->cwn= 2659.7952;
+        satCs->solrad= 5.043;
     }
-    else if (strcasestr(satCs.satID,"NOAA-19")){ 
-        satCs.avhrr3 = 1;
-        satCs.Aval= 1.67396;
-        satCs.Bval= 0.997364;
-        satCs.cwn= 2670.0;
-        satCs.solrad= 5.073;
+    else if (strcasestr(satname,"NOAA-19")){ 
+        satCs->avhrr3 = 1;
+        satCs->Aval= 1.67396;
+        satCs->Bval= 0.997364;
+        satCs->cwn= 2670.0;
+        satCs->solrad= 5.073;
     }
-    else if (strcasestr(satCs.satID,"MetOp-01")){ 
-        satCs.avhrr3 = 1;
-        satCs.Aval= 2.06699;
-        satCs.Bval= 0.996577;
-        satCs.cwn= 2687.0;
-        satCs.solrad= 5.1370;
+    else if (strcasestr(satname,"MetOp-01")){ 
+        satCs->avhrr3 = 1;
+        satCs->Aval= 2.06699;
+        satCs->Bval= 0.996577;
+        satCs->cwn= 2687.0;
+        satCs->solrad= 5.1370;
     }
-    else if (strcasestr(satCs.satID,"MetOp-02")){ 
-        satCs.avhrr3 = 1;
-        satCs.Aval= 2.06699;
-        satCs.Bval= 0.996577;
-        satCs.cwn= 2687.0;
-        satCs.solrad= 5.1370;
+    else if (strcasestr(satname,"MetOp-02")){ 
+        satCs->avhrr3 = 1;
+        satCs->Aval= 2.06699;
+        satCs->Bval= 0.996577;
+        satCs->cwn= 2687.0;
+        satCs->solrad= 5.1370;
     } else {
-        fmerrmsg(where, "Satellite %s is not recognised", satCs.satID);
-        exit(0); /* change behaviour in time... */
+        fmerrmsg(where, "Satellite %s is not recognised", satname);
+        return(FM_VAROUTOFSCOPE_ERR);
     }
 
-    return(satCs);
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * fm_ch3b_open
+ *
+ * PURPOSE:
+ * Identify the satellite and prepare the constants needed to estimate
+ * the channel 3b reflectance of a scene, to be used with
+ * fm_ch3brefl_scene.
+ *
+ * REQUIREMENTS:
+ * NA
+ *
+ * INPUT:
+ * o satellite identification (NOAA-??)
+ * o day of year in the range 0-364
+ *
+ * OUTPUT:
+ * o the constants of the scene
+ *
+ * RETURN VALUES:
+ * FM_OK on success, FM_VAROUTOFSCOPE_ERR if the satellite is not
+ * recognised.
+ *
+ * NOTES:
+ * NA
+ *
+ * BUGS:
+ * NA
+ *
+ * AUTHOR:
+ * METNO/FOU, 17.10.2026
+ *
+ * MODIFIED:
+ * NA
+ *
+ * ID:
+ * $Id$
+ */
+
+int fm_ch3b_open(char *satname, int doy, fm_ch3b_scene *scene) {
+
+    if (fm_ch3b_findsat(satname,&(scene->sat))) {
+        return(FM_VAROUTOFSCOPE_ERR);
+    }
+    fm_ch3b_setscene(scene,doy);
+
+    return(FM_OK);
 }
 
+/*
+ * Constants that depend on the satellite and the day of year only, as
+ * computed by fm_temp2rad and fm_findsollum.
+ */
+static void fm_ch3b_setscene(fm_ch3b_scene *scene, int doy) {
+    float planck1, planck2, dcorr;
+
+    if (scene->sat.avhrr3) {
+      planck1 = FM_PLANCKC1;
+      planck2 = FM_PLANCKC2;
+    } else {
+      planck1 = FM_PLANCKC1_v0;
+      planck2 = FM_PLANCKC2_v0;
+    }
+    scene->c1nu3 = powf(scene->sat.cwn,3.)*planck1;
+    scene->c2nu = planck2*scene->sat.cwn;
+    dcorr = fmesd(doy);
+    scene->esdrad = dcorr*scene->sat.solrad;
+}
 
+/*
+ * NAME:
+ * fm_ch3brefl_scene
+ *
+ * PURPOSE:
+ * Computes CH3B reflectance for given temperatures in CH3B and CH4 (K)
+ * and solar zenith angle (degrees) using the constants of a scene
+ * prepared by fm_ch3b_open.
+ *
+ * REQUIREMENTS:
+ * NA
+ *
+ * INPUT:
+ * o constants of the scene
+ * o brightness temperature of channel 3b
+ * o brightness temperature of channel 4
+ * o solar zenith angle IN DEGREES
+ *
+ * OUTPUT:
+ * The reflectance in CH3 in percent!
+ *
+ * NOTES:
+ * The result is identical to that of fm_ch3brefl. The scene is only
+ * read, and may be shared by several threads.
+ *
+ * BUGS:
+ * NA
+ *
+ * AUTHOR:
+ * METNO/FOU, 17.10.2026
+ *
+ * MODIFIED:
+ * NA
+ *
+ * ID:
+ * $Id$
+ */
+
+float fm_ch3brefl_scene(const fm_ch3b_scene *scene, float bt3b, float bt4,
+    float solang) {
+
+    float ch3brefl, ch3bthermrad;
+    float lumch3b, lumsolar, efftemp, solangrad;
+
+    /*
+     * The measured radiance in CH3B, see fm_temp2rad
+     */
+    efftemp = scene->sat.Aval+scene->sat.Bval*bt3b; 
+    lumch3b = scene->c1nu3/(expf(scene->c2nu/efftemp)-1.);
+
+    /*
+     * The "real" thermal radiance from CH3B, assuming the same temperature
+     * as in CH4
+     */
+    efftemp = scene->sat.Aval+scene->sat.Bval*bt4; 
+    ch3bthermrad = scene->c1nu3/(expf(scene->c2nu/efftemp)-1.);
+
+    /*
+     * Get the solar radiance, see fm_findsollum
+     */
+    solangrad = solang*DEG_TO_RAD;
+    lumsolar = scene->esdrad*cosf(solangrad);
+
+    /*
+     * Estimate the reflectivity
+     */
+    ch3brefl = (lumch3b - ch3bthermrad)/(lumsolar - ch3bthermrad);
+
+    /*
+     * Convert value to %, the same as for the values in CH1 and CH2!
+     */
+    ch3brefl *= 100.; 
+
+    return(ch3brefl); 
+}
@@ -31,6 +31,7 @@
  * make room for \0
  * Mari Anne Killie, MET/FOU, 06.08.2013: adding planck coefficients
  * for pre AVHRR/3-sensors (FM_PLANCKCX_v0).
+ * METNO/FOU, 17.10.2026: Added fm_ch3b_scene.
  *
  * ID:
  * $Id$
@@ -61,5 +62,17 @@ float fm_rad2temp(float radiance, char *satname);
 float fm_findsollum(float solang, char *satname, int doy);
 fm_ch3b_const fm_ch3b_identsat(char *satname);
 
+typedef struct { /*Channel 3b constants resolved once for a scene */
+  fm_ch3b_const sat; /*satellite constants*/
+  float c1nu3;   /*first Planck constant times cwn^3*/
+  float c2nu;    /*second Planck constant times cwn*/
+  float esdrad;  /*solrad corrected for Earth-Sun distance*/
+} fm_ch3b_scene;
+
+int fm_ch3b_findsat(char *satname, fm_ch3b_const *satCs);
+int fm_ch3b_open(char *satname, int doy, fm_ch3b_scene *scene);
+float fm_ch3brefl_scene(const fm_ch3b_scene *scene, float bt3b, float bt4,
+    float solang);
+
 
 #endif /* CH3B_H */
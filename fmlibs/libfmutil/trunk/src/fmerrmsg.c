@@ -30,6 +30,8 @@
  * Added LOGMSG and changed interface...
  * Thomas Lavergne, met.no, 03.12.2007: add the optional use of
  * printf-like format and parameters to fmlogmsg() and fmerrmsg()
+ * METNO/FOU, 17.10.2026: localtime_r, messages may be written by
+ * several threads.
  *
  * ID:
  * $Id$
@@ -52,12 +54,12 @@ void fmerrmsg(char *where, char *what)
     va_list ap;
 #endif
     time_t wtime;
-    struct tm *mytime;
+    struct tm mytime;
     char ftime[20];
 
     wtime = time(NULL);
-    mytime = localtime(&wtime);
-    strftime(ftime,19,"%F %R",mytime);
+    localtime_r(&wtime,&mytime);
+    strftime(ftime,19,"%F %R",&mytime);
 
     fprintf(stderr,"\n");
     fprintf(stderr," ERRMSG [%s %s]:\n", where, ftime);
@@ -84,13 +86,13 @@ void fmlogmsg(char *where, char *what)
     va_list ap;
 #endif
     time_t wtime;
-    struct tm *mytime;
+    struct tm mytime;
     char ftime[20];
 
     wtime = time(NULL);
-    mytime = localtime(&wtime);
+    localtime_r(&wtime,&mytime);
 
-    strftime(ftime,19,"%F %R",mytime);
+    strftime(ftime,19,"%F %R",&mytime);
 
     fprintf(stdout," \n");
     fprintf(stdout," LOGMSG [%s %s]:\n", where, ftime);
@@ -0,0 +1,365 @@
+/*
+ * NAME:
+ * fmgeogrid.c
+ *
+ * PURPOSE:
+ * To compute geographical latitude, longitude for all pixels of a tile
+ * once, instead of projecting each pixel through PROJ separately. The
+ * grid depends only on the UCS reference (pixel size, upper left corner
+ * and image size) and the projection, and can therefore be reused for
+ * every scene of the same tile.
+ *
+ * Grids may be stored in a cache directory on disk. Cache files are named
+ * from the UCS reference and projection, and the header of the file is
+ * checked against the requested geometry before the grid is used.
+ *
+ * REQUIREMENTS:
+ * o PROJ
+ *
+ * INPUT:
+ * NA
+ *
+ * OUTPUT:
+ * NA
+ *
+ * NOTES:
+ * The cache files are written in native byte order and are not intended
+ * to be moved between platforms, a file with foreign byte order is
+ * rejected by the header check and recomputed.
+ *
+ * BUGS:
+ * NA
+ *
+ * AUTHOR:
+ * METNO/FOU, 17.10.2026
+ *
+ * MODIFIED:
+ * NA
+ *
+ * ID:
+ * $Id$
+ */
+
+#include <fmutil.h>
+#include <unistd.h>
+
+#ifdef FMUTIL_HAVE_LIBPROJ
+#include <projects.h>
+#endif
+
+/*
+ * NAME:
+ * fmgeogrid_init
+ *
+ * PURPOSE:
+ * Initialise an empty grid.
+ */
+int fmgeogrid_init(fmgeogrid *g) {
+
+    g->ucs.Ax = g->ucs.Ay = g->ucs.Bx = g->ucs.By = 0.;
+    g->ucs.iw = g->ucs.ih = 0;
+    g->proj = MI;
+    g->lat = NULL;
+    g->lon = NULL;
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * fmgeogrid_get
+ *
+ * PURPOSE:
+ * Fill g with latitude, longitude for the tile described by ref. If g
+ * already holds the requested grid nothing is done. Otherwise the grid
+ * is read from cachedir if available there, or computed and stored in
+ * cachedir for later use. If cachedir is NULL or empty, no disk cache is
+ * used. The grid g must have been initialised by fmgeogrid_init.
+ *
+ * RETURN VALUES:
+ * FM_OK on success, failure to use the disk cache is reported but is not
+ * considered an error.
+ */
+int fmgeogrid_get(fmucsref ref, fmprojspec myproj, char *cachedir,
+	fmgeogrid *g) {
+
+    char *where="fmgeogrid_get";
+    char filename[FMSTRING1024];
+    int usecache;
+
+    if (g->lat != NULL && fmgeogrid_matches(*g, ref, myproj)) {
+	return(FM_OK);
+    }
+
+    usecache = (cachedir != NULL && strlen(cachedir) > 0);
+
+    if (usecache) {
+	if (fmgeogrid_cachename(cachedir, ref, myproj, filename)) {
+	    fmerrmsg(where,"Could not create cache filename, cache not used");
+	    usecache = 0;
+	} else if (access(filename, R_OK) == 0) {
+	    if (fmgeogrid_read(filename, ref, myproj, g) == FM_OK) {
+		fmlogmsg(where,"Using cached geolocation from %s", filename);
+		return(FM_OK);
+	    }
+	    fmerrmsg(where,"Could not use %s, recomputing", filename);
+	}
+    }
+
+    if (fmgeogrid_compute(ref, myproj, g)) {
+	fmerrmsg(where,"Could not compute geolocation grid");
+	return(FM_OTHER_ERR);
+    }
+
+    if (usecache) {
+	if (fmgeogrid_write(filename, *g)) {
+	    fmerrmsg(where,"Could not store geolocation in %s", filename);
+	} else {
+	    fmlogmsg(where,"Stored geolocation in %s", filename);
+	}
+    }
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * fmgeogrid_compute
+ *
+ * PURPOSE:
+ * Compute latitude, longitude for each pixel of the tile. The projection
+ * is initialised once for the whole tile. The UCS position of each pixel
+ * is estimated as in fmind2ucs, giving the same values as fmind2geo.
+ */
+int fmgeogrid_compute(fmucsref ref, fmprojspec myproj, fmgeogrid *g) {
+
+    char *where="fmgeogrid_compute";
+    projPJ pj;
+    projUV cnat;
+    int row, col, nerr;
+    long i, size;
+
+    if (ref.iw <= 0 || ref.ih <= 0) {
+	fmerrmsg(where,"Invalid image size %dx%d", ref.iw, ref.ih);
+	return(FM_VAROUTOFSCOPE_ERR);
+    }
+
+    if (myproj == MI) {
+	pj = pj_init(sizeof(miproj)/sizeof(char *), (char **) miproj);
+    } else if (myproj == MEOS) {
+	pj = pj_init(sizeof(meosproj)/sizeof(char *), (char **) meosproj);
+    } else {
+	fmerrmsg(where,"Projection not supported");
+	return(FM_VAROUTOFSCOPE_ERR);
+    }
+    if (!pj) {
+	fmerrmsg(where,"PROJ initialization failed.");
+	return(FM_OTHER_ERR);
+    }
+
+    fmgeogrid_free(g);
+    size = ((long) ref.iw)*((long) ref.ih);
+    if (fmalloc_double_vector(&(g->lat), size) ||
+	    fmalloc_double_vector(&(g->lon), size)) {
+	fmerrmsg(where,"Could not allocate geolocation grid");
+	fmgeogrid_free(g);
+	pj_free(pj);
+	return(FM_MEMALL_ERR);
+    }
+
+    nerr = 0;
+    for (row=0; row<ref.ih; row++) {
+	for (col=0; col<ref.iw; col++) {
+	    i = fmivec(col, row, ref.iw);
+	    cnat.u = ref.Bx + (((double) col)*ref.Ax);
+	    cnat.v = ref.By - (((double) row)*ref.Ay);
+	    cnat = pj_inv(cnat, pj);
+	    if (cnat.u == HUGE_VAL) nerr++;
+	    g->lon[i] = cnat.u*RAD_TO_DEG;
+	    g->lat[i] = cnat.v*RAD_TO_DEG;
+	}
+    }
+    pj_free(pj);
+
+    if (nerr) {
+	fmerrmsg(where,"pj_inv conversion failed for %d pixels", nerr);
+    }
+
+    g->ucs = ref;
+    g->proj = myproj;
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * fmgeogrid_cachename
+ *
+ * PURPOSE:
+ * Create the name of the cache file for a specific tile geometry. The
+ * string filename must hold at least FMSTRING1024 characters.
+ */
+int fmgeogrid_cachename(char *cachedir, fmucsref ref, fmprojspec myproj,
+	char *filename) {
+
+    int n;
+
+    n = snprintf(filename, FMSTRING1024,
+	    "%s/fmgeogrid_%s_%dx%d_%.4f_%.4f_%.4f_%.4f.bin",
+	    cachedir, (myproj == MEOS ? "meos" : "mi"), ref.iw, ref.ih,
+	    ref.Ax, ref.Ay, ref.Bx, ref.By);
+    if (n < 0 || n >= FMSTRING1024) {
+	return(FM_VAROUTOFSCOPE_ERR);
+    }
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * fmgeogrid_matches
+ *
+ * PURPOSE:
+ * Check whether a grid was computed for the requested tile geometry.
+ */
+fmbool fmgeogrid_matches(fmgeogrid g, fmucsref ref, fmprojspec myproj) {
+
+    if (g.proj != myproj ||
+	    g.ucs.iw != ref.iw || g.ucs.ih != ref.ih ||
+	    g.ucs.Ax != ref.Ax || g.ucs.Ay != ref.Ay ||
+	    g.ucs.Bx != ref.Bx || g.ucs.By != ref.By) {
+	return(FMFALSE);
+    }
+
+    return(FMTRUE);
+}
+
+/*
+ * NAME:
+ * fmgeogrid_read
+ *
+ * PURPOSE:
+ * Read a cached grid, the header must match the requested geometry.
+ */
+int fmgeogrid_read(char *filename, fmucsref ref, fmprojspec myproj,
+	fmgeogrid *g) {
+
+    char *where="fmgeogrid_read";
+    char magic[sizeof(FMGEOGRID_MAGIC)];
+    FILE *fp;
+    fmgeogrid head;
+    int proj;
+    long size;
+
+    fp = fopen(filename,"rb");
+    if (!fp) {
+	fmerrmsg(where,"Could not open %s", filename);
+	return(FM_IO_ERR);
+    }
+
+    if (fread(magic, sizeof(magic), 1, fp) != 1 ||
+	    strncmp(magic, FMGEOGRID_MAGIC, sizeof(magic)) != 0 ||
+	    fread(&(head.ucs), sizeof(fmucsref), 1, fp) != 1 ||
+	    fread(&proj, sizeof(int), 1, fp) != 1) {
+	fmerrmsg(where,"Header of %s is not recognised", filename);
+	fclose(fp);
+	return(FM_IO_ERR);
+    }
+    head.proj = (fmprojspec) proj;
+
+    if (!fmgeogrid_matches(head, ref, myproj)) {
+	fmerrmsg(where,"Geometry of %s does not match request", filename);
+	fclose(fp);
+	return(FM_IO_ERR);
+    }
+
+    fmgeogrid_free(g);
+    size = ((long) ref.iw)*((long) ref.ih);
+    if (fmalloc_double_vector(&(g->lat), size) ||
+	    fmalloc_double_vector(&(g->lon), size)) {
+	fmerrmsg(where,"Could not allocate geolocation grid");
+	fmgeogrid_free(g);
+	fclose(fp);
+	return(FM_MEMALL_ERR);
+    }
+
+    if (fread(g->lat, sizeof(double), size, fp) != size ||
+	    fread(g->lon, sizeof(double), size, fp) != size) {
+	fmerrmsg(where,"Could not read grid from %s", filename);
+	fmgeogrid_free(g);
+	fclose(fp);
+	return(FM_IO_ERR);
+    }
+    fclose(fp);
+
+    g->ucs = ref;
+    g->proj = myproj;
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * fmgeogrid_write
+ *
+ * PURPOSE:
+ * Store a grid in a cache file. The grid is written to a temporary file
+ * which is renamed when complete, thus concurrent processes will never
+ * see a partial cache file.
+ */
+int fmgeogrid_write(char *filename, fmgeogrid g) {
+
+    char *where="fmgeogrid_write";
+    char tmpname[FMSTRING1024+FMSTRING16];
+    FILE *fp;
+    int proj, err;
+    long size;
+
+    if (g.lat == NULL || g.lon == NULL) {
+	fmerrmsg(where,"No grid to store");
+	return(FM_VAROUTOFSCOPE_ERR);
+    }
+
+    sprintf(tmpname,"%s.%d", filename, (int) getpid());
+    fp = fopen(tmpname,"wb");
+    if (!fp) {
+	fmerrmsg(where,"Could not create %s", tmpname);
+	return(FM_IO_ERR);
+    }
+
+    size = ((long) g.ucs.iw)*((long) g.ucs.ih);
+    proj = (int) g.proj;
+    err = 0;
+    if (fwrite(FMGEOGRID_MAGIC, sizeof(FMGEOGRID_MAGIC), 1, fp) != 1) err++;
+    if (fwrite(&(g.ucs), sizeof(fmucsref), 1, fp) != 1) err++;
+    if (fwrite(&proj, sizeof(int), 1, fp) != 1) err++;
+    if (fwrite(g.lat, sizeof(double), size, fp) != size) err++;
+    if (fwrite(g.lon, sizeof(double), size, fp) != size) err++;
+    if (fclose(fp)) err++;
+
+    if (err || rename(tmpname, filename)) {
+	fmerrmsg(where,"Could not write %s", filename);
+	remove(tmpname);
+	return(FM_IO_ERR);
+    }
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * fmgeogrid_free
+ *
+ * PURPOSE:
+ * Release memory held by the grid.
+ */
+int fmgeogrid_free(fmgeogrid *g) {
+
+    if (g->lat) fmfree_double_vector(g->lat);
+    if (g->lon) fmfree_double_vector(g->lon);
+    g->lat = NULL;
+    g->lon = NULL;
+    g->ucs.iw = g->ucs.ih = 0;
+
+    return(FM_OK);
+}
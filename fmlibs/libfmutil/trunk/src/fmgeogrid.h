@@ -0,0 +1,66 @@
+/*
+ * NAME:
+ * fmgeogrid.h
+ *
+ * PURPOSE:
+ * See fmgeogrid.c
+ *
+ * REQUIREMENTS:
+ * o PROJ
+ *
+ * INPUT:
+ * NA
+ *
+ * OUTPUT:
+ * NA
+ *
+ * NOTES:
+ * NA
+ *
+ * BUGS:
+ * NA
+ *
+ * AUTHOR:
+ * METNO/FOU, 17.10.2026
+ *
+ * MODIFIED:
+ * NA
+ *
+ * ID:
+ * $Id$
+ */
+
+#ifndef FMGEOGRID_H
+#define FMGEOGRID_H
+
+#include "fmcoord.h"
+
+#define FMGEOGRID_MAGIC "FMGEOGRID1" /* Identifies on-disk cache files */
+
+/*
+ * Latitude and longitude for every pixel of a tile, row major order as
+ * used by fmivec. The grid is only valid for the UCS reference and
+ * projection it was computed for.
+ */
+typedef struct {
+    fmucsref ucs; /* tile geometry the grid was computed for */
+    fmprojspec proj; /* projection used for the computation */
+    double *lat; /* latitude of each pixel */
+    double *lon; /* longitude of each pixel */
+} fmgeogrid;
+
+#ifdef FMUTIL_HAVE_LIBPROJ
+int fmgeogrid_init(fmgeogrid *g);
+int fmgeogrid_get(fmucsref ref, fmprojspec myproj, char *cachedir,
+	fmgeogrid *g);
+int fmgeogrid_compute(fmucsref ref, fmprojspec myproj, fmgeogrid *g);
+int fmgeogrid_read(char *filename, fmucsref ref, fmprojspec myproj,
+	fmgeogrid *g);
+int fmgeogrid_write(char *filename, fmgeogrid g);
+int fmgeogrid_cachename(char *cachedir, fmucsref ref, fmprojspec myproj,
+	char *filename);
+fmbool fmgeogrid_matches(fmgeogrid g, fmucsref ref, fmprojspec myproj);
+int fmgeogrid_free(fmgeogrid *g);
+#endif
+
+#endif /* FMGEOGRID_H */
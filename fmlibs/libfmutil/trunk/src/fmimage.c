@@ -28,6 +28,8 @@
  *
  * MODIFIED:
  * ystein Gody, METNO/FOU, 2011-11-10: Adapted to the new structures.
+ * METNO/FOU, 17.10.2026: Added fmdatafield_setblock and free_fmdatafield.
+ * METNO/FOU, 17.10.2026: Added fmdatafield_value.
  *
  * ID:
  * $Id$
@@ -221,10 +223,14 @@ int allocate_fmdatafield(fmdatafield **d, int layers) {
     for (i=0;i<layers;i++) {
         (*d)[i].bytearray = NULL;
         (*d)[i].ushortarray = NULL;
+        (*d)[i].shortarray = NULL;
         (*d)[i].intarray = NULL;
         (*d)[i].floatarray = NULL;
         (*d)[i].doublearray = NULL;
         (*d)[i].class_names = NULL;
+        (*d)[i].block = NULL;
+        (*d)[i].scalefactor.slope = NULL;
+        (*d)[i].scalefactor.nslopes = 0;
         if (fmalloc_char_vector(&((*d)[i].description),50)) {
             fmerrmsg(where,"Could not allocate description at layer %d", i);
             return(FM_MEMALL_ERR);
@@ -243,6 +249,217 @@ int allocate_fmdatafield(fmdatafield **d, int layers) {
     return(FM_OK);
 }
 
+/*
+ * NAME:
+ * fmdatafield_setblock
+ *
+ * PURPOSE:
+ * To hold a layer of type dtype in one contiguous block of rows*columns
+ * values, which is typically filled by a single read in the native
+ * storage type of a file. Row views into the block are set in the array
+ * matching dtype (bytearray for FMUCHAR and FMCHAR, ushortarray,
+ * shortarray, intarray for FMINT and FMUINT, floatarray or doublearray).
+ *
+ * REQUIREMENTS:
+ *
+ * INPUT:
+ * d - layer to set
+ * dtype - type of the values in block
+ * block - values, row by row, owned by the layer afterwards
+ * rows, columns - size of the layer
+ *
+ * OUTPUT:
+ * FM_OK, else FM_MEMALL_ERR
+ *
+ * NOTES:
+ * Release layers with free_fmdatafield.
+ *
+ * BUGS:
+ *
+ * AUTHOR:
+ * METNO/FOU, 17.10.2026
+ *
+ * MODIFIED:
+ * NA
+ */
+int fmdatafield_setblock(fmdatafield *d, fmdatatype dtype, void *block,
+	int rows, int columns) {
+    char *where="fmdatafield_setblock";
+    size_t size;
+    void **rowp;
+    int i;
+
+    switch (dtype) {
+	case FMUCHAR:
+	case FMCHAR:
+	    size = sizeof(unsigned char);
+	    break;
+	case FMUSHORT:
+	case FMSHORT:
+	    size = sizeof(short);
+	    break;
+	case FMUINT:
+	case FMINT:
+	    size = sizeof(int);
+	    break;
+	case FMFLOAT:
+	    size = sizeof(float);
+	    break;
+	default:
+	    size = sizeof(double);
+    }
+
+    rowp = malloc(rows*sizeof(void *));
+    if (!rowp) {
+	fmerrmsg(where,"Could not allocate row pointers");
+	return(FM_MEMALL_ERR);
+    }
+    for (i=0;i<rows;i++) {
+	rowp[i] = (char *) block+(size_t) i*columns*size;
+    }
+
+    d->dtype = dtype;
+    d->block = block;
+    switch (dtype) {
+	case FMUCHAR:
+	case FMCHAR:
+	    d->bytearray = (unsigned char **) rowp;
+	    break;
+	case FMUSHORT:
+	    d->ushortarray = (unsigned short **) rowp;
+	    break;
+	case FMSHORT:
+	    d->shortarray = (short **) rowp;
+	    break;
+	case FMUINT:
+	case FMINT:
+	    d->intarray = (int **) rowp;
+	    break;
+	case FMFLOAT:
+	    d->floatarray = (float **) rowp;
+	    break;
+	default:
+	    d->doublearray = (double **) rowp;
+    }
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * fmdatafield_value
+ *
+ * PURPOSE:
+ * To get the stored value at row and col of a layer, whatever array of
+ * the layer holds it according to dtype. Layers read in their native
+ * storage type may thus be used like layers widened to int.
+ *
+ * REQUIREMENTS:
+ *
+ * INPUT:
+ * d - layer
+ * row, col - position of the value
+ *
+ * OUTPUT:
+ * The value as stored converted to float, not unpacked
+ *
+ * NOTES:
+ *
+ * BUGS:
+ *
+ * AUTHOR:
+ * METNO/FOU, 17.10.2026
+ *
+ * MODIFIED:
+ * NA
+ */
+float fmdatafield_value(fmdatafield *d, int row, int col) {
+
+    switch (d->dtype) {
+	case FMUCHAR:
+	    return((float) d->bytearray[row][col]);
+	case FMCHAR:
+	    return((float) (signed char) d->bytearray[row][col]);
+	case FMUSHORT:
+	    return((float) d->ushortarray[row][col]);
+	case FMSHORT:
+	    return((float) d->shortarray[row][col]);
+	case FMUINT:
+	    return((float) (unsigned int) d->intarray[row][col]);
+	case FMINT:
+	    return((float) d->intarray[row][col]);
+	case FMFLOAT:
+	    return((float) d->floatarray[row][col]);
+	default:
+	    return((float) d->doublearray[row][col]);
+    }
+}
+
+/*
+ * NAME:
+ * free_fmdatafield
+ *
+ * PURPOSE:
+ * To free layers allocated by allocate_fmdatafield, including their data
+ * whether held in separately allocated rows or in a contiguous block (see
+ * fmdatafield_setblock).
+ *
+ * REQUIREMENTS:
+ *
+ * INPUT:
+ * d - layers
+ * layers - number of layers
+ * rows - number of rows in each layer
+ *
+ * OUTPUT:
+ * FM_OK
+ *
+ * NOTES:
+ *
+ * BUGS:
+ *
+ * AUTHOR:
+ * METNO/FOU, 17.10.2026
+ *
+ * MODIFIED:
+ * NA
+ */
+int free_fmdatafield(fmdatafield *d, int layers, int rows) {
+    int i, j;
+    void **rowp;
+
+    if (!d) return(FM_OK);
+
+    for (i=0;i<layers;i++) {
+	rowp = NULL;
+	if (d[i].bytearray) rowp = (void **) d[i].bytearray;
+	else if (d[i].ushortarray) rowp = (void **) d[i].ushortarray;
+	else if (d[i].shortarray) rowp = (void **) d[i].shortarray;
+	else if (d[i].intarray) rowp = (void **) d[i].intarray;
+	else if (d[i].floatarray) rowp = (void **) d[i].floatarray;
+	else if (d[i].doublearray) rowp = (void **) d[i].doublearray;
+	if (rowp) {
+	    if (d[i].block) {
+		free(d[i].block);
+	    } else {
+		for (j=0;j<rows;j++) {
+		    free(rowp[j]);
+		}
+	    }
+	    free(rowp);
+	}
+	if (d[i].class_names) {
+	    fmfree_byte_2d(d[i].class_names,d[i].number_of_classes);
+	}
+	if (d[i].scalefactor.slope) free(d[i].scalefactor.slope);
+	if (d[i].description) free(d[i].description);
+	if (d[i].unit) free(d[i].unit);
+    }
+    free(d);
+
+    return(FM_OK);
+}
+
 /*
  * NAME:
  * unpack_fmdatafield_ushort
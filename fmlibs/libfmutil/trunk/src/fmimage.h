@@ -25,6 +25,7 @@
  * ystein Gody, METNO/FOU, 2012-12-06: Added controlled vocabularies,
  * more should be added (e.g. for constraints, area descriptions, etc).
  * ystein Gody, METNO/FOU, 2013-04-11: Added static to vocabularies...
+ * METNO/FOU, 17.10.2026: Added shortarray and block to fmdatafield.
  *
  * ID:
  * $Id$ 
@@ -165,6 +166,7 @@ typedef struct {
 typedef struct {
     unsigned char **bytearray; /* image data */
     unsigned short **ushortarray; /* image data */
+    short **shortarray; /* image data */
     int **intarray; /* image data */
     float **floatarray; /* image data */
     double **doublearray; /* image data */
@@ -178,6 +180,7 @@ typedef struct {
     fmbool palette; /* true if palette / classed image */
     int number_of_classes;
     char **class_names;
+    void *block; /* contiguous data the rows point into, or NULL */
 } fmdatafield;
 
 /*
@@ -191,6 +194,10 @@ typedef struct {
 int init_fmdataset(fmdataset *d); 
 int free_fmdataset(fmdataset *d); 
 int allocate_fmdatafield(fmdatafield **d, int layers);
+int fmdatafield_setblock(fmdatafield *d, fmdatatype dtype, void *block,
+	int rows, int columns);
+int free_fmdatafield(fmdatafield *d, int layers, int rows);
+float fmdatafield_value(fmdatafield *d, int row, int col);
 float unpack_fmdatafield_byte(char val, fmscale scale, int use); 
 float unpack_fmdatafield_ushort(unsigned short val, fmscale scale, int use); 
 float unpack_fmdatafield_short(short val, fmscale scale, int use); 
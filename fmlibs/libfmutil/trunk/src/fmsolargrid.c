@@ -0,0 +1,264 @@
+/*
+ * NAME:
+ * fmsolargrid.c
+ *
+ * PURPOSE:
+ * To estimate the solar zenith angle of all pixels of a tile from exact
+ * values at a lattice of tie points, instead of computing true solar
+ * time, declination and hour angle for every pixel. The angle varies
+ * slowly across a tile, and is bilinearly interpolated between the tie
+ * points.
+ *
+ * REQUIREMENTS:
+ * o PROJ
+ *
+ * INPUT:
+ * NA
+ *
+ * OUTPUT:
+ * NA
+ *
+ * NOTES:
+ * The exact angle is computed as in pix_proc, fmutc2tst followed by
+ * fmsolarzenith. The interpolation error is measured when the grid is
+ * computed, by comparing against exact values at the centre and edge
+ * midpoints of each cell. fmsolarzenith truncates true solar time to
+ * whole minutes, thus the exact angle has steps that the interpolation
+ * does not follow, and which may fall between the measured points. The
+ * largest change of the exact angle over one minute at the tie points is
+ * therefore added to the measured error, giving maxerr. Likewise, if
+ * local midnight in true solar time crosses the tile the declination
+ * changes stepwise, and the largest change over one day at the tie
+ * points is added.
+ *
+ * All pixels of a tile are assumed to be observed at the same time, as
+ * for the tiles processed by fmsnowcover.
+ *
+ * BUGS:
+ * NA
+ *
+ * AUTHOR:
+ * METNO/FOU, 17.10.2026
+ *
+ * MODIFIED:
+ * NA
+ *
+ * ID:
+ * $Id$
+ */
+
+#include <fmutil.h>
+
+#ifdef FMUTIL_HAVE_LIBPROJ
+
+/*
+ * Exact solar zenith angle of a pixel. If yday is not NULL, the day of
+ * year in true solar time is returned in it.
+ */
+static double fmsolargrid_exact(fmucsref ref, fmprojspec myproj,
+	fmgeogrid *geo, fmsec1970 utc, int row, int col, int *yday) {
+
+    fmindex ind;
+    fmgeopos gpos;
+    fmsec1970 tst;
+    fmtime t;
+
+    if (geo != NULL) {
+	gpos.lat = geo->lat[fmivec(col, row, ref.iw)];
+	gpos.lon = geo->lon[fmivec(col, row, ref.iw)];
+    } else {
+	ind.row = row;
+	ind.col = col;
+	gpos = fmind2geo(ref, myproj, ind);
+    }
+    tst = fmutc2tst(utc, gpos.lon);
+    if (yday != NULL) {
+	tofmtime(tst, &t);
+	*yday = t.fm_yday;
+    }
+
+    return(fmsolarzenith(tst, gpos));
+}
+
+/*
+ * Pixel position of tie point k of n, with distance step and the last
+ * tie point at size-1.
+ */
+static int fmsolargrid_pos(int k, int n, int step, int size) {
+
+    return(k < n-1 ? k*step : size-1);
+}
+
+/*
+ * NAME:
+ * fmsolargrid_init
+ *
+ * PURPOSE:
+ * Initialise an empty grid.
+ */
+int fmsolargrid_init(fmsolargrid *g) {
+
+    g->ucs.Ax = g->ucs.Ay = g->ucs.Bx = g->ucs.By = 0.;
+    g->ucs.iw = g->ucs.ih = 0;
+    g->utc = 0;
+    g->step = 0;
+    g->nx = g->ny = 0;
+    g->soz = NULL;
+    g->maxerr = 0.;
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * fmsolargrid_compute
+ *
+ * PURPOSE:
+ * Compute the solar zenith angle at tie points every step pixels of the
+ * tile described by ref, at time utc, and measure the interpolation
+ * error. If geo is not NULL it must match ref and myproj, and
+ * geolocation is taken from it instead of from PROJ. Memory held by g
+ * is reused or released.
+ *
+ * RETURN VALUES:
+ * FM_OK on success, FM_VAROUTOFSCOPE_ERR if step or the tile size is not
+ * valid and FM_MEMALL_ERR on memory trouble.
+ */
+int fmsolargrid_compute(fmucsref ref, fmprojspec myproj, fmgeogrid *geo,
+	fmsec1970 utc, int step, fmsolargrid *g) {
+
+    char *where="fmsolargrid_compute";
+    int kx, ky, x0, x1, y0, y1, xm, ym, yday, yday0;
+    double err, minstep, daystep;
+    fmbool newday;
+
+    if (step < 1 || ref.iw < 2 || ref.ih < 2) {
+	fmerrmsg(where,"Tie point step %d or tile size %dx%d is not valid",
+		step, ref.iw, ref.ih);
+	return(FM_VAROUTOFSCOPE_ERR);
+    }
+
+    if (g->soz) free(g->soz);
+    fmsolargrid_init(g);
+
+    g->nx = (ref.iw-2)/step+2;
+    g->ny = (ref.ih-2)/step+2;
+    g->soz = (double *) malloc(g->nx*g->ny*sizeof(double));
+    if (!g->soz) {
+	fmerrmsg(where,"Could not allocate memory for %dx%d tie points",
+		g->nx, g->ny);
+	fmsolargrid_init(g);
+	return(FM_MEMALL_ERR);
+    }
+    g->ucs = ref;
+    g->utc = utc;
+    g->step = step;
+
+    minstep = daystep = 0.;
+    newday = FMFALSE;
+    yday0 = -1;
+    for (ky=0; ky<g->ny; ky++) {
+	y0 = fmsolargrid_pos(ky, g->ny, step, ref.ih);
+	for (kx=0; kx<g->nx; kx++) {
+	    x0 = fmsolargrid_pos(kx, g->nx, step, ref.iw);
+	    g->soz[ky*g->nx+kx] =
+		fmsolargrid_exact(ref, myproj, geo, utc, y0, x0, &yday);
+	    if (yday0 < 0) yday0 = yday;
+	    if (yday != yday0) newday = FMTRUE;
+	    err = fabs(fmsolargrid_exact(ref, myproj, geo, utc+60, y0, x0,
+			NULL)-g->soz[ky*g->nx+kx]);
+	    if (err > minstep) minstep = err;
+	    err = fabs(fmsolargrid_exact(ref, myproj, geo, utc+86400, y0, x0,
+			NULL)-g->soz[ky*g->nx+kx]);
+	    if (err > daystep) daystep = err;
+	}
+    }
+
+    /*
+     * Measure the interpolation error at the centre and the upper and
+     * left edge midpoints of each cell, and at the lower and right edge
+     * midpoints of the last cells.
+     */
+    for (ky=0; ky<g->ny-1; ky++) {
+	y0 = fmsolargrid_pos(ky, g->ny, step, ref.ih);
+	y1 = fmsolargrid_pos(ky+1, g->ny, step, ref.ih);
+	ym = (y0+y1)/2;
+	for (kx=0; kx<g->nx-1; kx++) {
+	    x0 = fmsolargrid_pos(kx, g->nx, step, ref.iw);
+	    x1 = fmsolargrid_pos(kx+1, g->nx, step, ref.iw);
+	    xm = (x0+x1)/2;
+	    err = fabs(fmsolargrid_soz(g, ym, xm)-
+		    fmsolargrid_exact(ref, myproj, geo, utc, ym, xm, NULL));
+	    if (err > g->maxerr) g->maxerr = err;
+	    err = fabs(fmsolargrid_soz(g, y0, xm)-
+		    fmsolargrid_exact(ref, myproj, geo, utc, y0, xm, NULL));
+	    if (err > g->maxerr) g->maxerr = err;
+	    err = fabs(fmsolargrid_soz(g, ym, x0)-
+		    fmsolargrid_exact(ref, myproj, geo, utc, ym, x0, NULL));
+	    if (err > g->maxerr) g->maxerr = err;
+	    if (ky == g->ny-2) {
+		err = fabs(fmsolargrid_soz(g, y1, xm)-
+			fmsolargrid_exact(ref, myproj, geo, utc, y1, xm, NULL));
+		if (err > g->maxerr) g->maxerr = err;
+	    }
+	    if (kx == g->nx-2) {
+		err = fabs(fmsolargrid_soz(g, ym, x1)-
+			fmsolargrid_exact(ref, myproj, geo, utc, ym, x1, NULL));
+		if (err > g->maxerr) g->maxerr = err;
+	    }
+	}
+    }
+    g->maxerr += minstep;
+    if (newday) g->maxerr += daystep;
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * fmsolargrid_soz
+ *
+ * PURPOSE:
+ * Bilinear interpolation of the solar zenith angle [deg] at pixel
+ * row, col of the tile. The grid is only read, and may be used by
+ * several threads.
+ */
+double fmsolargrid_soz(const fmsolargrid *g, int row, int col) {
+
+    int kx, ky, x0, x1, y0, y1;
+    double tx, ty;
+    const double *p;
+
+    kx = col/g->step;
+    if (kx > g->nx-2) kx = g->nx-2;
+    ky = row/g->step;
+    if (ky > g->ny-2) ky = g->ny-2;
+
+    x0 = kx*g->step;
+    x1 = fmsolargrid_pos(kx+1, g->nx, g->step, g->ucs.iw);
+    y0 = ky*g->step;
+    y1 = fmsolargrid_pos(ky+1, g->ny, g->step, g->ucs.ih);
+    tx = ((double) (col-x0))/(x1-x0);
+    ty = ((double) (row-y0))/(y1-y0);
+
+    p = g->soz+ky*g->nx+kx;
+
+    return((1.-ty)*((1.-tx)*p[0]+tx*p[1])+
+	    ty*((1.-tx)*p[g->nx]+tx*p[g->nx+1]));
+}
+
+/*
+ * NAME:
+ * fmsolargrid_free
+ *
+ * PURPOSE:
+ * Release memory held by the grid, the grid is empty afterwards.
+ */
+int fmsolargrid_free(fmsolargrid *g) {
+
+    if (g->soz) free(g->soz);
+
+    return(fmsolargrid_init(g));
+}
+
+#endif
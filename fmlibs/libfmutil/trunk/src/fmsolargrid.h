@@ -0,0 +1,63 @@
+/*
+ * NAME:
+ * fmsolargrid.h
+ *
+ * PURPOSE:
+ * See fmsolargrid.c
+ *
+ * REQUIREMENTS:
+ * o PROJ
+ *
+ * INPUT:
+ * NA
+ *
+ * OUTPUT:
+ * NA
+ *
+ * NOTES:
+ * NA
+ *
+ * BUGS:
+ * NA
+ *
+ * AUTHOR:
+ * METNO/FOU, 17.10.2026
+ *
+ * MODIFIED:
+ * NA
+ *
+ * ID:
+ * $Id$
+ */
+
+#ifndef FMSOLARGRID_H
+#define FMSOLARGRID_H
+
+#include "fmcoord.h"
+#include "fmgeogrid.h"
+#include "fmtime.h"
+
+/*
+ * Solar zenith angle at tie points of a tile, every step pixel along
+ * rows and columns and at the last row and column. Tie points are stored
+ * in row major order.
+ */
+typedef struct {
+    fmucsref ucs; /* tile geometry the grid was computed for */
+    fmsec1970 utc; /* time the grid was computed for */
+    int step; /* distance in pixels between tie points */
+    int nx; /* number of tie points along a row */
+    int ny; /* number of tie points along a column */
+    double *soz; /* solar zenith angle [deg] at each tie point */
+    double maxerr; /* largest interpolation error measured [deg] */
+} fmsolargrid;
+
+#ifdef FMUTIL_HAVE_LIBPROJ
+int fmsolargrid_init(fmsolargrid *g);
+int fmsolargrid_compute(fmucsref ref, fmprojspec myproj, fmgeogrid *geo,
+	fmsec1970 utc, int step, fmsolargrid *g);
+double fmsolargrid_soz(const fmsolargrid *g, int row, int col);
+int fmsolargrid_free(fmsolargrid *g);
+#endif
+
+#endif /* FMSOLARGRID_H */
@@ -16,6 +16,9 @@
  * performed, it can however be used for storage of true solar time or
  * CET.
  *
+ * tofmtime is reentrant (gmtime_r), thus fmutc2tst, fmcet2tst and
+ * fmsolarzenith may be called concurrently from several threads.
+ *
  * BUGS:
  * Failure returns not implemented yet...
  *
@@ -38,6 +41,8 @@
  * �ystein God�y, METNO/FOU, 2011-11-01: Added fmmonthnum.
  * Thomas Lavergne, METNO/FOU, 2012-11-23: Added DOY decoding in fmstring2fmtime(), clean-up return codes.
  * Thomas Lavergne, METNO/FOU, 2012-11-29: Add check of date validity in tofmsec1970() and fmstring2fmtime()
+ * METNO/FOU, 17.10.2026: tofmtime made reentrant, removed unused
+ * timezone estimate and debug output.
  *
  * ID:
  * $Id$
@@ -205,52 +210,29 @@ fmsec1970 tofmsec1970(fmtime t) {
 
 int tofmtime(fmsec1970 secs, fmtime *fmt) {
 
-   long tmpsecs;
-   struct tm tmref, *tminp;
-   time_t tzdelta;
-
-
+   time_t tmpsecs;
+   struct tm tminp;
 
    /*
-    * Estimate delta time caused by timezone locale. January 1, 1970,
-    * 00:00:00 should return 0 seconds.
+    * Create struct, gmtime_r is used as this function is called for
+    * each pixel by threaded applications.
     */
-   tmref.tm_year = 1970-1900;
-   tmref.tm_mon = 1-1;
-   tmref.tm_mday = 1;
-   tmref.tm_hour = 0;
-   tmref.tm_min = 0;
-   tmref.tm_sec = 0;
-   tmref.tm_isdst = 0;
-
-   fprintf(stdout," Testing fmtime: %li \n",secs);
-
-   tzdelta = mktime(&tmref);
-
-   /*
-    * Apply timezone correction.
-    */
-   //tmpsecs = secs+tzdelta;
-   tmpsecs = secs;
-   /*
-    * Create struct
-    */
-
-
-   tminp = gmtime(&tmpsecs);
-   fprintf(stdout," Testing fmtime: %li \n",secs);
+   tmpsecs = (time_t) secs;
+   if (gmtime_r(&tmpsecs, &tminp) == NULL) {
+      return(FM_VAROUTOFSCOPE_ERR);
+   }
 
    /*
     * Put into fmtime
     */
-   fmt->fm_year = tminp->tm_year+1900;
-   fmt->fm_mon = tminp->tm_mon+1;
-   fmt->fm_mday = tminp->tm_mday;
-   fmt->fm_hour = tminp->tm_hour;
-   fmt->fm_min = tminp->tm_min;
-   fmt->fm_sec = tminp->tm_sec;
-   fmt->fm_wday = tminp->tm_wday;
-   fmt->fm_yday = tminp->tm_yday;
+   fmt->fm_year = tminp.tm_year+1900;
+   fmt->fm_mon = tminp.tm_mon+1;
+   fmt->fm_mday = tminp.tm_mday;
+   fmt->fm_hour = tminp.tm_hour;
+   fmt->fm_min = tminp.tm_min;
+   fmt->fm_sec = tminp.tm_sec;
+   fmt->fm_wday = tminp.tm_wday;
+   fmt->fm_yday = tminp.tm_yday;
    return(0);
 }
 
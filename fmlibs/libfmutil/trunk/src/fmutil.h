@@ -6,8 +6,10 @@
 		fmutil_config.h
 		fmutil_types.h
 		fmcoord.h
+		fmgeogrid.h
 		fmtime.h
 		fmsolar.h
+		fmsolargrid.h
 		fmangles.h
 		fmangleconversion.h
 		fmstrings.h
@@ -337,6 +339,71 @@ int fmucs2diana(fmucsref ucs, fmdianapos *nwp);
 #endif
 
 #endif /* FMCOORD_H */
+/*
+ * NAME:
+ * fmgeogrid.h
+ *
+ * PURPOSE:
+ * See fmgeogrid.c
+ *
+ * REQUIREMENTS:
+ * o PROJ
+ *
+ * INPUT:
+ * NA
+ *
+ * OUTPUT:
+ * NA
+ *
+ * NOTES:
+ * NA
+ *
+ * BUGS:
+ * NA
+ *
+ * AUTHOR:
+ * METNO/FOU, 17.10.2026
+ *
+ * MODIFIED:
+ * NA
+ *
+ * ID:
+ * $Id$
+ */
+
+#ifndef FMGEOGRID_H
+#define FMGEOGRID_H
+
+
+#define FMGEOGRID_MAGIC "FMGEOGRID1" /* Identifies on-disk cache files */
+
+/*
+ * Latitude and longitude for every pixel of a tile, row major order as
+ * used by fmivec. The grid is only valid for the UCS reference and
+ * projection it was computed for.
+ */
+typedef struct {
+    fmucsref ucs; /* tile geometry the grid was computed for */
+    fmprojspec proj; /* projection used for the computation */
+    double *lat; /* latitude of each pixel */
+    double *lon; /* longitude of each pixel */
+} fmgeogrid;
+
+#ifdef FMUTIL_HAVE_LIBPROJ
+int fmgeogrid_init(fmgeogrid *g);
+int fmgeogrid_get(fmucsref ref, fmprojspec myproj, char *cachedir,
+	fmgeogrid *g);
+int fmgeogrid_compute(fmucsref ref, fmprojspec myproj, fmgeogrid *g);
+int fmgeogrid_read(char *filename, fmucsref ref, fmprojspec myproj,
+	fmgeogrid *g);
+int fmgeogrid_write(char *filename, fmgeogrid g);
+int fmgeogrid_cachename(char *cachedir, fmucsref ref, fmprojspec myproj,
+	char *filename);
+fmbool fmgeogrid_matches(fmgeogrid g, fmucsref ref, fmprojspec myproj);
+int fmgeogrid_free(fmgeogrid *g);
+#endif
+
+#endif /* FMGEOGRID_H */
 
 /*
  * NAME:
@@ -457,6 +524,66 @@ float fmbidirref(int jd, float soz, float alb);
 double fmtoairrad(fmsec1970 tst, fmgeopos gpos, double s0);
 
 #endif
+/*
+ * NAME:
+ * fmsolargrid.h
+ *
+ * PURPOSE:
+ * See fmsolargrid.c
+ *
+ * REQUIREMENTS:
+ * o PROJ
+ *
+ * INPUT:
+ * NA
+ *
+ * OUTPUT:
+ * NA
+ *
+ * NOTES:
+ * NA
+ *
+ * BUGS:
+ * NA
+ *
+ * AUTHOR:
+ * METNO/FOU, 17.10.2026
+ *
+ * MODIFIED:
+ * NA
+ *
+ * ID:
+ * $Id$
+ */
+
+#ifndef FMSOLARGRID_H
+#define FMSOLARGRID_H
+
+
+/*
+ * Solar zenith angle at tie points of a tile, every step pixel along
+ * rows and columns and at the last row and column. Tie points are stored
+ * in row major order.
+ */
+typedef struct {
+    fmucsref ucs; /* tile geometry the grid was computed for */
+    fmsec1970 utc; /* time the grid was computed for */
+    int step; /* distance in pixels between tie points */
+    int nx; /* number of tie points along a row */
+    int ny; /* number of tie points along a column */
+    double *soz; /* solar zenith angle [deg] at each tie point */
+    double maxerr; /* largest interpolation error measured [deg] */
+} fmsolargrid;
+
+#ifdef FMUTIL_HAVE_LIBPROJ
+int fmsolargrid_init(fmsolargrid *g);
+int fmsolargrid_compute(fmucsref ref, fmprojspec myproj, fmgeogrid *geo,
+	fmsec1970 utc, int step, fmsolargrid *g);
+double fmsolargrid_soz(const fmsolargrid *g, int row, int col);
+int fmsolargrid_free(fmsolargrid *g);
+#endif
+
+#endif /* FMSOLARGRID_H */
 /*
  * NAME:
  * fmangles.h
@@ -683,6 +810,7 @@ int fmfree_double_2d(double **value, int rows);
  * �ystein God�y, METNO/FOU, 2012-12-06: Added controlled vocabularies,
  * more should be added (e.g. for constraints, area descriptions, etc).
  * �ystein God�y, METNO/FOU, 2013-04-11: Added static to vocabularies...
+ * METNO/FOU, 17.10.2026: Added shortarray and block to fmdatafield.
  *
  * ID:
  * $Id$ 
@@ -822,6 +950,7 @@ typedef struct {
 typedef struct {
     unsigned char **bytearray; /* image data */
     unsigned short **ushortarray; /* image data */
+    short **shortarray; /* image data */
     int **intarray; /* image data */
     float **floatarray; /* image data */
     double **doublearray; /* image data */
@@ -835,6 +964,7 @@ typedef struct {
     fmbool palette; /* true if palette / classed image */
     int number_of_classes;
     char **class_names;
+    void *block; /* contiguous data the rows point into, or NULL */
 } fmdatafield;
 
 /*
@@ -848,6 +978,10 @@ typedef struct {
 int init_fmdataset(fmdataset *d); 
 int free_fmdataset(fmdataset *d); 
 int allocate_fmdatafield(fmdatafield **d, int layers);
+int fmdatafield_setblock(fmdatafield *d, fmdatatype dtype, void *block,
+	int rows, int columns);
+int free_fmdatafield(fmdatafield *d, int layers, int rows);
+float fmdatafield_value(fmdatafield *d, int row, int col);
 float unpack_fmdatafield_byte(char val, fmscale scale, int use); 
 float unpack_fmdatafield_ushort(unsigned short val, fmscale scale, int use); 
 float unpack_fmdatafield_short(short val, fmscale scale, int use); 
@@ -1011,6 +1145,7 @@ extern void fmerrmsg(char *where, char *what);
  * make room for \0
  * Mari Anne Killie, MET/FOU, 06.08.2013: adding planck coefficients
  * for pre AVHRR/3-sensors (FM_PLANCKCX_v0).
+ * METNO/FOU, 17.10.2026: Added fm_ch3b_scene.
  *
  * ID:
  * $Id$
@@ -1041,6 +1176,18 @@ float fm_rad2temp(float radiance, char *satname);
 float fm_findsollum(float solang, char *satname, int doy);
 fm_ch3b_const fm_ch3b_identsat(char *satname);
 
+typedef struct { /*Channel 3b constants resolved once for a scene */
+  fm_ch3b_const sat; /*satellite constants*/
+  float c1nu3;   /*first Planck constant times cwn^3*/
+  float c2nu;    /*second Planck constant times cwn*/
+  float esdrad;  /*solrad corrected for Earth-Sun distance*/
+} fm_ch3b_scene;
+
+int fm_ch3b_findsat(char *satname, fm_ch3b_const *satCs);
+int fm_ch3b_open(char *satname, int doy, fm_ch3b_scene *scene);
+float fm_ch3brefl_scene(const fm_ch3b_scene *scene, float bt3b, float bt4,
+    float solang);
+
 
 #endif /* CH3B_H */
 /*
@@ -4,7 +4,7 @@ date=`date`
 
 outname="fmutil.h"
 
-srcnames="fmutil_config.h fmutil_types.h fmcoord.h fmtime.h fmsolar.h fmangles.h fmangleconversion.h fmstrings.h"
+srcnames="fmutil_config.h fmutil_types.h fmcoord.h fmgeogrid.h fmtime.h fmsolar.h fmsolargrid.h fmangles.h fmangleconversion.h fmstrings.h"
 srcnames="$srcnames fmstorage.h fmimage.h fmbyteswap.h fmcolormaps.h fmerrmsg.h fm_ch3b_reflectance.h fmtouch.h"
 srcnames="$srcnames fmfeltfile.h fmfilesystem.h"
 
@@ -0,0 +1,112 @@
+/*
+ * NAME:
+ * test_fmtime_4
+ *
+ * PURPOSE:
+ * Test that tofmtime, fmutc2tst and fmsolarzenith are reentrant, i.e.
+ * that concurrent calls from several threads give the same results as
+ * serial calls.
+ *
+ * NOTES:
+ * NA
+ *
+ * REQUIREMENTS:
+ * o POSIX threads
+ *
+ * AUTHOR:
+ * METNO/FOU, 17.10.2026
+ *
+ * MODIFIED:
+ *
+ * ID:
+ * $Id: $
+ */
+
+#include <stdlib.h>
+#include <pthread.h>
+#include <fmutil.h>
+
+#define NTHREADS 4
+#define NLAT 90
+#define NLON 180
+#define NSTEP 24
+
+char progname[] = "test_fmtime_4";
+
+typedef struct {
+   fmsec1970 start;
+   double *soz;
+} job;
+
+/* Solar zenith angle for a global grid at NSTEP hourly steps */
+static void compute(fmsec1970 start, double *soz) {
+   fmgeopos gp;
+   fmsec1970 tst;
+   fmtime t;
+   int i, j, k, n = 0;
+
+   for (k = 0 ; k < NSTEP ; k++) {
+      for (i = 0 ; i < NLAT ; i++) {
+         for (j = 0 ; j < NLON ; j++) {
+            gp.lat = -89.+2.*i;
+            gp.lon = -179.+2.*j;
+            tst = fmutc2tst(start+k*3600,gp.lon);
+            tofmtime(tst,&t);
+            soz[n++] = fmsolarzenith(tst,gp)+t.fm_yday;
+         }
+      }
+   }
+}
+
+static void *worker(void *arg) {
+   job *jb = (job *) arg;
+   compute(jb->start,jb->soz);
+   return(NULL);
+}
+
+int main(void) {
+
+   fmsec1970 starts[NTHREADS] = {0, 1104537600, 1230768000, 1356998400};
+   double *ref[NTHREADS];
+   job jobs[NTHREADS];
+   pthread_t th[NTHREADS];
+   long size = NSTEP*NLAT*NLON;
+   int i;
+   long n;
+
+   printf("\t(%s) 01. Compare threaded and serial solar zenith angles:\n",progname);
+   for (i = 0 ; i < NTHREADS ; i++) {
+      ref[i] = malloc(size*sizeof(double));
+      jobs[i].soz = malloc(size*sizeof(double));
+      jobs[i].start = starts[i];
+      if (!ref[i] || !jobs[i].soz) {
+         printf("\t\t(%s) 01. ERROR: could not allocate memory\n",progname);
+         exit(EXIT_FAILURE);
+      }
+      compute(starts[i],ref[i]);
+   }
+
+   for (i = 0 ; i < NTHREADS ; i++) {
+      if (pthread_create(&th[i],NULL,worker,&jobs[i])) {
+         printf("\t\t(%s) 01. ERROR: could not create thread %d\n",progname,i);
+         exit(EXIT_FAILURE);
+      }
+   }
+   for (i = 0 ; i < NTHREADS ; i++) {
+      pthread_join(th[i],NULL);
+   }
+
+   for (i = 0 ; i < NTHREADS ; i++) {
+      for (n = 0 ; n < size ; n++) {
+         if (jobs[i].soz[n] != ref[i][n]) {
+            printf("\t\t(%s) 01. ERROR: thread %d differs at %ld (%f vs %f)\n",
+                  progname,i,n,jobs[i].soz[n],ref[i][n]);
+            exit(EXIT_FAILURE);
+         }
+      }
+      free(ref[i]);
+      free(jobs[i].soz);
+   }
+
+   exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,604 @@
+/*
+ * NAME:
+ * bench_fmsnowcover
+ *
+ * PURPOSE:
+ * To benchmark the stages of fmsnowcover on synthetic tiles of given
+ * sizes: reading of the AVHRR scene by fm_readdata and of the land/sea
+ * mask, pixel processing by process_pixels4ice, probability estimation
+ * by probest and probest_batch alone, writing of the HDF5 and MITIFF
+ * products and reading of the HDF5 product.
+ *
+ * REQUIREMENTS:
+ * o libfmutil
+ * o libfmio
+ * o libosihdf5
+ * o libtiff
+ *
+ * INPUT:
+ * o tile sizes as <width>x<height>, by default BENCH_SIZES
+ * o -d <dir>: directory of synthetic input and products, default
+ *   BENCH_WORKDIR
+ * o -o <file>: result file, default BENCH_RESULTS in the directory
+ * o -t <n>: threads used by process_pixels4ice, default 1
+ * o -s <n>: tie point distance of the solar zenith grid, default 0
+ * o -r <n>: number of runs of each tile size, default 1
+ * o -c <method>: compression of MITIFF products, none, lzw or deflate
+ *   with horizontal differencing, default none
+ * o -l <n>: rows per strip of MITIFF products, default one strip
+ * o -z <level>: deflate level of the HDF5 product, default -1 for
+ *   contiguous datasets
+ * o -k <n>: rows per chunk of the HDF5 product, default H5PROD_CHUNKROWS
+ *
+ * OUTPUT:
+ * One tab separated line per run and stage, preceded by a header line:
+ * size, run, stage, pixels, seconds (wall time), pixels_per_second,
+ * peak_rss_kb and file_bytes, the size of the file read or written by
+ * the stage (0 if none).
+ *
+ * NOTES:
+ * Input is generated by bench_scene before the runs of each tile size
+ * and is not timed. Each run and the generation of input are done in
+ * separate processes, thus peak_rss_kb is the peak resident memory of
+ * the run up to the end of the stage, and does not depend on earlier
+ * runs. NWP surface temperature is synthetic, as in the scene.
+ *
+ * The options of process_pixels4ice are those of the default
+ * configuration, PROBBATCH 1 and PROBLAZY 1, without geolocation cache.
+ *
+ * BUGS:
+ * NA
+ *
+ * AUTHOR:
+ * METNO/FOU, 17.10.2026
+ *
+ * MODIFIED:
+ * METNO/FOU, 17.10.2026: Added -c and -l.
+ * METNO/FOU, 17.10.2026: Added -z and -k, read_hdf5_product and
+ * file_bytes.
+ *
+ * ID:
+ * $Id$
+ */
+
+#include <unistd.h>
+#include <errno.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <fmaccusnow.h>
+#include <bench_scene.h>
+
+#define BENCH_WORKDIR "bench_work"
+#define BENCH_RESULTS "bench_fmsnowcover.txt"
+#define BENCH_SIZELEN 32
+
+/*
+ * Default tile sizes, up to the largest tile of fmsnowcover.
+ */
+static char *bench_sizes[] = {"300x300", "600x600", "1200x1200", NULL};
+
+/*
+ * Strips and compression of MITIFF products, compressed by the threads
+ * used for pixel processing.
+ */
+static fmio_tiffopts bench_tiff;
+
+/*
+ * Storage of datasets in the HDF5 product.
+ */
+static h5prodopts bench_h5;
+
+typedef struct {
+    char size[BENCH_SIZELEN];
+    int iw;
+    int ih;
+    char scenef[FILELEN];
+    char lmaskf[FILELEN];
+    char coffile[FILELEN];
+    char hdf5f[FILELEN];
+    char classf[FILELEN];
+    char catf[FILELEN];
+} benchtile;
+
+static void bench_usage(void) {
+    fprintf(stdout,"\n");
+    fprintf(stdout," SYNTAX:\n");
+    fprintf(stdout,
+	    " bench_fmsnowcover [-d <dir>] [-o <file>] [-t <threads>]\n");
+    fprintf(stdout,
+	    "     [-s <sozstep>] [-r <runs>] [-c <method>] [-l <rows>]\n");
+    fprintf(stdout,"     [-z <level>] [-k <rows>] [<width>x<height> ...]\n\n");
+    fprintf(stdout," <dir>: directory of synthetic input and products.\n");
+    fprintf(stdout," <file>: file of results, default is %s in <dir>.\n",
+	    BENCH_RESULTS);
+    fprintf(stdout," <threads>: threads used for pixel processing.\n");
+    fprintf(stdout,
+	    " <sozstep>: tie point distance of solar zenith grid.\n");
+    fprintf(stdout," <runs>: number of runs of each tile size.\n");
+    fprintf(stdout,
+	    " <method>: compression of MITIFF products, none, lzw or deflate.\n");
+    fprintf(stdout," <rows>: rows per strip of MITIFF products (-l) or\n");
+    fprintf(stdout,"     chunk of the HDF5 product (-k).\n");
+    fprintf(stdout," <level>: deflate level of the HDF5 product.\n");
+    fprintf(stdout,"\n");
+    exit(FM_OK);
+}
+
+static double bench_now(void) {
+
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+
+    return(tv.tv_sec+1e-6*tv.tv_usec);
+}
+
+/*
+ * Report a stage, file is the file read or written by the stage, or NULL.
+ */
+static void bench_report(FILE *fp, benchtile *t, int run, char *stage,
+	long npix, double sec, char *file) {
+
+    struct rusage ru;
+    struct stat st;
+    long bytes;
+
+    getrusage(RUSAGE_SELF, &ru);
+    bytes = 0;
+    if (file && stat(file, &st) == 0) bytes = (long) st.st_size;
+    fprintf(fp,"%s\t%d\t%s\t%ld\t%.6f\t%.0f\t%ld\t%ld\n",
+	    t->size, run, stage, npix, sec,
+	    (sec > 0. ? npix/sec : 0.), (long) ru.ru_maxrss, bytes);
+    fflush(fp);
+}
+
+static int bench_tile(char *size, char *dir, benchtile *t) {
+
+    char *where="bench_tile";
+    char c;
+
+    if (sscanf(size,"%dx%d%c", &t->iw, &t->ih, &c) != 2 ||
+	    strlen(size) >= BENCH_SIZELEN) {
+	fmerrmsg(where,"Tile size %s is not valid", size);
+	return(FM_SYNTAX_ERR);
+    }
+    if (t->iw < 2 || t->ih < 2 || t->iw > 65535 || t->ih > 65535 ||
+	    ((double) t->iw)*t->ih > FMIO_MAXIMGSIZE) {
+	fmerrmsg(where,"Tile size %s is out of range", size);
+	return(FM_VAROUTOFSCOPE_ERR);
+    }
+    sprintf(t->size,"%s",size);
+    snprintf(t->scenef,FILELEN,"%s/bench_%s.aha",dir,size);
+    snprintf(t->lmaskf,FILELEN,"%s/physiography.bench_%s.hdf5",dir,size);
+    snprintf(t->coffile,FILELEN,"%s/coeffs_bench_%s",dir,size);
+    snprintf(t->hdf5f,FILELEN,"%s/fmsnow_bench_%s.hdf5",dir,size);
+    snprintf(t->classf,FILELEN,"%s/fmsnow_bench_%s.mitiff",dir,size);
+    snprintf(t->catf,FILELEN,"%s/fmsnow_cat_bench_%s.mitiff",dir,size);
+
+    return(FM_OK);
+}
+
+static int bench_generate(benchtile *t) {
+
+    if (bench_write_scene(t->scenef, t->iw, t->ih) ||
+	    bench_write_lmask(t->lmaskf, t->iw, t->ih) ||
+	    bench_write_coeffs(t->coffile)) {
+	return(FM_IO_ERR);
+    }
+
+    return(FM_OK);
+}
+
+/*
+ * Estimate the probabilities of all covered pixels of the image, row by
+ * row, by probest (batch false) or probest_batch (batch true). Only the
+ * estimation is timed, the time is returned in sec.
+ */
+static int bench_probest(fmio_img img, unsigned char *lmask, nwpice nwp,
+	statcoeffstr cof, fmbool batch, long *npix, double *sec) {
+
+    char *where="bench_probest";
+    fmio_calplan plan;
+    fm_ch3b_scene ch3b;
+    fmtime reftime;
+    probcoeffs pc;
+    pinpstr *cpa;
+    pinpbatch in;
+    probbatch out;
+    probstr p;
+    int i, j, k, m, status;
+    double t0;
+
+    fm_img2fmtime(img, &reftime);
+    fm_calplan_init(&plan);
+    if (fm_img2calplan(img, &plan) ||
+	    fm_ch3b_open(img.sa, fmdayofyear(reftime), &ch3b)) {
+	fmerrmsg(where,"Could not set up calibration of channels");
+	fm_calplan_free(&plan);
+	return(FM_IO_ERR);
+    }
+    probest_prepare(cof, &pc);
+
+    cpa = (pinpstr *) calloc(img.iw, sizeof(pinpstr));
+    in.A1 = (float *) malloc(img.iw*sizeof(float));
+    in.A2 = (float *) malloc(img.iw*sizeof(float));
+    in.A3 = (float *) malloc(img.iw*sizeof(float));
+    in.A3b = (float *) malloc(img.iw*sizeof(float));
+    in.T4 = (float *) malloc(img.iw*sizeof(float));
+    in.T5 = (float *) malloc(img.iw*sizeof(float));
+    in.soz = (float *) malloc(img.iw*sizeof(float));
+    in.tdiff = (float *) malloc(img.iw*sizeof(float));
+    in.lmask = (short *) malloc(img.iw*sizeof(short));
+    in.daytime3b = (short *) malloc(img.iw*sizeof(short));
+    out.pice = (double *) malloc(img.iw*sizeof(double));
+    out.pfree = (double *) malloc(img.iw*sizeof(double));
+    out.pcloud = (double *) malloc(img.iw*sizeof(double));
+
+    status = FM_OK;
+    if (!cpa || !in.A1 || !in.A2 || !in.A3 || !in.A3b || !in.T4 ||
+	    !in.T5 || !in.soz || !in.tdiff || !in.lmask || !in.daytime3b ||
+	    !out.pice || !out.pfree || !out.pcloud) {
+	fmerrmsg(where,"Could not allocate memory for row");
+	status = FM_MEMALL_ERR;
+    }
+
+    /*
+     * Inputs are prepared as in pix_proc, with a solar zenith angle
+     * varying along the rows instead of the exact one.
+     */
+    *npix = 0;
+    *sec = 0.;
+    for (j=0; j<img.ih && status == FM_OK; j++) {
+	m = 0;
+	for (i=0; i<img.iw; i++) {
+	    k = fmivec(i, j, img.iw);
+	    if (img.image[3][k] == 0 && img.image[4][k] == 0) continue;
+	    cpa[m].A1 = plan.lut[0][img.image[0][k]];
+	    cpa[m].A2 = plan.lut[1][img.image[1][k]];
+	    cpa[m].A3 = plan.lut[5][img.image[5][k]];
+	    cpa[m].T3 = plan.lut[2][img.image[2][k]];
+	    cpa[m].T4 = plan.lut[3][img.image[3][k]];
+	    cpa[m].T5 = plan.lut[4][img.image[4][k]];
+	    cpa[m].soz = 50.+10.*j/img.ih;
+	    cpa[m].tdiff = nwp.t0m[k]-cpa[m].T4;
+	    cpa[m].lmask = (lmask ? (short) lmask[k] : 0);
+	    cpa[m].daytime3b = (img.image[2][k] > 0 && img.image[5][k] == 0);
+	    cpa[m].A3b = (cpa[m].daytime3b ?
+		    fm_ch3brefl_scene(&ch3b,cpa[m].T3,cpa[m].T4,cpa[m].soz) : 0.);
+	    cpa[m].algo = 2;
+	    in.A1[m] = cpa[m].A1;
+	    in.A2[m] = cpa[m].A2;
+	    in.A3[m] = cpa[m].A3;
+	    in.A3b[m] = cpa[m].A3b;
+	    in.T4[m] = cpa[m].T4;
+	    in.T5[m] = cpa[m].T5;
+	    in.soz[m] = cpa[m].soz;
+	    in.tdiff[m] = cpa[m].tdiff;
+	    in.lmask[m] = cpa[m].lmask;
+	    in.daytime3b[m] = cpa[m].daytime3b;
+	    m++;
+	}
+
+	t0 = bench_now();
+	if (batch) {
+	    if (m > 0 && probest_batch(m, in, out, &pc)) {
+		fmerrmsg(where,"Could not estimate probabilities of row %d",j);
+		status = FM_OTHER_ERR;
+	    }
+	} else {
+	    for (k=0; k<m; k++) {
+		probest(cpa[k], &p, cof);
+	    }
+	}
+	*sec += bench_now()-t0;
+	*npix += m;
+    }
+
+    free(cpa);
+    free(in.A1); free(in.A2); free(in.A3); free(in.A3b); free(in.T4);
+    free(in.T5); free(in.soz); free(in.tdiff); free(in.lmask);
+    free(in.daytime3b);
+    free(out.pice); free(out.pfree); free(out.pcloud);
+    fm_calplan_free(&plan);
+
+    return(status);
+}
+
+/*
+ * One run of all stages on a tile, results are written to fp.
+ */
+static int bench_run(benchtile *t, int run, pixprocopts opts, FILE *fp) {
+
+    char *where="bench_run";
+    osi_dtype ice_ft[FMSNOWCOVER_OLEVELS]={OSI_FLOAT,OSI_FLOAT,OSI_FLOAT};
+    char *ice_desc[FMSNOWCOVER_OLEVELS]={"P(ice/snow)","P(water/land)","P(cloud)"};
+    fmio_img img;
+    fmio_mihead clinfo;
+    osihdf lm, ice, prod;
+    nwpice nwp;
+    statcoeffstr cof;
+    unsigned char *classed, *cat;
+    long size, npix;
+    int i, j, status;
+    double t0, sec;
+
+    fm_init_fmio_img(&img);
+    t0 = bench_now();
+    if (fm_readdata(t->scenef, &img)) {
+	fmerrmsg(where,"Could not read %s", t->scenef);
+	return(FM_IO_ERR);
+    }
+    size = img.iw*img.ih;
+    bench_report(fp, t, run, "fm_readdata", size, bench_now()-t0,
+	    t->scenef);
+
+    init_osihdf(&lm);
+    t0 = bench_now();
+    if (read_hdf5_product(t->lmaskf, &lm, 0)) {
+	fmerrmsg(where,"Could not read %s", t->lmaskf);
+	return(FM_IO_ERR);
+    }
+    bench_report(fp, t, run, "read_lmask", size, bench_now()-t0, t->lmaskf);
+
+    memset(&cof, 0, sizeof(statcoeffstr));
+    if (rdstatcoeffs(t->coffile, &cof)) {
+	fmerrmsg(where,"Could not read %s", t->coffile);
+	return(FM_IO_ERR);
+    }
+
+    nwpice_init(&nwp);
+    nwp.t0m = (float *) malloc(size*sizeof(float));
+    if (!nwp.t0m) {
+	fmerrmsg(where,"Could not allocate memory for NWP data");
+	return(FM_MEMALL_ERR);
+    }
+    for (j=0; j<img.ih; j++) {
+	for (i=0; i<img.iw; i++) {
+	    nwp.t0m[fmivec(i, j, img.iw)] =
+		270.+5.*bench_scene_noise(i, j, 10);
+	}
+    }
+
+    init_osihdf(&ice);
+    sprintf(ice.h.source, "%s", img.sa);
+    sprintf(ice.h.product, "%s", "bench_fmsnowcover");
+    ice.h.iw = img.iw;
+    ice.h.ih = img.ih;
+    ice.h.z = FMSNOWCOVER_OLEVELS;
+    ice.h.Ax = img.Ax;
+    ice.h.Ay = img.Ay;
+    ice.h.Bx = img.Bx;
+    ice.h.By = img.By;
+    ice.h.year = img.yy;
+    ice.h.month = img.mm;
+    ice.h.day = img.dd;
+    ice.h.hour = img.ho;
+    ice.h.minute = img.mi;
+    classed = (unsigned char *) malloc(size*sizeof(char));
+    cat = (unsigned char *) malloc(size*sizeof(char));
+    if (malloc_osihdf(&ice,ice_ft,ice_desc) || !classed || !cat) {
+	fmerrmsg(where,"Could not allocate memory for products");
+	return(FM_MEMALL_ERR);
+    }
+
+    t0 = bench_now();
+    status = process_pixels4ice(img, NULL, (unsigned char *) lm.d[0].data,
+	    nwp, ice.d, classed, cat, 2, cof, opts);
+    if (status && status != 10) {
+	fmerrmsg(where,"Could not process pixels of %s", t->scenef);
+	return(status);
+    }
+    bench_report(fp, t, run, "process_pixels4ice", size, bench_now()-t0,
+	    NULL);
+
+    if (bench_probest(img, (unsigned char *) lm.d[0].data, nwp, cof,
+		FMFALSE, &npix, &sec)) {
+	return(FM_OTHER_ERR);
+    }
+    bench_report(fp, t, run, "probest", npix, sec, NULL);
+    if (bench_probest(img, (unsigned char *) lm.d[0].data, nwp, cof,
+		FMTRUE, &npix, &sec)) {
+	return(FM_OTHER_ERR);
+    }
+    bench_report(fp, t, run, "probest_batch", npix, sec, NULL);
+
+    t0 = bench_now();
+    if (store_hdf5_product_opts(t->hdf5f, ice, bench_h5)) {
+	fmerrmsg(where,"Could not write %s", t->hdf5f);
+	return(FM_IO_ERR);
+    }
+    bench_report(fp, t, run, "store_hdf5_product", size, bench_now()-t0,
+	    t->hdf5f);
+
+    init_osihdf(&prod);
+    t0 = bench_now();
+    if (read_hdf5_product(t->hdf5f, &prod, 0)) {
+	fmerrmsg(where,"Could not read %s", t->hdf5f);
+	return(FM_IO_ERR);
+    }
+    bench_report(fp, t, run, "read_hdf5_product", size, bench_now()-t0,
+	    t->hdf5f);
+    free_osihdf(&prod);
+
+    memset(&clinfo, 0, sizeof(fmio_mihead));
+    sprintf(clinfo.satellite,"%s",img.sa);
+    clinfo.hour = img.ho;
+    clinfo.minute = img.mi;
+    clinfo.day = img.dd;
+    clinfo.month = img.mm;
+    clinfo.year = img.yy;
+    clinfo.zsize = 1;
+    clinfo.xsize = img.iw;
+    clinfo.ysize = img.ih;
+    clinfo.Ax = img.Ax;
+    clinfo.Ay = img.Ay;
+    clinfo.Bx = img.Bx;
+    clinfo.By = img.By;
+
+    t0 = bench_now();
+    if (store_snow_opts(t->classf, classed, clinfo, 0, bench_tiff)) {
+	fmerrmsg(where,"Could not write %s", t->classf);
+	return(FM_IO_ERR);
+    }
+    bench_report(fp, t, run, "store_snow_class", size, bench_now()-t0,
+	    t->classf);
+
+    t0 = bench_now();
+    if (store_snow_opts(t->catf, cat, clinfo, 1, bench_tiff)) {
+	fmerrmsg(where,"Could not write %s", t->catf);
+	return(FM_IO_ERR);
+    }
+    bench_report(fp, t, run, "store_snow_cat", size, bench_now()-t0, t->catf);
+
+    free(classed);
+    free(cat);
+    free(nwp.t0m);
+    free_osihdf(&ice);
+    free_osihdf(&lm);
+    fm_clear_fmio_img(&img);
+
+    return(FM_OK);
+}
+
+/*
+ * Generate the input of a tile (run < 0) or do one run of the benchmark
+ * in a child process and wait for it. The exit status of the child is
+ * returned.
+ */
+static int bench_fork(benchtile *t, int run, pixprocopts opts, FILE *fp) {
+
+    char *where="bench_fork";
+    pid_t pid;
+    int wstatus;
+
+    fflush(fp);
+    fflush(stdout);
+    pid = fork();
+    if (pid < 0) {
+	fmerrmsg(where,"Could not create process");
+	return(FM_OTHER_ERR);
+    }
+    if (pid == 0) {
+	if (run < 0) {
+	    exit(bench_generate(t));
+	}
+	exit(bench_run(t, run, opts, fp));
+    }
+    if (waitpid(pid, &wstatus, 0) < 0 || !WIFEXITED(wstatus)) {
+	fmerrmsg(where,"Benchmark of %s did not complete", t->size);
+	return(FM_OTHER_ERR);
+    }
+
+    return(WEXITSTATUS(wstatus));
+}
+
+int main(int argc, char *argv[]) {
+
+    char *where="bench_fmsnowcover";
+    char *dir, *opfn, **sizes, resfile[FILELEN];
+    int ret, i, run, nruns, nsizes;
+    FILE *fp;
+    benchtile t;
+    pixprocopts opts;
+
+    dir = BENCH_WORKDIR;
+    opfn = NULL;
+    nruns = 1;
+    opts.geo = NULL;
+    opts.nthreads = 1;
+    opts.batch = FMTRUE;
+    opts.lazy = FMTRUE;
+    opts.sozstep = 0;
+    opts.sozmaxerr = 0.5;
+    fm_tiffopts_init(&bench_tiff);
+    h5prodopts_init(&bench_h5);
+
+    while ((ret = getopt(argc, argv, "d:o:t:s:r:c:l:z:k:h")) != EOF) {
+	switch (ret) {
+	    case 'd':
+		dir = optarg;
+		break;
+	    case 'o':
+		opfn = optarg;
+		break;
+	    case 't':
+		opts.nthreads = atoi(optarg);
+		break;
+	    case 's':
+		opts.sozstep = atoi(optarg);
+		break;
+	    case 'r':
+		nruns = atoi(optarg);
+		break;
+	    case 'c':
+		bench_tiff.compression = fm_tiffopts_compression(optarg);
+		bench_tiff.predictor = FMTRUE;
+		break;
+	    case 'l':
+		bench_tiff.rowsperstrip = atoi(optarg);
+		break;
+	    case 'z':
+		bench_h5.deflate = atoi(optarg);
+		break;
+	    case 'k':
+		bench_h5.chunkrows = atoi(optarg);
+		break;
+	    default:
+		bench_usage();
+	}
+    }
+    if (nruns < 1 || opts.nthreads < 0 || opts.sozstep < 0 ||
+	    bench_tiff.compression < 0) bench_usage();
+    bench_tiff.nthreads = opts.nthreads;
+
+    if (optind < argc) {
+	sizes = &(argv[optind]);
+	nsizes = argc-optind;
+    } else {
+	sizes = bench_sizes;
+	for (nsizes=0; bench_sizes[nsizes]; nsizes++);
+    }
+    for (i=0; i<nsizes; i++) {
+	if (bench_tile(sizes[i], dir, &t)) exit(FM_SYNTAX_ERR);
+    }
+
+    if (mkdir(dir, 0755) && errno != EEXIST) {
+	fmerrmsg(where,"Could not create %s", dir);
+	exit(FM_IO_ERR);
+    }
+    if (!opfn) {
+	snprintf(resfile,FILELEN,"%s/%s",dir,BENCH_RESULTS);
+	opfn = resfile;
+    }
+    fp = fopen(opfn,"w");
+    if (!fp) {
+	fmerrmsg(where,"Could not open %s", opfn);
+	exit(FM_IO_ERR);
+    }
+
+    fprintf(fp,"size\trun\tstage\tpixels\tseconds\tpixels_per_second\t"
+	    "peak_rss_kb\tfile_bytes\n");
+    for (i=0; i<nsizes; i++) {
+	bench_tile(sizes[i], dir, &t);
+	fmlogmsg(where,"Generating synthetic input of %s", t.size);
+	if (bench_fork(&t, -1, opts, fp)) {
+	    fmerrmsg(where,"Could not generate input of %s", t.size);
+	    exit(FM_IO_ERR);
+	}
+	for (run=0; run<nruns; run++) {
+	    fmlogmsg(where,"Benchmarking %s, run %d", t.size, run);
+	    if (bench_fork(&t, run, opts, fp)) {
+		fmerrmsg(where,"Benchmark of %s failed", t.size);
+		exit(FM_OTHER_ERR);
+	    }
+	}
+    }
+
+    fclose(fp);
+    fmlogmsg(where,"Results are written to %s", opfn);
+
+    exit(FM_OK);
+}
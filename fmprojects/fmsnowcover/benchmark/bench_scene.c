@@ -0,0 +1,435 @@
+/*
+ * NAME:
+ * bench_scene.c
+ *
+ * PURPOSE:
+ * To generate the synthetic input of the fmsnowcover benchmark for a
+ * tile of any size: an AVHRR scene in AHA_METSAT format, a physiography
+ * land/sea mask in HDF5 and a file of statistical coefficients.
+ *
+ * REQUIREMENTS:
+ * o libfmutil
+ * o libosihdf5
+ *
+ * INPUT:
+ * NA
+ *
+ * OUTPUT:
+ * NA
+ *
+ * NOTES:
+ * The tile is divided in blocks of BENCH_BLOCK pixels of sea ice, open
+ * water, snow covered land, snow free land or cloud, with the mean
+ * feature values of the coefficient file in each block. Land blocks have
+ * a coastal border in the land/sea mask. Channel 3A is available in the
+ * left half of the tile, and missing in the right half where channel 3B
+ * is used, and the rightmost columns are outside the swath.
+ *
+ * Pixel values are a function of position only, computed by an integer
+ * hash from BENCH_SEED, thus files are identical between runs and
+ * platforms and may be written layer by layer using memory for a single
+ * row.
+ *
+ * BUGS:
+ * NA
+ *
+ * AUTHOR:
+ * METNO/FOU, 17.10.2026
+ *
+ * MODIFIED:
+ * NA
+ *
+ * ID:
+ * $Id$
+ */
+
+#include <bench_scene.h>
+
+#define BENCH_BLOCK 64 /* size of surface blocks in pixels */
+#define BENCH_COAST 2 /* width of coastal border of land blocks */
+#define BENCH_NLAYERS 6
+#define BENCH_MISSING -32768 /* stored as 0 by fm_readMETSATdata */
+#define BENCH_VISGAIN 0.01
+#define BENCH_IRGAIN 0.01
+
+/*
+ * Surfaces of the blocks and their mean values of A1 [%], A2/A1, A3/A1
+ * and T4 [K], the difference T3-T4 [K] and the noise amplitudes.
+ */
+enum {BENCH_ICE, BENCH_WATER, BENCH_SNOW, BENCH_LAND, BENCH_CLOUD,
+    BENCH_NSURF};
+
+static struct {
+    float a1, r21, r3a1, t4, dt3;
+    float da1, dr21, dr3a1, dt4;
+} bench_surf[BENCH_NSURF] = {
+    {56.3, 0.85, 0.12, 258., 4., 10.6, 0.10, 0.06, 3.},
+    { 7.6, 0.46, 0.12, 274., 3.,  2.5, 0.06, 0.09, 2.},
+    {49.7, 0.88, 0.17, 262., 5., 21.0, 0.16, 0.07, 4.},
+    { 7.9, 1.89, 1.39, 280., 6.,  2.1, 0.39, 0.24, 4.},
+    {55.9, 0.91, 0.67, 250., 15., 14.8, 0.09, 0.22, 8.}
+};
+
+static char *bench_coeffs[] = {
+    "ice\ta1\tn\t56.28432\t10.59245\t0",
+    "ice\tr21\tn\t0.849512\t0.1035101\t0",
+    "ice\tr3a1\tn\t0.1186385\t0.05849505\t0",
+    "ice\tr3b1\tn\t0.01819690\t0.01587715\t0",
+    "ice\tdt\tn\t4.321039\t6.261954\t0",
+    "snow\ta1\tn\t49.6754\t20.97159\t0",
+    "snow\tr21\tn\t0.8754824\t0.1555307\t0",
+    "snow\tr3a1\tn\t0.1728445\t0.07297933\t0",
+    "snow\tr3b1\tn\t0.0273016\t0.02549709\t0",
+    "snow\tdt\tn\t4.321039\t6.261954\t0",
+    "cloud\ta1\tn\t55.85365\t14.78555\t0",
+    "cloud\tr21\tn\t0.9128154\t0.08670341\t0",
+    "cloud\tr3a1\tn\t0.6690058\t0.2216875\t0",
+    "cloud\tr3b1\tn\t0.1901366\t0.1331275\t0",
+    "cloud\tdt\tn\t19.56302\t15.36650\t0",
+    "water\ta1\tn\t7.552976\t2.471333\t0",
+    "water\tr21\tn\t0.4639897\t0.06464453\t0",
+    "water\tr3a1\tn\t0.1169045\t0.0906175\t0",
+    "water\tr3b1\tn\t0.06353492\t0.06767656\t0",
+    "water\tdt\tn\t19.56302\t15.36650\t0",
+    "land\ta1\tn\t7.933469\t2.125764\t0",
+    "land\tr21\tn\t1.889108\t0.3935855\t0",
+    "land\tr3a1\tn\t1.392030\t0.2381562\t0",
+    "land\tr3b1\tn\t0.3689924\t0.1173226\t0",
+    "land\tdt\tn\t19.56302\t15.36650\t0",
+    NULL
+};
+
+/*
+ * Integer hash of position and layer, uniformly distributed in [0,1).
+ */
+static double bench_uniform(int col, int row, int layer) {
+
+    unsigned long h;
+
+    h = BENCH_SEED;
+    h = ((h^((unsigned long) col))*0x9e3779b1UL)&0xffffffffUL;
+    h = ((h^((unsigned long) row))*0x85ebca6bUL)&0xffffffffUL;
+    h = ((h^((unsigned long) layer))*0xc2b2ae35UL)&0xffffffffUL;
+    h ^= h>>16;
+    h = (h*0x7feb352dUL)&0xffffffffUL;
+    h ^= h>>15;
+    h = (h*0x846ca68bUL)&0xffffffffUL;
+    h ^= h>>16;
+
+    return(((double) h)/4294967296.);
+}
+
+/*
+ * NAME:
+ * bench_scene_noise
+ *
+ * PURPOSE:
+ * Noise in [-1,1) at a pixel, independent for each layer. Layers below
+ * BENCH_NLAYERS are used by the scene, higher layers are free for other
+ * synthetic fields.
+ */
+float bench_scene_noise(int col, int row, int layer) {
+
+    return((float) (2.*bench_uniform(col, row, layer+1)-1.));
+}
+
+static int bench_surface(int col, int row) {
+
+    return((int) (BENCH_NSURF*
+		bench_uniform(col/BENCH_BLOCK, row/BENCH_BLOCK, 0)));
+}
+
+static int bench_island(int col, int row) {
+
+    return(bench_uniform(col/BENCH_BLOCK, row/BENCH_BLOCK, -1) < 0.5);
+}
+
+/*
+ * NAME:
+ * bench_scene_ucs
+ *
+ * PURPOSE:
+ * Geometry of a synthetic tile of iw x ih pixels. The corner is rounded
+ * to whole km, as it is stored in single precision in the files.
+ */
+int bench_scene_ucs(int iw, int ih, fmucsref *ref) {
+
+    fmgeopos centre;
+    fmucspos pos;
+
+    centre.lat = BENCH_LAT;
+    centre.lon = BENCH_LON;
+    pos = fmgeo2ucs(centre, MI);
+
+    ref->Ax = ref->Ay = BENCH_PIXSIZE;
+    ref->Bx = floor(pos.eastings-0.5*iw*ref->Ax);
+    ref->By = floor(pos.northings+0.5*ih*ref->Ay);
+    ref->iw = iw;
+    ref->ih = ih;
+
+    return(FM_OK);
+}
+
+/*
+ * Packed value of layer at a pixel, as stored in the file.
+ */
+static short bench_value(int col, int row, int layer, int iw) {
+
+    int s;
+    double a1, t4, v;
+
+    if (col >= iw-iw/20) return(BENCH_MISSING);
+    if (layer == 5 && col >= iw/2) return(BENCH_MISSING);
+
+    s = bench_surface(col, row);
+    a1 = bench_surf[s].a1+bench_surf[s].da1*bench_scene_noise(col,row,0);
+    if (a1 < 0.) a1 = 0.;
+    t4 = bench_surf[s].t4+bench_surf[s].dt4*bench_scene_noise(col,row,3);
+
+    switch (layer) {
+	case 0:
+	    v = a1/BENCH_VISGAIN;
+	    break;
+	case 1:
+	    v = a1*(bench_surf[s].r21+
+		    bench_surf[s].dr21*bench_scene_noise(col,row,1))/
+		BENCH_VISGAIN;
+	    break;
+	case 2:
+	    v = (t4+bench_surf[s].dt3*
+		    (1.+0.5*bench_scene_noise(col,row,2)))/BENCH_IRGAIN;
+	    break;
+	case 3:
+	    v = t4/BENCH_IRGAIN;
+	    break;
+	case 4:
+	    v = (t4-0.75*(1.+bench_scene_noise(col,row,4)))/BENCH_IRGAIN;
+	    break;
+	default:
+	    v = a1*(bench_surf[s].r3a1+
+		    bench_surf[s].dr3a1*bench_scene_noise(col,row,5))/
+		BENCH_VISGAIN;
+	    break;
+    }
+    if (v < 0.) v = 0.;
+    if (v > 32767.) v = 32767.;
+
+    return((short) (v+0.5));
+}
+
+/*
+ * NAME:
+ * bench_write_scene
+ *
+ * PURPOSE:
+ * Write a synthetic AVHRR scene of iw x ih pixels in AHA_METSAT format,
+ * channels 1, 2, 3B, 4, 5 and 3A, to be read by fm_readdata.
+ *
+ * NOTES:
+ * Data are written in native byte order. fm_readMETSATdata swaps files
+ * marked little_end T on little endian machines.
+ *
+ * RETURN VALUES:
+ * FM_OK on success, FM_IO_ERR if the file could not be written and
+ * FM_MEMALL_ERR on memory trouble.
+ */
+int bench_write_scene(char *fname, int iw, int ih) {
+
+    char *where="bench_write_scene";
+    char hd[2048];
+    int i, j, k, n, dtsz, litend;
+    long startbyte[BENCH_NLAYERS];
+    short *row;
+    FILE *fp;
+    fmucsref ref;
+    unsigned short one = 1;
+
+    litend = (*((unsigned char *) &one) == 1);
+    bench_scene_ucs(iw, ih, &ref);
+    dtsz = BENCH_NLAYERS*iw*ih*sizeof(short);
+    for (k=0; k<BENCH_NLAYERS; k++) {
+	startbyte[k] = ((long) k)*iw*ih*sizeof(short);
+    }
+
+    /*
+     * The key area must precede area_extent, as keys are matched by
+     * prefix.
+     */
+    n = snprintf(hd, sizeof(hd),
+	    "product = bench_scene\n"
+	    "satid = %s\n"
+	    "layers = %d\n"
+	    "channel_id = ['1', '2', '3b', '4', '5', '3a']\n"
+	    "typecode = ['h', 'h', 'h', 'h', 'h', 'h']\n"
+	    "itemsize = [2, 2, 2, 2, 2, 2]\n"
+	    "datatypes = ['data', 'data', 'data', 'data', 'data', 'data']\n"
+	    "compressed = F\n"
+	    "start_byte = [%ld, %ld, %ld, %ld, %ld, %ld]\n"
+	    "little_end = %c\n"
+	    "orbit_no = 0\n"
+	    "data_first_year = %d\n"
+	    "data_first_dayofyear = %d\n"
+	    "data_first_secofday = %.1f\n"
+	    "area = bench\n"
+	    "area_extent = %.1f %.1f %.1f %.1f\n"
+	    "xsize = %d\n"
+	    "ysize = %d\n"
+	    "xscale = %.1f\n"
+	    "yscale = %.1f\n"
+	    "ir_gain = %g\n"
+	    "ir_intercept = 0.0\n"
+	    "vis_gain = %g\n"
+	    "vis_intercept = 0.0\n"
+	    "EOH\n",
+	    BENCH_SATID, BENCH_NLAYERS,
+	    startbyte[0], startbyte[1], startbyte[2],
+	    startbyte[3], startbyte[4], startbyte[5],
+	    (litend ? 'F' : 'T'),
+	    BENCH_YEAR, BENCH_YDAY, BENCH_SECOFDAY,
+	    ref.Bx*1000., (ref.By-ih*ref.Ay)*1000.,
+	    (ref.Bx+iw*ref.Ax)*1000., ref.By*1000.,
+	    iw, ih, ref.Ax*1000., ref.Ay*1000.,
+	    BENCH_IRGAIN, BENCH_VISGAIN);
+    if (n >= sizeof(hd)) {
+	fmerrmsg(where,"Header of %s is too long", fname);
+	return(FM_IO_ERR);
+    }
+
+    row = (short *) malloc(iw*sizeof(short));
+    if (!row) {
+	fmerrmsg(where,"Could not allocate memory for row");
+	return(FM_MEMALL_ERR);
+    }
+    fp = fopen(fname,"w");
+    if (!fp) {
+	fmerrmsg(where,"Could not open %s", fname);
+	free(row);
+	return(FM_IO_ERR);
+    }
+
+    fprintf(fp,"AHA_METSAT %d %d\n", n, dtsz);
+    fputs(hd, fp);
+    for (k=0; k<BENCH_NLAYERS; k++) {
+	for (j=0; j<ih; j++) {
+	    for (i=0; i<iw; i++) {
+		row[i] = bench_value(i, j, k, iw);
+	    }
+	    fwrite(row, sizeof(short), iw, fp);
+	}
+    }
+    /* No subsatellite track */
+    n = 0;
+    fwrite(&n, sizeof(int), 1, fp);
+
+    free(row);
+    if (ferror(fp) || fclose(fp)) {
+	fmerrmsg(where,"Could not write %s", fname);
+	return(FM_IO_ERR);
+    }
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * bench_write_lmask
+ *
+ * PURPOSE:
+ * Write the land/sea mask of a synthetic tile of iw x ih pixels in the
+ * format of the physiography files.
+ *
+ * RETURN VALUES:
+ * FM_OK on success, FM_IO_ERR if the file could not be written and
+ * FM_MEMALL_ERR on memory trouble.
+ */
+int bench_write_lmask(char *fname, int iw, int ih) {
+
+    char *where="bench_write_lmask";
+    osi_dtype lm_ft[1]={OSI_UCHAR};
+    char *lm_desc[1]={"Land/sea mask"};
+    osihdf lm;
+    fmucsref ref;
+    unsigned char *d;
+    int i, j, s, bx, by, status;
+
+    bench_scene_ucs(iw, ih, &ref);
+
+    init_osihdf(&lm);
+    sprintf(lm.h.source, "%s", "bench_scene");
+    sprintf(lm.h.product, "%s", "physiography");
+    lm.h.iw = iw;
+    lm.h.ih = ih;
+    lm.h.z = 1;
+    lm.h.Ax = ref.Ax;
+    lm.h.Ay = ref.Ay;
+    lm.h.Bx = ref.Bx;
+    lm.h.By = ref.By;
+    if (malloc_osihdf(&lm,lm_ft,lm_desc)) {
+	fmerrmsg(where,"Could not allocate memory for land/sea mask");
+	return(FM_MEMALL_ERR);
+    }
+
+    d = (unsigned char *) lm.d[0].data;
+    for (j=0; j<ih; j++) {
+	for (i=0; i<iw; i++) {
+	    s = bench_surface(i, j);
+	    if (s == BENCH_SNOW || s == BENCH_LAND ||
+		    (s == BENCH_CLOUD && bench_island(i, j))) {
+		bx = i%BENCH_BLOCK;
+		by = j%BENCH_BLOCK;
+		if (bx < BENCH_COAST || by < BENCH_COAST ||
+			bx >= BENCH_BLOCK-BENCH_COAST ||
+			by >= BENCH_BLOCK-BENCH_COAST) {
+		    d[fmivec(i, j, iw)] = (FMSNOWSEA+FMSNOWLAND)/2;
+		} else {
+		    d[fmivec(i, j, iw)] = FMSNOWLAND;
+		}
+	    } else {
+		d[fmivec(i, j, iw)] = FMSNOWSEA;
+	    }
+	}
+    }
+
+    status = store_hdf5_product(fname, lm);
+    free_osihdf(&lm);
+    if (status) {
+	fmerrmsg(where,"Could not write %s", fname);
+	return(FM_IO_ERR);
+    }
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * bench_write_coeffs
+ *
+ * PURPOSE:
+ * Write the statistical coefficients, those of etc/coeffs_070809, in the
+ * format read by rdstatcoeffs.
+ *
+ * RETURN VALUES:
+ * FM_OK on success and FM_IO_ERR if the file could not be written.
+ */
+int bench_write_coeffs(char *fname) {
+
+    char *where="bench_write_coeffs";
+    FILE *fp;
+    int i;
+
+    fp = fopen(fname,"w");
+    if (!fp) {
+	fmerrmsg(where,"Could not open %s", fname);
+	return(FM_IO_ERR);
+    }
+    fprintf(fp,"# Statistical coefficients of the fmsnowcover benchmark\n");
+    for (i=0; bench_coeffs[i]; i++) {
+	fprintf(fp,"%s\n", bench_coeffs[i]);
+    }
+    if (ferror(fp) || fclose(fp)) {
+	fmerrmsg(where,"Could not write %s", fname);
+	return(FM_IO_ERR);
+    }
+
+    return(FM_OK);
+}
@@ -0,0 +1,57 @@
+/*
+ * NAME:
+ * bench_scene.h
+ *
+ * PURPOSE:
+ * See bench_scene.c
+ *
+ * REQUIREMENTS:
+ * NA
+ *
+ * INPUT:
+ * NA
+ *
+ * OUTPUT:
+ * NA
+ *
+ * NOTES:
+ * NA
+ *
+ * BUGS:
+ * NA
+ *
+ * AUTHOR:
+ * METNO/FOU, 17.10.2026
+ *
+ * MODIFIED:
+ * NA
+ *
+ * ID:
+ * $Id$
+ */
+
+#ifndef BENCH_SCENE_H
+#define BENCH_SCENE_H
+
+#include <fmsnowcover.h>
+
+/*
+ * Time and position of the synthetic scenes, a daytime NOAA-18 pass over
+ * Scandinavia with 1 km pixels centred at BENCH_LAT, BENCH_LON.
+ */
+#define BENCH_SATID "noaa18"
+#define BENCH_YEAR 2009
+#define BENCH_YDAY 105
+#define BENCH_SECOFDAY 39600.
+#define BENCH_LAT 65.
+#define BENCH_LON 15.
+#define BENCH_PIXSIZE 1. /* km */
+#define BENCH_SEED 20091504UL
+
+int bench_scene_ucs(int iw, int ih, fmucsref *ref);
+float bench_scene_noise(int col, int row, int layer);
+int bench_write_scene(char *fname, int iw, int ih);
+int bench_write_lmask(char *fname, int iw, int ih);
+int bench_write_coeffs(char *fname);
+
+#endif /* BENCH_SCENE_H */
@@ -9,7 +9,8 @@
  * 
  * SYNTAX: accusnow -s <dir_fmsnow> -d <date_end> 
  *         -p <period> -a <pref_outf> -o <path_outf>
- *         (-t <satellite> -l <satlist> -m <arealist> -z)
+ *         (-t <satellite> -l <satlist> -m <arealist> -z -x <level>
+ *         -n <threads> -k <ckpdir> -w <workers> -b <budget>)
  *
  *    <dir_fmsnow>  : Directory with hdf5 files with fmsnow data.
  *    <date_end>     : End date of merging period.
@@ -20,6 +21,16 @@
  *    <satlist>      : File with satellites to use (optional).
  *    <arealist>     : File with tile areas to use (optional).
  *    -z             : Use threshold on satellite zenith angle (value from header file).
+ *    <level>        : Deflate level (0-9) of chunked HDF5 output (optional).
+ *    <threads>      : Threads reading the input files of a tile, 0 for
+ *                     all processors (optional, default 1).
+ *    <ckpdir>       : Directory of accumulator checkpoints, one per tile
+ *                     and satellite selection, with a slice of each
+ *                     pass of the period (optional).
+ *    <workers>      : Tiles processed concurrently, 0 for all processors
+ *                     (optional, default 1).
+ *    <budget>       : Memory in MB of the tiles processed at a time, 0
+ *                     for no limit (optional, default 0).
  *
  * NOTE:
  * NA
@@ -33,6 +44,17 @@
  * ystein Gody, METNO/FOU, 23.04.2009: More cleaning of software.
  * Mari Anne Killie, METNO/FOU, 02.07.2010: Replacing
  * store_mitiff_.. with store_snow.
+ * METNO/FOU, 17.10.2026: HDF5 output in compressed chunks (-x).
+ * METNO/FOU, 17.10.2026: Input files read by several threads (-n).
+ * METNO/FOU, 17.10.2026: Accumulator checkpoints (-k), input files of
+ * a tile are processed in the order of their names.
+ * METNO/FOU, 17.10.2026: Headers of input files are taken from the
+ * header index of the input directory.
+ * METNO/FOU, 17.10.2026: Input directory read once, files collected by
+ * tile (passselect), no fixed limits on satellites and tiles.
+ * METNO/FOU, 17.10.2026: Tiles processed concurrently by a pool of
+ * workers (-w) within a memory budget (-b).
+ * METNO/FOU, 17.10.2026: Memory of a tile released on every return.
  *
  * CVS_ID:
  * $Id: fmaccusnow.c,v 1.10 2011-11-25 13:21:49 mariak Exp $
@@ -42,50 +64,61 @@
 #include <fmaccusnow.h>
 #include <unistd.h>
 
+/*
+ * Settings and passes shared by the tiles, see accusnow_tile.
+ */
+typedef struct {
+    passselect *sel;
+    headerindex *hidx;
+    char **arealist;
+    char *satstring;
+    char *path_outf;
+    char *pref_outf;
+    int period;
+    float cloudlim;
+    fmtime timedate;
+    int nthreads;
+    char *ckpdir;
+    h5prodopts h5opts;
+} accutask;
+
+static int accusnow_tile(tilepool *p, int tile);
+static int accusnow_merge_tile(accutask *task, int tile, osihdf *inputhdf,
+	int nfiles);
+
 int main(int argc, char *argv[]) {    
     char *where="fmaccusnow";
     extern char *optarg;
     char *dir_avhrrice, *date_start, *date_prod, *date_end;
     int sflg, dflg, pflg, aflg, oflg, tflg, lflg, mflg, zflg, cflg;
-    int period, i, j, f, t, tile, nrInput, ret, ind, numf;
+    int period, i, j, f, t, nrInput, ret, ind, numf;
     int numsat, numarea;
     fmsec1970 stime, ftime, etime, prodtime;
     float cloudlim;
-    char **infile_avhrrice, *outfHDF, *outfMITIFF_class, *outfMITIFF_psnow;
-    char **infile_sorted,**infile_currenttile;
     char *pref_outf, *path_outf, *checkfile, *sret, datestr[13], *procsat; 
     char datestr_ymdhms[15];
     char *satlistfile, *arealistfile, **satlist, **arealist;
     fmtime timedate;
-    fmucsref refucs;
     struct dirent *dirl_avhrrice;
     DIR *dirp_avhrrice;
     char *defpref = "accusnow";
-    char *pref_ps = "sp";
-    char *pref_cl = "cl";
     int satfound;
     char *satstring; /*To be used in output filenames*/
-    osihdf snowprod, checkfileheader;
-    osihdf *inputhdf;
-    char *prod_desc[FMACCUSNOWPROD_LEVELS] = {"class","P(snow)","P(clear)"};
-    osi_dtype prod_ft[FMACCUSNOWPROD_LEVELS] = {CLASS_DT,PROB_DT,PROB_DT};
-    unsigned char *catclass, *snowclass;
-    float *probsnow, *probclear;
-    int sorted_index, index_offset;
-    int *num_files_area, *num_files_area_counter, *numCloudfree;
+    osihdf checkfileheader;
     char *default_arealist[TOTAREAS] ={"ns","nr","at","gr","gn","gf","gm","gs"};
-    char checkstr[10];
-    int image_type; /*0: probability for snow, 1: classed image/category
-		     *2: updated with sar   */
-    fmio_mihead clinfo = {
-	"Not known",
-	00, 00, 00, 00, 0000, -9, 
-	{0, 0, 0, 0, 0, 0, 0, 0}, 
-	0, 0, 0, 0., 0., -999., -999.
-    };
-    int include_sar = 0;
+    int nthreads = 1;
+    int nworkers = 1;
+    long long budget = 0;
+    char *ckpdir = NULL;
+    headerindex hidx;
+    headerentry *hent;
+    PRODhead candh;
+    int nindexed, naddindex, addindex;
+    passselect sel;
+    accutask task;
+    h5prodopts h5opts;
   
-    if (!(argc >= 9 && argc <= 18)) usage();
+    if (!(argc >= 9 && argc <= 28)) usage();
 
     fprintf(stdout,"\n");
     fprintf(stdout,"\t=================================================\n");
@@ -95,7 +128,8 @@ int main(int argc, char *argv[]) {
 
     /* Interprete commandline arguments */
     sflg=dflg=pflg=aflg=oflg=tflg=lflg=mflg=zflg=cflg=0;
-    while ((ret = getopt(argc, argv, "s:d:p:a:o:t:l:m:c:z")) != EOF) {
+    h5prodopts_init(&h5opts);
+    while ((ret = getopt(argc, argv, "s:d:p:a:o:t:l:m:c:zx:n:k:w:b:")) != EOF) {
 	switch (ret) {
 	    case 's':
 		dir_avhrrice = (char *) malloc(strlen(optarg)+1);
@@ -171,6 +205,35 @@ int main(int argc, char *argv[]) {
 	    case 'z':
 		zflg++;
 		break;
+	    case 'x':
+		h5opts.deflate = atoi(optarg);
+		break;
+	    case 'n':
+		nthreads = atoi(optarg);
+		if (nthreads < 1) {
+		    nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+		    if (nthreads < 1) nthreads = 1;
+		}
+		break;
+	    case 'k':
+		ckpdir = (char *) malloc(strlen(optarg)+1);
+		if (! ckpdir) {
+		    fmerrmsg(where,"Could not allocate ckpdir");
+		    exit(FM_MEMALL_ERR);
+		}
+		if (!strcpy(ckpdir, optarg)) exit(FM_IO_ERR);
+		break;
+	    case 'w':
+		nworkers = atoi(optarg);
+		if (nworkers < 1) {
+		    nworkers = sysconf(_SC_NPROCESSORS_ONLN);
+		    if (nworkers < 1) nworkers = 1;
+		}
+		break;
+	    case 'b':
+		budget = atoll(optarg)*1024*1024;
+		if (budget < 0) budget = 0;
+		break;
 	    default:
 		usage();
 	}
@@ -239,41 +302,41 @@ int main(int argc, char *argv[]) {
 	fprintf(stdout,"\tUsing area tiles from file: %s \n", arealistfile);
     }
 
-    satlist = (char **) malloc(MAXSAT*sizeof(char *)); 
-    if (! satlist) {
-	fmerrmsg(where,"Could not allocate satlist");
-	exit(FM_MEMALL_ERR);
-    }
-
     /* 
      * Read satellite name list 
      */
     numsat = 0;
+    satlist = NULL;
     if (lflg) {
-	numsat = read_sat_area_list(satlistfile,satlist);
+	numsat = read_sat_area_list(satlistfile,&satlist);
 	if (numsat == 0) {
-	    fprintf(stderr,
-	    "\n\tFound NO satellites on file %s\n\texiting..\n\n",satlistfile);
+	    fmerrmsg(where,"Found no satellites on %s",satlistfile);
+	    exit(FM_IO_ERR);
 	} else if (numsat < 0) {
 	    fmerrmsg(where,"Could not read %s, processing all passages.",
 		     satlistfile);
+	    numsat = 0;
 	    lflg = 0;
-	} else {
-	    fprintf(stdout,"\n\tProcessing satellites (%d): \n\t  ",numsat);
-	    satstring = (char *) malloc(LISTLEN*sizeof(char));
-	    if (! satstring) {
-		fmerrmsg(where,"Could not allocate satstring");
-		exit(FM_MEMALL_ERR);
-	    }
-	    for (i=0;i<numsat;i++) { 
-		fprintf(stdout,"%s ",satlist[i]);
-		if (i != 0) strcat(satstring,"_");
-		strcat(satstring,satlist[i]);
-	    }
-	    fprintf(stdout,"\n");
 	}
+    }
+    if (lflg) {
+	fprintf(stdout,"\n\tProcessing satellites (%d): \n\t  ",numsat);
+	j = 1;
+	for (i=0;i<numsat;i++) j += strlen(satlist[i])+1;
+	satstring = (char *) malloc(j*sizeof(char));
+	if (! satstring) {
+	    fmerrmsg(where,"Could not allocate satstring");
+	    exit(FM_MEMALL_ERR);
+	}
+	satstring[0] = '\0';
+	for (i=0;i<numsat;i++) { 
+	    fprintf(stdout,"%s ",satlist[i]);
+	    if (i != 0) strcat(satstring,"_");
+	    strcat(satstring,satlist[i]);
+	}
+	fprintf(stdout,"\n");
     } else if (tflg) {
-	satstring = (char *) malloc(strlen(procsat)*sizeof(char));
+	satstring = (char *) malloc((strlen(procsat)+1)*sizeof(char));
 	if (! satstring) {
 	    fmerrmsg(where,"Could not allocate satstring");
 	    exit(FM_MEMALL_ERR);
@@ -290,13 +353,9 @@ int main(int argc, char *argv[]) {
     }
 
     numarea = 0;
-    arealist = (char **) malloc(MAXAREA*sizeof(char *));
-    if (! arealist) {
-	fmerrmsg(where,"Could not allocate arealist");
-	exit(FM_MEMALL_ERR);
-    }
+    arealist = NULL;
     if (mflg) {/* Read tile list */
-	numarea = read_sat_area_list(arealistfile,arealist);
+	numarea = read_sat_area_list(arealistfile,&arealist);
 	if (numarea == 0) {
 	    fmerrmsg(where,"Found no area tiles on %s",arealistfile);
 	    exit(FM_IO_ERR);
@@ -326,22 +385,11 @@ int main(int argc, char *argv[]) {
     fprintf(stdout,"\n");
 
     /* 
-     * Allocate and initialise variables to handle sorting of files 
-     * based on tile
+     * Passes are collected in one bucket for each tile.
      */
-    num_files_area = (int *)malloc(numarea*sizeof(int));
-    if (! num_files_area) {
-	fmerrmsg(where,"Could not allocate num_files_area");
-	exit(FM_MEMALL_ERR);
-    }
-    num_files_area_counter = (int *)malloc(numarea*sizeof(int));
-    if (! num_files_area_counter) {
-	fmerrmsg(where,"Could not allocate num_files_area_counter");
+    if (passselect_init(&sel, arealist, numarea)) {
 	exit(FM_MEMALL_ERR);
     }
-    for (i=0;i<numarea;i++){
-	num_files_area[i] = num_files_area_counter[i] = 0;
-    }
 
     /* 
      * Reading directory, find all avhrrice files to process. 
@@ -352,38 +400,22 @@ int main(int argc, char *argv[]) {
 	return(FM_IO_ERR);
     }
 
-    numf = 0;
-    while ((dirl_avhrrice = readdir(dirp_avhrrice)) != NULL) {
-	if (strncmp(dirl_avhrrice->d_name,BASEFNAME,strlen(BASEFNAME)) == 0 &&
-	    strstr(dirl_avhrrice->d_name,".hdf") != NULL && 
-	    strlen(dirl_avhrrice->d_name) >= MINLENFNAME) {
-	    sret = strncpy(datestr,&dirl_avhrrice->d_name[10],12);
-	    datestr[12] = '\0';
-	    sprintf(datestr_ymdhms,"%s00",datestr);
-	    ftime = ymdhms2fmsec1970(datestr_ymdhms,0);
-	    if (ftime >= stime && ftime <= etime) {
-		numf ++;
-	    }
-	}
+    /*
+     * Headers of indexed products are taken from the header index of the
+     * directory instead of the files.
+     */
+    if (headerindex_read(dir_avhrrice, &hidx)) {
+	fmerrmsg(where,"Could not read header index of %s", dir_avhrrice);
+	exit(FM_IO_ERR);
     }
-    rewinddir(dirp_avhrrice);
+    nindexed = naddindex = 0;
+    addindex = 1;
 
-    infile_avhrrice = (char **) malloc(numf*sizeof(char *));
-    if (! infile_avhrrice) {
-	fmerrmsg(where,"Could not allocate infile_avhrrice");
-	exit(FM_MEMALL_ERR);
-    }
-    infile_sorted   = (char **) malloc(numf*sizeof(char *));
-    if (! infile_sorted) {
-	fmerrmsg(where,"Could not allocate infile_sorted");
-	exit(FM_MEMALL_ERR);
-    }
+    numf = 0;
     i = 0;
 
-
-
     /*
-     * Loop through files
+     * Loop through files, the directory is read once
      */
     while ((dirl_avhrrice = readdir(dirp_avhrrice)) != NULL) {
 
@@ -404,10 +436,22 @@ int main(int argc, char *argv[]) {
 	    if (ftime < stime || ftime > etime) {
 		continue;
 	    }
+	    numf ++;
+
+	    /*
+	     * Check tile, this returns the bucket of the tile.
+	     */
+	    ind = passselect_tile(&sel,dirl_avhrrice->d_name);
+	    if (ind < 0) {
+		fprintf(stdout,"\tFile not in area tile list, skipping %s\n",
+			dirl_avhrrice->d_name);
+		continue;
+	    }
 
 	    /*
 	     * Check that file can be opened (this removes files of size
-	     * zero!
+	     * zero!). Files not in the header index, or changed since
+	     * they were indexed, are opened and added to the index.
 	     */
 	    checkfile = (char *) malloc(256*sizeof(char));
 	    if (! checkfile) {
@@ -415,15 +459,31 @@ int main(int argc, char *argv[]) {
 		exit(FM_MEMALL_ERR);
 	    }
 	    sprintf(checkfile,"%s/%s",dir_avhrrice,dirl_avhrrice->d_name);
-	    init_osihdf(&checkfileheader);
-	    ret = read_hdf5_product(checkfile,&checkfileheader,1);
-	    free(checkfile);
-	    if (ret != 0) {
-	      fmerrmsg(where,"Could not open %s, skipping file",
-		       dirl_avhrrice->d_name);
-		free_osihdf(&checkfileheader);
-		continue;
+	    hent = headerindex_lookup(&hidx, checkfile);
+	    if (hent) {
+		candh = hent->h;
+		nindexed++;
+	    } else {
+		init_osihdf(&checkfileheader);
+		ret = read_hdf5_product(checkfile,&checkfileheader,1);
+		if (ret != 0) {
+		  fmerrmsg(where,"Could not open %s, skipping file",
+			   dirl_avhrrice->d_name);
+		    free_osihdf(&checkfileheader);
+		    free(checkfile);
+		    continue;
+		}
+		candh = checkfileheader.h;
+		if (lflg || tflg) free_osihdf(&checkfileheader);
+		if (addindex) {
+		    if (headerindex_add(checkfile, candh)) {
+			addindex = 0;
+		    } else {
+			naddindex++;
+		    }
+		}
 	    }
+	    free(checkfile);
 
 	    /*
 	     * Check satellite name. satname is not part of input
@@ -433,54 +493,43 @@ int main(int argc, char *argv[]) {
 	    if (lflg || tflg) { 
 		satfound = 0;
 		if (tflg) {
-		    if (strstr(checkfileheader.h.source,procsat)) {
+		    if (strstr(candh.source,procsat)) {
 			satfound++;
 		    } 
 		}
 		else {
 		    for (j=0;j<numsat;j++) { 
-			if (strstr(checkfileheader.h.source,satlist[j])) {
+			if (strstr(candh.source,satlist[j])) {
 			    satfound++;
 			}
 		    }
 		} 
-		free_osihdf(&checkfileheader);
 		if (!satfound) {
 		    continue;
 		}
 	    }
 
 	    /*
-	     * Check tile, this returns the element number.
-	     */
-	    ind = find_sat_area_index(arealist,numarea,dirl_avhrrice->d_name);
-	    if (ind < 0) {
-		fprintf(stdout,"\tFile not in area tile list, skipping %s\n",
-			dirl_avhrrice->d_name);
-		continue;
-	    }
-
-	    /*
-	     * If all tests passed, add to list of ok files :-)
+	     * If all tests passed, add to the bucket of the tile :-)
 	     */
-	    infile_avhrrice[i] = (char *) malloc(256*sizeof(char));
-	    if (! infile_avhrrice[i]) {
-		fmerrmsg(where,"Could not allocate infile_avhrrice[%d]", i);
-		exit(FM_MEMALL_ERR);
-	    }
-	    infile_sorted[i]   = (char *) malloc(256*sizeof(char));
-	    if (! infile_sorted[i]) {
-		fmerrmsg(where,"Could not allocate infile_sorted[%d]", i);
+	    if (passselect_add(&sel,ind,dir_avhrrice,dirl_avhrrice->d_name)) {
 		exit(FM_MEMALL_ERR);
 	    }
-	    sprintf(infile_avhrrice[i],"%s/%s",dir_avhrrice,
-		    dirl_avhrrice->d_name);
 	    i ++;
-	    num_files_area[ind]++;
 	}
     }
-    free(dir_avhrrice);
+    closedir(dirp_avhrrice);
     nrInput = i;
+    fmlogmsg(where,"Took %d headers from the header index, %d were added.",
+	    nindexed, naddindex);
+    if (naddindex > 0) {
+	headerindex_free(&hidx);
+	if (headerindex_read(dir_avhrrice, &hidx)) {
+	    fmerrmsg(where,"Could not read header index of %s", dir_avhrrice);
+	    exit(FM_IO_ERR);
+	}
+    }
+    free(dir_avhrrice);
 
     if (nrInput == 0) {
 	fmerrmsg(where,"No files to be processed.");
@@ -492,29 +541,14 @@ int main(int argc, char *argv[]) {
 
  
 
-    for (i=0;i<nrInput;i++) {
-	fprintf(stdout,"\t%2d %s\n",i,infile_avhrrice[i]);
-    }
-
     fmlogmsg(where,"Sorting the file to process.");
+    passselect_sort(&sel);
     for (t=0;t<numarea;t++) {
 	fprintf(stdout,
 		"\t\tTile: %s  Number of files: %d\n",
-		arealist[t],num_files_area[t]);
-	num_files_area_counter[t] = 0;
-    }
-    for (i=0;i<nrInput;i++) {
-	for (t=0;t<numarea;t++) {
-	    sprintf(checkstr,"fmsnow_%2s",arealist[t]);
-	    if (strstr(infile_avhrrice[i],checkstr)) {
-		sorted_index = 0;
-		for (j=0;j<t;j++) {
-		    sorted_index += num_files_area[j];
-		}
-		sorted_index+=num_files_area_counter[t];
-		sprintf(infile_sorted[sorted_index],"%s",infile_avhrrice[i]) ;
-		num_files_area_counter[t]++;
-	    }
+		arealist[t],sel.b[t].n);
+	for (f=0;f<sel.b[t].n;f++) {
+	    fprintf(stdout,"\t%2d %s\n",f,sel.b[t].fname[f]);
 	}
     }
 
@@ -531,454 +565,569 @@ int main(int argc, char *argv[]) {
     }
 
     
-    for (tile=0;tile<numarea;tile++){
+    /*
+     * Process the tiles, by nworkers workers holding at most budget
+     * bytes of tile accumulators at a time.
+     */
+    task.sel = &sel;
+    task.hidx = &hidx;
+    task.arealist = arealist;
+    task.satstring = satstring;
+    task.path_outf = path_outf;
+    task.pref_outf = pref_outf;
+    task.period = period;
+    task.cloudlim = cloudlim;
+    task.timedate = timedate;
+    task.nthreads = nthreads;
+    task.ckpdir = ckpdir;
+    task.h5opts = h5opts;
+    ret = tilepool_run(numarea, nworkers, budget, accusnow_tile, &task);
+    if (ret != 0) {
+	fmerrmsg(where,"Could not process all tiles");
+	exit(ret);
+    }
 
-	if (num_files_area[tile]==0) {
-	    fprintf(stdout,
-       "\t No input files for tile %s, continuing on list\n",arealist[tile]);
-	    continue;
-	}
+    /* 
+     * Free some more memory used outside the tilehandling
+     */
+    free(date_start);
+    if (aflg) { 
+	free(pref_outf); 
+    }
+    free(path_outf);
+    free(satstring);
 
-	index_offset=0;
-	for (t=0;t<tile;t++) {
-	    index_offset += num_files_area[t];
-	}
+    for (i=0;i<numsat;i++) { 
+	free(satlist[i]); 
+    }
+    free(satlist);
 
-	/*
-	 * Creating list of files for this tile
-	 */
-	infile_currenttile = (char **) malloc(num_files_area[tile]*sizeof(char *));
-	if (! infile_currenttile) {
-	    fmerrmsg(where,"Could not allocate infile_currenttile");
-	    exit(FM_MEMALL_ERR);
-	}
-	for (f=0;f<num_files_area[tile];f++) {
-	    infile_currenttile[f] = (char *) malloc(256*sizeof(char));
-	    if (! infile_currenttile[f]) {
-		fmerrmsg(where,"Could not allocate infile_currenttile[%d]", f);
-		exit(FM_MEMALL_ERR);
-	    }
-	    sprintf(infile_currenttile[f],"%s",infile_sorted[f+index_offset]);
-	}
+    passselect_free(&sel);
+    if (mflg) {
+	for (i=0;i<numarea;i++) { free(arealist[i]); }
+	free(arealist);
+    }
 
-	inputhdf = (osihdf *) malloc(num_files_area[tile]*sizeof(osihdf));
-	if (! inputhdf) {
-	    fmerrmsg(where,"Could not allocate inputhdf");
-	    exit(FM_MEMALL_ERR);
-	}
+    headerindex_free(&hidx);
 
-	/*
-	 * Initialise the structure to hold the data
-	 */
-	init_osihdf(&snowprod);
+    if (lflg) {free(satlistfile);}
+    if (mflg) {free(arealistfile);}
 
-	/*
-	 * Read headers of all files on list to compare products and collect
-	 * information. Products must cover the same area.
-	 */
-	for (f=0;f<num_files_area[tile];f++) {
-	    init_osihdf(&inputhdf[f]);
+    fprintf(stdout,"\t=================================================\n");
+
+    exit(FM_OK);
+}
+
+/*
+ * Process tile of the pool p of tasks: check the headers of the passes
+ * of the tile, reserve the memory of its accumulators from the budget
+ * of the pool and merge the passes.
+ */
+static int accusnow_tile(tilepool *p, int tile) {
+
+    char *where="fmaccusnow";
+    accutask *task = (accutask *) p->arg;
+    char **infile_currenttile;
+    int f, nfiles, ret;
+    osihdf *inputhdf;
+    headerentry *hent;
+    fmucsref refucs;
+    long long mem;
+
+    if (task->sel->b[tile].n==0) {
+	fprintf(stdout,
+   "\t No input files for tile %s, continuing on list\n",
+	   task->arealist[tile]);
+	return(FM_OK);
+    }
+
+    /*
+     * List of files for this tile, sorted by time
+     */
+    infile_currenttile = task->sel->b[tile].fname;
+    nfiles = task->sel->b[tile].n;
+
+    inputhdf = (osihdf *) malloc(nfiles*sizeof(osihdf));
+    if (! inputhdf) {
+	fmerrmsg(where,"Could not allocate inputhdf");
+	return(FM_MEMALL_ERR);
+    }
+
+    /*
+     * Read headers of all files on list to compare products and collect
+     * information. Products must cover the same area.
+     */
+    for (f=0;f<nfiles;f++) {
+	init_osihdf(&inputhdf[f]);
+	hent = headerindex_lookup(task->hidx, infile_currenttile[f]);
+	if (hent) {
+	    inputhdf[f].h = hent->h;
+	} else {
+	    accusnow_h5lock();
 	    ret=read_hdf5_product(infile_currenttile[f],&inputhdf[f], 1);
+	    accusnow_h5unlock();
 	    if (ret != 0) {
-	fmerrmsg(where,"Could not read header of %s",infile_currenttile[f]);
+		fmerrmsg(where,"Could not read header of %s",
+			infile_currenttile[f]);
 	    }
-	    if (inputhdf[f].h.iw != inputhdf[0].h.iw ||
-		    inputhdf[f].h.ih != inputhdf[0].h.ih ||
-		    inputhdf[f].h.Ax != inputhdf[0].h.Ax ||
-		    inputhdf[f].h.Ay != inputhdf[0].h.Ay ||
-		    inputhdf[f].h.Bx != inputhdf[0].h.Bx ||
-		    inputhdf[f].h.By != inputhdf[0].h.By ) {
+	}
+	if (inputhdf[f].h.iw != inputhdf[0].h.iw ||
+		inputhdf[f].h.ih != inputhdf[0].h.ih ||
+		inputhdf[f].h.Ax != inputhdf[0].h.Ax ||
+		inputhdf[f].h.Ay != inputhdf[0].h.Ay ||
+		inputhdf[f].h.Bx != inputhdf[0].h.Bx ||
+		inputhdf[f].h.By != inputhdf[0].h.By ) {
 	    fmerrmsg(where,"Input files for tile %s, are from different tiles.",
-		     arealist[tile]);
-		exit(FM_IO_ERR);
-	    }
+		    task->arealist[tile]);
+	    free(inputhdf);
+	    return(FM_IO_ERR);
 	}
+    }
 
-	snowprod.h.iw = inputhdf[0].h.iw;
-	snowprod.h.ih = inputhdf[0].h.ih;
-	snowprod.h.z  = inputhdf[0].h.z;
-	snowprod.h.Ax = inputhdf[0].h.Ax;
-	snowprod.h.Ay = inputhdf[0].h.Ay;
-	snowprod.h.Bx = inputhdf[0].h.Bx;
-	snowprod.h.By = inputhdf[0].h.By;
-	snowprod.h.year = timedate.fm_year;
-	snowprod.h.month = timedate.fm_mon;
-	snowprod.h.day = timedate.fm_mday;
-	snowprod.h.hour = timedate.fm_hour;
-	snowprod.h.minute = timedate.fm_min;
-	sprintf(snowprod.h.area, "%s", inputhdf[0].h.area);
-	sprintf(snowprod.h.source, "%s", inputhdf[0].h.source);
-	sprintf(snowprod.h.product, "%s", inputhdf[0].h.product);
-	sprintf(snowprod.h.projstr, "%s", inputhdf[0].h.projstr);
-
-	refucs.Ax = snowprod.h.Ax;
-	refucs.Ay = snowprod.h.Ay;
-	refucs.Bx = snowprod.h.Bx;
-	refucs.By = snowprod.h.By;
-	refucs.iw = snowprod.h.iw;
-	refucs.ih = snowprod.h.ih;
-
-	sprintf(clinfo.satellite,"%s",satstring);
-	clinfo.hour = snowprod.h.hour;
-	clinfo.minute = snowprod.h.minute;
-	clinfo.day = snowprod.h.day;
-	clinfo.month = snowprod.h.month;
-	clinfo.year = snowprod.h.year;
-	clinfo.zsize = 1;
-	clinfo.xsize = snowprod.h.iw;
-	clinfo.ysize = snowprod.h.ih;
-	clinfo.Ax = snowprod.h.Ax;
-	clinfo.Ay = snowprod.h.Ay;
-	clinfo.Bx = snowprod.h.Bx;
-	clinfo.By = snowprod.h.By;
-
-	catclass = (unsigned char *) malloc(refucs.iw*refucs.ih*sizeof(char));
-	snowclass = (unsigned char *) malloc(refucs.iw*refucs.ih*sizeof(char));
-	probsnow = (float *) malloc(refucs.iw*refucs.ih*sizeof(float));
-	probclear = (float *) malloc(refucs.iw*refucs.ih*sizeof(float));
-	numCloudfree = (int *) malloc(refucs.iw*refucs.ih*sizeof(int));
-
-       if (!catclass || !snowclass || !probsnow || !probclear || !numCloudfree){
-	    fmerrmsg(where,"Could not allocate memory");
-	    exit(FM_MEMALL_ERR);
-	}
+    /*
+     * Memory of the accumulators and products of the tile, and of the
+     * passes being merged.
+     */
+    refucs.iw = inputhdf[0].h.iw;
+    refucs.ih = inputhdf[0].h.ih;
+    mem = average_merge_mem(refucs, inputhdf[0].h.z, task->nthreads) +
+	(long long) refucs.iw*refucs.ih*(2*sizeof(unsigned char)+
+	2*sizeof(float)+sizeof(int)+FMACCUSNOWPROD_LEVELS*sizeof(float));
+    fmlogmsg(where,"Tile %s holds %lld MB", task->arealist[tile],
+	    mem/(1024*1024));
+
+    ret = tilepool_reserve(p, mem);
+    if (ret == FM_OK) {
+	ret = accusnow_merge_tile(task, tile, inputhdf, nfiles);
+	tilepool_release(p, mem);
+    }
+    free(inputhdf);
 
-	for (i=0;i<refucs.iw*refucs.ih;i++) {
-	    catclass[i]  = C_UNDEF; 
-	    snowclass[i] = 0;
-	    probsnow[i]  = PROB_MISVAL;
-	    probclear[i] = PROB_MISVAL;
-	    numCloudfree[i]= 0;
-	}
+    return(ret);
+}
 
-	/*
-	 * Do the time integration using the method chosen...
-	 */
-	if (num_files_area[tile] > 0) {
-	    fprintf(stdout,"\n\tNow averaging tile %s (%d files)..\n",
-		    arealist[tile],num_files_area[tile]);
-	    ret = average_merge_files(infile_currenttile, num_files_area[tile],
-				      refucs, catclass, snowclass, probsnow, 
-				      probclear, cloudlim, numCloudfree); 
-	    if (ret != 0) {
-		fmerrmsg(where,"Could not finish average_merge_files");
-		exit(FM_OTHER_ERR);
-	    }
-	}
+/*
+ * Merge the nfiles passes of tile, with headers inputhdf, and store the
+ * products of the tile.
+ */
+static int accusnow_merge_tile(accutask *task, int tile, osihdf *inputhdf,
+	int nfiles) {
 
-	/*
-	 * Include SAR here - first version! Move to separate routine later.
-	 */
-	if (include_sar > 0){
-	  /*Check if sar-file for this tile is available, with date
-	    matching. Also (later!) check that tile info matches
-	    (position, resolution etc.). Then look for high
-	    probability of wet snow in SAR. Pixels with high
-	    probability of wet snow should update the accumulated
-	    product (how!?), first version is to expand the average*/
-
-	  char *sardir = "/home/mariak/fmprojects/fmsnowcover/etc";
-	  char *sarfname = "SAR_polarstereo_200905150500_ns.hdf5";
-	  char *sarfile, *outfWITHSARmitiff_psnow, *outfUpdSARmitiff;
-	  osihdf sar_h5p;
-	  float *probsnow_withsar, sar_wsprob;
-	  float WSPROBLIM = 0.5;
-	  unsigned char *wetsnowclass, *sar_ws_flg;
-	  char *sarsatstring = "AVHRR_SAR"; 
-	  char *sarflgstring = "SARupdated";
-	  sarfile = (char *) malloc(FILELEN);
-	  sprintf(sarfile,"%s/%s",sardir,sarfname);
-	  fmlogmsg(where,"Including SAR");
-
-	  /*Search for SAR files. Check if correct tile*/
-	  /*Run through files on SAR list and check header info for each*/
-
-	  ind = find_sat_area_index(arealist,numarea,sarfile);
-	  if (ind < 0) {
-	    fprintf(stdout,"\tSAR File not in area tile list, skipping %s\n",
-		    sarfile);
-	    continue;
-	  }
-
-	  probsnow_withsar = (float *)malloc(refucs.iw*refucs.ih*sizeof(float));
-	  sar_ws_flg=(unsigned char *)malloc(refucs.iw*refucs.ih*sizeof(char));
-	  wetsnowclass=(unsigned char*)malloc(refucs.iw*refucs.ih*sizeof(char));
-
-	  if (!probsnow_withsar || !sar_ws_flg || !wetsnowclass) {
-	    fmerrmsg(where,"Could not allocate memory");
-	    exit(FM_MEMALL_ERR);
-	  }
-	  
-	  /*Initialize probsnow_withsar, sar_ws_flt, wetsnowclass*/
-	  init_osihdf(&sar_h5p);
-	  ret = read_hdf5_product(sarfile,&sar_h5p,0); /*0:reads everything*/
-	  if (ret) {
-	    fprintf(stderr,
-		    "Trouble encountered when reading SAR file %s.\n", 
-		    sarfile);
-	    fprintf(stderr,"\t Skipping file.\n");
-	  }
-	  else {
-	    fmlogmsg(where,"SAR file read");
-	  /*Later: add checking that tile, proj etc is the same!!*/
-	  
-	  /*loop through pixels, update probability if high prob of wet snow*/
-	  for (i=0;i<refucs.iw*refucs.ih;i++){
-	    probsnow_withsar[i] = probsnow[i];
-	    sar_wsprob =((float *) sar_h5p.d->data)[i];
-	    if (sar_wsprob > WSPROBLIM){
-	      sar_ws_flg[i]=1;/*Keeps track of which pixels SAR has updated*/
-	      probsnow_withsar[i] = probsnow[i]*numCloudfree[i] + sar_wsprob;
-	      probsnow_withsar[i] = probsnow_withsar[i]/(numCloudfree[i]+1);
-	    }
-	    if (probsnow_withsar[i] < 0.0) {
-	      wetsnowclass[i] = 0;
-	    } else if (probsnow_withsar[i] < 0.05) {
-	      wetsnowclass[i] = 1;
-	    } else if (probsnow_withsar[i] < 0.10) {
-	      wetsnowclass[i] = 2;
-	    } else if (probsnow_withsar[i] < 0.15) {
-	      wetsnowclass[i] = 3;
-	    } else if (probsnow_withsar[i] < 0.20) {
-	      wetsnowclass[i] = 4;
-	    } else if (probsnow_withsar[i] < 0.25) {
-	      wetsnowclass[i] = 5;
-	    } else if (probsnow_withsar[i] < 0.30) {
-	      wetsnowclass[i] = 6;
-	    } else if (probsnow_withsar[i] < 0.35) {
-	      wetsnowclass[i] = 7;
-	    } else if (probsnow_withsar[i] < 0.40) {
-	      wetsnowclass[i] = 8;
-	    } else if (probsnow_withsar[i] < 0.45) {
-	      wetsnowclass[i] = 9;
-	    } else if (probsnow_withsar[i] < 0.50) {
-	      wetsnowclass[i] = 10;
-	    } else if (probsnow_withsar[i] < 0.55) {
-	      wetsnowclass[i] = 11;
-	    } else if (probsnow_withsar[i] < 0.60) {
-	      wetsnowclass[i] = 12;
-	    } else if (probsnow_withsar[i] < 0.65) {
-	      wetsnowclass[i] = 13;
-	    } else if (probsnow_withsar[i] < 0.70) {
-	      wetsnowclass[i] = 14;
-	    } else if (probsnow_withsar[i] < 0.75) {
-	      wetsnowclass[i] = 15;
-	    } else if (probsnow_withsar[i] < 0.80) {
-	      wetsnowclass[i] = 16;
-	    } else if (probsnow_withsar[i] < 0.85) {
-	      wetsnowclass[i] = 17;
-	    } else if (probsnow_withsar[i] < 0.90) {
-	      wetsnowclass[i] = 18;
-	    } else if (probsnow_withsar[i] < 0.95) {
-	      wetsnowclass[i] = 19;
-	    } else if (probsnow_withsar[i] <= 1.0) {
-	      wetsnowclass[i] = 20;
-	    } else {
-	      wetsnowclass[i] = 0;
-	    }
-	  }
-  
-	  /* 
-	   * Create MITIFF for SAR-updated, classified ice probability image 
-	   */
-	  image_type = 0;
-	  sprintf(clinfo.satellite,"%s",sarsatstring);
-	  outfWITHSARmitiff_psnow = (char *) malloc(FILELEN+5);
-	  if (!outfWITHSARmitiff_psnow) {
-	    fmerrmsg(where,"Could not allocate memory for SAR mitiff file"); 
-	  } else {
-	    sprintf(outfWITHSARmitiff_psnow,
-		    "%s/%s-%s_%s_%04d%02d%02d%02d-%dhours_%s.mitiff",
-		    path_outf,pref_outf,pref_ps,arealist[tile],
-		    snowprod.h.year,snowprod.h.month,snowprod.h.day,
-		    snowprod.h.hour,period,sarsatstring);
-	    ret = store_snow(outfWITHSARmitiff_psnow, wetsnowclass, clinfo,
-			     image_type);
-	    if (ret != 0)  {
-	      fmerrmsg(where,"Could not create MITIFF file %s", 
-		       outfWITHSARmitiff_psnow);
-	    }
-	    else {
-	      printf("\tAVHRR-SAR product created:\n\t %s\n",
-		     outfWITHSARmitiff_psnow);
-	    }
-	    free(outfWITHSARmitiff_psnow);
-	  }
-	  /*
-	   * For now: create MITIFF that shows which pixels have been
-	   * updated using SAR
-	   */ 
-	  image_type = 2;
-	  sprintf(clinfo.satellite,"%s",sarflgstring);
- 	  outfUpdSARmitiff = (char *) malloc(FILELEN+5);
-	  if (!outfUpdSARmitiff){
-	    fmerrmsg(where,"Could not allocate memory for SAR mitiff file"); 
-	  } else {
-	    sprintf(outfUpdSARmitiff,
-		    "%s/%s-%s_%s_%04d%02d%02d%02d-%dhours_%s.mitiff",
-		    path_outf,pref_outf,pref_ps,arealist[tile],
-		    snowprod.h.year,snowprod.h.month,snowprod.h.day,
-		    snowprod.h.hour,period,sarflgstring);
-	    ret = store_snow(outfUpdSARmitiff,sar_ws_flg,clinfo,image_type);
-	    if (ret != 0)  {
-	      fmerrmsg(where,"Could not create MITIFF file %s", 
-		       outfUpdSARmitiff);
-	    } else {
-	      printf("\tSAR-influence product created:\n\t %s\n",
-		     outfUpdSARmitiff);
-	    }
+    char *where="fmaccusnow";
+    char **arealist = task->arealist;
+    int numarea = task->sel->nbucket;
+    char **infile_currenttile = task->sel->b[tile].fname;
+    char *satstring = task->satstring;
+    char *path_outf = task->path_outf;
+    char *pref_outf = task->pref_outf;
+    int period = task->period;
+    fmtime timedate = task->timedate;
+    char *pref_ps = "sp";
+    char *pref_cl = "cl";
+    int i, ind, ret, status;
+    char *outfHDF = NULL, *outfMITIFF_class = NULL, *outfMITIFF_psnow = NULL;
+    char *ckpfile = NULL;
+    fmucsref refucs;
+    osihdf snowprod;
+    fmbool prodalloc = FMFALSE;
+    char *prod_desc[FMACCUSNOWPROD_LEVELS] = {"class","P(snow)","P(clear)"};
+    osi_dtype prod_ft[FMACCUSNOWPROD_LEVELS] = {CLASS_DT,PROB_DT,PROB_DT};
+    unsigned char *catclass = NULL, *snowclass = NULL;
+    float *probsnow = NULL, *probclear = NULL;
+    int *numCloudfree = NULL;
+    char *sarfile = NULL;
+    float *probsnow_withsar = NULL;
+    unsigned char *wetsnowclass = NULL, *sar_ws_flg = NULL;
+    int image_type; /*0: probability for snow, 1: classed image/category
+		     *2: updated with sar   */
+    fmio_mihead clinfo = {
+	"Not known",
+	00, 00, 00, 00, 0000, -9,
+	{0, 0, 0, 0, 0, 0, 0, 0},
+	0, 0, 0, 0., 0., -999., -999.
+    };
+    int include_sar = 0;
 
-	    free(outfUpdSARmitiff);
-	  }
-	  
-	  free_osihdf(&sar_h5p);
-	  free(sar_ws_flg);
-	  free(probsnow_withsar);
-	  free(wetsnowclass);
-	  }
-	} /*End of if (include_sar > 0) */
-	
+    /*
+     * Initialise the structure to hold the data
+     */
+    init_osihdf(&snowprod);
+
+    snowprod.h.iw = inputhdf[0].h.iw;
+    snowprod.h.ih = inputhdf[0].h.ih;
+    snowprod.h.z  = inputhdf[0].h.z;
+    snowprod.h.Ax = inputhdf[0].h.Ax;
+    snowprod.h.Ay = inputhdf[0].h.Ay;
+    snowprod.h.Bx = inputhdf[0].h.Bx;
+    snowprod.h.By = inputhdf[0].h.By;
+    snowprod.h.year = timedate.fm_year;
+    snowprod.h.month = timedate.fm_mon;
+    snowprod.h.day = timedate.fm_mday;
+    snowprod.h.hour = timedate.fm_hour;
+    snowprod.h.minute = timedate.fm_min;
+    sprintf(snowprod.h.area, "%s", inputhdf[0].h.area);
+    sprintf(snowprod.h.source, "%s", inputhdf[0].h.source);
+    sprintf(snowprod.h.product, "%s", inputhdf[0].h.product);
+    sprintf(snowprod.h.projstr, "%s", inputhdf[0].h.projstr);
+
+    refucs.Ax = snowprod.h.Ax;
+    refucs.Ay = snowprod.h.Ay;
+    refucs.Bx = snowprod.h.Bx;
+    refucs.By = snowprod.h.By;
+    refucs.iw = snowprod.h.iw;
+    refucs.ih = snowprod.h.ih;
+
+    snprintf(clinfo.satellite,sizeof(clinfo.satellite),"%s",satstring);
+    clinfo.hour = snowprod.h.hour;
+    clinfo.minute = snowprod.h.minute;
+    clinfo.day = snowprod.h.day;
+    clinfo.month = snowprod.h.month;
+    clinfo.year = snowprod.h.year;
+    clinfo.zsize = 1;
+    clinfo.xsize = snowprod.h.iw;
+    clinfo.ysize = snowprod.h.ih;
+    clinfo.Ax = snowprod.h.Ax;
+    clinfo.Ay = snowprod.h.Ay;
+    clinfo.Bx = snowprod.h.Bx;
+    clinfo.By = snowprod.h.By;
+
+    catclass = (unsigned char *) malloc(refucs.iw*refucs.ih*sizeof(char));
+    snowclass = (unsigned char *) malloc(refucs.iw*refucs.ih*sizeof(char));
+    probsnow = (float *) malloc(refucs.iw*refucs.ih*sizeof(float));
+    probclear = (float *) malloc(refucs.iw*refucs.ih*sizeof(float));
+    numCloudfree = (int *) malloc(refucs.iw*refucs.ih*sizeof(int));
+
+    status = FM_MEMALL_ERR;
+    if (!catclass || !snowclass || !probsnow || !probclear || !numCloudfree){
+	fmerrmsg(where,"Could not allocate memory");
+	goto cleanup;
+    }
 
-	/*
-	 * Do some freeing, freeing snowprod is not required as not data
-	 * have been allocated yet.
-	 */
-	for (f=0;f<num_files_area[tile];f++) {
-	    free(infile_currenttile[f]);
-	}
-	free(infile_currenttile);
+    for (i=0;i<refucs.iw*refucs.ih;i++) {
+	catclass[i]  = C_UNDEF; 
+	snowclass[i] = 0;
+	probsnow[i]  = PROB_MISVAL;
+	probclear[i] = PROB_MISVAL;
+	numCloudfree[i]= 0;
+    }
 
-	/* 
-	 * Allocate the storage required to handle the hdf5 product 
-	 */
-	ret = malloc_osihdf(&snowprod,prod_ft,prod_desc);
+    /*
+     * Do the time integration using the method chosen...
+     */
+    if (nfiles > 0) {
+	fprintf(stdout,"\n\tNow averaging tile %s (%d files)..\n",
+		arealist[tile],nfiles);
+	if (task->ckpdir) {
+	    ckpfile = (char *) malloc(FILELEN*sizeof(char));
+	    if (! ckpfile) {
+		fmerrmsg(where,"Could not allocate ckpfile");
+		goto cleanup;
+	    }
+	    snprintf(ckpfile,FILELEN,"%s/fmaccusnow_%s_%s.ckp",
+		    task->ckpdir,satstring,arealist[tile]);
+	}
+	ret = average_merge_files(infile_currenttile, nfiles,
+				  refucs, catclass, snowclass, probsnow, 
+				  probclear, task->cloudlim, numCloudfree,
+				  task->nthreads, ckpfile);
+	if (ckpfile) {
+	    free(ckpfile);
+	    ckpfile = NULL;
+	}
 	if (ret != 0) {
-	    fmerrmsg(where,"Could not run malloc_osihdf");
-	    return(FM_MEMALL_ERR); 
+	    fmerrmsg(where,"Could not finish average_merge_files");
+	    status = FM_OTHER_ERR;
+	    goto cleanup;
 	}
+    }
 
-	for (i=0;i<refucs.iw*refucs.ih;i++){
-	    ((int*)snowprod.d[0].data)[i] = catclass[i];
-	    ((float*)snowprod.d[1].data)[i] = probsnow[i];
-	    ((float*)snowprod.d[2].data)[i] = probclear[i];
+    /*
+     * Include SAR here - first version! Move to separate routine later.
+     */
+    if (include_sar > 0){
+      /*Check if sar-file for this tile is available, with date
+	matching. Also (later!) check that tile info matches
+	(position, resolution etc.). Then look for high
+	probability of wet snow in SAR. Pixels with high
+	probability of wet snow should update the accumulated
+	product (how!?), first version is to expand the average*/
+
+      char *sardir = "/home/mariak/fmprojects/fmsnowcover/etc";
+      char *sarfname = "SAR_polarstereo_200905150500_ns.hdf5";
+      char *outfWITHSARmitiff_psnow, *outfUpdSARmitiff;
+      osihdf sar_h5p;
+      float sar_wsprob;
+      float WSPROBLIM = 0.5;
+      char *sarsatstring = "AVHRR_SAR"; 
+      char *sarflgstring = "SARupdated";
+      sarfile = (char *) malloc(FILELEN);
+      if (!sarfile) {
+	fmerrmsg(where,"Could not allocate memory");
+	goto cleanup;
+      }
+      sprintf(sarfile,"%s/%s",sardir,sarfname);
+      fmlogmsg(where,"Including SAR");
+
+      /*Search for SAR files. Check if correct tile*/
+      /*Run through files on SAR list and check header info for each*/
+
+      ind = find_sat_area_index(arealist,numarea,sarfile);
+      if (ind < 0) {
+	fprintf(stdout,"\tSAR File not in area tile list, skipping %s\n",
+		sarfile);
+	status = FM_OK;
+	goto cleanup;
+      }
+
+      probsnow_withsar = (float *)malloc(refucs.iw*refucs.ih*sizeof(float));
+      sar_ws_flg=(unsigned char *)malloc(refucs.iw*refucs.ih*sizeof(char));
+      wetsnowclass=(unsigned char*)malloc(refucs.iw*refucs.ih*sizeof(char));
+
+      if (!probsnow_withsar || !sar_ws_flg || !wetsnowclass) {
+	fmerrmsg(where,"Could not allocate memory");
+	goto cleanup;
+      }
+
+      /*Initialize probsnow_withsar, sar_ws_flt, wetsnowclass*/
+      init_osihdf(&sar_h5p);
+      ret = read_hdf5_product(sarfile,&sar_h5p,0); /*0:reads everything*/
+      if (ret) {
+	fprintf(stderr,
+		"Trouble encountered when reading SAR file %s.\n", 
+		sarfile);
+	fprintf(stderr,"\t Skipping file.\n");
+      }
+      else {
+	fmlogmsg(where,"SAR file read");
+      /*Later: add checking that tile, proj etc is the same!!*/
+
+      /*loop through pixels, update probability if high prob of wet snow*/
+      for (i=0;i<refucs.iw*refucs.ih;i++){
+	probsnow_withsar[i] = probsnow[i];
+	sar_wsprob =((float *) sar_h5p.d->data)[i];
+	if (sar_wsprob > WSPROBLIM){
+	  sar_ws_flg[i]=1;/*Keeps track of which pixels SAR has updated*/
+	  probsnow_withsar[i] = probsnow[i]*numCloudfree[i] + sar_wsprob;
+	  probsnow_withsar[i] = probsnow_withsar[i]/(numCloudfree[i]+1);
 	}
-
-	fprintf(stdout,"\tAVHRR output files for tile %s:\n",arealist[tile]);
-
-	/* 
-	 * Create the output HDF5 product file 
-	 */
-	outfHDF = (char *) malloc(FILELEN+5);
-	if (!outfHDF) exit(FM_MEMALL_ERR);
-	sprintf(outfHDF,"%s/%s_%s_%04d%02d%02d%02d-%dhours_%s.hdf5",path_outf,
-	    pref_outf,arealist[tile],
-	    snowprod.h.year,snowprod.h.month,snowprod.h.day,snowprod.h.hour,
-	    period,satstring);
-	ret = store_hdf5_product(outfHDF, snowprod);
+	if (probsnow_withsar[i] < 0.0) {
+	  wetsnowclass[i] = 0;
+	} else if (probsnow_withsar[i] < 0.05) {
+	  wetsnowclass[i] = 1;
+	} else if (probsnow_withsar[i] < 0.10) {
+	  wetsnowclass[i] = 2;
+	} else if (probsnow_withsar[i] < 0.15) {
+	  wetsnowclass[i] = 3;
+	} else if (probsnow_withsar[i] < 0.20) {
+	  wetsnowclass[i] = 4;
+	} else if (probsnow_withsar[i] < 0.25) {
+	  wetsnowclass[i] = 5;
+	} else if (probsnow_withsar[i] < 0.30) {
+	  wetsnowclass[i] = 6;
+	} else if (probsnow_withsar[i] < 0.35) {
+	  wetsnowclass[i] = 7;
+	} else if (probsnow_withsar[i] < 0.40) {
+	  wetsnowclass[i] = 8;
+	} else if (probsnow_withsar[i] < 0.45) {
+	  wetsnowclass[i] = 9;
+	} else if (probsnow_withsar[i] < 0.50) {
+	  wetsnowclass[i] = 10;
+	} else if (probsnow_withsar[i] < 0.55) {
+	  wetsnowclass[i] = 11;
+	} else if (probsnow_withsar[i] < 0.60) {
+	  wetsnowclass[i] = 12;
+	} else if (probsnow_withsar[i] < 0.65) {
+	  wetsnowclass[i] = 13;
+	} else if (probsnow_withsar[i] < 0.70) {
+	  wetsnowclass[i] = 14;
+	} else if (probsnow_withsar[i] < 0.75) {
+	  wetsnowclass[i] = 15;
+	} else if (probsnow_withsar[i] < 0.80) {
+	  wetsnowclass[i] = 16;
+	} else if (probsnow_withsar[i] < 0.85) {
+	  wetsnowclass[i] = 17;
+	} else if (probsnow_withsar[i] < 0.90) {
+	  wetsnowclass[i] = 18;
+	} else if (probsnow_withsar[i] < 0.95) {
+	  wetsnowclass[i] = 19;
+	} else if (probsnow_withsar[i] <= 1.0) {
+	  wetsnowclass[i] = 20;
+	} else {
+	  wetsnowclass[i] = 0;
+	}
+      }
+
+      /* 
+       * Create MITIFF for SAR-updated, classified ice probability image 
+       */
+      image_type = 0;
+      sprintf(clinfo.satellite,"%s",sarsatstring);
+      outfWITHSARmitiff_psnow = (char *) malloc(FILELEN+5);
+      if (!outfWITHSARmitiff_psnow) {
+	fmerrmsg(where,"Could not allocate memory for SAR mitiff file"); 
+      } else {
+	sprintf(outfWITHSARmitiff_psnow,
+		"%s/%s-%s_%s_%04d%02d%02d%02d-%dhours_%s.mitiff",
+		path_outf,pref_outf,pref_ps,arealist[tile],
+		snowprod.h.year,snowprod.h.month,snowprod.h.day,
+		snowprod.h.hour,period,sarsatstring);
+	ret = store_snow(outfWITHSARmitiff_psnow, wetsnowclass, clinfo,
+			 image_type);
 	if (ret != 0)  {
-	    fmerrmsg(where,"Could not create HDF file %s", outfHDF);
-	    exit(FM_IO_ERR);
-	}    
-
-	
-	/* 
-	 * Create MITIFF for the classified/categorized image 
-	 */
-	image_type = 1;
-	sprintf(clinfo.satellite,"%s",satstring);
-	outfMITIFF_class = (char *) malloc(FILELEN+5);
-	if (!outfMITIFF_class) exit(FM_MEMALL_ERR);
-	sprintf(outfMITIFF_class,
-	    "%s/%s-%s_%s_%04d%02d%02d%02d-%dhours_%s.mitiff",
-	    path_outf,pref_outf,pref_cl,arealist[tile],
-	    snowprod.h.year,snowprod.h.month,snowprod.h.day,snowprod.h.hour,
-	    period,satstring);
-	ret = store_snow(outfMITIFF_class, catclass, clinfo, image_type);
-	if (ret != 0)  { 
-	    fmerrmsg(where,"Could not create MITIFF file %s", outfMITIFF_class);
-	    exit(FM_IO_ERR);
-	} 
-
-	/* 
-	 * Create MITIFF for ice probability image 
-	 */
-	image_type = 0;
-	sprintf(clinfo.satellite,"%s",satstring);
-	outfMITIFF_psnow = (char *) malloc(FILELEN+5);
-	if (!outfMITIFF_psnow) exit(FM_MEMALL_ERR);
-	sprintf(outfMITIFF_psnow,
-	    "%s/%s-%s_%s_%04d%02d%02d%02d-%dhours_%s.mitiff",
-	    path_outf,pref_outf,pref_ps,arealist[tile],
-	    snowprod.h.year,snowprod.h.month,snowprod.h.day,snowprod.h.hour,
-	    period,satstring);
-	ret = store_snow(outfMITIFF_psnow, snowclass, clinfo, image_type);
+	  fmerrmsg(where,"Could not create MITIFF file %s", 
+		   outfWITHSARmitiff_psnow);
+	}
+	else {
+	  printf("\tAVHRR-SAR product created:\n\t %s\n",
+		 outfWITHSARmitiff_psnow);
+	}
+	free(outfWITHSARmitiff_psnow);
+      }
+      /*
+       * For now: create MITIFF that shows which pixels have been
+       * updated using SAR
+       */ 
+      image_type = 2;
+      sprintf(clinfo.satellite,"%s",sarflgstring);
+      outfUpdSARmitiff = (char *) malloc(FILELEN+5);
+      if (!outfUpdSARmitiff){
+	fmerrmsg(where,"Could not allocate memory for SAR mitiff file"); 
+      } else {
+	sprintf(outfUpdSARmitiff,
+		"%s/%s-%s_%s_%04d%02d%02d%02d-%dhours_%s.mitiff",
+		path_outf,pref_outf,pref_ps,arealist[tile],
+		snowprod.h.year,snowprod.h.month,snowprod.h.day,
+		snowprod.h.hour,period,sarflgstring);
+	ret = store_snow(outfUpdSARmitiff,sar_ws_flg,clinfo,image_type);
 	if (ret != 0)  {
-	    fmerrmsg(where,"Could not create MITIFF file %s", outfMITIFF_psnow);
-	    exit(FM_IO_ERR);
+	  fmerrmsg(where,"Could not create MITIFF file %s", 
+		   outfUpdSARmitiff);
+	} else {
+	  printf("\tSAR-influence product created:\n\t %s\n",
+		 outfUpdSARmitiff);
 	}
 
-	fprintf(stdout,"\t%s\n",outfHDF);
-	fprintf(stdout,"\t%s\n",outfMITIFF_class);
-	fprintf(stdout,"\t%s\n\n",outfMITIFF_psnow);
+	free(outfUpdSARmitiff);
+      }
+
+      free_osihdf(&sar_h5p);
+      }
+    } /*End of if (include_sar > 0) */
 
-	/* 
-	 * Free some memory, check that everything is handled!! 
-	 */
-	free(outfHDF); 
-	free(outfMITIFF_class);
-	free(outfMITIFF_psnow);
-	free(catclass);
-	free(snowclass);
-	free(probsnow);
-	free(probclear);
-	free(numCloudfree);
-	free_osihdf(&snowprod);   
-
-    } /* end for-loop for tile */
+
+    /*
+     * Do some freeing, freeing snowprod is not required as not data
+     * have been allocated yet. The file list is released with sel.
+     */
 
     /* 
-     * Free some more memory used outside the tilehandling
+     * Allocate the storage required to handle the hdf5 product 
      */
-    free(date_start);
-    if (aflg) { 
-	free(pref_outf); 
+    ret = malloc_osihdf(&snowprod,prod_ft,prod_desc);
+    if (ret != 0) {
+	fmerrmsg(where,"Could not run malloc_osihdf");
+	goto cleanup;
     }
-    free(path_outf);
-    free(satstring);
+    prodalloc = FMTRUE;
 
-    for (i=0;i<numsat;i++) { 
-	free(satlist[i]); 
+    for (i=0;i<refucs.iw*refucs.ih;i++){
+	((int*)snowprod.d[0].data)[i] = catclass[i];
+	((float*)snowprod.d[1].data)[i] = probsnow[i];
+	((float*)snowprod.d[2].data)[i] = probclear[i];
     }
-    free(satlist);
 
-    if (mflg) {
-	for (i=0;i<numarea;i++) { free(arealist[i]); }
-	free(arealist);
-    }
+    fprintf(stdout,"\tAVHRR output files for tile %s:\n",arealist[tile]);
 
-    free(num_files_area);
-    free(num_files_area_counter);
-    for (f=0;f<nrInput;f++) {
-	free(infile_avhrrice[f]);
-	free(infile_sorted[f]);
-    }
- 
-    free(infile_avhrrice);
-    free(infile_sorted);
+    /* 
+     * Create the output HDF5 product file 
+     */
+    outfHDF = (char *) malloc(FILELEN+strlen(satstring)+5);
+    if (!outfHDF) goto cleanup;
+    sprintf(outfHDF,"%s/%s_%s_%04d%02d%02d%02d-%dhours_%s.hdf5",path_outf,
+	pref_outf,arealist[tile],
+	snowprod.h.year,snowprod.h.month,snowprod.h.day,snowprod.h.hour,
+	period,satstring);
+    accusnow_h5lock();
+    ret = store_hdf5_product_opts(outfHDF, snowprod, task->h5opts);
+    accusnow_h5unlock();
+    if (ret != 0)  {
+	fmerrmsg(where,"Could not create HDF file %s", outfHDF);
+	status = FM_IO_ERR;
+	goto cleanup;
+    }    
 
-    if (lflg) {free(satlistfile);}
-    if (mflg) {free(arealistfile);}
 
-    fprintf(stdout,"\t=================================================\n");
+    /* 
+     * Create MITIFF for the classified/categorized image 
+     */
+    image_type = 1;
+    snprintf(clinfo.satellite,sizeof(clinfo.satellite),"%s",satstring);
+    outfMITIFF_class = (char *) malloc(FILELEN+strlen(satstring)+5);
+    if (!outfMITIFF_class) goto cleanup;
+    sprintf(outfMITIFF_class,
+	"%s/%s-%s_%s_%04d%02d%02d%02d-%dhours_%s.mitiff",
+	path_outf,pref_outf,pref_cl,arealist[tile],
+	snowprod.h.year,snowprod.h.month,snowprod.h.day,snowprod.h.hour,
+	period,satstring);
+    ret = store_snow(outfMITIFF_class, catclass, clinfo, image_type);
+    if (ret != 0)  { 
+	fmerrmsg(where,"Could not create MITIFF file %s", outfMITIFF_class);
+	status = FM_IO_ERR;
+	goto cleanup;
+    } 
 
-    exit(FM_OK);
+    /* 
+     * Create MITIFF for ice probability image 
+     */
+    image_type = 0;
+    snprintf(clinfo.satellite,sizeof(clinfo.satellite),"%s",satstring);
+    outfMITIFF_psnow = (char *) malloc(FILELEN+strlen(satstring)+5);
+    if (!outfMITIFF_psnow) goto cleanup;
+    sprintf(outfMITIFF_psnow,
+	"%s/%s-%s_%s_%04d%02d%02d%02d-%dhours_%s.mitiff",
+	path_outf,pref_outf,pref_ps,arealist[tile],
+	snowprod.h.year,snowprod.h.month,snowprod.h.day,snowprod.h.hour,
+	period,satstring);
+    ret = store_snow(outfMITIFF_psnow, snowclass, clinfo, image_type);
+    if (ret != 0)  {
+	fmerrmsg(where,"Could not create MITIFF file %s", outfMITIFF_psnow);
+	status = FM_IO_ERR;
+	goto cleanup;
+    }
+
+    fprintf(stdout,"\t%s\n",outfHDF);
+    fprintf(stdout,"\t%s\n",outfMITIFF_class);
+    fprintf(stdout,"\t%s\n\n",outfMITIFF_psnow);
+    status = FM_OK;
+
+    /* 
+     * Free the memory of the tile, on errors as well
+     */
+cleanup:
+    free(outfHDF); 
+    free(outfMITIFF_class);
+    free(outfMITIFF_psnow);
+    free(catclass);
+    free(snowclass);
+    free(probsnow);
+    free(probclear);
+    free(numCloudfree);
+    free(sarfile);
+    free(probsnow_withsar);
+    free(sar_ws_flg);
+    free(wetsnowclass);
+    if (prodalloc) free_osihdf(&snowprod);   
+
+    return(status);
 }
 
 void usage() {
     fprintf(stdout,"\n  SYNTAX: \n");
     fprintf(stdout,"  accusnow -s <dir_avhrrice> -d <date_end> -p <period>\n");
     fprintf(stdout,"\t  -a <pref_outf> -o <path_outf> (-t <satellite name>\n");
-    fprintf(stdout,"\t  -l <satlist> -c <cloudlimit> -m <arealist> -z) \n\n");
+    fprintf(stdout,"\t  -l <satlist> -c <cloudlimit> -m <arealist> -z\n");
+    fprintf(stdout,"\t  -x <level> -n <threads> -k <ckpdir> -w <workers>\n");
+    fprintf(stdout,"\t  -b <budget>) \n\n");
     fprintf(stdout,"  <dir_avhrrice> : Directory with hdf5 files ");
     fprintf(stdout,"with avhrr ice data.\n");
     fprintf(stdout,"  <date_end>   : End date of merging period\n");
@@ -994,6 +1143,21 @@ void usage() {
     fprintf(stdout,
     "  <cloudlimit>   : Probability limit for class cloud (optional).\n");
     fprintf(stdout,"  -z             : Use threshold on satellite ");
-    fprintf(stdout,"zenith angle (not in use!).\n\n");
+    fprintf(stdout,"zenith angle (not in use!).\n");
+    fprintf(stdout,"  <level>        : Deflate level (0-9) of HDF5 output ");
+    fprintf(stdout,"in chunks\n");
+    fprintf(stdout,"                   of %d rows (optional).\n",
+	    H5PROD_CHUNKROWS);
+    fprintf(stdout,"  <threads>      : Threads reading input files, 0 for ");
+    fprintf(stdout,"all processors\n");
+    fprintf(stdout,"                   (optional, default 1).\n");
+    fprintf(stdout,"  <ckpdir>       : Directory of accumulator checkpoints ");
+    fprintf(stdout,"(optional).\n");
+    fprintf(stdout,"  <workers>      : Tiles processed concurrently, 0 for ");
+    fprintf(stdout,"all processors\n");
+    fprintf(stdout,"                   (optional, default 1).\n");
+    fprintf(stdout,"  <budget>       : Memory in MB of the tiles processed ");
+    fprintf(stdout,"at a time, 0 for\n");
+    fprintf(stdout,"                   no limit (optional, default 0).\n\n");
     exit(FM_OK);
 }
@@ -11,6 +11,19 @@
  * MODIFIED: 
  * ystein Gody, METNO/FOU, 23.04.2009: Modified for use within the
  * fmsnowcover package.
+ * METNO/FOU, 17.10.2026: Added store_snow_opts.
+ * METNO/FOU, 17.10.2026: Added h5prodopts and store_hdf5_product_opts.
+ * METNO/FOU, 17.10.2026: Added h5prodbands, the h5prodbands functions
+ * and store_snow_open.
+ * METNO/FOU, 17.10.2026: Added nthreads to average_merge_files.
+ * METNO/FOU, 17.10.2026: Added ckpfile to average_merge_files and
+ * cmp_filename.
+ * METNO/FOU, 17.10.2026: Added headerindex and the headerindex functions.
+ * METNO/FOU, 17.10.2026: Added passselect and the passselect functions,
+ * read_sat_area_list allocates the list. Removed MAXSAT and MAXAREA.
+ * METNO/FOU, 17.10.2026: Added tilepool and the tilepool functions,
+ * average_merge_mem and accusnow_h5lock.
+ * METNO/FOU, 17.10.2026: Added headerindex_tilename.
  *
  * CVS_ID:
  * $Id: fmaccusnow.h,v 1.5 2013-02-01 10:31:28 steingod Exp $
@@ -25,9 +38,11 @@
 #include <math.h>
 #include <safhdf.h>
 #include <tiffio.h>
+#include <hdf5.h>
 #include <fmutil.h>
 #include <fmio.h>
 #include <dirent.h>
+#include <pthread.h>
 
 /*
  * Useful constants
@@ -35,8 +50,7 @@
 #define LISTLEN 100
 #define DEFAULTCLOUD 0.2
 #define TOTAREAS 8
-#define MAXSAT 20
-#define MAXAREA 20
+#define FMACCUSNOW_MAXTHREADS 64 /* Upper limit of readers and workers */
 #define DATESTRINGLENGTH 50 /* Holds even ISO strings */
 
 
@@ -74,6 +88,34 @@
 #define C_UNDEF   5
 #define PROB_MISVAL -199
 
+/*
+ * Storage of datasets in HDF5 products, see store_hdf5_product_opts.
+ * deflate is the compression level 0-9, negative for the storage of
+ * store_hdf5_product (chunks of 50x50 at level 6), chunkrows the number
+ * of rows in a chunk (0 for whole datasets) and shuffle selects the
+ * shuffle filter.
+ */
+#define H5PROD_CHUNKROWS 64
+typedef struct {
+    int deflate;
+    int chunkrows;
+    fmbool shuffle;
+} h5prodopts;
+
+/*
+ * Layers of an HDF5 product being read or written a band of rows at a
+ * time, see h5prodbands_open and h5prodbands_create. The z layers of ih
+ * rows and iw columns are dset.
+ */
+#define H5PROD_MAXLAYERS 16
+typedef struct {
+    hid_t file;
+    int z;
+    int iw;
+    int ih;
+    hid_t dset[H5PROD_MAXLAYERS];
+} h5prodbands;
+
 #define PROBLIMITS 20
 #define CATLIMITS 5
 #define CLASSLIMITSSTR 66
@@ -81,13 +123,79 @@
 #define FILELEN 256 /* standard length of filenames including path */
 #define FMACCUSNOWPROD_LEVELS 3
 
+/*
+ * Header index of a product directory, see headerindex.c. The entries
+ * are sorted by file name, line is the line of the index file an entry
+ * was read from.
+ */
+#define HEADERINDEXFILE "fmsnowheaders.txt"
+typedef struct {
+    char fname[FILELEN];
+    int line;
+    long long size;
+    long long mtime;
+    PRODhead h;
+} headerentry;
+
+typedef struct {
+    int n;
+    int nalloc;
+    headerentry *e;
+} headerindex;
+
+/*
+ * Passes selected for the tiles of fmaccusnow, see passselect.c. Bucket
+ * i holds the n passes, with path, of tile area of arealist[i], hash
+ * maps tile names to buckets.
+ */
+typedef struct {
+    char *area;
+    int n;
+    int nalloc;
+    char **fname;
+} passbucket;
+
+typedef struct {
+    int nbucket;
+    passbucket *b;
+    int nhash;
+    int *hash;
+} passselect;
+
+/*
+ * Workers processing the tiles of fmaccusnow, see tilepool.c. The
+ * function processing a tile is given the pool, holding arg, and the
+ * tile.
+ */
+typedef struct tilepool_ tilepool;
+typedef int (*tilepool_fn)(tilepool *p, int tile);
+
+struct tilepool_ {
+    int ntile; /* number of tiles */
+    int next; /* next tile to start */
+    int status; /* FM_OK until a tile fails */
+    long long budget; /* bytes to reserve at a time, 0 for no limit */
+    long long reserved; /* bytes reserved */
+    int nreserved; /* tiles holding a reservation */
+    tilepool_fn fn;
+    void *arg;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+};
+
 /*
  * Function prototypes.
  */
 int average_merge_files(char **infSST, int nrInput, fmucsref safucs, 
 			unsigned char *class, unsigned char *probclass,
 			float *probice, float *probclear, float cloudlim,
-			int *numCloudfree);
+			int *numCloudfree, int nthreads, char *ckpfile);
+long long average_merge_mem(fmucsref safucs, int z, int nthreads);
+
+void accusnow_h5lock(void);
+void accusnow_h5unlock(void);
+
+int cmp_filename(const void *a, const void *b);
 
 int check_headers(int nrInput, PRODhead hrSSThead[]);
 
@@ -95,9 +203,42 @@ int check_sat_area(char **satlist, int numsat, char *filename);
 
 int find_sat_area_index(char **satlist, int numsat, char *filename);
 
-int read_sat_area_list(char *listfile, char **elemlist);
+int read_sat_area_list(char *listfile, char ***elemlist);
 
 int store_snow(char *fname,unsigned char *im,fmio_mihead clinfo,int image_type);
+int store_snow_opts(char *fname,unsigned char *im,fmio_mihead clinfo,
+	int image_type, fmio_tiffopts opts);
+
+int store_snow_open(char *fname, fmio_mihead clinfo, int image_type,
+	fmio_tiffopts opts, fmio_tiffband *b);
+
+void h5prodopts_init(h5prodopts *opts);
+int store_hdf5_product_opts(char *filename, osihdf f, h5prodopts opts);
+int h5prodbands_create(char *filename, osihdf f, h5prodopts opts,
+	h5prodbands *b);
+int h5prodbands_open(char *filename, fmbool update, h5prodbands *b);
+int h5prodbands_read(h5prodbands *b, int layer, hid_t memtype, void *buf,
+	int row0, int nrows);
+int h5prodbands_write(h5prodbands *b, int layer, hid_t memtype, void *buf,
+	int row0, int nrows);
+int h5prodbands_close(h5prodbands *b);
+
+int headerindex_tilename(char *fname, char **tile);
+int headerindex_add(char *fname, PRODhead h);
+int headerindex_read(char *dir, headerindex *idx);
+headerentry *headerindex_lookup(headerindex *idx, char *fname);
+void headerindex_free(headerindex *idx);
+
+int passselect_init(passselect *s, char **arealist, int numarea);
+int passselect_tile(passselect *s, char *fname);
+int passselect_add(passselect *s, int tile, char *dir, char *fname);
+void passselect_sort(passselect *s);
+void passselect_free(passselect *s);
+
+int tilepool_run(int ntile, int nworkers, long long budget,
+	tilepool_fn fn, void *arg);
+int tilepool_reserve(tilepool *p, long long bytes);
+void tilepool_release(tilepool *p, long long bytes);
 
 void usage();
 
@@ -15,36 +15,567 @@
  * Mari Anne Killie, METNO/FOU, 08.01.2009: Original file by Steinar
  * Eastwood modified for use within the fmsnowcover package.
  * ystein Gody, METNO/FOU, 23.04.2009: More cleaning of software.
+ * METNO/FOU, 17.10.2026: average_merge_files reads passes by a pool of
+ * reader threads.
+ * METNO/FOU, 17.10.2026: Accumulator checkpoint of average_merge_files
+ * and cmp_filename.
+ * METNO/FOU, 17.10.2026: read_sat_area_list allocates the list.
+ * METNO/FOU, 17.10.2026: average_merge_mem and accusnow_h5lock, for
+ * tiles processed concurrently.
+ * METNO/FOU, 17.10.2026: Checkpoint of average_merge_files kept as
+ * slices of the passes, for a moving period.
  *
  * CVS_ID:
  * $Id: fmaccusnowfuncs.c,v 1.3 2013-02-01 08:41:36 mariak Exp $
  */ 
 
 #include <fmaccusnow.h>
+#include <pthread.h>
+#include <sys/stat.h>
 
 
 
+/*
+ * Passes of average_merge_files. A pass is read and decoded by
+ * read_pass, leaving for each of its n pixels its class in code and, for
+ * cloudfree pixels, the ratios P(ice)/P(cloudfree) and P(clear)/
+ * P(cloudfree) in pice and pclear, the first two layers of h5p or, for
+ * a pass taken from its slice (see below), arrays of their own. slice is
+ * set for a pass taken from its slice, sliced for a pass that has one.
+ * The passes are then folded into the accumulators by merge_pass in the
+ * order given, which makes the result independent of the number of
+ * readers.
+ */
+#define AMF_SKIP 0
+#define AMF_CLOUD 1
+#define AMF_UNDEF 2
+#define AMF_CLOUDFREE 3
+
+#define AMF_PENDING 0
+#define AMF_READING 1
+#define AMF_READY 2
+
+typedef struct {
+    osihdf h5p;
+    unsigned char *code;
+    float *pice;
+    float *pclear;
+    int n;
+    fmbool slice;
+    fmbool sliced;
+    int state;
+    int status;
+} amfpass;
+
+typedef struct {
+  char name[FILELEN];
+  long long size;
+  long long mtime;
+} amfckppass;
+
+typedef struct {
+    char **infile;
+    int nrInput;
+    float cloudlim;
+    fmucsref ucs;
+    char *ckpfile;
+    amfckppass *cur;
+    amfpass *pass;
+    int next;
+    int merged;
+    int ahead;
+    fmbool abort;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+} amfpool;
+
+/*
+ * libhdf5 is usually built without thread safety, reads by several
+ * readers are serialised. Other HDF5 calls of threads of fmaccusnow are
+ * made holding the same lock, by accusnow_h5lock.
+ */
+static pthread_mutex_t amf_h5lock = PTHREAD_MUTEX_INITIALIZER;
+
+void accusnow_h5lock(void) {
+
+  pthread_mutex_lock(&amf_h5lock);
+}
+
+void accusnow_h5unlock(void) {
+
+  pthread_mutex_unlock(&amf_h5lock);
+}
+
+/*
+ * Accumulator checkpoint of average_merge_files. Each pass folded into
+ * the accumulators is kept as a slice: its decoded classes and, for
+ * cloudfree pixels, its ratios, in file <ckpfile>.<pass>. A pass with a
+ * slice is taken from the slice instead of being read and decoded again.
+ * The slices are folded in the order of the passes, exactly as passes
+ * read from their files, the sums are thus the same as those of a full
+ * rebuild when passes leave or enter the period.
+ *
+ * A slice holds the name, size and modification time of its pass, the
+ * tile and cloudlim, and is only used if these match, a pass reprocessed
+ * since the slice was written is thus read again. ckpfile lists the
+ * passes having a slice, slices of passes no longer among the passes of
+ * the tile are removed. Files are written in the byte order of the host.
+ */
+#define AMF_CKPMAGIC "FMACCUSNOWCKP2"
+#define AMF_SLCMAGIC "FMACCUSNOWSLC1"
+
+typedef struct {
+  char magic[16];
+  int npass;
+} amfckphead;
+
+typedef struct {
+  char magic[16];
+  amfckppass pass;
+  fmucsref ucs;
+  float cloudlim;
+  int n;
+  int ncloudfree;
+} amfslchead;
+
+/*
+ * Identify pass fname by name, size and modification time, size and
+ * time are -1 if the file can not be accessed.
+ */
+static void stat_pass(char *fname, amfckppass *p) {
+
+  struct stat sb;
+
+  memset(p, 0, sizeof(amfckppass));
+  snprintf(p->name, FILELEN, "%s", fname);
+  if (stat(fname, &sb)) {
+    p->size = -1;
+    p->mtime = -1;
+  } else {
+    p->size = (long long) sb.st_size;
+    p->mtime = (long long) sb.st_mtime;
+  }
+}
+
+/*
+ * File name of the slice of pass fname of checkpoint ckpfile.
+ */
+static void slice_path(char *ckpfile, char *fname, char *path) {
+
+  char *pt;
+
+  pt = strrchr(fname, '/');
+  snprintf(path, 2*FILELEN, "%s.%s", ckpfile, (pt ? pt+1 : fname));
+}
+
+/*
+ * Take pass pn from its slice. Returns 0 if the slice matches the pass
+ * and could be read, 1 otherwise.
+ */
+static int read_slice(amfpool *p, int pn) {
+
+  amfpass *a = &(p->pass[pn]);
+  char path[2*FILELEN];
+  amfslchead h;
+  float *ratio;
+  FILE *fp;
+  int elem, i, ok;
+
+  slice_path(p->ckpfile, p->infile[pn], path);
+  fp = fopen(path, "rb");
+  if (!fp) return(1);
+
+  ok = (fread(&h, sizeof(amfslchead), 1, fp) == 1 &&
+      strcmp(h.magic, AMF_SLCMAGIC) == 0 &&
+      strcmp(h.pass.name, p->cur[pn].name) == 0 &&
+      h.pass.size == p->cur[pn].size && h.pass.mtime == p->cur[pn].mtime &&
+      h.ucs.iw == p->ucs.iw && h.ucs.ih == p->ucs.ih &&
+      h.ucs.Ax == p->ucs.Ax && h.ucs.Ay == p->ucs.Ay &&
+      h.ucs.Bx == p->ucs.Bx && h.ucs.By == p->ucs.By &&
+      h.cloudlim == p->cloudlim && 
+      h.n == p->ucs.iw*p->ucs.ih && h.ncloudfree >= 0 && h.ncloudfree <= h.n);
+  if (!ok) {
+    fclose(fp);
+    return(1);
+  }
+
+  a->n = h.n;
+  a->code = (unsigned char *) malloc(h.n*sizeof(unsigned char));
+  a->pice = (float *) calloc(h.n, sizeof(float));
+  a->pclear = (float *) calloc(h.n, sizeof(float));
+  ratio = (float *) malloc((h.ncloudfree > 0 ? h.ncloudfree : 1)*sizeof(float));
+  ok = (a->code && a->pice && a->pclear && ratio &&
+      fread(a->code, sizeof(unsigned char), h.n, fp) == h.n);
+  for (elem=0,i=0;ok && elem<h.n;elem++) {
+    if (a->code[elem] == AMF_CLOUDFREE && ++i > h.ncloudfree) ok = 0;
+  }
+  ok = (ok && i == h.ncloudfree &&
+      fread(ratio, sizeof(float), h.ncloudfree, fp) == h.ncloudfree);
+  for (elem=0,i=0;ok && elem<h.n;elem++) {
+    if (a->code[elem] == AMF_CLOUDFREE) a->pice[elem] = ratio[i++];
+  }
+  ok = (ok && fread(ratio, sizeof(float), h.ncloudfree, fp) == h.ncloudfree);
+  for (elem=0,i=0;ok && elem<h.n;elem++) {
+    if (a->code[elem] == AMF_CLOUDFREE) a->pclear[elem] = ratio[i++];
+  }
+  fclose(fp);
+  if (ratio) free(ratio);
+  if (!ok) {
+    if (a->code) free(a->code);
+    if (a->pice) free(a->pice);
+    if (a->pclear) free(a->pclear);
+    a->code = NULL;
+    a->pice = NULL;
+    a->pclear = NULL;
+    return(1);
+  }
+  a->slice = FMTRUE;
+  a->sliced = FMTRUE;
+
+  return(0);
+}
+
+/*
+ * Store pass pn, read from its file, in its slice. The slice is removed
+ * if it can not be written.
+ */
+static int write_slice(amfpool *p, int pn) {
+
+  char *where="average_merge_files";
+  amfpass *a = &(p->pass[pn]);
+  char path[2*FILELEN];
+  amfslchead h;
+  FILE *fp;
+  int elem, ok;
+
+  slice_path(p->ckpfile, p->infile[pn], path);
+  fp = fopen(path, "wb");
+  if (!fp) {
+    fmerrmsg(where,"Could not create slice %s", path);
+    return(FM_IO_ERR);
+  }
+
+  memset(&h, 0, sizeof(amfslchead));
+  sprintf(h.magic,"%s",AMF_SLCMAGIC);
+  h.pass = p->cur[pn];
+  h.ucs = p->ucs;
+  h.cloudlim = p->cloudlim;
+  h.n = a->n;
+  for (elem=0;elem<a->n;elem++) {
+    if (a->code[elem] == AMF_CLOUDFREE) h.ncloudfree++;
+  }
+  ok = (fwrite(&h, sizeof(amfslchead), 1, fp) == 1 &&
+      fwrite(a->code, sizeof(unsigned char), a->n, fp) == a->n);
+  for (elem=0;ok && elem<a->n;elem++) {
+    if (a->code[elem] == AMF_CLOUDFREE) 
+      ok = (fwrite(&(a->pice[elem]), sizeof(float), 1, fp) == 1);
+  }
+  for (elem=0;ok && elem<a->n;elem++) {
+    if (a->code[elem] == AMF_CLOUDFREE) 
+      ok = (fwrite(&(a->pclear[elem]), sizeof(float), 1, fp) == 1);
+  }
+  if (fclose(fp)) ok = 0;
+  if (!ok) {
+    fmerrmsg(where,"Could not write slice %s", path);
+    remove(path);
+    return(FM_IO_ERR);
+  }
+  a->sliced = FMTRUE;
+
+  return(FM_OK);
+}
+
+/*
+ * List the passes of p having a slice in checkpoint ckpfile, and remove
+ * the slices of the passes of the previous checkpoint that are not
+ * listed. The list is written to a temporary file that replaces ckpfile
+ * when complete.
+ */
+static int write_ckp(amfpool *p) {
+
+  char *where="average_merge_files";
+  char *tmpfile, path[2*FILELEN];
+  FILE *fp;
+  amfckphead h;
+  amfckppass old;
+  int pn, i, n, ok;
+
+  /*
+   * Slices of the previous checkpoint that are no longer in use
+   */
+  fp = fopen(p->ckpfile, "rb");
+  if (fp) {
+    ok = (fread(&h, sizeof(amfckphead), 1, fp) == 1 &&
+	strcmp(h.magic, AMF_CKPMAGIC) == 0);
+    for (i=0;ok && i<h.npass;i++) {
+      if (fread(&old, sizeof(amfckppass), 1, fp) != 1) break;
+      for (pn=0;pn<p->nrInput;pn++) {
+	if (p->pass[pn].sliced && strcmp(old.name, p->cur[pn].name) == 0) 
+	  break;
+      }
+      if (pn == p->nrInput) {
+	slice_path(p->ckpfile, old.name, path);
+	remove(path);
+      }
+    }
+    fclose(fp);
+  }
+
+  tmpfile = (char *) malloc(strlen(p->ckpfile)+5);
+  if (!tmpfile) {
+    fmerrmsg(where,"Could not allocate tmpfile");
+    return(FM_MEMALL_ERR);
+  }
+  sprintf(tmpfile,"%s.tmp",p->ckpfile);
+  fp = fopen(tmpfile, "wb");
+  if (!fp) {
+    fmerrmsg(where,"Could not create checkpoint %s", tmpfile);
+    free(tmpfile);
+    return(FM_IO_ERR);
+  }
+
+  memset(&h, 0, sizeof(amfckphead));
+  sprintf(h.magic,"%s",AMF_CKPMAGIC);
+  for (pn=0;pn<p->nrInput;pn++) {
+    if (p->pass[pn].sliced) h.npass++;
+  }
+  ok = (fwrite(&h, sizeof(amfckphead), 1, fp) == 1);
+  for (pn=0,n=0;ok && pn<p->nrInput;pn++) {
+    if (!p->pass[pn].sliced) continue;
+    ok = (fwrite(&(p->cur[pn]), sizeof(amfckppass), 1, fp) == 1);
+    if (p->pass[pn].slice) n++;
+  }
+  if (fclose(fp)) ok = 0;
+  if (!ok || rename(tmpfile, p->ckpfile)) {
+    fmerrmsg(where,"Could not write checkpoint %s", p->ckpfile);
+    remove(tmpfile);
+    free(tmpfile);
+    return(FM_IO_ERR);
+  }
+  free(tmpfile);
+  fmlogmsg(where,"Checkpoint %s holds %d passes, %d taken from slices",
+      p->ckpfile, h.npass, n);
+
+  return(FM_OK);
+}
+
+/*
+ * Read and decode pass pn, from its slice if it has one. Returns 0, 1 if the file could not be read
+ * and is to be skipped, and 8 if cloudlim leaves no cloudfree
+ * probability to divide by.
+ */
+static int read_pass(amfpool *p, int pn) {
+
+  amfpass *a = &(p->pass[pn]);
+  int elem, size_n, ret;
+  float Pice_val, Pclear_val, Pcloud_val, probsum, sumCloudfree;
+  float *Pice, *Pclear, *Pcloud;
+
+  init_osihdf(&(a->h5p));
+  a->code = NULL;
+  a->pice = NULL;
+  a->pclear = NULL;
+
+  if (p->ckpfile && read_slice(p, pn) == 0) return(0);
+
+  pthread_mutex_lock(&amf_h5lock);
+  ret = read_hdf5_product(p->infile[pn],&(a->h5p),0); /*0:reads everything*/
+  pthread_mutex_unlock(&amf_h5lock);
+  if (ret) return(1);
+
+  size_n = a->h5p.h.iw*a->h5p.h.ih;
+  a->code = (unsigned char *) malloc(size_n*sizeof(unsigned char));
+  if (!a->code) {
+    fprintf(stderr," Could not allocate memory for data field\n");
+    return(3);
+  }
+
+  Pice   = (float *) a->h5p.d[0].data;
+  Pclear = (float *) a->h5p.d[1].data;
+  Pcloud = (float *) a->h5p.d[2].data;
+
+  for (elem=0;elem<size_n;elem++) {
+
+    Pice_val   = Pice[elem];
+    Pclear_val = Pclear[elem];
+    Pcloud_val = Pcloud[elem];
+    a->code[elem] = AMF_SKIP;
+
+    /*1) check that pixel has prob.value */
+    if ( (Pcloud_val>=MINPROBAVHRR) && (Pcloud_val<=MAXPROBAVHRR) && (Pclear_val>=MINPROBAVHRR) && (Pclear_val<=MAXPROBAVHRR) && (Pice_val>=MINPROBAVHRR) && (Pice_val<=MAXPROBAVHRR) ){
+
+      /*2) check that prob.values sum to ~1*/
+      probsum = Pcloud_val + Pclear_val + Pice_val;
+      if (probsum > 1.05 || probsum < 0.95) { 
+	/*this should never be true due to similar check in avhrrice_pap!*/
+	continue;
+      }
+
+      /*3) check cloud probability -> if too high, throw away pixel*/
+      if (Pcloud_val >= p->cloudlim) {
+	a->code[elem] = AMF_CLOUD;
+	continue;
+      }
+
+      /*4) compute a prob based on the ratio between clear and ice/snow*/
+      sumCloudfree = Pclear_val + Pice_val;
+      if (sumCloudfree <= MINPROBAVHRR) {
+	/* will not happen unless cloudlim > 0.95 (still unlikely)*/
+	return(8); /*random return value used.. */
+      }
+      a->code[elem] = AMF_CLOUDFREE;
+      Pice[elem] = Pice_val/sumCloudfree;
+      Pclear[elem] = Pclear_val/sumCloudfree;
+    }
+
+    /* if NOT prob.value for this pixel: */
+    else if (Pice_val == FMACCUSNOWMISVAL_NOCOV || Pice_val == FMACCUSNOWMISVAL_NIGHT || Pice_val == FMACCUSNOWMISVAL_3A){ /* Undefined*/
+      if (Pcloud_val != Pice_val || Pclear_val != Pice_val) {
+	/*not supposed to happen, check avhrrice_pap routines!*/
+	fprintf(stderr,
+		"Strange values encountered for pixel %d in file %s\n",
+		elem,p->infile[pn]);
+	fprintf(stderr,"(P(ice) = %f, P(clear) = %f, P(cloud) = %f)\n",
+		Pice_val,Pclear_val,Pcloud_val);
+	continue;
+      }
+      a->code[elem] = AMF_UNDEF;
+    }
+
+    /*else also not supposed to happen, check avhrrice_pap/input files*/
+  }
+  a->n = size_n;
+  a->pice = Pice;
+  a->pclear = Pclear;
+  if (p->ckpfile) write_slice(p, pn);
+
+  return(0);
+}
+
+/*
+ * Release the data of a pass read by read_pass, files that could not
+ * be read are left as they are.
+ */
+static int free_pass(amfpass *a) {
+
+  if (a->code) free(a->code);
+  a->code = NULL;
+  if (a->slice) {
+    if (a->pice) free(a->pice);
+    if (a->pclear) free(a->pclear);
+    a->pice = NULL;
+    a->pclear = NULL;
+    return(0);
+  }
+  if (a->status != 1 && a->h5p.d) return(free_osihdf(&(a->h5p)));
+
+  return(0);
+}
+
+/*
+ * Reader thread of average_merge_files, reads passes in order while
+ * they are at most ahead passes ahead of the merge.
+ */
+static void *read_pass_thread(void *arg) {
+
+  amfpool *p = (amfpool *) arg;
+  int pn, status;
+
+  pthread_mutex_lock(&(p->lock));
+  while (1) {
+    while (!p->abort && p->next < p->nrInput && 
+	p->next > p->merged+p->ahead) {
+      pthread_cond_wait(&(p->cond), &(p->lock));
+    }
+    if (p->abort || p->next >= p->nrInput) break;
+    pn = p->next++;
+    p->pass[pn].state = AMF_READING;
+    pthread_mutex_unlock(&(p->lock));
+
+    status = read_pass(p, pn);
+
+    pthread_mutex_lock(&(p->lock));
+    p->pass[pn].status = status;
+    p->pass[pn].state = AMF_READY;
+    pthread_cond_broadcast(&(p->cond));
+  }
+  pthread_mutex_unlock(&(p->lock));
+
+  return(NULL);
+}
+
+/*
+ * Wait for pass pn to be read, reading it in the calling thread if no
+ * reader has taken it.
+ */
+static void wait_pass(amfpool *p, int pn) {
+
+  pthread_mutex_lock(&(p->lock));
+  while (p->pass[pn].state != AMF_READY) {
+    if (p->pass[pn].state == AMF_PENDING && p->next == pn) {
+      p->next++;
+      p->pass[pn].state = AMF_READING;
+      pthread_mutex_unlock(&(p->lock));
+      p->pass[pn].status = read_pass(p, pn);
+      pthread_mutex_lock(&(p->lock));
+      p->pass[pn].state = AMF_READY;
+      break;
+    }
+    pthread_cond_wait(&(p->cond), &(p->lock));
+  }
+  pthread_mutex_unlock(&(p->lock));
+}
+
+/*
+ * Estimate of the bytes held by average_merge_files for tile safucs of
+ * passes of z layers read by nthreads readers: the accumulators, and the
+ * passes read ahead of the merge.
+ */
+long long average_merge_mem(fmucsref safucs, int z, int nthreads) {
+
+  long long size_n, npass;
+
+  size_n = (long long) safucs.iw*safucs.ih;
+  if (nthreads > FMACCUSNOW_MAXTHREADS) nthreads = FMACCUSNOW_MAXTHREADS;
+  npass = (nthreads > 1 ? nthreads+1 : 1);
+
+  return(size_n*(2*sizeof(float)+5*sizeof(int)) + 
+      npass*size_n*(z*sizeof(float)+sizeof(unsigned char)));
+}
+
 /* 
  *  Function to loop through all input files checking each
  *  pixel. Pixels with probability of cloud larger than given
  *  'cloudlim' are thrown away. The remaining are summed, and then
  *  averaged to find a probability for snow for cloudfree case.
  *
+ *  The files are read by nthreads reader threads, or serially if
+ *  nthreads is 1 or less, while the passes read are merged in the order
+ *  of infAVHRRICE. The result does not depend on nthreads.
+ *
+ *  If ckpfile is given, passes folded by an earlier run are taken from
+ *  their slices of checkpoint ckpfile, and only passes new to the
+ *  period, or reprocessed, are read from their files. Slices of passes
+ *  that have left the period are removed. All passes are folded in the
+ *  order of infAVHRRICE either way, the result is thus the same as
+ *  without a checkpoint.
  */
 
 int average_merge_files(char **infAVHRRICE, int nrInput, fmucsref safucs, 
 			unsigned char *catclass, unsigned char *probclass, 
 			float *probice, float *probclear, float cloudlim,
-			int *numCloudfree)
+			int *numCloudfree, int nthreads, char *ckpfile)
 {
 
   char *errmsg="\n\tERROR(average_merge_files): ";
-  int i, elem, pn, status, ret, size_n;
-  unsigned int xc, yc;
+  int i, elem, pn, status, size_n, pass_n, nstarted;
   int *numPix, *numIce, *numLand, *numCloud, *numUndef;
-  float Pice_val, Pclear_val, Pcloud_val, probsum, sumCloudfree;
-  float *sumIce, *sumClear;
-  osihdf ice_h5p;
+  float *sumIce, *sumClear, *Pice, *Pclear;
+  unsigned char *code;
+  amfpool pool;
+  amfpass *a;
+  amfckppass *cur;
+  pthread_t *tid;
 
   /* Allocate memory */
   size_n = safucs.iw*safucs.ih;
@@ -75,101 +606,136 @@ int average_merge_files(char **infAVHRRICE, int nrInput, fmucsref safucs,
     numUndef[i] = 0;
   }
 
-
-  for (pn=0;pn<nrInput;pn++)  {      /* Loop through all sat.passes */   
-   
-    init_osihdf(&ice_h5p);
-
-    ret = read_hdf5_product(infAVHRRICE[pn],&ice_h5p,0); /*0:reads everything*/
-    if (ret) {
-      fprintf(stderr,
-	      "%s, Trouble encountered when reading data file %s (%d).\n", 
-	      errmsg, infAVHRRICE[pn],status);
-      fprintf(stderr,"\t Skipping file.\n");
-      continue;
+  /* Identify the passes for their slices in the checkpoint */
+  cur = NULL;
+  if (ckpfile) {
+    cur = (amfckppass *) malloc(nrInput*sizeof(amfckppass));
+    if (!cur) {
+      fprintf(stderr," Could not allocate memory for checkpoint\n");
+      return(3);
     }
-      
-
-    for (yc=0;yc<ice_h5p.h.ih;yc++) {
-    for (xc=0;xc<ice_h5p.h.iw;xc++) {
-
-      elem = fmivec(xc, yc, ice_h5p.h.iw);
+    for (pn=0;pn<nrInput;pn++) stat_pass(infAVHRRICE[pn], &cur[pn]);
+  }
 
-      Pice_val   = ((float *) ice_h5p.d[0].data)[elem];
-      Pclear_val = ((float *) ice_h5p.d[1].data)[elem];
-      Pcloud_val = ((float *) ice_h5p.d[2].data)[elem];
+  /* Start the readers, each may read one pass ahead of the merge */
+  if (nthreads > FMACCUSNOW_MAXTHREADS) nthreads = FMACCUSNOW_MAXTHREADS;
+  if (nthreads > nrInput) nthreads = nrInput;
+  if (nthreads < 1) nthreads = 1;
+  pool.infile = infAVHRRICE;
+  pool.nrInput = nrInput;
+  pool.cloudlim = cloudlim;
+  pool.ucs = safucs;
+  pool.ckpfile = ckpfile;
+  pool.cur = cur;
+  pool.next = 0;
+  pool.merged = 0;
+  pool.ahead = nthreads;
+  pool.abort = FMFALSE;
+  pool.pass = (amfpass *) malloc(nrInput*sizeof(amfpass));
+  tid = (pthread_t *) malloc(nthreads*sizeof(pthread_t));
+  if (!pool.pass || !tid) {
+    fprintf(stderr," Could not allocate memory for readers\n");
+    return(3);
+  }
+  for (pn=0;pn<nrInput;pn++) {
+    pool.pass[pn].state = AMF_PENDING;
+    pool.pass[pn].status = 0;
+    pool.pass[pn].code = NULL;
+    pool.pass[pn].pice = NULL;
+    pool.pass[pn].pclear = NULL;
+    pool.pass[pn].slice = FMFALSE;
+    pool.pass[pn].sliced = FMFALSE;
+    init_osihdf(&(pool.pass[pn].h5p));
+  }
+  pthread_mutex_init(&(pool.lock), NULL);
+  pthread_cond_init(&(pool.cond), NULL);
+  nstarted = 0;
+  if (nthreads > 1) {
+    for (i=0;i<nthreads;i++) {
+      if (pthread_create(&tid[nstarted], NULL, read_pass_thread, &pool)) {
+	fprintf(stderr,
+	  " Could not start reader thread, reading with %d threads\n",
+	  nstarted);
+	break;
+      }
+      nstarted++;
+    }
+  }
 
+  status = 0;
+  for (pn=0;pn<nrInput;pn++)  {      /* Loop through all sat.passes */   
 
-      /*1) check that pixel has prob.value */
-      if ( (Pcloud_val>=MINPROBAVHRR) && (Pcloud_val<=MAXPROBAVHRR) && (Pclear_val>=MINPROBAVHRR) && (Pclear_val<=MAXPROBAVHRR) && (Pice_val>=MINPROBAVHRR) && (Pice_val<=MAXPROBAVHRR) ){
-	
-	/*2) check that prob.values sum to ~1*/
-	probsum = Pcloud_val + Pclear_val + Pice_val;
-	if (probsum > 1.05 || probsum < 0.95) { 
-	/*this should never be true due to similar check in avhrrice_pap!*/
-	/* printf("P(ice): %f, P(clear): %f, P(cloud): %f\n",
-	   Pice_val, Pclear_val, Pcloud_val); 
-	  fprintf(stderr,"The probability does not add up to 1 (%f),",probsum);
-	  fprintf(stderr," check input file %s\n", infAVHRRICE[pn]);*/
-	  continue;
-	}
+    wait_pass(&pool, pn);
+    a = &(pool.pass[pn]);
 
-	/*3) check cloud probability -> if too high, throw away pixel*/
-	if (Pcloud_val >= cloudlim) {
+    if (a->status == 1) {
+      fprintf(stderr,
+	      "%s, Trouble encountered when reading data file %s.\n", 
+	      errmsg, infAVHRRICE[pn]);
+      fprintf(stderr,"\t Skipping file.\n");
+    } else if (a->status == 8) {
+      fprintf(stderr,"Not nice to divide by zero, check cloudlim!\n");
+      status = 8;
+    } else if (a->status) {
+      status = a->status;
+    } else {
+      pass_n = a->n;
+      code = a->code;
+      Pice = a->pice;
+      Pclear = a->pclear;
+      for (elem=0;elem<pass_n;elem++) {
+	if (code[elem] == AMF_SKIP) continue;
+	numPix[elem] ++;
+	if (code[elem] == AMF_CLOUD) {
 	  numCloud[elem] ++;
-	  numPix[elem] ++;
-	  continue;
-	}
-	
-	/*4) compute a prob based on the ratio between clear and ice/snow*/
-	else { 
- 	  sumCloudfree = Pclear_val + Pice_val;
-	  if (sumCloudfree <= MINPROBAVHRR) {
-	    /* will not happen unless cloudlim > 0.95 (still unlikely)*/
-	    fprintf(stderr,"Not nice to divide by zero, check cloudlim!\n");
-	    return(8); /*random return value used.. */
-	  }
+	} else if (code[elem] == AMF_UNDEF) {
+	  numUndef[elem] ++;	 
+	} else {
 	  numCloudfree[elem] ++; 
-	  numPix[elem] ++;
-	  sumIce[elem] += Pice_val/sumCloudfree;
-	  sumClear[elem] += Pclear_val/sumCloudfree;
+	  sumIce[elem] += Pice[elem];
+	  sumClear[elem] += Pclear[elem];
 	}
-      }
-
-      /* if NOT prob.value for this pixel: */
-      else if (Pice_val == FMACCUSNOWMISVAL_NOCOV || Pice_val == FMACCUSNOWMISVAL_NIGHT || Pice_val == FMACCUSNOWMISVAL_3A){ /* Undefined*/
-	if (Pcloud_val != Pice_val || Pclear_val != Pice_val) {
-	  /*not supposed to happen, check avhrrice_pap routines!*/
-	  fprintf(stderr,
-		  "Strange values encountered for pixel %d in file %s\n",
-		  elem,infAVHRRICE[pn]);
-	  fprintf(stderr,"(P(ice) = %f, P(clear) = %f, P(cloud) = %f)\n",
-		  Pice_val,Pclear_val,Pcloud_val);
-	  continue;
-	}
-	numUndef[elem] ++;	 
-	numPix[elem] ++; 
-      }
-      
-      else { /*also not supposed to happen, check avhrrice_pap/input files*/
-	/*fprintf(stderr,"Invalid pixel values encountered in file %s\n",
-		infAVHRRICE[pn]);
-	fprintf(stderr,"\tP(ice) = %f, P(clear) = %f, P(cloud) = %f\n",
-	Pice_val,Pclear_val,Pcloud_val);*/
-	continue;
-      }
-   
+      } /*finished looping through all pixels for current sat.pass*/
     }
-    } /*finished looping through all pixels for current sat.pass*/
- 
-    
-    if (free_osihdf(&ice_h5p) != 0) {
+
+    if (free_pass(a) != 0) {
       fprintf(stderr,"%s Could not free ice_h5p properly.",errmsg);
-      return(3);
+      if (!status) status = 3;
     }
 
+    pthread_mutex_lock(&(pool.lock));
+    pool.merged++;
+    if (status) pool.abort = FMTRUE;
+    pthread_cond_broadcast(&(pool.cond));
+    pthread_mutex_unlock(&(pool.lock));
+    if (status) break;
+
   } /*finished looping through all sat.passes*/
 
+  /* Stop the readers, passes read ahead of a failure are released */
+  for (i=0;i<nstarted;i++) {
+    pthread_join(tid[i], NULL);
+  }
+  for (pn=pn+1;pn<nrInput;pn++) {
+    if (pool.pass[pn].state == AMF_READY) free_pass(&(pool.pass[pn]));
+  }
+  pthread_cond_destroy(&(pool.cond));
+  pthread_mutex_destroy(&(pool.lock));
+  if (!status && cur) write_ckp(&pool);
+  free(pool.pass);
+  free(tid);
+  if (cur) free(cur);
+  if (status) {
+    free(sumIce);
+    free(sumClear);
+    free(numIce);
+    free(numPix);
+    free(numLand);
+    free(numCloud);
+    free(numUndef);
+    return(status);
+  }
+
 
   /* Loop through grid and calculate average probabilities */
   for (elem=0;elem<size_n;elem++) {
@@ -302,25 +868,27 @@ int check_headers(int nrInput, PRODhead hrSSThead[])
 
 /*
  *  Function to read files with list of satellites or area tiles to 
- *  be used.
+ *  be used. The list is allocated, and grown as needed, in *elemlist.
  *
  *  Return values:
  *  -2 : File contains no data (no lines).
- *  -1 : Can't find file.
+ *  -1 : Can't find file, or could not allocate the list (no list is
+ *       left then).
  *   0 -> : Number of elements found on file.
  *
  *  Implemented 04.02.2005
  */
 
 
-int read_sat_area_list(char *listfile, char **elemlist) 
+int read_sat_area_list(char *listfile, char ***elemlist) 
 {
   char *errmsg="\n\tERROR(read_sat_area_list): ";
-  int i, numelem;
-  char linein[100];
+  int i, numelem, nalloc, memerr;
+  char linein[100], **pt;
   FILE *fpin;
 
-  numelem = i = 0;
+  numelem = i = nalloc = 0;
+  *elemlist = NULL;
 
   fpin = fopen(listfile,"r");
   if (!fpin) {
@@ -328,15 +896,41 @@ int read_sat_area_list(char *listfile, char **elemlist)
     return(-1);
   }
 
+  memerr = 0;
   while (fgets(linein,99,fpin) != NULL) {
     i ++;
     if (linein[0] != '#' && strlen(linein) > 1) {
-      elemlist[numelem] = (char *) malloc((strlen(linein)+1)*sizeof(char));
-      sscanf(linein,"%s",elemlist[numelem]);
+      if (numelem == nalloc) {
+	nalloc = (nalloc ? 2*nalloc : 16);
+	pt = (char **) realloc(*elemlist, nalloc*sizeof(char *));
+	if (!pt) {
+	  memerr = 1;
+	  break;
+	}
+	*elemlist = pt;
+      }
+      (*elemlist)[numelem] = (char *) malloc((strlen(linein)+1)*sizeof(char));
+      if (!(*elemlist)[numelem]) {
+	memerr = 1;
+	break;
+      }
+      sscanf(linein,"%s",(*elemlist)[numelem]);
       numelem ++;
     }
   }
-  
+  fclose(fpin);
+
+  /*
+   * The partial list is released when memory is exhausted
+   */
+  if (memerr) {
+    fprintf(stderr,"%s Could not allocate list of %s\n",errmsg,listfile);
+    for (i=0;i<numelem;i++) free((*elemlist)[i]);
+    free(*elemlist);
+    *elemlist = NULL;
+    return(-1);
+  }
+
   if (i == 0) {
     fprintf(stderr,"%s File contains no data: %s\n",errmsg,listfile);
     return(-2);
@@ -402,3 +996,12 @@ int find_sat_area_index(char **elemlist, int numelem, char *filename)
   return(-1);
 }
 
+
+/*
+ * Compare file names for qsort, orders passes of a tile by time as the
+ * time is given in the names.
+ */
+int cmp_filename(const void *a, const void *b)
+{
+  return(strcmp(*((char **) a), *((char **) b)));
+}
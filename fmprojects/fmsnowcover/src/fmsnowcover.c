@@ -49,6 +49,28 @@
  * landmask + surface. d34 removed.
  * Mari Anne Killie, METNO/FOU, 02.07.2010: replacing
  * store_mitiff_result with store_snow.
+ * METNO/FOU, 17.10.2026: Geolocation is taken from a grid cached per
+ * tile geometry (GEOCACHEPATH in the configuration file).
+ * METNO/FOU, 17.10.2026: Pixels are processed by NTHREADS threads.
+ * METNO/FOU, 17.10.2026: Added PROBBATCH.
+ * METNO/FOU, 17.10.2026: Added PDFTABLE and PDFTABLEMAXERR.
+ * METNO/FOU, 17.10.2026: Added PROBLAZY.
+ * METNO/FOU, 17.10.2026: Added SOZGRID and SOZGRIDMAXERR.
+ * METNO/FOU, 17.10.2026: Resources used by each stage are recorded
+ * (STATSFILE).
+ * METNO/FOU, 17.10.2026: MITIFF products may be written in compressed
+ * strips (MITIFFCOMPRESSION, MITIFFROWSPERSTRIP and MITIFFPREDICTOR).
+ * METNO/FOU, 17.10.2026: HDF5 products may be written in compressed
+ * chunks (HDF5DEFLATE, HDF5CHUNKROWS and HDF5SHUFFLE).
+ * METNO/FOU, 17.10.2026: Tiles may be processed in bands of rows
+ * (BANDROWS) by fmsnowcover_bands.
+ * METNO/FOU, 17.10.2026: Products are written concurrently on threads of
+ * a prodwriter (ASYNCWRITE), in band mode while later bands are
+ * classified.
+ * METNO/FOU, 17.10.2026: Products are added to the header index of the
+ * product directory.
+ * METNO/FOU, 17.10.2026: Scenes that fail are recorded in STATSFILE,
+ * through fmsnowcover_exit.
  *
  * CVS_ID:
  * $Id: fmsnowcover.c,v 1.12 2010-07-02 15:07:18 mariak Exp $
@@ -63,6 +85,95 @@
 #include <fmaccusnow.h>
 /*#undef FMSNOWCOVER_HAVE_LIBUSENWP*/
 
+/*
+ * Products of a tile written by the writers of a prodwriter. A whole
+ * tile is written at once from slot 0, in band mode the band of a slot
+ * is written to the products opened in h5, classb and catb.
+ */
+typedef struct {
+    char *hdf5file;
+    char *classfile;
+    char *catfile;
+    fmio_mihead clinfo;
+    h5prodopts h5opts;
+    fmio_tiffopts tiffopts;
+    osihdf ice[FMSNOWCOVER_WRITESLOTS];
+    unsigned char *classed[FMSNOWCOVER_WRITESLOTS];
+    unsigned char *cat[FMSNOWCOVER_WRITESLOTS];
+    fmbool bands;
+    h5prodbands h5;
+    fmio_tiffband classb;
+    fmio_tiffband catb;
+    pthread_mutex_t *h5lock;
+    long notcovered; /* counts of countcloudfree */
+    long cloudfree;
+} prodout;
+
+static int prodout_hdf5(void *arg, int slot, int row0, int nrows) {
+
+    prodout *o = (prodout *) arg;
+    int i, status;
+
+    pthread_mutex_lock(o->h5lock);
+    if (o->bands) {
+	status = FM_OK;
+	for (i=0; i<FMSNOWCOVER_OLEVELS && !status; i++) {
+	    status = h5prodbands_write(&(o->h5), i, H5T_NATIVE_FLOAT,
+		    o->ice[slot].d[i].data, row0, nrows);
+	}
+    } else {
+	status = store_hdf5_product_opts(o->hdf5file, o->ice[slot], o->h5opts);
+    }
+    pthread_mutex_unlock(o->h5lock);
+
+    return(status);
+}
+
+static int prodout_class(void *arg, int slot, int row0, int nrows) {
+
+    prodout *o = (prodout *) arg;
+
+    if (o->bands) {
+	return(fm_MITIFF_write_band(&(o->classb), o->classed[slot], nrows));
+    }
+    return(store_snow_opts(o->classfile, o->classed[slot], o->clinfo, 0,
+		o->tiffopts));
+}
+
+static int prodout_cat(void *arg, int slot, int row0, int nrows) {
+
+    prodout *o = (prodout *) arg;
+
+    if (o->bands) {
+	return(fm_MITIFF_write_band(&(o->catb), o->cat[slot], nrows));
+    }
+    return(store_snow_opts(o->catfile, o->cat[slot], o->clinfo, 1,
+		o->tiffopts));
+}
+
+static int prodout_cloudfree(void *arg, int slot, int row0, int nrows) {
+
+    prodout *o = (prodout *) arg;
+
+    countcloudfree(o->ice[slot].d, o->clinfo.xsize*nrows, &(o->notcovered),
+	    &(o->cloudfree));
+
+    return(FM_OK);
+}
+
+/*
+ * Add the writers of the products of o to w.
+ */
+static void prodout_add(prodout *o, prodwriter *w) {
+
+    o->h5lock = &(w->h5lock);
+    o->notcovered = o->cloudfree = 0;
+    prodwriter_add(w, "store_hdf5_product", prodout_hdf5, o);
+    prodwriter_add(w, "store_snow", prodout_class, o);
+    prodwriter_add(w, "store_snow_cat", prodout_cat, o);
+    prodwriter_add(w, "findcloudfree", prodout_cloudfree, o);
+}
+
 int main2(int argc, char *argv[]) {
 
     char *where="fmsnowcover";
@@ -94,16 +205,21 @@ int main2(int argc, char *argv[]) {
     };
     fmio_img img;
     fmucsref refucs;
+    fmgeogrid geo;
+    pixprocopts ppopts;
     fmtime reftime;
     nwpice nwp;
     osihdf lm;
     osihdf ice;
+    h5prodopts h5opts;
     osi_dtype ice_ft[FMSNOWCOVER_OLEVELS]={OSI_FLOAT,OSI_FLOAT,OSI_FLOAT};
     char *ice_desc[FMSNOWCOVER_OLEVELS]={"P(ice/snow)","P(water/land)","P(cloud)"};
     float cloudfree;
+    stagestats stats;
+    prodwriter pw;
+    prodout out;
 
     statcoeffstr coeffs = {{{0}}};
-    int image_type;
 
     /*
      * Interprete commandline arguments.
@@ -139,10 +255,13 @@ int main2(int argc, char *argv[]) {
     /*
      * Decode configuration file.
      */
+    stagestats_init(&stats);
+    stagestats_start(&stats,"decode_cfg");
     if (decode_cfg(cfgfile,&cfg) != 0) {
 	fmerrmsg(where,"Could not decode configuration");
 	exit(FM_IO_ERR);
     }
+    stagestats_stop(&stats);
 
     /*
      * Set up datapaths etc.
@@ -152,7 +271,7 @@ int main2(int argc, char *argv[]) {
     	fprintf(stderr,"%s\n"," Trouble processing:");
     	fprintf(stderr,"%s\n",infile);
     	fmerrmsg(where,"Could not allocate memory for infile");
-    	exit(FM_MEMALL_ERR);
+    	fmsnowcover_exit(&stats,cfg.statsfile,fname,FM_MEMALL_ERR);
     }
     sprintf(infile,"%s/%s",cfg.imgpath,fname);
     lmaskf = (char *) malloc(FILELEN);
@@ -160,7 +279,7 @@ int main2(int argc, char *argv[]) {
     	fprintf(stderr,"%s\n"," Trouble processing:");
     	fprintf(stderr,"%s\n",infile);
     	fmerrmsg(where,"Could not allocate memory for lmaskf");
-    	exit(FM_MEMALL_ERR);
+    	fmsnowcover_exit(&stats,cfg.statsfile,fname,FM_MEMALL_ERR);
     }
     if (strstr(fname,"ns") != NULL) {
     	sprintf(pname,"%s","ns");
@@ -182,7 +301,7 @@ int main2(int argc, char *argv[]) {
     	fprintf(stderr,"%s\n"," Trouble processing:");
     	fprintf(stderr,"%s\n",infile);
     	fprintf(stderr," ERROR(main):  area not recognised\n");
-    	exit(FM_VAROUTOFSCOPE_ERR);
+    	fmsnowcover_exit(&stats,cfg.statsfile,fname,FM_VAROUTOFSCOPE_ERR);
     }
     /*setting path to file containing probability coeffs*/
     coffile = (char *) malloc(FILELEN);
@@ -190,10 +309,21 @@ int main2(int argc, char *argv[]) {
     	fprintf(stderr,"%s\n"," Trouble processing:");
     	fprintf(stderr,"%s\n",coffile);
     	fmerrmsg(where,"Could not allocate memory for coffile");
-    	exit(FM_MEMALL_ERR);
+    	fmsnowcover_exit(&stats,cfg.statsfile,fname,FM_MEMALL_ERR);
     }
     sprintf(coffile,"%s",cfg.probtabname);
 
+    /*
+     * Large tiles are read, classified and written a band of rows at a
+     * time if BANDROWS is given.
+     */
+    if (cfg.bandrows > 0) {
+	ret = fmsnowcover_bands(&cfg, fname, infile, lmaskf, coffile, pname,
+		&stats);
+	fprintf(stdout," ================================================\n");
+	fmsnowcover_exit(&stats,cfg.statsfile,fname,ret);
+    }
+
     /*
      * Open file with AVHRR information and read image
      * data and information
@@ -201,10 +331,12 @@ int main2(int argc, char *argv[]) {
     fprintf(stdout," Reading input AVHRR data...\n");
     fprintf(stdout," %s\n", fname);
     fm_init_fmio_img(&img);
+    stagestats_start(&stats,"fm_readdata");
     if (fm_readdata(infile, &img)) {
     	fmerrmsg(where,"Could not open file...\n");
-    	exit(FM_IO_ERR);
+    	fmsnowcover_exit(&stats,cfg.statsfile,fname,FM_IO_ERR);
     }
+    stagestats_stop(&stats);
 
     printf(" Satellite: %s\n", img.sa);
     printf(" Time: %02d/%02d/%4d %02d:%02d\n", img.dd, img.mm, img.yy,
@@ -227,7 +359,7 @@ int main2(int argc, char *argv[]) {
     if ((img.cover < 40. && (strstr(fname,"NoA") == NULL))) {
     	fmlogmsg(where,
     			"The percentage coverage (%.0f%) of this scene is too small for further processing.",img.cover);
-    	exit(FM_OK);
+    	fmsnowcover_exit(&stats,cfg.statsfile,fname,FM_OK);
     }
 
     fm_img2fmtime(img,&reftime);
@@ -242,12 +374,14 @@ int main2(int argc, char *argv[]) {
     nwpice_init(&nwp);
 
 #ifdef FMSNOWCOVER_HAVE_LIBUSENWP
+    stagestats_start(&stats,"nwpice_read");
     if (nwpice_read(cfg.nwppath,fnwc,3,4,reftime,refucs,&nwp)) {
     	fmerrmsg(where,"No NWP data available.");
     	fm_clear_fmio_img(&img);
     	nwpice_free(&nwp);
-    	exit(FM_IO_ERR);
+    	fmsnowcover_exit(&stats,cfg.statsfile,fname,FM_IO_ERR);
     }
+    stagestats_stop(&stats);
 #endif
 
     /*
@@ -255,6 +389,7 @@ int main2(int argc, char *argv[]) {
      * Reintroduced to determine wheter coeffs for land or sea should be used.
      */
 
+    stagestats_start(&stats,"read_lmask");
     lm.d = NULL;
     if (lmask_located = fopen(lmaskf,"r")) {
     	fprintf(stdout," Reading land/sea mask (GTOPO30 based):\n %s\n", lmaskf);
@@ -264,7 +399,7 @@ int main2(int argc, char *argv[]) {
     		fprintf(stderr,"%s\n"," Trouble processing:");
     		fprintf(stderr,"%s\n",infile);
     		fprintf(stderr,"%s%s\n", fmerrmsg,"Could not read land/sea mask");
-    		return(FM_IO_ERR);
+    		fmsnowcover_exit(&stats,cfg.statsfile,fname,FM_IO_ERR);
     	}
     	fprintf(stdout," Checking for area consistency with land/sea mask...\n");
     	if (((int) floorf(lm.h.Bx*10.)) != ((int) floorf(img.Bx*10.)) ||
@@ -283,17 +418,19 @@ int main2(int argc, char *argv[]) {
     		fprintf(stderr," iw: %d %d\n", lm.h.iw, img.iw);
     		fprintf(stderr," ih: %d %d\n", lm.h.ih, img.ih);
 
-    		return(FM_IO_ERR);
+    		fmsnowcover_exit(&stats,cfg.statsfile,fname,FM_IO_ERR);
     	}
 
     }
     else {
     	fmlogmsg(where,"No landmask is available, continuing without.");
     }
+    stagestats_stop(&stats);
 
     /*
      * Loading the statistical coeffs into statcoeffs struct
      */
+    stagestats_start(&stats,"rdstatcoeffs");
     fmlogmsg(where,"Loading statistical coefficients from \n\t%s", coffile);
     ret = rdstatcoeffs(coffile,&coeffs);
     if (ret) {
@@ -302,6 +439,14 @@ int main2(int argc, char *argv[]) {
     	printf(" WARNING: %d potential issues encountered ",ret);
     	printf("when loading coefficients\n");
     }
+    if (cfg.pdftabn > 0) {
+	fmlogmsg(where,"Tabulating pdfs, %d nodes, max. rel. error %g",
+		cfg.pdftabn, cfg.pdftabmaxerr);
+	if (pdftab_init(&coeffs, cfg.pdftabn, cfg.pdftabmaxerr)) {
+	    fmerrmsg(where,"Could not tabulate pdfs, using analytic pdfs");
+	}
+    }
+    stagestats_stop(&stats);
 
     /*
      * Function "process_pixels4ice" is called to perform the objective
@@ -331,7 +476,7 @@ int main2(int argc, char *argv[]) {
 	"Could not allocate memory for classed array while processing : %s\n",
 		infile);
 	fmerrmsg(where,what);
-	exit(FM_MEMALL_ERR);
+	fmsnowcover_exit(&stats,cfg.statsfile,fname,FM_MEMALL_ERR);
     }
     /*MAK added 22/9-09*/
     cat = (unsigned char *) malloc(size*sizeof(char));
@@ -340,18 +485,41 @@ int main2(int argc, char *argv[]) {
 	"Could not allocate memory for cat array while processing : %s\n",
 		infile);
 	fmerrmsg(where,what);
-	exit(FM_MEMALL_ERR);
+	fmsnowcover_exit(&stats,cfg.statsfile,fname,FM_MEMALL_ERR);
     }
 
+    /*
+     * Geolocation of the tile is computed once per tile geometry and
+     * reused from GEOCACHEPATH if available there.
+     */
+    stagestats_start(&stats,"fmgeogrid_get");
+    fmgeogrid_init(&geo);
+    if (fmgeogrid_get(refucs, MI, cfg.geocachepath, &geo)) {
+	fmerrmsg(where,
+		"Could not get geolocation grid, estimating pixel by pixel");
+    }
+    stagestats_stop(&stats);
+
+    ppopts.geo = (geo.lat != NULL ? &geo : NULL);
+    ppopts.nthreads = cfg.nthreads;
+    ppopts.batch = (cfg.probbatch ? FMTRUE : FMFALSE);
+    ppopts.lazy = (cfg.problazy ? FMTRUE : FMFALSE);
+    ppopts.sozstep = cfg.sozstep;
+    ppopts.sozmaxerr = cfg.sozmaxerr;
+
     fmlogmsg(where,"Estimating ice probability");
 
+    stagestats_start(&stats,"process_pixels4ice");
     if (lm.d == NULL) {
       status = process_pixels4ice(img, NULL, NULL, nwp,
-				  ice.d, classed, cat, 2, coeffs);
+				  ice.d, classed, cat, 2, coeffs, ppopts);
     } else {
       status = process_pixels4ice(img, NULL, (unsigned char *)(lm.d->data),
-				  nwp, ice.d, classed, cat, 2, coeffs);
+				  nwp, ice.d, classed, cat, 2, coeffs, ppopts);
     }
+    stagestats_stop(&stats);
+    fmgeogrid_free(&geo);
+    pdftab_free(&coeffs);
 
     if ((status) && (status != 10)) {
 	sprintf(what,"Something failed while processing pixels of %s",infile);
@@ -397,41 +565,67 @@ int main2(int argc, char *argv[]) {
     clinfo.By = img.By;
 
     opfn1 = (char *) malloc(FILELEN+5);
-    if (!opfn1) exit(FM_IO_ERR);
+    if (!opfn1) fmsnowcover_exit(&stats,cfg.statsfile,fname,
+	    FM_IO_ERR);
     sprintf(opfn1,"%s/fmsnow_%s_%4d%02d%02d%02d%02d.hdf5",
 	cfg.productpath,pname,
 	img.yy, img.mm, img.dd, img.ho, img.mi);
     sprintf(what,"Creating output file: %s", opfn1);
     fmlogmsg(where,what);
-    status = store_hdf5_product(opfn1,ice);
-    if (status != 0) {
-	sprintf(what,"Trouble processing: %s",infile);
-	fmerrmsg(where,what);
-    }
+    h5prodopts_init(&h5opts);
+    h5opts.deflate = cfg.h5deflate;
+    h5opts.chunkrows = cfg.h5chunkrows;
+    h5opts.shuffle = (cfg.h5shuffle ? FMTRUE : FMFALSE);
 
     opfn2 = (char *) malloc(FILELEN+5);
-    if (!opfn2) exit(FM_IO_ERR);
+    if (!opfn2) fmsnowcover_exit(&stats,cfg.statsfile,fname,
+	    FM_IO_ERR);
     sprintf(opfn2,"%s/fmsnow_%s_%4d%02d%02d%02d%02d.mitiff",
 	cfg.productpath,pname,
 	img.yy, img.mm, img.dd, img.ho, img.mi);
     sprintf(what,"Creating output file: %s", opfn2);
     fmlogmsg(where,what);
-    image_type = 0;
-    store_snow(opfn2,classed,clinfo,image_type);
 
 
     /*Can be helpful when trying to improve the product*/
     /*Must make some changes in subroutines as well. */
     opfn3 = (char *) malloc(FILELEN+5);
-    if (!opfn3) exit(FM_IO_ERR);
+    if (!opfn3) fmsnowcover_exit(&stats,cfg.statsfile,fname,
+	    FM_IO_ERR);
     sprintf(opfn3,"%s/fmsnow_cat_%s_%4d%02d%02d%02d%02d.mitiff",
 	cfg.productpath,pname,
 	img.yy, img.mm, img.dd, img.ho, img.mi);
     sprintf(what,"Creating output file: %s", opfn3);
     fmlogmsg(where,what);
-    image_type = 1;
-    store_snow(opfn3,cat,clinfo,image_type);
 
+    /*
+     * The HDF5 and MITIFF products are written and the cloud free
+     * coverage is found concurrently, each by a writer of pw, and the
+     * scene is indexed when all have finished.
+     */
+    stagestats_start(&stats,"store_products");
+    out.hdf5file = opfn1;
+    out.classfile = opfn2;
+    out.catfile = opfn3;
+    out.clinfo = clinfo;
+    out.h5opts = h5opts;
+    out.tiffopts = cfg.tiffopts;
+    out.ice[0] = ice;
+    out.classed[0] = classed;
+    out.cat[0] = cat;
+    out.bands = FMFALSE;
+    prodwriter_init(&pw, 1, (cfg.asyncwrite ? FMTRUE : FMFALSE));
+    prodout_add(&out, &pw);
+    prodwriter_submit(&pw, 0, img.ih);
+    ret = prodwriter_finish(&pw);
+    stagestats_stop(&stats);
+    if (ret) {
+	fmerrmsg(where,"Trouble processing: %s", infile);
+	free(classed);
+	free(cat);
+	free_osihdf(&ice);
+	fmsnowcover_exit(&stats,cfg.statsfile,fname,ret);
+    }
 
     /*
      * Add information on processed scenes, time and area
@@ -439,11 +633,17 @@ int main2(int argc, char *argv[]) {
      * tile and estimated cloud free coverage of the scene.
      */
     printf(" cover: %f\n",img.cover);
-    cloudfree = findcloudfree(ice.d,img.iw,img.ih);
+    cloudfree = fraccloudfree((long) img.iw*img.ih, out.notcovered,
+	    out.cloudfree);
     fmsec19702isodatetime(tofmsec1970(reftime), datestr);
+    stagestats_start(&stats,"updateindexfile");
     if (updateindexfile(cfg.indexfile,fname,opfn1,datestr,pname,img.cover,cloudfree)) {
 	fmerrmsg(where,"Could not update %s", cfg.indexfile);
     }
+    if (headerindex_add(opfn1, ice.h)) {
+	fmerrmsg(where,"Could not add %s to the header index", opfn1);
+    }
+    stagestats_stop(&stats);
 
 
     fprintf(stdout," ================================================\n");
@@ -456,7 +656,409 @@ int main2(int argc, char *argv[]) {
     free(cat);
     free_osihdf(&ice);
 
-    exit(FM_OK);
+    fmsnowcover_exit(&stats,cfg.statsfile,fname,FM_OK);
+}
+
+/*
+ * NAME:
+ * fmsnowcover_bands
+ *
+ * PURPOSE:
+ * To classify a tile as main2 does, but reading, classifying and
+ * writing cfg->bandrows rows at a time. The products are the same as
+ * those of main2, while the memory used depends on the width of the
+ * tile and the number of rows in a band, not on the size of the tile.
+ *
+ * NOTES:
+ * The scene is read twice, first to find its cover, so that scenes with
+ * too little cover are rejected before anything else is done. NWP data
+ * and geolocation are found for each band, geolocation grids are cached
+ * per band geometry in GEOCACHEPATH. Bands of a multiple of SOZGRID rows
+ * keep the tie points of the solar zenith grid of the tile. With
+ * ASYNCWRITE a band is written while the next one is classified, which
+ * doubles the memory used for bands.
+ *
+ * RETURN VALUES:
+ * FM_OK, or the error of the stage that failed, no products are left
+ * then.
+ */
+int fmsnowcover_bands(cfgstruct *cfg, char *fname, char *infile,
+	char *lmaskf, char *coffile, char *pname, stagestats *stats) {
+
+    char *where="fmsnowcover_bands";
+    char *fnwc[3]={"h12sf","h12pl","h12ml"};
+    char *ice_desc[FMSNOWCOVER_OLEVELS]={"P(ice/snow)","P(water/land)","P(cloud)"};
+    char opfn1[FILELEN+5], opfn2[FILELEN+5], opfn3[FILELEN+5], datestr[25];
+    unsigned char *lmask = NULL;
+    int i, s, ret, status, bandrows, nslots, row0, nrows;
+    long valid;
+    float cloudfraction;
+    PRODhead prodh;
+    fmio_mihead clinfo = {
+	"Not known",
+	00, 00, 00, 00, 0000, -9,
+	{0, 0, 0, 0, 0, 0, 0, 0},
+	0, 0, 0, 0., 0., -999., -999.
+    };
+    fmio_img hdr, img;
+    fmio_window win;
+    fmucsref refucs;
+    fmgeogrid geo;
+    pixprocopts ppopts;
+    fmtime reftime;
+    nwpice nwp;
+    osihdf lm;
+    h5prodbands lmb;
+    h5prodopts h5opts;
+    osi_dtype ice_ft[FMSNOWCOVER_OLEVELS]={OSI_FLOAT,OSI_FLOAT,OSI_FLOAT};
+    statcoeffstr coeffs = {{{0}}};
+    prodwriter pw;
+    prodout out;
+
+    /*
+     * Read the header of the scene and find its cover band by band.
+     */
+    fprintf(stdout," Reading input AVHRR data in bands of %d rows...\n",
+	    cfg->bandrows);
+    fprintf(stdout," %s\n", fname);
+    fm_init_fmio_img(&hdr);
+    stagestats_start(stats,"fm_readheader");
+    if (fm_readheader(infile, &hdr)) {
+	fmerrmsg(where,"Could not read the header of %s", infile);
+	return(FM_IO_ERR);
+    }
+    bandrows = (cfg->bandrows < hdr.ih ? cfg->bandrows : hdr.ih);
+
+    printf(" Satellite: %s\n", hdr.sa);
+    printf(" Time: %02d/%02d/%4d %02d:%02d\n", hdr.dd, hdr.mm, hdr.yy,
+	    hdr.ho, hdr.mi);
+
+    stagestats_start(stats,"cover");
+    valid = 0;
+    for (row0=0; row0<hdr.ih; row0+=bandrows) {
+	win.col = 0;
+	win.row = row0;
+	win.nx = hdr.iw;
+	win.ny = bandrows;
+	fm_init_fmio_img(&img);
+	if (fm_readdata_window(infile, &img, win)) {
+	    fmerrmsg(where,"Could not read rows %d-%d of %s", row0,
+		    row0+bandrows-1, infile);
+	    return(FM_IO_ERR);
+	}
+	for (i=0; i<img.size; i++) {
+	    if ((img.image[0])[i] != img.outofimageval) valid++;
+	}
+	fm_clear_fmio_img(&img);
+    }
+    stagestats_stop(stats);
+    hdr.cover = valid*100./((double) hdr.iw*hdr.ih);
+    printf(" Image cover: %.2f\n",hdr.cover);
+    if ((hdr.cover < 40. && (strstr(fname,"NoA") == NULL))) {
+	fmlogmsg(where,
+		"The percentage coverage (%.0f%) of this scene is too small for further processing.",hdr.cover);
+	return(FM_OK);
+    }
+
+    fm_img2fmtime(hdr,&reftime);
+
+    /*
+     * Check the land/sea mask as main2 does, its bands are read with
+     * those of the scene.
+     */
+    stagestats_start(stats,"read_lmask");
+    lmb.file = -1;
+    lmb.z = 0;
+    if (access(lmaskf, R_OK) == 0) {
+	fprintf(stdout," Reading land/sea mask (GTOPO30 based):\n %s\n", lmaskf);
+	init_osihdf(&lm);
+	if (read_hdf5_product(lmaskf, &lm, 1) ||
+		h5prodbands_open(lmaskf, FMFALSE, &lmb)) {
+	    fmerrmsg(where,"Could not read land/sea mask %s", lmaskf);
+	    return(FM_IO_ERR);
+	}
+	fprintf(stdout," Checking for area consistency with land/sea mask...\n");
+	if (((int) floorf(lm.h.Bx*10.)) != ((int) floorf(hdr.Bx*10.)) ||
+		((int) floorf(lm.h.By*10.)) != ((int) floorf(hdr.By*10.)) ||
+		((int) floorf(lm.h.Ax*10.)) != ((int) floorf(hdr.Ax*10.)) ||
+		((int) floorf(lm.h.Ay*10.)) != ((int) floorf(hdr.Ay*10.)) ||
+		lm.h.iw != hdr.iw || lm.h.ih != hdr.ih ||
+		lmb.iw != hdr.iw || lmb.ih != hdr.ih) {
+	    fmerrmsg(where,
+		    "Inconsistency between land/sea mask and data input.");
+	    h5prodbands_close(&lmb);
+	    return(FM_IO_ERR);
+	}
+    } else {
+	fmlogmsg(where,"No landmask is available, continuing without.");
+    }
+    stagestats_stop(stats);
+
+    stagestats_start(stats,"rdstatcoeffs");
+    fmlogmsg(where,"Loading statistical coefficients from \n\t%s", coffile);
+    ret = rdstatcoeffs(coffile,&coeffs);
+    if (ret) {
+	printf(" WARNING: %d potential issues encountered ",ret);
+	printf("when loading coefficients\n");
+    }
+    if (cfg->pdftabn > 0) {
+	fmlogmsg(where,"Tabulating pdfs, %d nodes, max. rel. error %g",
+		cfg->pdftabn, cfg->pdftabmaxerr);
+	if (pdftab_init(&coeffs, cfg->pdftabn, cfg->pdftabmaxerr)) {
+	    fmerrmsg(where,"Could not tabulate pdfs, using analytic pdfs");
+	}
+    }
+    stagestats_stop(stats);
+
+    /*
+     * The layers of the HDF5 product hold one band, they are written to
+     * the product created here with the header of the tile. Bands are
+     * held in two slots when written asynchronously, the writers of pw
+     * write one while the next is classified.
+     */
+    nslots = (cfg->asyncwrite ? FMSNOWCOVER_WRITESLOTS : 1);
+    status = FM_OK;
+    for (s=0; s<nslots; s++) {
+	init_osihdf(&(out.ice[s]));
+	sprintf(out.ice[s].h.source, "%s", hdr.sa);
+	sprintf(out.ice[s].h.product, "%s", "fmsnowcover");
+	out.ice[s].h.iw = hdr.iw;
+	out.ice[s].h.ih = bandrows;
+	out.ice[s].h.z = FMSNOWCOVER_OLEVELS;
+	out.ice[s].h.Ax = hdr.Ax;
+	out.ice[s].h.Ay = hdr.Ay;
+	out.ice[s].h.Bx = hdr.Bx;
+	out.ice[s].h.By = hdr.By;
+	out.ice[s].h.year = hdr.yy;
+	out.ice[s].h.month = hdr.mm;
+	out.ice[s].h.day = hdr.dd;
+	out.ice[s].h.hour = hdr.ho;
+	out.ice[s].h.minute = hdr.mi;
+	if (malloc_osihdf(&(out.ice[s]),ice_ft,ice_desc)) status = FM_MEMALL_ERR;
+	out.ice[s].h.ih = hdr.ih;
+	out.classed[s] = (unsigned char *) malloc(hdr.iw*bandrows*sizeof(char));
+	out.cat[s] = (unsigned char *) malloc(hdr.iw*bandrows*sizeof(char));
+	if (!out.classed[s] || !out.cat[s]) status = FM_MEMALL_ERR;
+    }
+    if (lmb.z > 0) {
+	lmask = (unsigned char *) malloc(hdr.iw*bandrows*sizeof(char));
+	if (!lmask) status = FM_MEMALL_ERR;
+    }
+    if (status) {
+	fmerrmsg(where,"Could not allocate memory for a band of %s", infile);
+	if (lmb.z > 0) h5prodbands_close(&lmb);
+	pdftab_free(&coeffs);
+	for (s=0; s<nslots; s++) {
+	    free_osihdf(&(out.ice[s]));
+	    free(out.classed[s]);
+	    free(out.cat[s]);
+	}
+	free(lmask);
+	return(FM_MEMALL_ERR);
+    }
+
+    sprintf(clinfo.satellite,"%s",hdr.sa);
+    clinfo.hour = hdr.ho;
+    clinfo.minute = hdr.mi;
+    clinfo.day = hdr.dd;
+    clinfo.month = hdr.mm;
+    clinfo.year = hdr.yy;
+    clinfo.zsize = 1;
+    clinfo.xsize = hdr.iw;
+    clinfo.ysize = hdr.ih;
+    clinfo.Ax = hdr.Ax;
+    clinfo.Ay = hdr.Ay;
+    clinfo.Bx = hdr.Bx;
+    clinfo.By = hdr.By;
+
+    sprintf(opfn1,"%s/fmsnow_%s_%4d%02d%02d%02d%02d.hdf5",
+	cfg->productpath,pname,
+	hdr.yy, hdr.mm, hdr.dd, hdr.ho, hdr.mi);
+    sprintf(opfn2,"%s/fmsnow_%s_%4d%02d%02d%02d%02d.mitiff",
+	cfg->productpath,pname,
+	hdr.yy, hdr.mm, hdr.dd, hdr.ho, hdr.mi);
+    sprintf(opfn3,"%s/fmsnow_cat_%s_%4d%02d%02d%02d%02d.mitiff",
+	cfg->productpath,pname,
+	hdr.yy, hdr.mm, hdr.dd, hdr.ho, hdr.mi);
+
+    stagestats_start(stats,"open_products");
+    fmlogmsg(where,"Creating output files:\n\t%s\n\t%s\n\t%s",
+	    opfn1, opfn2, opfn3);
+    h5prodopts_init(&h5opts);
+    h5opts.deflate = cfg->h5deflate;
+    h5opts.chunkrows = cfg->h5chunkrows;
+    h5opts.shuffle = (cfg->h5shuffle ? FMTRUE : FMFALSE);
+    out.hdf5file = opfn1;
+    out.classfile = opfn2;
+    out.catfile = opfn3;
+    out.clinfo = clinfo;
+    out.h5opts = h5opts;
+    out.tiffopts = cfg->tiffopts;
+    out.bands = FMTRUE;
+    out.h5.file = -1;
+    out.h5.z = 0;
+    out.classb.tif = out.catb.tif = NULL;
+    if ((status = h5prodbands_create(opfn1, out.ice[0], h5opts, &(out.h5))) ||
+	    (status = store_snow_open(opfn2, clinfo, 0, cfg->tiffopts,
+				      &(out.classb))) ||
+	    (status = store_snow_open(opfn3, clinfo, 1, cfg->tiffopts,
+				      &(out.catb)))) {
+	fmerrmsg(where,"Could not create the products of %s", infile);
+    }
+    stagestats_stop(stats);
+
+    ppopts.nthreads = cfg->nthreads;
+    ppopts.batch = (cfg->probbatch ? FMTRUE : FMFALSE);
+    ppopts.lazy = (cfg->problazy ? FMTRUE : FMFALSE);
+    ppopts.sozstep = cfg->sozstep;
+    ppopts.sozmaxerr = cfg->sozmaxerr;
+
+    /*
+     * Read and classify the tile band by band, each band is handed over
+     * to the writers of pw. HDF5 is used by one thread at a time.
+     */
+    fmlogmsg(where,"Estimating ice probability");
+    stagestats_start(stats,"process_bands");
+    prodwriter_init(&pw, nslots, (cfg->asyncwrite ? FMTRUE : FMFALSE));
+    if (!status) prodout_add(&out, &pw);
+    for (row0=0; row0<hdr.ih && !status; row0+=nrows) {
+	if ((s = prodwriter_slot(&pw)) < 0) {
+	    status = FM_IO_ERR;
+	    break;
+	}
+	win.col = 0;
+	win.row = row0;
+	win.nx = hdr.iw;
+	win.ny = bandrows;
+	fm_init_fmio_img(&img);
+	pthread_mutex_lock(&(pw.h5lock));
+	status = fm_readdata_window(infile, &img, win);
+	pthread_mutex_unlock(&(pw.h5lock));
+	if (status) {
+	    fmerrmsg(where,"Could not read rows %d-%d of %s", row0,
+		    row0+bandrows-1, infile);
+	    break;
+	}
+	nrows = img.ih;
+	fm_img2fmucsref(img,&refucs);
+
+	nwpice_init(&nwp);
+#ifdef FMSNOWCOVER_HAVE_LIBUSENWP
+	if (nwpice_read(cfg->nwppath,fnwc,3,4,reftime,refucs,&nwp)) {
+	    fmerrmsg(where,"No NWP data available.");
+	    fm_clear_fmio_img(&img);
+	    nwpice_free(&nwp);
+	    status = FM_IO_ERR;
+	    break;
+	}
+#endif
+	if (lmask) {
+	    pthread_mutex_lock(&(pw.h5lock));
+	    status = h5prodbands_read(&lmb, 0, H5T_NATIVE_UCHAR, lmask, row0,
+		    nrows);
+	    pthread_mutex_unlock(&(pw.h5lock));
+	}
+	if (status) {
+	    fmerrmsg(where,"Could not read rows %d-%d of %s", row0,
+		    row0+nrows-1, lmaskf);
+	    fm_clear_fmio_img(&img);
+	    nwpice_free(&nwp);
+	    break;
+	}
+
+	fmgeogrid_init(&geo);
+	if (fmgeogrid_get(refucs, MI, cfg->geocachepath, &geo)) {
+	    fmerrmsg(where,
+		    "Could not get geolocation grid, estimating pixel by pixel");
+	}
+	ppopts.geo = (geo.lat != NULL ? &geo : NULL);
+
+	status = process_pixels4ice(img, NULL, lmask, nwp,
+		out.ice[s].d, out.classed[s], out.cat[s], 2, coeffs, ppopts);
+	fmgeogrid_free(&geo);
+	nwpice_free(&nwp);
+	fm_clear_fmio_img(&img);
+	if ((status) && (status != 10)) {
+	    fmerrmsg(where,"Something failed while processing rows %d-%d of %s",
+		    row0, row0+nrows-1, infile);
+	    break;
+	}
+
+	status = prodwriter_submit(&pw, row0, nrows);
+    }
+    ret = prodwriter_finish(&pw);
+    if (ret) status = ret;
+    stagestats_stop(stats);
+
+    /*
+     * Products are removed unless all bands are written.
+     */
+    stagestats_start(stats,"close_products");
+    if (out.h5.file >= 0 && h5prodbands_close(&(out.h5))) status = FM_IO_ERR;
+    if (out.classb.tif && fm_MITIFF_close_bands(&(out.classb))) {
+	status = FM_IO_ERR;
+    }
+    if (out.catb.tif && fm_MITIFF_close_bands(&(out.catb))) {
+	status = FM_IO_ERR;
+    }
+    stagestats_stop(stats);
+    if (lmb.z > 0) h5prodbands_close(&lmb);
+    pdftab_free(&coeffs);
+    prodh = out.ice[0].h;
+    for (s=0; s<nslots; s++) {
+	free_osihdf(&(out.ice[s]));
+	free(out.classed[s]);
+	free(out.cat[s]);
+    }
+    free(lmask);
+    if (status) {
+	fmerrmsg(where,"Could not complete the products of %s", infile);
+	unlink(opfn1);
+	unlink(opfn2);
+	unlink(opfn3);
+	return(status);
+    }
+    fmlogmsg(where,"Finished estimating ice probability");
+
+    /*
+     * Add information on the processed scene to the index file.
+     */
+    printf(" cover: %f\n",hdr.cover);
+    cloudfraction = fraccloudfree((long) hdr.iw*hdr.ih, out.notcovered,
+	    out.cloudfree);
+    fmsec19702isodatetime(tofmsec1970(reftime), datestr);
+    stagestats_start(stats,"updateindexfile");
+    if (updateindexfile(cfg->indexfile,fname,opfn1,datestr,pname,hdr.cover,
+		cloudfraction)) {
+	fmerrmsg(where,"Could not update %s", cfg->indexfile);
+    }
+    if (headerindex_add(opfn1, prodh)) {
+	fmerrmsg(where,"Could not add %s to the header index", opfn1);
+    }
+    stagestats_stop(stats);
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * fmsnowcover_exit
+ *
+ * PURPOSE:
+ * To end the processing of scene with status, after writing the record
+ * of its processing stages to statsfile. Scenes that fail are recorded
+ * as well, with the stage they failed in as the last stage.
+ */
+void fmsnowcover_exit(stagestats *stats, char *statsfile, char *scene,
+	int status) {
+
+    char *where="fmsnowcover_exit";
+
+    if (stagestats_write(stats,statsfile,scene,status)) {
+	fmerrmsg(where,"Could not write record of processing stages");
+    }
+
+    exit(status);
 }
 
 /*
@@ -509,6 +1111,22 @@ int decode_cfg(char cfgfile[],cfgstruct *cfg) {
 	return(FM_IO_ERR);
     }
 
+    cfg->geocachepath[0] = '\0';
+    cfg->nthreads = 1;
+    cfg->probbatch = 1;
+    cfg->problazy = 1;
+    cfg->pdftabn = 0;
+    cfg->pdftabmaxerr = 1e-4;
+    cfg->sozstep = 0;
+    cfg->sozmaxerr = 0.5;
+    cfg->statsfile[0] = '\0';
+    fm_tiffopts_init(&(cfg->tiffopts));
+    cfg->h5deflate = -1;
+    cfg->h5chunkrows = H5PROD_CHUNKROWS;
+    cfg->h5shuffle = 1;
+    cfg->bandrows = 0;
+    cfg->asyncwrite = 1;
+
     while (fgets(dummy,FILELEN,fp) != NULL) {
 	if (strncmp(dummy,"#",1) == 0) continue;
 	if (strlen(dummy) > (FILELEN-50)) {
@@ -588,11 +1206,165 @@ int decode_cfg(char cfgfile[],cfgstruct *cfg) {
 	    }
 	    fmremovenewline(pt);
 	    sprintf(cfg->indexfile,"%s",pt);
+	} else if (strncmp(pt,"GEOCACHEPATH",12) == 0) {
+	    pt = strtok(NULL,token);
+	    if (!pt) {
+		fmerrmsg(where,"%s","strtok trouble for geocachepath.");
+		free(dummy);
+		return(FM_IO_ERR);
+	    }
+	    fmremovenewline(pt);
+	    sprintf(cfg->geocachepath,"%s",pt);
+	} else if (strncmp(pt,"NTHREADS",8) == 0) {
+	    pt = strtok(NULL,token);
+	    if (!pt) {
+		fmerrmsg(where,"%s","strtok trouble for nthreads.");
+		free(dummy);
+		return(FM_IO_ERR);
+	    }
+	    cfg->nthreads = atoi(pt);
+	    if (cfg->nthreads < 1) {
+		cfg->nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+		if (cfg->nthreads < 1) cfg->nthreads = 1;
+	    }
+	} else if (strncmp(pt,"PROBBATCH",9) == 0) {
+	    pt = strtok(NULL,token);
+	    if (!pt) {
+		fmerrmsg(where,"%s","strtok trouble for probbatch.");
+		free(dummy);
+		return(FM_IO_ERR);
+	    }
+	    cfg->probbatch = atoi(pt);
+	} else if (strncmp(pt,"PROBLAZY",8) == 0) {
+	    pt = strtok(NULL,token);
+	    if (!pt) {
+		fmerrmsg(where,"%s","strtok trouble for problazy.");
+		free(dummy);
+		return(FM_IO_ERR);
+	    }
+	    cfg->problazy = atoi(pt);
+	} else if (strncmp(pt,"PDFTABLEMAXERR",14) == 0) {
+	    pt = strtok(NULL,token);
+	    if (!pt) {
+		fmerrmsg(where,"%s","strtok trouble for pdftablemaxerr.");
+		free(dummy);
+		return(FM_IO_ERR);
+	    }
+	    cfg->pdftabmaxerr = atof(pt);
+	} else if (strncmp(pt,"PDFTABLE",8) == 0) {
+	    pt = strtok(NULL,token);
+	    if (!pt) {
+		fmerrmsg(where,"%s","strtok trouble for pdftable.");
+		free(dummy);
+		return(FM_IO_ERR);
+	    }
+	    cfg->pdftabn = atoi(pt);
+	} else if (strncmp(pt,"SOZGRIDMAXERR",13) == 0) {
+	    pt = strtok(NULL,token);
+	    if (!pt) {
+		fmerrmsg(where,"%s","strtok trouble for sozgridmaxerr.");
+		free(dummy);
+		return(FM_IO_ERR);
+	    }
+	    cfg->sozmaxerr = atof(pt);
+	} else if (strncmp(pt,"SOZGRID",7) == 0) {
+	    pt = strtok(NULL,token);
+	    if (!pt) {
+		fmerrmsg(where,"%s","strtok trouble for sozgrid.");
+		free(dummy);
+		return(FM_IO_ERR);
+	    }
+	    cfg->sozstep = atoi(pt);
+	} else if (strncmp(pt,"STATSFILE",9) == 0) {
+	    pt = strtok(NULL,token);
+	    if (!pt) {
+		fmerrmsg(where,"%s","strtok trouble for statsfile.");
+		free(dummy);
+		return(FM_IO_ERR);
+	    }
+	    fmremovenewline(pt);
+	    sprintf(cfg->statsfile,"%s",pt);
+	} else if (strncmp(pt,"MITIFFCOMPRESSION",17) == 0) {
+	    pt = strtok(NULL,token);
+	    if (!pt) {
+		fmerrmsg(where,"%s","strtok trouble for mitiffcompression.");
+		free(dummy);
+		return(FM_IO_ERR);
+	    }
+	    fmremovenewline(pt);
+	    cfg->tiffopts.compression = fm_tiffopts_compression(pt);
+	    if (cfg->tiffopts.compression < 0) {
+		fmerrmsg(where,"Unknown MITIFFCOMPRESSION %s", pt);
+		free(dummy);
+		return(FM_IO_ERR);
+	    }
+	} else if (strncmp(pt,"MITIFFROWSPERSTRIP",18) == 0) {
+	    pt = strtok(NULL,token);
+	    if (!pt) {
+		fmerrmsg(where,"%s","strtok trouble for mitiffrowsperstrip.");
+		free(dummy);
+		return(FM_IO_ERR);
+	    }
+	    cfg->tiffopts.rowsperstrip = atoi(pt);
+	} else if (strncmp(pt,"MITIFFPREDICTOR",15) == 0) {
+	    pt = strtok(NULL,token);
+	    if (!pt) {
+		fmerrmsg(where,"%s","strtok trouble for mitiffpredictor.");
+		free(dummy);
+		return(FM_IO_ERR);
+	    }
+	    cfg->tiffopts.predictor = (atoi(pt) ? FMTRUE : FMFALSE);
+	} else if (strncmp(pt,"HDF5DEFLATE",11) == 0) {
+	    pt = strtok(NULL,token);
+	    if (!pt) {
+		fmerrmsg(where,"%s","strtok trouble for hdf5deflate.");
+		free(dummy);
+		return(FM_IO_ERR);
+	    }
+	    cfg->h5deflate = atoi(pt);
+	} else if (strncmp(pt,"HDF5CHUNKROWS",13) == 0) {
+	    pt = strtok(NULL,token);
+	    if (!pt) {
+		fmerrmsg(where,"%s","strtok trouble for hdf5chunkrows.");
+		free(dummy);
+		return(FM_IO_ERR);
+	    }
+	    cfg->h5chunkrows = atoi(pt);
+	} else if (strncmp(pt,"HDF5SHUFFLE",11) == 0) {
+	    pt = strtok(NULL,token);
+	    if (!pt) {
+		fmerrmsg(where,"%s","strtok trouble for hdf5shuffle.");
+		free(dummy);
+		return(FM_IO_ERR);
+	    }
+	    cfg->h5shuffle = atoi(pt);
+	} else if (strncmp(pt,"BANDROWS",8) == 0) {
+	    pt = strtok(NULL,token);
+	    if (!pt) {
+		fmerrmsg(where,"%s","strtok trouble for bandrows.");
+		free(dummy);
+		return(FM_IO_ERR);
+	    }
+	    cfg->bandrows = atoi(pt);
+	} else if (strncmp(pt,"ASYNCWRITE",10) == 0) {
+	    pt = strtok(NULL,token);
+	    if (!pt) {
+		fmerrmsg(where,"%s","strtok trouble for asyncwrite.");
+		free(dummy);
+		return(FM_IO_ERR);
+	    }
+	    cfg->asyncwrite = atoi(pt);
 	}
     }
 
     fclose(fp);
 
+    /*
+     * Strips of MITIFF products are compressed by the threads used for
+     * pixel processing.
+     */
+    cfg->tiffopts.nthreads = cfg->nthreads;
+
     free(dummy);
 
     return(FM_OK);
@@ -734,9 +1506,23 @@ int putcoeffs(featstr *feat, dummystr dummies) {
 }
 
 float findcloudfree(datafield *d, int xsize, int ysize) {
-	char *where="findcloudfree";
-	int i, validpixels;
-	float cloudfree, notcovered;
+	long notcovered, cloudfree;
+
+	notcovered = cloudfree = 0;
+	countcloudfree(d, xsize*ysize, &notcovered, &cloudfree);
+
+	return(fraccloudfree(xsize*ysize, notcovered, cloudfree));
+}
+
+/*
+ * Add the pixels not covered and the cloud free pixels among the npix
+ * pixels of d to notcovered and cloudfree, thus the counts of a tile may
+ * be found band by band.
+ */
+void countcloudfree(datafield *d, int npix, long *notcovered,
+	long *cloudfree) {
+	char *where="countcloudfree";
+	int i;
 
 	for (i=0;i<FMSNOWCOVER_OLEVELS;i++) {
 		if (d[i].type != OSI_FLOAT) {
@@ -744,22 +1530,29 @@ float findcloudfree(datafield *d, int xsize, int ysize) {
 			exit(FM_OTHER_ERR);
 		}
 	}
-	notcovered = cloudfree = 0;
-	for (i=0;i<(xsize*ysize);i++) {
-		if (((float *) d[0].data)[i] == FMSNOWCOVERMISVAL_NOCOV) notcovered++;
+	for (i=0;i<npix;i++) {
+		if (((float *) d[0].data)[i] == FMSNOWCOVERMISVAL_NOCOV) (*notcovered)++;
 		if (((float *) d[0].data)[i] > ((float *) d[1].data)[i] > ((float *)d[2].data)[i]) {
-			cloudfree++;
+			(*cloudfree)++;
 		} else if (((float *) d[1].data)[i] > ((float *) d[0].data)[i] > ((float *) d[2].data)[i]) {
-			cloudfree++;
+			(*cloudfree)++;
 		}
 	}
+}
+
+/*
+ * Cloud free fraction of a tile of npix pixels from the counts of
+ * countcloudfree.
+ */
+float fraccloudfree(long npix, long notcovered, long cloudfree) {
+	float fcloudfree, fnotcovered;
 
-	notcovered /= (xsize*ysize);
-	cloudfree /= ((xsize*ysize)-notcovered);
-	printf(" cloudfree: %f\n", cloudfree);
-	printf(" notcovered: %f\n", notcovered);
+	fnotcovered = (float) notcovered/npix;
+	fcloudfree = cloudfree/(npix-fnotcovered);
+	printf(" cloudfree: %f\n", fcloudfree);
+	printf(" notcovered: %f\n", fnotcovered);
 
-	return(cloudfree);
+	return(fcloudfree);
 }
 
 /*
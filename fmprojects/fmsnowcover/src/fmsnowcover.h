@@ -40,6 +40,20 @@
  * Mari Anne Killie, METNO/FOU, 26.08.2008: Added A3b in struct
  * pinpstr and edited for r3a1/r3b1 in struct surfstr
  * Mari Anne Killie, METNO/FOU, 08.05.2009: snow added, d34 removed.
+ * METNO/FOU, 17.10.2026: Added geocachepath and geolocation grid to
+ * process_pixels4ice.
+ * METNO/FOU, 17.10.2026: Added nthreads and pixprocopts.
+ * METNO/FOU, 17.10.2026: Added structures for probest_batch.
+ * METNO/FOU, 17.10.2026: Added tabulated pdfs (pdftab).
+ * METNO/FOU, 17.10.2026: Added probest_lazy.
+ * METNO/FOU, 17.10.2026: Added solar zenith grid options.
+ * METNO/FOU, 17.10.2026: Added statsfile and stagestats.
+ * METNO/FOU, 17.10.2026: Added tiffopts.
+ * METNO/FOU, 17.10.2026: Added h5deflate, h5chunkrows and h5shuffle.
+ * METNO/FOU, 17.10.2026: Added bandrows, fmsnowcover_bands and
+ * countcloudfree.
+ * METNO/FOU, 17.10.2026: Added asyncwrite and prodwriter.
+ * METNO/FOU, 17.10.2026: Added fmsnowcover_exit.
  *
  * CVS_ID:
  * $Id: fmsnowcover.h,v 1.13 2012-01-04 11:37:07 mariak Exp $
@@ -54,6 +68,7 @@
 #include <fmutil.h>
 #include <fmio.h>
 #include <getnwp.h>
+#include <pthread.h>
 
 #define FMSNOWCOVER_MSGLENGTH 255 /* String length for system messages */
 #define MAXCHANNELS 6
@@ -70,6 +85,11 @@
 #define FMSNOWSUNZEN 85.
 #define FMSNOWSEA 0 
 #define FMSNOWLAND 191 /*works better than 255?!*/
+#define FMSNOWCOVER_MAXTHREADS 64 /* Upper limit of threads in pix_proc */
+#define FMSNOWCOVER_MAXSTAGES 16 /* Stages recorded by stagestats */
+#define FMSNOWCOVER_STAGENAME 32 /* Length of stage names in stagestats */
+#define FMSNOWCOVER_MAXWRITERS 8 /* Writers of a prodwriter */
+#define FMSNOWCOVER_WRITESLOTS 2 /* Bands held for writers of a prodwriter */
 /*The following 5 can be removed:*/
 #define ICE 1
 #define CLEAR 2
@@ -104,8 +124,85 @@ typedef struct {
     char productpath[FILELEN];
     char probtabname[FILELEN];
     char indexfile[FILELEN];
+    char geocachepath[FILELEN]; /* cache of geolocation grids, optional */
+    int nthreads; /* threads used for pixel processing */
+    int probbatch; /* use probest_batch instead of probest */
+    int problazy; /* use probest_lazy instead of probest */
+    int pdftabn; /* nodes of tabulated pdfs, 0 to use analytic pdfs */
+    double pdftabmaxerr; /* maximum relative error of tabulated pdfs */
+    int sozstep; /* tie point distance of solar zenith grid, 0 for exact */
+    double sozmaxerr; /* maximum accepted error of solar zenith grid */
+    char statsfile[FILELEN]; /* record of stages, stderr if empty */
+    fmio_tiffopts tiffopts; /* strips and compression of MITIFF products */
+    int h5deflate; /* deflate level of HDF5 products, -1 as libosihdf5 */
+    int h5chunkrows; /* rows in a chunk of HDF5 products */
+    int h5shuffle; /* shuffle filter before deflate in HDF5 products */
+    int bandrows; /* rows processed at a time, 0 for the whole tile */
+    int asyncwrite; /* write products on threads while classifying */
 } cfgstruct;
 
+/*
+ * Options for process_pixels4ice.
+ */
+typedef struct {
+    fmgeogrid *geo; /* precomputed geolocation, NULL if not available */
+    int nthreads; /* number of row bands processed in parallel */
+    fmbool batch; /* estimate probabilities row by row, probest_batch */
+    fmbool lazy; /* only features needed for the surface, probest_lazy */
+    int sozstep; /* tie point distance of solar zenith grid, 0 for exact */
+    double sozmaxerr; /* maximum accepted error [deg] of the grid */
+} pixprocopts;
+
+/*
+ * Resources used by a processing stage, see stagestats.c. While the
+ * stage is running the members hold the counters at its start.
+ */
+typedef struct {
+    char name[FMSNOWCOVER_STAGENAME];
+    double wall; /* wall time [s] */
+    double cpu; /* CPU time of all threads [s] */
+    long long rbytes; /* bytes read, -1 if not known */
+    long long wbytes; /* bytes written, -1 if not known */
+    long maxrss; /* peak resident memory at the end of the stage [kB] */
+} stagerec;
+
+typedef struct {
+    int n; /* number of stages recorded */
+    fmbool active; /* stage[n] is running */
+    stagerec stage[FMSNOWCOVER_MAXSTAGES];
+} stagestats;
+
+/*
+ * Writers of the products of a tile, see prodwriter.c. A writer is
+ * given the slot, first row and number of rows of each band.
+ */
+typedef int (*prodwriter_fn)(void *arg, int slot, int row0, int nrows);
+
+typedef struct prodjob_ {
+    struct prodwriter_ *w;
+    char name[FMSNOWCOVER_STAGENAME];
+    prodwriter_fn fn;
+    void *arg;
+    pthread_t tid;
+    fmbool started; /* the writer runs on thread tid */
+    int status; /* FM_OK until the writer fails */
+    int done; /* bands written */
+} prodjob;
+
+typedef struct prodwriter_ {
+    int n; /* number of writers */
+    int nslots; /* slots holding bands */
+    fmbool async; /* writers run on threads of their own */
+    prodjob job[FMSNOWCOVER_MAXWRITERS];
+    int queued; /* bands submitted */
+    int row0[FMSNOWCOVER_WRITESLOTS]; /* first row of the band of a slot */
+    int nrows[FMSNOWCOVER_WRITESLOTS]; /* rows of the band of a slot */
+    fmbool closed; /* no more bands are submitted */
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pthread_mutex_t h5lock; /* held by HDF5 calls of writers and caller */
+} prodwriter;
+
 /*
  * Data structure to hold time identification of satellite scene or equivalent.
  */
@@ -147,6 +244,19 @@ typedef struct {
     double pcloud;
 } probstr;
 
+/*
+ * Tabulated pdf of a feature, see pdftab.c. Values between the n nodes
+ * spanning [xmin,xmax] are linearly interpolated.
+ */
+typedef struct {
+  int n;
+  double xmin;
+  double xmax;
+  double rdx; /* 1/node spacing */
+  double maxerr; /* maximum relative error found in verification */
+  double *val;
+} pdftab;
+
 /*
  * Data structure to hold probability coefficients read from file 
  */
@@ -156,6 +266,7 @@ typedef struct { /*struct for coefficients!*/
   double par2;
   double par3;
   int count; /*counts the number of times coeffs are read!*/
+  pdftab *tab; /*tabulated pdf, NULL if not available*/
 } featstr;
 
 typedef struct {
@@ -174,6 +285,61 @@ typedef struct {
   surfstr land;
 } statcoeffstr;
 
+/*
+ * Coefficients of a feature prepared for repeated evaluation of the
+ * pdf, constants depending only on the coefficients are computed once.
+ */
+typedef struct {
+  char key;
+  int valid; /* coefficients read once and key recognised */
+  double par1;
+  double par2;
+  double par3;
+  double c1; /* normal: 1/(sdev*sqrt(2pi)), gamma: G(alpha)*beta^alpha */
+  double c2; /* normal: 2*sdev^2 */
+  double errval; /* gamma: error return for all x, 0 if none */
+  const pdftab *tab; /* tabulated pdf, NULL if not available */
+} featpdf;
+
+typedef struct {
+  featpdf a1;
+  featpdf r21;
+  featpdf r3a1;
+  featpdf r3b1;
+  featpdf dt;
+} surfpdf;
+
+typedef struct {
+  surfpdf ice;
+  surfpdf snow;
+  surfpdf cloud;
+  surfpdf water;
+  surfpdf land;
+} probcoeffs;
+
+/*
+ * Input and output of probest_batch, one array element per pixel
+ * (structure of arrays). Members correspond to pinpstr and probstr.
+ */
+typedef struct {
+    float *A1;
+    float *A2;
+    float *A3;
+    float *A3b;
+    float *T4;
+    float *T5;
+    float *soz;
+    float *tdiff;
+    short *lmask;
+    short *daytime3b;
+} pinpbatch;
+
+typedef struct {
+    double *pice;
+    double *pfree;
+    double *pcloud;
+} probbatch;
+
 typedef struct {
   char feat[10];
   char surf[10];
@@ -194,18 +360,27 @@ int decode_cfg_swath(char cfgfile[],cfgstruct *cfg);
 int process_pixels4ice(fmio_img img, 
     unsigned char *cmask[], unsigned char *lmask, nwpice nwp, 
     datafield *probs, unsigned char *class, unsigned char *cat,
-    short algo, statcoeffstr cof);
+    short algo, statcoeffstr cof, pixprocopts opts);
 
 int process_pixels4ice_swath(fmdataset img, unsigned char *cmask[],
-       int **lmask, nwpice nwp, fmdataset sz, datafield *probs,
+       fmdatafield *lmask, nwpice nwp, fmdataset sz, datafield *probs,
        unsigned char *class, unsigned char *cat, short algo, statcoeffstr cof);
 
 void moment(float data[], int n, float *ave, float *adev, float *sdev,
     float *var, float *skew, float *curt);
 
 int probest(pinpstr cpa, probstr *p, statcoeffstr cof);
+int probest_lazy(pinpstr cpa, probstr *p, statcoeffstr cof);
+int probest_prepare(statcoeffstr cof, probcoeffs *pc);
+int probest_batch(int n, pinpbatch cpa, probbatch p, probcoeffs *pc);
 double gammapdf(double alpha, double beta, double x);
+double gammapdf3par(double alpha, double beta, double gamma, double x);
 double normalpdf(double mean, double sdev, double x);
+double pdfanalytic(featstr feat, double x);
+int pdftab_build(featstr *feat, int n, double maxerr);
+int pdftab_init(statcoeffstr *cof, int n, double maxerr);
+double pdftab_eval(const pdftab *tab, double x);
+void pdftab_free(statcoeffstr *cof);
 
 /*void store_mitiff_result(char *outfile,unsigned char *icep,fmio_mihead img);*/
 /*void store_mitiff_cat(char *outfile, unsigned char *cat, fmio_mihead img);*/
@@ -214,5 +389,23 @@ double findprob(featstr feat, double x, char *whereami);
 int locstatcoeffs (dummystr dummies, statcoeffstr *cof);
 int putcoeffs(featstr *feat, dummystr dummies);
 float findcloudfree(datafield *d, int xsize, int ysize);
+void countcloudfree(datafield *d, int npix, long *notcovered,
+    long *cloudfree);
+float fraccloudfree(long npix, long notcovered, long cloudfree);
+int fmsnowcover_bands(cfgstruct *cfg, char *fname, char *infile,
+    char *lmaskf, char *coffile, char *pname, stagestats *stats);
+void fmsnowcover_exit(stagestats *stats, char *statsfile, char *scene,
+    int status);
 int updateindexfile(char *filename, char *avhrrfile, char *fmsnowfile,
     char *datetime, char *areaname, float validraw, float cloudfree); 
+int stagestats_init(stagestats *s);
+int stagestats_start(stagestats *s, char *name);
+int stagestats_stop(stagestats *s);
+int stagestats_write(stagestats *s, char *filename, char *scene,
+    int status);
+int prodwriter_init(prodwriter *w, int nslots, fmbool async);
+int prodwriter_add(prodwriter *w, char *name, prodwriter_fn fn,
+    void *arg);
+int prodwriter_slot(prodwriter *w);
+int prodwriter_submit(prodwriter *w, int row0, int nrows);
+int prodwriter_finish(prodwriter *w);
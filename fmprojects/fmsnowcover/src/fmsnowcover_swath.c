@@ -52,6 +52,8 @@
  * Anette Lauen Borg, METNO/Metklim, 05.2014: Adapt to swath input files from PPS
  * Input files: Data file, physiography file, sunsatangle file (all from PPS) + NWP file (hirlam12)
  * Program reads data from noaa/avhrr and npp/viirs instruments. Instrument dependent part in pix_proc_swath.c! (process_pixels4ice_swath)
+ * METNO/FOU, 17.10.2026: Input files are read by
+ * fm_readMETSATdata_swath_native, layers are held in their storage type.
  *
  * CVS_ID:
  * $Id: fmsnowcover.c,v 1.12 2010-07-02 15:07:18 mariak Exp $
@@ -224,7 +226,7 @@ int main(int argc, char *argv[]) {
     	exit(FM_OTHER_ERR);
     }
 
-    if(fm_readMETSATdata_swath(infile, &img)){ //Read data into struct img
+    if(fm_readMETSATdata_swath_native(infile, &img)){ //Read data into struct img
     	fmerrmsg(where,"Could not open file...\n");
     	exit(FM_IO_ERR);
     }
@@ -240,7 +242,7 @@ int main(int argc, char *argv[]) {
     int i,j;
     for (i=0;i<img.h.ysize;i++) {
     	for(j=0;j<img.h.xsize;j++) {
-    		if ((img.d)->intarray[i][j] == (img.d)[0].missingdatavalue || (img.d)->intarray[i][j] == (img.d)[0].nodatavalue) continue; //If data value = default value (no data), skip to next data point
+    		if (fmdatafield_value(img.d,i,j) == (img.d)[0].missingdatavalue || fmdatafield_value(img.d,i,j) == (img.d)[0].nodatavalue) continue; //If data value = default value (no data), skip to next data point
     		valpix++; //... or, if valid data value, add to valpix.
     	}
     }
@@ -260,7 +262,7 @@ int main(int argc, char *argv[]) {
     if (lmask_located = fopen(lmaskf,"r")) {
     	fprintf(stdout," Reading land/sea mask (GTOPO30 based):\n %s\n", lmaskf);
     	//status = read_hdf5_product(lmaskf, &lm, 0);
-    	status = fm_readMETSATdata_swath(lmaskf, &lm);
+    	status = fm_readMETSATdata_swath_native(lmaskf, &lm);
     	fclose(lmask_located);
     	if (status != 0) {
     		fprintf(stderr,"%s\n"," Trouble processing:");
@@ -280,7 +282,7 @@ int main(int argc, char *argv[]) {
      */
     if (sunzen_located = fopen(sunzenf,"r")) {
     	fprintf(stdout," Reading sun zenith angle: %s\n", sunzenf);
-    	status = fm_readMETSATdata_swath(sunzenf, &sz);
+    	status = fm_readMETSATdata_swath_native(sunzenf, &sz);
     	fclose(sunzen_located);
     	if (status != 0) {
     		fprintf(stderr,"%s\n"," Trouble processing:");
@@ -392,7 +394,7 @@ int main(int argc, char *argv[]) {
       status = process_pixels4ice_swath(img, NULL, NULL, nwp, sz,
 				  ice.d, classed, cat, 2, coeffs);
     } else {
-      status = process_pixels4ice_swath(img, NULL, (int **)(lm.d[0].intarray), nwp, sz,
+      status = process_pixels4ice_swath(img, NULL, &(lm.d[0]), nwp, sz,
 				  ice.d, classed, cat, 2, coeffs);
     }
 
@@ -11,6 +11,8 @@
  * The Gamma function may create overflow for large values.
  * The Gamma function is not part of the ANSI C standard. In this function the
  * SGI mathematical library is used.
+ * lgamma_r is used instead of gamma as the global signgam is not safe
+ * when pixels are processed by several threads.
  *
  * RETURN VALUES:
  * The probability (positive value) is returned unless an error occured.
@@ -22,6 +24,7 @@
  *
  * MODIFIED:
  * ystein Gody, met.no/FOU, 28.09.2004
+ * METNO/FOU, 17.10.2026: Reentrant, using lgamma_r.
  *
  * CVS_ID:
  * $Id: gammapdf.c,v 1.2 2009-03-01 21:24:15 steingod Exp $
@@ -35,6 +38,7 @@
 
 double gammapdf(double alpha, double beta, double x) {
     double g, lg;
+    int sign;
     double gpdf;
     char *where="gammapdf";
 
@@ -49,8 +53,8 @@ double gammapdf(double alpha, double beta, double x) {
 	return(-2);
     }
 
-    lg = gamma(alpha);
-    g = signgam*exp(lg);
+    lg = lgamma_r(alpha, &sign);
+    g = sign*exp(lg);
 
     gpdf = (pow(x,(alpha-1))*exp(-x/beta))/(g*pow(beta,alpha));
 
@@ -22,7 +22,8 @@
  * ystein Gody, met.no/FOU, 28.09.2004 
  *
  * MODIFIED:
- * NA
+ * METNO/FOU, 17.10.2026: Using fmerrmsg, added to the build for key 't'
+ * in findprob.
  *
  * CVS_ID:
  * $Id: gammapdf3par.c,v 1.2 2009-03-01 21:24:15 steingod Exp $
@@ -31,6 +32,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#include <fmutil.h>
 
 double gammapdf3par(double alpha, double beta, double gamma, double x) {
     double g, lg;
@@ -38,12 +40,12 @@ double gammapdf3par(double alpha, double beta, double gamma, double x) {
     char *where="gammapdf3par";
 
     if (x <= 0) {
-	errmsg(where,
+	fmerrmsg(where,
 	    "The Gamma distribution is only defined for positive values.");
 	return(-1);
     }
     if (alpha > 170) {
-	errmsg(where,
+	fmerrmsg(where,
 	    "The alpha parameter is too large.");
 	return(-2);
     }
@@ -0,0 +1,349 @@
+/*
+ * NAME:
+ * headerindex_tilename
+ * headerindex_add
+ * headerindex_read
+ * headerindex_lookup
+ * headerindex_free
+ *
+ * PURPOSE:
+ * To keep an index of the headers of the products in a product
+ * directory, so that products can be selected without opening them.
+ * fmsnowcover adds each product it writes, and fmaccusnow looks the
+ * candidate products up in the index.
+ *
+ * REQUIREMENTS:
+ * o libosihdf5
+ *
+ * INPUT:
+ * o product file names
+ * o product headers
+ *
+ * OUTPUT:
+ * The index file HEADERINDEXFILE in the directory of the products.
+ *
+ * NOTES:
+ * The index holds one line per product written, with the fields
+ * separated by tabs: file name (without path), size and modification
+ * time of the file, area, source, product, year, month, day, hour,
+ * minute, iw, ih, z, Ax, Ay, Bx, By and projstr. The area is the tile
+ * of the file name (see headerindex_tilename), as fmsnowcover does not
+ * set it in the header. Lines are appended, the last line of a file is
+ * the one in use.
+ *
+ * When the lines superseded by later lines of the same file outnumber
+ * the products, headerindex_read rewrites the index with one line per
+ * product, through a temporary file renamed onto the index. A line
+ * appended by another process while the index is rewritten may be
+ * lost, the product is then read from its file and added again by the
+ * next fmaccusnow.
+ *
+ * An entry is only used if size and modification time still match the
+ * file, products rewritten by other means, or by earlier versions of
+ * fmsnowcover, are thus not taken from the index.
+ *
+ * BUGS:
+ * NA
+ *
+ * AUTHOR:
+ * METNO/FOU, 17.10.2026
+ *
+ * MODIFIED:
+ * METNO/FOU, 17.10.2026: Area taken from the file name, the index is
+ * compacted when superseded lines dominate.
+ *
+ * ID:
+ * $Id$
+ */
+
+#include <fmaccusnow.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define HEADERINDEX_FIELDS 19
+#define HEADERINDEX_LINELEN 1024
+#define HEADERINDEX_MINSUPERSEDED 256
+
+/*
+ * Path of the index file of the directory of product file fname.
+ */
+static void headerindex_path(char *fname, char *path) {
+
+    char *pt;
+
+    pt = strrchr(fname, '/');
+    if (pt) {
+	snprintf(path, FILELEN, "%.*s/%s", (int) (pt-fname), fname,
+		HEADERINDEXFILE);
+    } else {
+	snprintf(path, FILELEN, "%s", HEADERINDEXFILE);
+    }
+}
+
+/*
+ * Point tile to the tile name in product fname (without path), the part
+ * between BASEFNAME and the next underscore, and return its length. -1
+ * is returned if fname is not named as a product.
+ */
+int headerindex_tilename(char *fname, char **tile) {
+
+    char *pt;
+
+    if (strncmp(fname, BASEFNAME, strlen(BASEFNAME)) != 0) return(-1);
+    *tile = fname+strlen(BASEFNAME);
+    pt = strchr(*tile, '_');
+    if (!pt) return(-1);
+
+    return(pt-*tile);
+}
+
+/*
+ * Order entries by file name.
+ */
+static int headerindex_cmp_name(const void *a, const void *b) {
+
+    return(strcmp(((headerentry *) a)->fname, ((headerentry *) b)->fname));
+}
+
+/*
+ * Order entries by file name, entries of the same file by the line they
+ * were read from.
+ */
+static int headerindex_cmp(const void *a, const void *b) {
+
+    int c;
+
+    c = headerindex_cmp_name(a, b);
+    if (c) return(c);
+
+    return(((headerentry *) a)->line-((headerentry *) b)->line);
+}
+
+/*
+ * Write the index line of product fname (without path), of size and
+ * modification time mtime, with header h to fp.
+ */
+static void headerindex_write(FILE *fp, char *fname, long long size,
+	long long mtime, PRODhead h) {
+
+    fprintf(fp,"%s\t%lld\t%lld\t%s\t%s\t%s\t", fname, size, mtime,
+	    h.area, h.source, h.product);
+    fprintf(fp,"%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t", h.year, h.month, h.day,
+	    h.hour, h.minute, h.iw, h.ih, h.z);
+    fprintf(fp,"%.17g\t%.17g\t%.17g\t%.17g\t%s\n", (double) h.Ax,
+	    (double) h.Ay, (double) h.Bx, (double) h.By, h.projstr);
+}
+
+/*
+ * Rewrite the index path with the entries of idx, one line per product.
+ * The index is left as it is if it can not be rewritten.
+ */
+static void headerindex_compact(char *path, headerindex *idx) {
+
+    char *where="headerindex_compact";
+    char tmppath[FILELEN];
+    int i, ret;
+    FILE *fp;
+
+    snprintf(tmppath, FILELEN, "%s.%d", path, (int) getpid());
+    fp = fopen(tmppath, "w");
+    if (!fp) {
+	fmlogmsg(where,"Could not open %s, index not compacted", tmppath);
+	return;
+    }
+    for (i=0; i<idx->n; i++) {
+	headerindex_write(fp, idx->e[i].fname, idx->e[i].size,
+		idx->e[i].mtime, idx->e[i].h);
+    }
+    ret = ferror(fp);
+    if (fclose(fp) || ret || rename(tmppath, path)) {
+	fmlogmsg(where,"Could not write %s, index not compacted", tmppath);
+	remove(tmppath);
+	return;
+    }
+    fmlogmsg(where,"Compacted %s to %d lines", path, idx->n);
+}
+
+/*
+ * Add product fname, with header h, to the index of its directory.
+ */
+int headerindex_add(char *fname, PRODhead h) {
+
+    char *where="headerindex_add";
+    char path[FILELEN], *pt, *tile;
+    struct stat sb;
+    int n;
+    FILE *fp;
+
+    if (stat(fname, &sb)) {
+	fmerrmsg(where,"Could not stat %s", fname);
+	return(FM_IO_ERR);
+    }
+    headerindex_path(fname, path);
+    pt = strrchr(fname, '/');
+    pt = (pt ? pt+1 : fname);
+
+    /*
+     * The area of the header is not set by fmsnowcover, the tile is
+     * taken from the file name.
+     */
+    n = headerindex_tilename(pt, &tile);
+    if (n >= 0) {
+	snprintf(h.area, sizeof(h.area), "%.*s", n, tile);
+    }
+
+    /*
+     * The line is written by one write on closing the file, lines added
+     * by concurrent processes are thus not mixed.
+     */
+    fp = fopen(path, "a");
+    if (!fp) {
+	fmerrmsg(where,"Could not open %s", path);
+	return(FM_IO_ERR);
+    }
+    headerindex_write(fp, pt, (long long) sb.st_size,
+	    (long long) sb.st_mtime, h);
+    if (fclose(fp)) {
+	fmerrmsg(where,"Could not properly close %s", path);
+	return(FM_IO_ERR);
+    }
+
+    return(FM_OK);
+}
+
+/*
+ * Read the index of directory dir into idx. A directory without an index
+ * gives an empty index. Lines that can not be decoded are skipped. The
+ * index is compacted if most of its lines are superseded.
+ */
+int headerindex_read(char *dir, headerindex *idx) {
+
+    char *where="headerindex_read";
+    char path[FILELEN], line[HEADERINDEX_LINELEN];
+    char *field[HEADERINDEX_FIELDS], *pt;
+    int i, nf, nline;
+    headerentry *e;
+    FILE *fp;
+
+    idx->n = 0;
+    idx->nalloc = 0;
+    idx->e = NULL;
+
+    snprintf(path, FILELEN, "%s/%s", dir, HEADERINDEXFILE);
+    fp = fopen(path, "r");
+    if (!fp) {
+	fmlogmsg(where,"No header index in %s", dir);
+	return(FM_OK);
+    }
+
+    nline = 0;
+    while (fgets(line, HEADERINDEX_LINELEN, fp)) {
+	nline++;
+	pt = strchr(line, '\n');
+	if (!pt) continue;
+	*pt = '\0';
+	nf = 0;
+	field[nf++] = line;
+	for (pt=line; *pt && nf<HEADERINDEX_FIELDS; pt++) {
+	    if (*pt == '\t') {
+		*pt = '\0';
+		field[nf++] = pt+1;
+	    }
+	}
+	if (nf != HEADERINDEX_FIELDS) continue;
+
+	if (idx->n == idx->nalloc) {
+	    idx->nalloc = (idx->nalloc ? 2*idx->nalloc : 256);
+	    e = (headerentry *) realloc(idx->e,
+		    idx->nalloc*sizeof(headerentry));
+	    if (!e) {
+		fmerrmsg(where,"Could not allocate index of %s", dir);
+		fclose(fp);
+		headerindex_free(idx);
+		return(FM_MEMALL_ERR);
+	    }
+	    idx->e = e;
+	}
+	e = &(idx->e[idx->n]);
+	memset(e, 0, sizeof(headerentry));
+	snprintf(e->fname, FILELEN, "%s", field[0]);
+	e->line = nline;
+	e->size = atoll(field[1]);
+	e->mtime = atoll(field[2]);
+	snprintf(e->h.area, sizeof(e->h.area), "%s", field[3]);
+	snprintf(e->h.source, sizeof(e->h.source), "%s", field[4]);
+	snprintf(e->h.product, sizeof(e->h.product), "%s", field[5]);
+	e->h.year = atoi(field[6]);
+	e->h.month = atoi(field[7]);
+	e->h.day = atoi(field[8]);
+	e->h.hour = atoi(field[9]);
+	e->h.minute = atoi(field[10]);
+	e->h.iw = atoi(field[11]);
+	e->h.ih = atoi(field[12]);
+	e->h.z = atoi(field[13]);
+	e->h.Ax = atof(field[14]);
+	e->h.Ay = atof(field[15]);
+	e->h.Bx = atof(field[16]);
+	e->h.By = atof(field[17]);
+	snprintf(e->h.projstr, sizeof(e->h.projstr), "%s", field[18]);
+	idx->n++;
+    }
+    fclose(fp);
+
+    /*
+     * Sort by file name and keep the last entry of each file.
+     */
+    qsort(idx->e, idx->n, sizeof(headerentry), headerindex_cmp);
+    nf = 0;
+    for (i=0; i<idx->n; i++) {
+	if (i+1 < idx->n && strcmp(idx->e[i].fname, idx->e[i+1].fname) == 0) {
+	    continue;
+	}
+	if (nf != i) idx->e[nf] = idx->e[i];
+	nf++;
+    }
+    idx->n = nf;
+    fmlogmsg(where,"Header index of %s holds %d products", dir, idx->n);
+
+    if (nline-idx->n >= HEADERINDEX_MINSUPERSEDED && nline-idx->n > idx->n) {
+	headerindex_compact(path, idx);
+    }
+
+    return(FM_OK);
+}
+
+/*
+ * Return the entry of product fname in idx if its size and modification
+ * time match the file, NULL otherwise.
+ */
+headerentry *headerindex_lookup(headerindex *idx, char *fname) {
+
+    headerentry key, *e;
+    struct stat sb;
+    char *pt;
+
+    if (idx->n == 0) return(NULL);
+    pt = strrchr(fname, '/');
+    snprintf(key.fname, FILELEN, "%s", (pt ? pt+1 : fname));
+    key.line = 0;
+    e = (headerentry *) bsearch(&key, idx->e, idx->n, sizeof(headerentry),
+	    headerindex_cmp_name);
+    if (!e) return(NULL);
+    if (stat(fname, &sb) || (long long) sb.st_size != e->size ||
+	    (long long) sb.st_mtime != e->mtime) {
+	return(NULL);
+    }
+
+    return(e);
+}
+
+/*
+ * Release the entries of idx.
+ */
+void headerindex_free(headerindex *idx) {
+
+    if (idx->e) free(idx->e);
+    idx->e = NULL;
+    idx->n = 0;
+    idx->nalloc = 0;
+}
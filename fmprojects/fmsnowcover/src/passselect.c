@@ -0,0 +1,180 @@
+/*
+ * NAME:
+ * passselect_init
+ * passselect_tile
+ * passselect_add
+ * passselect_sort
+ * passselect_free
+ *
+ * PURPOSE:
+ * To collect the passes selected by fmaccusnow in one scan of the input
+ * directory, in one bucket for each tile to process, and to order the
+ * passes of each tile.
+ *
+ * REQUIREMENTS:
+ * NA
+ *
+ * INPUT:
+ * o the tiles to process
+ * o file names of passes
+ *
+ * OUTPUT:
+ * The buckets of passselect, see fmaccusnow.h.
+ *
+ * NOTES:
+ * The tile of a pass is the part of its file name between BASEFNAME and
+ * the next underscore (see headerindex_tilename), and is found in an
+ * open addressing hash table of the tiles. Buckets grow as passes are
+ * added, and are sorted by file name, which orders the passes of a tile
+ * by time.
+ *
+ * A tile given more than once is collected in its first bucket.
+ *
+ * BUGS:
+ * NA
+ *
+ * AUTHOR:
+ * METNO/FOU, 17.10.2026
+ *
+ * MODIFIED:
+ * METNO/FOU, 17.10.2026: Tile name parsed by headerindex_tilename.
+ *
+ * ID:
+ * $Id$
+ */
+
+#include <fmaccusnow.h>
+
+/*
+ * Hash of the n first characters of tile name str (FNV-1a).
+ */
+static unsigned int passselect_hash(char *str, int n) {
+
+    unsigned int h = 2166136261U;
+    int i;
+
+    for (i=0; i<n && str[i]; i++) {
+	h ^= (unsigned char) str[i];
+	h *= 16777619U;
+    }
+
+    return(h);
+}
+
+/*
+ * Prepare s with one empty bucket for each of the numarea tiles of
+ * arealist.
+ */
+int passselect_init(passselect *s, char **arealist, int numarea) {
+
+    char *where="passselect_init";
+    int i, slot;
+
+    s->nbucket = numarea;
+    s->nhash = 16;
+    while (s->nhash < 2*numarea) s->nhash *= 2;
+    s->b = (passbucket *) calloc(numarea, sizeof(passbucket));
+    s->hash = (int *) malloc(s->nhash*sizeof(int));
+    if (!s->b || !s->hash) {
+	fmerrmsg(where,"Could not allocate buckets for %d tiles", numarea);
+	s->nbucket = 0;
+	return(FM_MEMALL_ERR);
+    }
+    for (i=0; i<s->nhash; i++) s->hash[i] = -1;
+
+    for (i=0; i<numarea; i++) {
+	s->b[i].area = arealist[i];
+	slot = passselect_hash(arealist[i], strlen(arealist[i])) &
+	    (s->nhash-1);
+	while (s->hash[slot] >= 0 &&
+		strcmp(arealist[s->hash[slot]], arealist[i]) != 0) {
+	    slot = (slot+1) & (s->nhash-1);
+	}
+	if (s->hash[slot] < 0) s->hash[slot] = i;
+    }
+
+    return(FM_OK);
+}
+
+/*
+ * Return the bucket of the tile of pass fname (without path), -1 if the
+ * tile is not to be processed.
+ */
+int passselect_tile(passselect *s, char *fname) {
+
+    char *tile;
+    int n, slot;
+
+    n = headerindex_tilename(fname, &tile);
+    if (n < 0) return(-1);
+
+    slot = passselect_hash(tile, n) & (s->nhash-1);
+    while (s->hash[slot] >= 0) {
+	if (strncmp(s->b[s->hash[slot]].area, tile, n) == 0 &&
+		s->b[s->hash[slot]].area[n] == '\0') {
+	    return(s->hash[slot]);
+	}
+	slot = (slot+1) & (s->nhash-1);
+    }
+
+    return(-1);
+}
+
+/*
+ * Add pass fname of directory dir to bucket tile.
+ */
+int passselect_add(passselect *s, int tile, char *dir, char *fname) {
+
+    char *where="passselect_add";
+    passbucket *b = &(s->b[tile]);
+    char **pt;
+
+    if (b->n == b->nalloc) {
+	b->nalloc = (b->nalloc ? 2*b->nalloc : 64);
+	pt = (char **) realloc(b->fname, b->nalloc*sizeof(char *));
+	if (!pt) {
+	    fmerrmsg(where,"Could not allocate passes of tile %s", b->area);
+	    return(FM_MEMALL_ERR);
+	}
+	b->fname = pt;
+    }
+    b->fname[b->n] = (char *) malloc(strlen(dir)+strlen(fname)+2);
+    if (!b->fname[b->n]) {
+	fmerrmsg(where,"Could not allocate %s", fname);
+	return(FM_MEMALL_ERR);
+    }
+    sprintf(b->fname[b->n],"%s/%s",dir,fname);
+    b->n++;
+
+    return(FM_OK);
+}
+
+/*
+ * Order the passes of each bucket by file name.
+ */
+void passselect_sort(passselect *s) {
+
+    int i;
+
+    for (i=0; i<s->nbucket; i++) {
+	qsort(s->b[i].fname, s->b[i].n, sizeof(char *), cmp_filename);
+    }
+}
+
+/*
+ * Release the buckets of s.
+ */
+void passselect_free(passselect *s) {
+
+    int i, f;
+
+    for (i=0; i<s->nbucket; i++) {
+	for (f=0; f<s->b[i].n; f++) free(s->b[i].fname[f]);
+	if (s->b[i].fname) free(s->b[i].fname);
+    }
+    if (s->b) free(s->b);
+    if (s->hash) free(s->hash);
+    s->b = NULL;
+    s->hash = NULL;
+    s->nbucket = 0;
+}
@@ -0,0 +1,325 @@
+/*
+ * NAME:
+ * pdftab
+ *
+ * PURPOSE:
+ * To tabulate the pdf of each feature once after the statistical
+ * coefficients are read, so that findprob and probest_batch can
+ * interpolate in a table instead of evaluating exp, pow and the Gamma
+ * function for every feature of every pixel.
+ *
+ * REQUIREMENTS:
+ * NA
+ *
+ * INPUT:
+ * o statistical coefficients as read by rdstatcoeffs
+ * o number of nodes in each table
+ * o maximum accepted relative error
+ *
+ * OUTPUT:
+ * o a table attached to each featstr that could be tabulated
+ *
+ * NOTES:
+ * The domain of a table is the interval where the pdf is larger than
+ * PDFTAB_CUTOFF times its maximum, found by scanning the pdf over
+ * PDFTAB_NSIGMA standard deviations around the mean. Values outside the
+ * domain, including those giving an error for the Gamma distributions,
+ * are computed analytically, thus the tails of the pdfs are exact.
+ *
+ * Within the domain values are linearly interpolated between n nodes.
+ * After a table is built, the relative error is checked against the
+ * analytic pdf at 3 points within each interval. If it exceeds maxerr,
+ * the number of nodes is doubled up to PDFTAB_MAXNODES. Features that
+ * can not be tabulated within maxerr (e.g. Gamma distributions with
+ * alpha<1, which are singular at 0) are evaluated analytically.
+ *
+ * Tables are read only after pdftab_init and can be used by several
+ * threads.
+ *
+ * BUGS:
+ * NA
+ *
+ * AUTHOR:
+ * METNO/FOU, 17.10.2026
+ *
+ * MODIFIED:
+ * NA
+ *
+ * CVS_ID:
+ * $Id$
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <fmsnowcover.h>
+
+#define PDFTAB_CUTOFF 1e-6 /* Relative pdf value bounding the domain */
+#define PDFTAB_NSIGMA 40. /* Standard deviations scanned for the domain */
+#define PDFTAB_NSCAN 4000 /* Points used when scanning for the domain */
+#define PDFTAB_MAXNODES 1048576 /* Maximum number of nodes in a table */
+
+/*
+ * NAME:
+ * pdfanalytic
+ *
+ * PURPOSE:
+ * Evaluate the pdf of a feature analytically, the key must be checked by
+ * the caller.
+ */
+double pdfanalytic(featstr feat, double x) {
+
+    if (feat.key == 'n') return(normalpdf(feat.par1, feat.par2, x));
+    if (feat.key == 'g') return(gammapdf(feat.par1, feat.par2, x));
+    return(gammapdf3par(feat.par1, feat.par2, feat.par3, x));
+}
+
+/*
+ * NAME:
+ * pdftab_eval
+ *
+ * PURPOSE:
+ * Interpolate in a table, x must be within [xmin,xmax].
+ */
+double pdftab_eval(const pdftab *tab, double x) {
+    double t;
+    int k;
+
+    t = (x-tab->xmin)*tab->rdx;
+    k = (int) t;
+    if (k > tab->n-2) k = tab->n-2;
+    t -= k;
+
+    return(tab->val[k]+t*(tab->val[k+1]-tab->val[k]));
+}
+
+/*
+ * Find the domain of a feature, returns 1 if the pdf can not be
+ * tabulated.
+ */
+static int pdftab_domain(featstr feat, double *xmin, double *xmax) {
+    double mean, sdev, lo, hi, step, f, peak;
+    int i, first, last;
+
+    if (feat.par2 <= 0) return(1);
+    if (feat.key == 'n') {
+	mean = feat.par1;
+	sdev = feat.par2;
+	lo = mean-PDFTAB_NSIGMA*sdev;
+    } else if (feat.key == 'g' || feat.key == 't') {
+	if (feat.par1 <= 0 || feat.par1 > 170) return(1);
+	mean = feat.par1*feat.par2;
+	sdev = sqrt(feat.par1)*feat.par2;
+	lo = 0.;
+	if (feat.key == 't') {
+	    mean += feat.par3;
+	    if (feat.par3 > lo) lo = feat.par3;
+	}
+	if (mean-PDFTAB_NSIGMA*sdev > lo) lo = mean-PDFTAB_NSIGMA*sdev;
+    } else {
+	return(1);
+    }
+    hi = mean+PDFTAB_NSIGMA*sdev;
+    step = (hi-lo)/PDFTAB_NSCAN;
+
+    /*
+     * The lower limit of the Gamma distributions is not part of the
+     * domain, scanning starts one step above it.
+     */
+    peak = 0.;
+    for (i=1; i<=PDFTAB_NSCAN; i++) {
+	f = pdfanalytic(feat, lo+i*step);
+	if (!isfinite(f)) return(1);
+	if (f > peak) peak = f;
+    }
+    if (peak <= 0.) return(1);
+
+    first = last = 0;
+    for (i=1; i<=PDFTAB_NSCAN; i++) {
+	f = pdfanalytic(feat, lo+i*step);
+	if (f >= PDFTAB_CUTOFF*peak) {
+	    if (!first) first = i;
+	    last = i;
+	}
+    }
+    if (first > 1) first--;
+    if (last < PDFTAB_NSCAN) last++;
+    *xmin = lo+first*step;
+    *xmax = lo+last*step;
+    if (!(*xmax > *xmin)) return(1);
+
+    return(0);
+}
+
+/*
+ * Largest relative error of the table, checked at the quarter points
+ * of each interval. Returns a negative value if the pdf is not positive
+ * within the domain.
+ */
+static double pdftab_verify(featstr feat, const pdftab *tab) {
+    double dx, x, f, err, maxerr;
+    int k, j;
+
+    dx = 1./tab->rdx;
+    maxerr = 0.;
+    for (k=0; k<tab->n-1; k++) {
+	for (j=1; j<=3; j++) {
+	    x = tab->xmin+(k+0.25*j)*dx;
+	    f = pdfanalytic(feat, x);
+	    if (!(f > 0.) || !isfinite(f)) return(-1.);
+	    err = fabs(pdftab_eval(tab, x)-f)/f;
+	    if (err > maxerr) maxerr = err;
+	}
+    }
+
+    return(maxerr);
+}
+
+/*
+ * NAME:
+ * pdftab_build
+ *
+ * PURPOSE:
+ * Build the table of a single feature using at least n nodes. The table
+ * is only attached to the feature if the relative error is below maxerr.
+ *
+ * RETURN VALUES:
+ * FM_OK if a table is attached, FM_VAROUTOFSCOPE_ERR if the feature can
+ * not be tabulated within maxerr and FM_MEMALL_ERR on memory trouble.
+ */
+int pdftab_build(featstr *feat, int n, double maxerr) {
+    char *where="pdftab_build";
+    pdftab *tab;
+    double xmin, xmax, err;
+    int k;
+
+    feat->tab = NULL;
+    if (feat->count != 1 || n < 2) return(FM_VAROUTOFSCOPE_ERR);
+    if (pdftab_domain(*feat, &xmin, &xmax)) return(FM_VAROUTOFSCOPE_ERR);
+
+    tab = (pdftab *) malloc(sizeof(pdftab));
+    if (!tab) {
+	fmerrmsg(where,"Could not allocate pdf table");
+	return(FM_MEMALL_ERR);
+    }
+    tab->val = NULL;
+    tab->xmin = xmin;
+    tab->xmax = xmax;
+
+    for (; n<=PDFTAB_MAXNODES; n*=2) {
+	free(tab->val);
+	tab->val = (double *) malloc(n*sizeof(double));
+	if (!tab->val) {
+	    fmerrmsg(where,"Could not allocate pdf table");
+	    free(tab);
+	    return(FM_MEMALL_ERR);
+	}
+	tab->n = n;
+	tab->rdx = (n-1)/(xmax-xmin);
+	for (k=0; k<n; k++) {
+	    tab->val[k] = pdfanalytic(*feat, xmin+k*((xmax-xmin)/(n-1)));
+	}
+	err = pdftab_verify(*feat, tab);
+	if (err < 0.) break;
+	if (err <= maxerr) {
+	    tab->maxerr = err;
+	    feat->tab = tab;
+	    return(FM_OK);
+	}
+    }
+
+    free(tab->val);
+    free(tab);
+
+    return(FM_VAROUTOFSCOPE_ERR);
+}
+
+static int pdftab_surf(surfstr *surf, char *name, int n, double maxerr) {
+    char *where="pdftab_init";
+    featstr *feat[5];
+    char *fname[5] = {"a1","r21","r3a1","r3b1","dt"};
+    int i, ret;
+
+    feat[0] = &surf->a1;
+    feat[1] = &surf->r21;
+    feat[2] = &surf->r3a1;
+    feat[3] = &surf->r3b1;
+    feat[4] = &surf->dt;
+
+    for (i=0; i<5; i++) {
+	if (!feat[i]->count) continue;
+	ret = pdftab_build(feat[i], n, maxerr);
+	if (ret == FM_MEMALL_ERR) return(ret);
+	if (ret) {
+	    fmlogmsg(where,"Using analytic pdf for %s %s", name, fname[i]);
+	} else {
+	    fmlogmsg(where,
+		    "Tabulated %s %s in [%g,%g], %d nodes, max. rel. error %.1e",
+		    name, fname[i], feat[i]->tab->xmin, feat[i]->tab->xmax,
+		    feat[i]->tab->n, feat[i]->tab->maxerr);
+	}
+    }
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * pdftab_init
+ *
+ * PURPOSE:
+ * Build tables for all features that have been read, should be called
+ * once after rdstatcoeffs. The tables are released by pdftab_free.
+ *
+ * RETURN VALUES:
+ * FM_OK, features that can not be tabulated are evaluated analytically.
+ * FM_MEMALL_ERR on memory trouble.
+ */
+int pdftab_init(statcoeffstr *cof, int n, double maxerr) {
+
+    if (pdftab_surf(&cof->ice, "ice", n, maxerr) ||
+	    pdftab_surf(&cof->snow, "snow", n, maxerr) ||
+	    pdftab_surf(&cof->cloud, "cloud", n, maxerr) ||
+	    pdftab_surf(&cof->water, "water", n, maxerr) ||
+	    pdftab_surf(&cof->land, "land", n, maxerr)) {
+	pdftab_free(cof);
+	return(FM_MEMALL_ERR);
+    }
+
+    return(FM_OK);
+}
+
+static void pdftab_freesurf(surfstr *surf) {
+    featstr *feat[5];
+    int i;
+
+    feat[0] = &surf->a1;
+    feat[1] = &surf->r21;
+    feat[2] = &surf->r3a1;
+    feat[3] = &surf->r3b1;
+    feat[4] = &surf->dt;
+
+    for (i=0; i<5; i++) {
+	if (feat[i]->tab) {
+	    free(feat[i]->tab->val);
+	    free(feat[i]->tab);
+	    feat[i]->tab = NULL;
+	}
+    }
+}
+
+/*
+ * NAME:
+ * pdftab_free
+ *
+ * PURPOSE:
+ * Release the tables, features are then evaluated analytically.
+ */
+void pdftab_free(statcoeffstr *cof) {
+
+    pdftab_freesurf(&cof->ice);
+    pdftab_freesurf(&cof->snow);
+    pdftab_freesurf(&cof->cloud);
+    pdftab_freesurf(&cof->water);
+    pdftab_freesurf(&cof->land);
+}
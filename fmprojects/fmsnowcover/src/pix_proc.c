@@ -20,6 +20,11 @@
  * cmask - cloud mask
  * lmask - land/sea mask
  * algo - flag determining whether night time or day time data are used
+ * opts - processing options
+ *   geo: latitude, longitude of each pixel (fmgeogrid_get), if NULL the
+ *   geolocation is estimated pixel by pixel
+ *   nthreads: number of threads processing bands of rows, 1 or less
+ *   gives serial processing
  *
  * OUTPUT:
  * pice - Probability of ice given the AVHRR observations
@@ -33,6 +38,10 @@
  * ensure that pixels with enough sun is processed instead of discarding the
  * whole tile...
  *
+ * Pixels are independent, the tile is therefore split in bands of rows
+ * which may be processed by separate threads. Each band starts from the
+ * same initial state, giving output identical to serial processing.
+ *
  * A hack to handle saturation problems within 3A is imlemented. This
  * should be handled more properly by the preprocessing in time.
  *
@@ -59,43 +68,85 @@
  * introducing fm_ch3brefl.
  * MAK, METNO/FOU, 22.09.2009: (temp.) adding "cat" to categorize each
  * pixel in class with highest probability.
+ * METNO/FOU, 17.10.2026: Geolocation may be taken from a precomputed
+ * grid instead of projecting each pixel.
+ * METNO/FOU, 17.10.2026: Threaded processing of row bands.
+ * METNO/FOU, 17.10.2026: Optional use of probest_batch for each row.
+ * METNO/FOU, 17.10.2026: Optional use of probest_lazy.
+ * METNO/FOU, 17.10.2026: Calibration using fmio_calplan lookup tables
+ * instead of fm_byte2float.
+ * METNO/FOU, 17.10.2026: Channel 3b constants are found once for the
+ * scene by fm_ch3b_open.
+ * METNO/FOU, 17.10.2026: Solar zenith angles may be interpolated from a
+ * grid of tie points (fmsolargrid).
+ * METNO/FOU, 17.10.2026: Scenes missing any of the channels are rejected.
  *
  * CVS_ID:
  * $Id: pix_proc.c,v 1.10 2011-12-05 09:58:47 mariak Exp $
  */
 
 #include <fmsnowcover.h>
+#include <pthread.h>
 /*#undef FMSNOWCOVER_HAVE_LIBUSENWP*/
 
+/*
+ * Input and output shared by all bands of a tile, and the rows handled
+ * by a specific band.
+ */
+typedef struct {
+    fmio_img *img;
+    unsigned char *lmask;
+    nwpice *nwp;
+    datafield *probs;
+    unsigned char *class;
+    unsigned char *cat;
+    short algo;
+    statcoeffstr *cof;
+    fmbool batch;
+    fmbool lazy;
+    probcoeffs *pc;
+    fmgeogrid *geo;
+    fmsolargrid *soz;
+    fmucsref ucs0;
+    fmsec1970 timeidsec;
+    fmio_calplan *plan;
+    fm_ch3b_scene *ch3b;
+    int row0; /* first row of band */
+    int row1; /* row following the last row of band */
+    int status;
+} ppband;
+
+static int process_rows(ppband *b);
+static int alloc_rowbatch(int n, pinpbatch *in, probbatch *out, int **pix);
+static void free_rowbatch(pinpbatch *in, probbatch *out, int *pix);
+static void *process_rows_thread(void *arg);
+
 int process_pixels4ice(fmio_img img, unsigned char *cmask[],
        unsigned char *lmask, nwpice nwp, datafield *probs,
-       unsigned char *class, unsigned char *cat, short algo, statcoeffstr cof) {
+       unsigned char *class, unsigned char *cat, short algo, statcoeffstr cof,
+       pixprocopts opts) {
 
     char *where="process_pixels4ice";
-    char what[FMSNOWCOVER_MSGLENGTH];
-    int i, j, size;
-    int xc, yc;
-    /* double x; */
-    pinpstr cpar;
-    probstr p;
+    int i, nthreads, nrows, status;
     fmucsref ucs0;
-   /*  fmxy cart; */
-    fmindex cart;
-    fmucspos ucspos;
-    fmgeopos geop;
     fmtime timeid;
-    fmsec1970 timeidsec, tst;
-    float zsun;
+    fmsec1970 timeidsec;
     int doy;
     fmscale calib; /*will contain gain and intercept values*/
+    fmio_calplan plan; /*lookup tables for calibration of channels*/
+    fm_ch3b_scene ch3b; /*channel 3b constants of the satellite*/
+    fmgeogrid *geo;
+    fmsolargrid sozgrid, *soz;
+    probcoeffs pc;
+    ppband *band;
+    pthread_t *tid;
+    short *started;
 
     fmlogmsg(where,
 	    "Now processing the individual pixels to gain ice probability...");
     /*
      * Convert structures to lesser units for later use...
      */
-    size = img.iw*img.ih;
-
     ucs0.Ax = img.Ax;
     ucs0.Ay = img.Ay;
     ucs0.Bx = img.Bx;
@@ -111,6 +162,364 @@ int process_pixels4ice(fmio_img img, unsigned char *cmask[],
     timeid.fm_sec = 0;
     timeidsec = tofmsec1970(timeid);
 
+    /*
+     * All channels, 3A and 3B included, are read for each pixel.
+     */
+    for (i=0; i<FMIO_MAXCHANNELS; i++) {
+	if (i >= img.z || img.image[i] == NULL) {
+	    fmerrmsg(where,"Channel %d is missing", i+1);
+	    return(FM_IO_ERR);
+	}
+    }
+
+    if (fm_img2slopes(img,&calib)) { /*collects gain and intercept*/
+	fmerrmsg(where,"Could not get gain and intercept values");
+	return(FM_MEMALL_ERR);
+    }
+
+    /*
+     * Channels are bound to reflectance or temperature once, and the
+     * calibrated values are tabulated. Reflectances are used by all
+     * daytime pixels, which are processed by algo 2 whatever algo is
+     * given.
+     */
+    fm_calplan_init(&plan);
+    status = FM_OK;
+    if (img.z > 3) {
+	if (fm_calplan_bind(&plan, 0, calib, "Reflectance") ||
+		fm_calplan_bind(&plan, 1, calib, "Reflectance") ||
+		fm_calplan_bind(&plan, 5, calib, "Reflectance")) {
+	    status = FM_IO_ERR;
+	}
+    }
+    if (fm_calplan_bind(&plan, 2, calib, "Temperature") ||
+	    fm_calplan_bind(&plan, 3, calib, "Temperature") ||
+	    fm_calplan_bind(&plan, 4, calib, "Temperature")) {
+	status = FM_IO_ERR;
+    }
+    free(calib.slope);
+    if (status) {
+	fmerrmsg(where,"Could not set up calibration of channels");
+	fm_calplan_free(&plan);
+	return(status);
+    }
+
+//    fprintf(stdout, "Gain, intercept refl: %f %f", img.rga, img.ria);
+//    fprintf(stdout, "Gain, intercept temp: %f %f", img.rgt, img.rit);
+
+    doy = fmdayofyear(timeid);
+
+    /*
+     * Channel 3b is used when 3a is missing, the satellite is identified
+     * once for the scene. Daytime pixels are processed by algo 2 whatever
+     * algo is given, the scene is thus always needed.
+     */
+    if (fm_ch3b_open(img.sa, doy, &ch3b)) {
+	fmerrmsg(where,"Could not find channel 3b constants for %s",
+		img.sa);
+	fm_calplan_free(&plan);
+	return(FM_VAROUTOFSCOPE_ERR);
+    }
+
+    geo = opts.geo;
+    if (geo != NULL && !fmgeogrid_matches(*geo, ucs0, MI)) {
+	fmerrmsg(where,
+		"Geolocation grid does not match image, not used");
+	geo = NULL;
+    }
+
+    /*
+     * Solar zenith angles are interpolated from tie points if requested
+     * and the measured error is acceptable, otherwise computed for each
+     * pixel.
+     */
+    fmsolargrid_init(&sozgrid);
+    soz = NULL;
+    if (opts.sozstep > 0) {
+	if (fmsolargrid_compute(ucs0, MI, geo, timeidsec, opts.sozstep,
+		    &sozgrid)) {
+	    fmerrmsg(where,
+		    "Could not compute solar zenith grid, using exact angles");
+	} else if (sozgrid.maxerr > opts.sozmaxerr) {
+	    fmlogmsg(where,
+		    "Solar zenith grid error %.3f exceeds %.3f deg, using exact angles",
+		    sozgrid.maxerr, opts.sozmaxerr);
+	} else {
+	    fmlogmsg(where,
+		    "Solar zenith angles from %dx%d tie points, max. error %.3f deg",
+		    sozgrid.nx, sozgrid.ny, sozgrid.maxerr);
+	    soz = &sozgrid;
+	}
+    }
+
+    if (opts.batch) {
+	probest_prepare(cof, &pc);
+    }
+
+    /*
+     * Split the tile in bands of rows, one for each thread.
+     */
+    nthreads = opts.nthreads;
+    if (nthreads > FMSNOWCOVER_MAXTHREADS) nthreads = FMSNOWCOVER_MAXTHREADS;
+    if (nthreads > img.ih) nthreads = img.ih;
+    if (nthreads < 1) nthreads = 1;
+
+    band = (ppband *) malloc(nthreads*sizeof(ppband));
+    tid = (pthread_t *) malloc(nthreads*sizeof(pthread_t));
+    started = (short *) malloc(nthreads*sizeof(short));
+    if (!band || !tid || !started) {
+	fmerrmsg(where,"Could not allocate memory for row bands");
+	if (band) free(band);
+	if (tid) free(tid);
+	if (started) free(started);
+	fm_calplan_free(&plan);
+	fmsolargrid_free(&sozgrid);
+	return(FM_MEMALL_ERR);
+    }
+
+    nrows = (img.ih+nthreads-1)/nthreads;
+    for (i=0; i<nthreads; i++) {
+	band[i].img = &img;
+	band[i].lmask = lmask;
+	band[i].nwp = &nwp;
+	band[i].probs = probs;
+	band[i].class = class;
+	band[i].cat = cat;
+	band[i].algo = algo;
+	band[i].cof = &cof;
+	band[i].batch = opts.batch;
+	band[i].lazy = opts.lazy;
+	band[i].pc = &pc;
+	band[i].geo = geo;
+	band[i].soz = soz;
+	band[i].ucs0 = ucs0;
+	band[i].timeidsec = timeidsec;
+	band[i].plan = &plan;
+	band[i].ch3b = &ch3b;
+	band[i].row0 = i*nrows;
+	band[i].row1 = (i+1)*nrows;
+	if (band[i].row1 > img.ih) band[i].row1 = img.ih;
+	band[i].status = FM_OK;
+	started[i] = 0;
+    }
+
+    if (nthreads == 1) {
+	process_rows(&band[0]);
+    } else {
+	fmlogmsg(where,"Processing %d bands of %d rows in parallel",
+		nthreads, nrows);
+	for (i=0; i<nthreads; i++) {
+	    if (pthread_create(&tid[i], NULL, process_rows_thread, &band[i])) {
+		fmerrmsg(where,
+			"Could not start thread for band %d, processing it serially", i);
+		continue;
+	    }
+	    started[i] = 1;
+	}
+	/*
+	 * Bands that could not be given to a thread are processed here
+	 * while the other threads work.
+	 */
+	for (i=0; i<nthreads; i++) {
+	    if (!started[i]) process_rows(&band[i]);
+	}
+	for (i=0; i<nthreads; i++) {
+	    if (started[i]) pthread_join(tid[i], NULL);
+	}
+    }
+
+    status = FM_OK;
+    for (i=0; i<nthreads; i++) {
+	if (band[i].status != FM_OK) status = band[i].status;
+    }
+
+    free(band);
+    free(tid);
+    free(started);
+    fm_calplan_free(&plan);
+    fmsolargrid_free(&sozgrid);
+
+    fmlogmsg(where,"Now returning to main...");
+
+    return(status);
+}
+
+/*
+ * NAME:
+ * classify_pixel
+ *
+ * PURPOSE:
+ * Store the probabilities of pixel i and the corresponding class and
+ * category.
+ */
+static void classify_pixel(probstr p, int i, datafield *probs,
+       unsigned char *class, unsigned char *cat) {
+
+    /*
+     * Adding this to prevent classification when probabilities do
+     * not sum to 1.
+     */
+    if (p.pice+p.pfree+p.pcloud<0.95 || p.pice+p.pfree+p.pcloud>1.05){
+	return;
+    }
+
+    /*
+     * Also, if r3b1 is too large the probabilities can end up as
+     * nan (not fixed by statement above). Trying this:
+     */
+    if (isnan(p.pice) || isnan(p.pfree) || isnan(p.pcloud)) {
+	return;
+    }
+
+    ((float *) probs[0].data)[i] = p.pice;
+    ((float *) probs[1].data)[i] = p.pfree;
+    ((float *) probs[2].data)[i] = p.pcloud;
+
+    /* Do not remove, I would like to test this further later...
+     * It did not converge at first attempt...
+     * �ystein God�y, METNO/FOU, 12.04.2007
+    p = -8.48841152
+	+2.90687352*(cpar.A2/cpar.A1)
+	-8.06381521*(cpar.A3/cpar.A1)
+	+0.06169313*cpar.soz
+	+0.01925053*cpar.saz;
+    x = -6.92968721
+	+3.15424360*(cpar.A2/cpar.A1)
+	-8.51300241*(cpar.A3/cpar.A1)
+	+0.04520431*cpar.soz;
+    x = -7.147843141
+	+0.006599748*(cpar.A1/cos(deg2rad(cpar.soz)))
+	+2.962917376*(cpar.A2/cpar.A1)
+	-8.593505367*(cpar.A3/cpar.A1)
+	+0.047032443*(cpar.soz);
+    x = -5.012037873
+	+0.008460015*(cpar.A1/cos(deg2rad(cpar.soz)))
+	-6.927675661*(cpar.A3/cpar.A1)
+	+0.044061292*(cpar.soz);
+    x = -6.57091311
+	+0.00738986*(cpar.A1/cos(deg2rad(cpar.soz)))
+	-5.72279895*(cpar.A3/cpar.A1)
+	+0.05807489*(cpar.soz);
+
+    x = -4.761735
+	+3.649293*(cpar.A2/cpar.A1)
+	-7.423763*(cpar.A3/cpar.A1);
+    p = exp(x)/(1+exp(x));
+    */
+
+    if (p.pice < 0.0) {
+	class[i] = 0;
+    } else if (p.pice < 0.05) {
+	class[i] = 1;
+    } else if (p.pice < 0.10) {
+	class[i] = 2;
+    } else if (p.pice < 0.15) {
+	class[i] = 3;
+    } else if (p.pice < 0.20) {
+	class[i] = 4;
+    } else if (p.pice < 0.25) {
+	class[i] = 5;
+    } else if (p.pice < 0.30) {
+	class[i] = 6;
+    } else if (p.pice < 0.35) {
+	class[i] = 7;
+    } else if (p.pice < 0.40) {
+	class[i] = 8;
+    } else if (p.pice < 0.45) {
+	class[i] = 9;
+    } else if (p.pice < 0.50) {
+	class[i] = 10;
+    } else if (p.pice < 0.55) {
+	class[i] = 11;
+    } else if (p.pice < 0.60) {
+	class[i] = 12;
+    } else if (p.pice < 0.65) {
+	class[i] = 13;
+    } else if (p.pice < 0.70) {
+	class[i] = 14;
+    } else if (p.pice < 0.75) {
+	class[i] = 15;
+    } else if (p.pice < 0.80) {
+	class[i] = 16;
+    } else if (p.pice < 0.85) {
+	class[i] = 17;
+    } else if (p.pice < 0.90) {
+	class[i] = 18;
+    } else if (p.pice < 0.95) {
+	class[i] = 19;
+    } else if (p.pice <= 1.0) {
+	class[i] = 20;
+    } else {
+	class[i] = 0;
+    }
+
+    if ((p.pice > p.pfree) && (p.pice > p.pcloud)) {
+      cat[i] = ICE;
+    } else if ((p.pfree > p.pice) && (p.pfree > p.pcloud)) {
+      cat[i] = CLEAR;
+    } else if ((p.pcloud > p.pice) && (p.pcloud > p.pfree)){
+      cat[i] = CLOUD;
+    } else { /*some probs. are equal*/
+      cat[i] = UNCL;
+    }
+}
+
+static void *process_rows_thread(void *arg) {
+
+    process_rows((ppband *) arg);
+
+    return(NULL);
+}
+
+/*
+ * NAME:
+ * process_rows
+ *
+ * PURPOSE:
+ * Classify the pixels of the rows row0 to row1-1. Only the output arrays
+ * for these rows are written, thus bands may be processed concurrently.
+ */
+static int process_rows(ppband *b) {
+
+    char *where="process_pixels4ice";
+    char what[FMSNOWCOVER_MSGLENGTH];
+    int i, j;
+    int xc, yc;
+    /* double x; */
+    pinpstr cpar;
+    probstr p;
+   /*  fmxy cart; */
+    fmindex cart;
+    fmucspos ucspos;
+    fmgeopos geop;
+    fmsec1970 tst;
+    float zsun;
+    fmio_img img = *(b->img);
+    unsigned char *lmask = b->lmask;
+    nwpice nwp = *(b->nwp);
+    datafield *probs = b->probs;
+    unsigned char *class = b->class;
+    unsigned char *cat = b->cat;
+    statcoeffstr cof = *(b->cof);
+    fmgeogrid *geo = b->geo;
+    fmsolargrid *soz = b->soz;
+    fmucsref ucs0 = b->ucs0;
+    fmsec1970 timeidsec = b->timeidsec;
+    fmio_calplan plan = *(b->plan);
+    fm_ch3b_scene *ch3b = b->ch3b;
+    pinpbatch rin;
+    probbatch rout;
+    int *pix, k, m, status;
+
+    if (b->batch) {
+	if (alloc_rowbatch(img.iw, &rin, &rout, &pix)) {
+	    fmerrmsg(where,"Could not allocate memory for probest_batch");
+	    b->status = FM_MEMALL_ERR;
+	    return(FM_MEMALL_ERR);
+	}
+    }
+    status = FM_OK;
+
     cpar.A1 = -999.;
     cpar.A2 = -999.;
     cpar.A3 = -999.;
@@ -121,19 +530,13 @@ int process_pixels4ice(fmio_img img, unsigned char *cmask[],
     cpar.soz= -99;
     cpar.saz= -99;
     cpar.tdiff=-99;
-    cpar.algo = algo;
-
-    fm_img2slopes(img,&calib); /*collects gain and intercept*/
-
-//    fprintf(stdout, "Gain, intercept refl: %f %f", img.rga, img.ria);
-//    fprintf(stdout, "Gain, intercept temp: %f %f", img.rgt, img.rit);
-
-    doy = fmdayofyear(timeid);
+    cpar.algo = b->algo;
 
     /*
      * Start of nested loops that run through alle pixels.
      */
-    for (yc=0; yc < img.ih; yc++) {
+    for (yc=b->row0; yc < b->row1; yc++) {
+	m = 0;
 	for (xc=0; xc < img.iw; xc++) {
 
 	    /*
@@ -159,13 +562,22 @@ int process_pixels4ice(fmio_img img, unsigned char *cmask[],
 	    /*
 	     * Estimate solar zenith angle for each pixel.
 	     */
-	    cart.row = yc;
-	    cart.col = xc;
-	    ucspos = fmind2ucs(ucs0, cart);
-	    geop = fmucs2geo(ucspos,MI);
-	    /*tst needed to compensate for changes in fmsolarzenith:*/
-	    tst = fmutc2tst(timeidsec, geop.lon);
-	    zsun = fmsolarzenith(tst, geop);
+	    if (soz != NULL) {
+		zsun = fmsolargrid_soz(soz, yc, xc);
+	    } else {
+		if (geo != NULL) {
+		    geop.lat = geo->lat[i];
+		    geop.lon = geo->lon[i];
+		} else {
+		    cart.row = yc;
+		    cart.col = xc;
+		    ucspos = fmind2ucs(ucs0, cart);
+		    geop = fmucs2geo(ucspos,MI);
+		}
+		/*tst needed to compensate for changes in fmsolarzenith:*/
+		tst = fmutc2tst(timeidsec, geop.lon);
+		zsun = fmsolarzenith(tst, geop);
+	    }
 
 
 	    if (zsun < FMSNOWSUNZEN) {
@@ -234,13 +646,13 @@ int process_pixels4ice(fmio_img img, unsigned char *cmask[],
 	     */
 
 	    if (cpar.algo == 2 && img.z > 3) {
-	    	cpar.A1 = fm_byte2float(img.image[0][i], calib, "Reflectance");
-	    	cpar.A2 = fm_byte2float(img.image[1][i], calib, "Reflectance");
-	    	cpar.A3 = fm_byte2float(img.image[5][i], calib, "Reflectance");
+	    	cpar.A1 = plan.lut[0][img.image[0][i]];
+	    	cpar.A2 = plan.lut[1][img.image[1][i]];
+	    	cpar.A3 = plan.lut[5][img.image[5][i]];
 	    }
-	    cpar.T3 = fm_byte2float(img.image[2][i], calib, "Temperature");
-	    cpar.T4 = fm_byte2float(img.image[3][i], calib, "Temperature");
-	    cpar.T5 = fm_byte2float(img.image[4][i], calib, "Temperature");
+	    cpar.T3 = plan.lut[2][img.image[2][i]];
+	    cpar.T4 = plan.lut[3][img.image[3][i]];
+	    cpar.T5 = plan.lut[4][img.image[4][i]];
 	    cpar.soz = zsun;
 	    cpar.saz = 0.;
 
@@ -252,130 +664,117 @@ int process_pixels4ice(fmio_img img, unsigned char *cmask[],
 
 	    /* Estimate the reflective part of daytime channel 3b */
 	    if (cpar.daytime3b){
-	      cpar.A3b = fm_ch3brefl(cpar.T3,cpar.T4,cpar.soz,img.sa,doy);
+	      cpar.A3b = fm_ch3brefl_scene(ch3b,cpar.T3,cpar.T4,cpar.soz);
 	    }
 
 
 	    if (i == 0) {
 	     fmlogmsg(where,"Using probest to estimate pixel probabilities...");
 	    }
-	    if (probest(cpar, &p, cof)) {
-		sprintf(what,
-			"Something went wrong in pixel processing of %d",i);
-		fmerrmsg(where,what);
-	    }
 
 	    /*
-	     * Adding this to prevent classification when probabilities do
-	     * not sum to 1.
+	     * In batch mode the pixels of the row are collected and
+	     * classified after probest_batch.
 	     */
-	    if (p.pice+p.pfree+p.pcloud<0.95 || p.pice+p.pfree+p.pcloud>1.05){
+	    if (b->batch) {
+		rin.A1[m] = cpar.A1;
+		rin.A2[m] = cpar.A2;
+		rin.A3[m] = cpar.A3;
+		rin.A3b[m] = cpar.A3b;
+		rin.T4[m] = cpar.T4;
+		rin.T5[m] = cpar.T5;
+		rin.soz[m] = cpar.soz;
+		rin.tdiff[m] = cpar.tdiff;
+		rin.lmask[m] = cpar.lmask;
+		rin.daytime3b[m] = cpar.daytime3b;
+		pix[m] = i;
+		m++;
 		continue;
 	    }
 
-	    /*
-	     * Also, if r3b1 is too large the probabilities can end up as
-	     * nan (not fixed by statement above). Trying this:
-	     */
-	    if (isnan(p.pice) || isnan(p.pfree) || isnan(p.pcloud)) {
-		continue;
+	    if ((b->lazy ? probest_lazy(cpar, &p, cof) :
+			probest(cpar, &p, cof))) {
+		sprintf(what,
+			"Something went wrong in pixel processing of %d",i);
+		fmerrmsg(where,what);
 	    }
 
-	    ((float *) probs[0].data)[i] = p.pice;
-	    ((float *) probs[1].data)[i] = p.pfree;
-	    ((float *) probs[2].data)[i] = p.pcloud;
-
-	    /* Do not remove, I would like to test this further later...
-	     * It did not converge at first attempt...
-	     * �ystein God�y, METNO/FOU, 12.04.2007
-	    p = -8.48841152
-		+2.90687352*(cpar.A2/cpar.A1)
-		-8.06381521*(cpar.A3/cpar.A1)
-		+0.06169313*cpar.soz
-		+0.01925053*cpar.saz;
-	    x = -6.92968721
-		+3.15424360*(cpar.A2/cpar.A1)
-		-8.51300241*(cpar.A3/cpar.A1)
-		+0.04520431*cpar.soz;
-	    x = -7.147843141
-		+0.006599748*(cpar.A1/cos(deg2rad(cpar.soz)))
-		+2.962917376*(cpar.A2/cpar.A1)
-		-8.593505367*(cpar.A3/cpar.A1)
-		+0.047032443*(cpar.soz);
-	    x = -5.012037873
-		+0.008460015*(cpar.A1/cos(deg2rad(cpar.soz)))
-		-6.927675661*(cpar.A3/cpar.A1)
-		+0.044061292*(cpar.soz);
-	    x = -6.57091311
-		+0.00738986*(cpar.A1/cos(deg2rad(cpar.soz)))
-		-5.72279895*(cpar.A3/cpar.A1)
-		+0.05807489*(cpar.soz);
-
-	    x = -4.761735
-		+3.649293*(cpar.A2/cpar.A1)
-		-7.423763*(cpar.A3/cpar.A1);
-	    p = exp(x)/(1+exp(x));
-	    */
-
-	    if (p.pice < 0.0) {
-		class[i] = 0;
-	    } else if (p.pice < 0.05) {
-		class[i] = 1;
-	    } else if (p.pice < 0.10) {
-		class[i] = 2;
-	    } else if (p.pice < 0.15) {
-		class[i] = 3;
-	    } else if (p.pice < 0.20) {
-		class[i] = 4;
-	    } else if (p.pice < 0.25) {
-		class[i] = 5;
-	    } else if (p.pice < 0.30) {
-		class[i] = 6;
-	    } else if (p.pice < 0.35) {
-		class[i] = 7;
-	    } else if (p.pice < 0.40) {
-		class[i] = 8;
-	    } else if (p.pice < 0.45) {
-		class[i] = 9;
-	    } else if (p.pice < 0.50) {
-		class[i] = 10;
-	    } else if (p.pice < 0.55) {
-		class[i] = 11;
-	    } else if (p.pice < 0.60) {
-		class[i] = 12;
-	    } else if (p.pice < 0.65) {
-		class[i] = 13;
-	    } else if (p.pice < 0.70) {
-		class[i] = 14;
-	    } else if (p.pice < 0.75) {
-		class[i] = 15;
-	    } else if (p.pice < 0.80) {
-		class[i] = 16;
-	    } else if (p.pice < 0.85) {
-		class[i] = 17;
-	    } else if (p.pice < 0.90) {
-		class[i] = 18;
-	    } else if (p.pice < 0.95) {
-		class[i] = 19;
-	    } else if (p.pice <= 1.0) {
-		class[i] = 20;
-	    } else {
-		class[i] = 0;
-	    }
+	    classify_pixel(p, i, probs, class, cat);
+	}
 
-	    if ((p.pice > p.pfree) && (p.pice > p.pcloud)) {
-	      cat[i] = ICE;
-	    } else if ((p.pfree > p.pice) && (p.pfree > p.pcloud)) {
-	      cat[i] = CLEAR;
-	    } else if ((p.pcloud > p.pice) && (p.pcloud > p.pfree)){
-	      cat[i] = CLOUD;
-	    } else { /*some probs. are equal*/
-	      cat[i] = UNCL;
+	if (b->batch && m > 0) {
+	    if (probest_batch(m, rin, rout, b->pc)) {
+		fmerrmsg(where,"Could not estimate probabilities of row %d",yc);
+		status = FM_OTHER_ERR;
+		break;
+	    }
+	    for (k=0; k<m; k++) {
+		p.pice = rout.pice[k];
+		p.pfree = rout.pfree[k];
+		p.pcloud = rout.pcloud[k];
+		classify_pixel(p, pix[k], probs, class, cat);
 	    }
-
 	}
     }
-    fmlogmsg(where,"Now returning to main...");
+
+    if (b->batch) {
+	free_rowbatch(&rin, &rout, pix);
+    }
+
+    b->status = status;
+
+    return(status);
+}
+
+/*
+ * NAME:
+ * alloc_rowbatch, free_rowbatch
+ *
+ * PURPOSE:
+ * Allocate and free the arrays holding the input and output of
+ * probest_batch for a row of n pixels, and the index of each pixel.
+ */
+static int alloc_rowbatch(int n, pinpbatch *in, probbatch *out, int **pix) {
+
+    in->A1 = (float *) malloc(n*sizeof(float));
+    in->A2 = (float *) malloc(n*sizeof(float));
+    in->A3 = (float *) malloc(n*sizeof(float));
+    in->A3b = (float *) malloc(n*sizeof(float));
+    in->T4 = (float *) malloc(n*sizeof(float));
+    in->T5 = (float *) malloc(n*sizeof(float));
+    in->soz = (float *) malloc(n*sizeof(float));
+    in->tdiff = (float *) malloc(n*sizeof(float));
+    in->lmask = (short *) malloc(n*sizeof(short));
+    in->daytime3b = (short *) malloc(n*sizeof(short));
+    out->pice = (double *) malloc(n*sizeof(double));
+    out->pfree = (double *) malloc(n*sizeof(double));
+    out->pcloud = (double *) malloc(n*sizeof(double));
+    *pix = (int *) malloc(n*sizeof(int));
+
+    if (!in->A1 || !in->A2 || !in->A3 || !in->A3b || !in->T4 || !in->T5 ||
+	    !in->soz || !in->tdiff || !in->lmask || !in->daytime3b ||
+	    !out->pice || !out->pfree || !out->pcloud || !*pix) {
+	free_rowbatch(in, out, *pix);
+	return(FM_MEMALL_ERR);
+    }
 
     return(FM_OK);
 }
+
+static void free_rowbatch(pinpbatch *in, probbatch *out, int *pix) {
+
+    free(in->A1);
+    free(in->A2);
+    free(in->A3);
+    free(in->A3b);
+    free(in->T4);
+    free(in->T5);
+    free(in->soz);
+    free(in->tdiff);
+    free(in->lmask);
+    free(in->daytime3b);
+    free(out->pice);
+    free(out->pfree);
+    free(out->pcloud);
+    free(pix);
+}
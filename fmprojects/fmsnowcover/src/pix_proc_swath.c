@@ -60,6 +60,10 @@
  * introducing fm_ch3brefl.
  * MAK, METNO/FOU, 22.09.2009: (temp.) adding "cat" to categorize each
  * pixel in class with highest probability.
+ * METNO/FOU, 17.10.2026: Channel 3b constants are found once for the
+ * swath by fm_ch3b_open.
+ * METNO/FOU, 17.10.2026: Layers are read by fmdatafield_value, whatever
+ * their storage type. lmask is the land/sea mask layer.
  *
  * CVS_ID:
  * $Id: pix_proc.c,v 1.10 2011-12-05 09:58:47 mariak Exp $
@@ -70,7 +74,7 @@
 /*#undef FMSNOWCOVER_HAVE_LIBUSENWP*/
 
 int process_pixels4ice_swath(fmdataset img, unsigned char *cmask[],
-       int **lmask, nwpice nwp, fmdataset sz, datafield *probs,
+       fmdatafield *lmask, nwpice nwp, fmdataset sz, datafield *probs,
        unsigned char *class, unsigned char *cat, short algo, statcoeffstr cof) {
 
 	//Input: data struct, cmask?, landmask struct, model data (NWP) struct, sun zenith angles struct, struct with info,
@@ -93,6 +97,7 @@ int process_pixels4ice_swath(fmdataset img, unsigned char *cmask[],
     float zsun, zsun2;
     int doy;
     fmscale calib; /*will contain gain and intercept values*/
+    fm_ch3b_scene ch3b; /*channel 3b constants of the satellite*/
 
     fmlogmsg(where,
 	    "Now processing the individual pixels to gain ice probability.");
@@ -144,6 +149,17 @@ int process_pixels4ice_swath(fmdataset img, unsigned char *cmask[],
     }
 //    fprintf(stdout,"Channels 1:%d 2:%d 3a:%d 3b:%d 4:%d 5:%d\n",channel1, channel2, channel3a, channel3b, channel4, channel5);
 
+    /*
+     * Identify the satellite once if channel 3b may be used, daytime
+     * pixels are processed by algo 2 whatever algo is given.
+     */
+    if (channel3b > 0) {
+    	if (fm_ch3b_open(img.h.platform_name, doy, &ch3b)) {
+    		fmerrmsg(where,"Could not find channel 3b constants for %s",
+    				img.h.platform_name);
+    		return(FM_VAROUTOFSCOPE_ERR);
+    	}
+    }
 
     /*
      * Start of nested loops that run through all pixels.
@@ -174,8 +190,7 @@ int process_pixels4ice_swath(fmdataset img, unsigned char *cmask[],
     			if(strstr(sz.d[im].description, "sun zenith ang")) { //Find right layer (containing the solar zenith angle)
     				float gain = sz.d[im].scalefactor.slope->gain;
     				float offset = sz.d[im].scalefactor.slope->intercept;
-    				if(sz.d[im].dtype == FMFLOAT) zsun = sz.d[im].floatarray[yc][xc]*gain + offset; //If data type is float
-    				else if(sz.d[im].dtype == FMINT) zsun = sz.d[im].intarray[yc][xc]*gain + offset; //If data type is int
+    				zsun = fmdatafield_value(&sz.d[im],yc,xc)*gain + offset;
     			}
     		}
 
@@ -212,7 +227,7 @@ int process_pixels4ice_swath(fmdataset img, unsigned char *cmask[],
 //    		 */
 
 
-    		if ((img.d[channel4].intarray[yc][xc] == 0) && (img.d[channel5].intarray[yc][xc] == 0)) {
+    		if ((fmdatafield_value(&img.d[channel4],yc,xc) == 0) && (fmdatafield_value(&img.d[channel5],yc,xc) == 0)) {
     			for (j=0; j<FMSNOWCOVER_OLEVELS; j++) {
     				((float *) probs[j].data)[i] = FMSNOWCOVERMISVAL_NOCOV;
     			}
@@ -225,14 +240,14 @@ int process_pixels4ice_swath(fmdataset img, unsigned char *cmask[],
     		cpar.daytime3b = 0;
     		if(cpar.algo == 2 && channel3b > 0) {
     			if (strstr(img.h.sensor_name,"avhrr")) cpar.daytime3b = 1; //Use 3b data if no 3a data provided (avhrr)
-    			if (strstr(img.h.sensor_name,"viirs") && img.d[channel3a].intarray[yc][xc] == 0 && img.d[channel3b].intarray[yc][xc] > 0) cpar.daytime3b = 1; //Use 3b data if 3a data does not exists for this time step (viirs)
+    			if (strstr(img.h.sensor_name,"viirs") && fmdatafield_value(&img.d[channel3a],yc,xc) == 0 && fmdatafield_value(&img.d[channel3b],yc,xc) > 0) cpar.daytime3b = 1; //Use 3b data if 3a data does not exists for this time step (viirs)
     		}
 
     		/*
     		 * AVHRR: Added hack on 3A due to saturation problems...
     		 */
     		if (!cpar.daytime3b  && strstr(img.h.sensor_name,"avhrr")) { //If 3a data is provided by instrument avhrr
-    			if ((img.d[channel3a].intarray[yc][xc] == 0) && (img.d[channel4].intarray[yc][xc] > 50)) { //If channel 3a data = 0 and channel 4 (another IR channel) data > 50
+    			if ((fmdatafield_value(&img.d[channel3a],yc,xc) == 0) && (fmdatafield_value(&img.d[channel4],yc,xc) > 50)) { //If channel 3a data = 0 and channel 4 (another IR channel) data > 50
     				class[i] = 0;
     				for (j=0; j<FMSNOWCOVER_OLEVELS; j++) {
     					((float *) probs[j].data)[i] = FMSNOWCOVERMISVAL_3A; //Set probability to default value
@@ -249,7 +264,7 @@ int process_pixels4ice_swath(fmdataset img, unsigned char *cmask[],
     			}
     		}
     		else {
-    			cpar.lmask = (short) lmask[yc][xc]; //Else, use landmask provided in physiography file
+    			cpar.lmask = (short) fmdatafield_value(lmask,yc,xc); //Else, use landmask provided in physiography file
     		}
 
     		/*
@@ -263,12 +278,12 @@ int process_pixels4ice_swath(fmdataset img, unsigned char *cmask[],
 
 
     		//"Unpack" compressed data (from int/short to float): data*gain + intercept
-    		cpar.A1 = img.d[channel1].intarray[yc][xc]*img.d[channel1].scalefactor.slope->gain + img.d[channel1].scalefactor.slope->intercept;
-    		cpar.A2 = img.d[channel2].intarray[yc][xc]*img.d[channel2].scalefactor.slope->gain + img.d[channel2].scalefactor.slope->intercept;
-    		if(channel3a > 0) cpar.A3 = img.d[channel3a].intarray[yc][xc]*img.d[channel3a].scalefactor.slope->gain + img.d[channel3a].scalefactor.slope->intercept;
-    		if(channel3b > 0) cpar.T3 = img.d[channel3b].intarray[yc][xc]*img.d[channel3b].scalefactor.slope->gain + img.d[channel3b].scalefactor.slope->intercept;
-    		cpar.T4 = img.d[channel4].intarray[yc][xc]*img.d[channel4].scalefactor.slope->gain + img.d[channel4].scalefactor.slope->intercept;
-    		cpar.T5 = img.d[channel5].intarray[yc][xc]*img.d[channel5].scalefactor.slope->gain + img.d[channel5].scalefactor.slope->intercept;
+    		cpar.A1 = fmdatafield_value(&img.d[channel1],yc,xc)*img.d[channel1].scalefactor.slope->gain + img.d[channel1].scalefactor.slope->intercept;
+    		cpar.A2 = fmdatafield_value(&img.d[channel2],yc,xc)*img.d[channel2].scalefactor.slope->gain + img.d[channel2].scalefactor.slope->intercept;
+    		if(channel3a > 0) cpar.A3 = fmdatafield_value(&img.d[channel3a],yc,xc)*img.d[channel3a].scalefactor.slope->gain + img.d[channel3a].scalefactor.slope->intercept;
+    		if(channel3b > 0) cpar.T3 = fmdatafield_value(&img.d[channel3b],yc,xc)*img.d[channel3b].scalefactor.slope->gain + img.d[channel3b].scalefactor.slope->intercept;
+    		cpar.T4 = fmdatafield_value(&img.d[channel4],yc,xc)*img.d[channel4].scalefactor.slope->gain + img.d[channel4].scalefactor.slope->intercept;
+    		cpar.T5 = fmdatafield_value(&img.d[channel5],yc,xc)*img.d[channel5].scalefactor.slope->gain + img.d[channel5].scalefactor.slope->intercept;
 
 //    		fprintf(stdout,"Data: %f %f %f %f %f %f %f\n",cpar.A1,cpar.A2,cpar.A3,cpar.T3,cpar.T4,cpar.T5,zsun, img.h.);
 
@@ -282,7 +297,7 @@ int process_pixels4ice_swath(fmdataset img, unsigned char *cmask[],
 
     		/* Estimate the reflective part of daytime channel 3b */
     		if (cpar.daytime3b){
-    			cpar.A3b = fm_ch3brefl(cpar.T3,cpar.T4,cpar.soz,img.h.platform_name,doy);
+    			cpar.A3b = fm_ch3brefl_scene(&ch3b,cpar.T3,cpar.T4,cpar.soz);
     		}
     		/*Get probability estimates*/
     		if (i == 0) {
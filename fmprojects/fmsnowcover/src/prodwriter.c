@@ -0,0 +1,236 @@
+/*
+ * NAME:
+ * prodwriter_init
+ * prodwriter_add
+ * prodwriter_slot
+ * prodwriter_submit
+ * prodwriter_finish
+ *
+ * PURPOSE:
+ * To write the products of a tile on background threads while the tile
+ * is classified. Each writer added by prodwriter_add is given the bands
+ * of the tile in order, bands are held in slots that are reused once
+ * all writers are done with them.
+ *
+ * REQUIREMENTS:
+ * o pthreads
+ *
+ * INPUT:
+ * o writers, functions writing the band of a slot to a product
+ * o bands, the first row and number of rows of each band
+ *
+ * OUTPUT:
+ * The status of the writers, returned by prodwriter_finish.
+ *
+ * NOTES:
+ * The caller fills the slot returned by prodwriter_slot with the next
+ * band and hands it over by prodwriter_submit, for a whole tile this is
+ * one band in one slot. prodwriter_finish is the single completion
+ * barrier, it waits for all writers and returns the first error. Once a
+ * writer fails it writes no more bands, and prodwriter_slot returns -1.
+ *
+ * Writers that could not be given a thread, and all writers if async is
+ * not set, are run by prodwriter_submit in the calling thread.
+ *
+ * HDF5 calls of writers and of the caller are to be made holding
+ * h5lock, as libhdf5 is usually built without thread safety.
+ *
+ * BUGS:
+ * NA
+ *
+ * AUTHOR:
+ * METNO/FOU, 17.10.2026
+ *
+ * MODIFIED:
+ * NA
+ *
+ * ID:
+ * $Id$
+ */
+
+#include <fmsnowcover.h>
+
+/*
+ * Write the bands given to writer arg until the writer is closed or
+ * fails.
+ */
+static void *prodwriter_thread(void *arg) {
+
+    prodjob *j = (prodjob *) arg;
+    prodwriter *w = j->w;
+    int slot, row0, nrows, status;
+
+    pthread_mutex_lock(&(w->lock));
+    while (1) {
+	while (j->done == w->queued && !w->closed) {
+	    pthread_cond_wait(&(w->cond), &(w->lock));
+	}
+	if (j->done == w->queued) break;
+	slot = j->done % w->nslots;
+	row0 = w->row0[slot];
+	nrows = w->nrows[slot];
+	pthread_mutex_unlock(&(w->lock));
+
+	status = j->fn(j->arg, slot, row0, nrows);
+
+	pthread_mutex_lock(&(w->lock));
+	j->done++;
+	if (status) {
+	    fmerrmsg(j->name,"Could not write rows %d-%d", row0,
+		    row0+nrows-1);
+	    j->status = status;
+	}
+	pthread_cond_broadcast(&(w->cond));
+	if (status) break;
+    }
+    pthread_mutex_unlock(&(w->lock));
+
+    return(NULL);
+}
+
+/*
+ * Prepare w for writers of bands held in nslots slots, writers run on
+ * threads of their own if async is set.
+ */
+int prodwriter_init(prodwriter *w, int nslots, fmbool async) {
+
+    char *where="prodwriter_init";
+
+    if (nslots < 1 || nslots > FMSNOWCOVER_WRITESLOTS) {
+	fmerrmsg(where,"Can not hold bands in %d slots", nslots);
+	return(FM_VAROUTOFSCOPE_ERR);
+    }
+    w->n = 0;
+    w->nslots = nslots;
+    w->async = async;
+    w->queued = 0;
+    w->closed = FMFALSE;
+    pthread_mutex_init(&(w->lock), NULL);
+    pthread_cond_init(&(w->cond), NULL);
+    pthread_mutex_init(&(w->h5lock), NULL);
+
+    return(FM_OK);
+}
+
+/*
+ * Add writer fn, called with arg and the slot, first row and number of
+ * rows of each band. name identifies the writer in messages.
+ */
+int prodwriter_add(prodwriter *w, char *name, prodwriter_fn fn,
+	void *arg) {
+
+    char *where="prodwriter_add";
+    prodjob *j;
+
+    if (w->n >= FMSNOWCOVER_MAXWRITERS || w->queued > 0) {
+	fmerrmsg(where,"Can not add writer %s", name);
+	return(FM_VAROUTOFSCOPE_ERR);
+    }
+    j = &(w->job[w->n]);
+    j->w = w;
+    snprintf(j->name, FMSNOWCOVER_STAGENAME, "%s", name);
+    j->fn = fn;
+    j->arg = arg;
+    j->status = FM_OK;
+    j->done = 0;
+    j->started = FMFALSE;
+    if (w->async) {
+	if (pthread_create(&(j->tid), NULL, prodwriter_thread, j)) {
+	    fmerrmsg(where,
+		    "Could not start thread for %s, writing it serially", name);
+	} else {
+	    j->started = FMTRUE;
+	}
+    }
+    w->n++;
+
+    return(FM_OK);
+}
+
+/*
+ * Wait until the slot of the next band is free, and return it, or -1 if
+ * a writer has failed.
+ */
+int prodwriter_slot(prodwriter *w) {
+
+    int i, slot;
+    fmbool isfree;
+
+    pthread_mutex_lock(&(w->lock));
+    while (1) {
+	isfree = FMTRUE;
+	for (i=0; i<w->n; i++) {
+	    if (w->job[i].status) {
+		pthread_mutex_unlock(&(w->lock));
+		return(-1);
+	    }
+	    if (w->job[i].done <= w->queued-w->nslots) isfree = FMFALSE;
+	}
+	if (isfree) break;
+	pthread_cond_wait(&(w->cond), &(w->lock));
+    }
+    slot = w->queued % w->nslots;
+    pthread_mutex_unlock(&(w->lock));
+
+    return(slot);
+}
+
+/*
+ * Hand the band of rows row0 to row0+nrows-1, held in the slot returned
+ * by prodwriter_slot, over to the writers. Writers without a thread
+ * write it before returning, their first error is returned.
+ */
+int prodwriter_submit(prodwriter *w, int row0, int nrows) {
+
+    int i, slot, status;
+    prodjob *j;
+
+    pthread_mutex_lock(&(w->lock));
+    slot = w->queued % w->nslots;
+    w->row0[slot] = row0;
+    w->nrows[slot] = nrows;
+    w->queued++;
+    pthread_cond_broadcast(&(w->cond));
+    pthread_mutex_unlock(&(w->lock));
+
+    status = FM_OK;
+    for (i=0; i<w->n; i++) {
+	j = &(w->job[i]);
+	if (j->started || j->status) continue;
+	j->status = j->fn(j->arg, slot, row0, nrows);
+	if (j->status) {
+	    fmerrmsg(j->name,"Could not write rows %d-%d", row0, row0+nrows-1);
+	}
+	pthread_mutex_lock(&(w->lock));
+	j->done++;
+	pthread_mutex_unlock(&(w->lock));
+	if (j->status && !status) status = j->status;
+    }
+
+    return(status);
+}
+
+/*
+ * Wait for all writers to finish the bands submitted, and release w.
+ */
+int prodwriter_finish(prodwriter *w) {
+
+    int i, status;
+
+    pthread_mutex_lock(&(w->lock));
+    w->closed = FMTRUE;
+    pthread_cond_broadcast(&(w->cond));
+    pthread_mutex_unlock(&(w->lock));
+
+    status = FM_OK;
+    for (i=0; i<w->n; i++) {
+	if (w->job[i].started) pthread_join(w->job[i].tid, NULL);
+	if (w->job[i].status && !status) status = w->job[i].status;
+    }
+    w->n = 0;
+    pthread_cond_destroy(&(w->cond));
+    pthread_mutex_destroy(&(w->lock));
+    pthread_mutex_destroy(&(w->h5lock));
+
+    return(status);
+}
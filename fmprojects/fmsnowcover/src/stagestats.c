@@ -0,0 +1,209 @@
+/*
+ * NAME:
+ * stagestats.c
+ *
+ * PURPOSE:
+ * To record the resources used by each processing stage of a scene:
+ * wall time, CPU time, bytes read and written and peak memory. The
+ * record of a scene is written as a single line, to tell slow I/O from
+ * slow computation in production.
+ *
+ * REQUIREMENTS:
+ * NA
+ *
+ * INPUT:
+ * NA
+ *
+ * OUTPUT:
+ * One line per scene, with key=value fields separated by blanks:
+ * time, scene, status and for each stage <stage>.wall and <stage>.cpu
+ * [s], <stage>.rbytes and <stage>.wbytes and <stage>.maxrss [kB].
+ *
+ * NOTES:
+ * CPU time is user and system time of all threads of the process. Bytes
+ * read and written are those of read and write system calls as counted
+ * in /proc/self/io, including data found in the page cache and messages
+ * written to stdout, and are -1 where this is not available. Peak memory
+ * is the peak resident set size of the process at the end of the stage.
+ *
+ * BUGS:
+ * NA
+ *
+ * AUTHOR:
+ * METNO/FOU, 17.10.2026
+ *
+ * MODIFIED:
+ * NA
+ *
+ * ID:
+ * $Id$
+ */
+
+#include <fmsnowcover.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+/*
+ * Wall time, CPU time and I/O counters of the process. Reading
+ * /proc/self/io is itself counted after the values are given, at the
+ * start of a stage the bytes of this read are added to rbytes so that
+ * they are not counted in the stage.
+ */
+static void stagestats_now(double *wall, double *cpu, long long *rbytes,
+	long long *wbytes, long *maxrss, fmbool start) {
+
+    struct timeval tv;
+    struct rusage ru;
+    FILE *fp;
+    char line[FMSNOWCOVER_MSGLENGTH];
+    long long nread;
+
+    gettimeofday(&tv, NULL);
+    *wall = tv.tv_sec+1e-6*tv.tv_usec;
+
+    getrusage(RUSAGE_SELF, &ru);
+    *cpu = ru.ru_utime.tv_sec+1e-6*ru.ru_utime.tv_usec+
+	ru.ru_stime.tv_sec+1e-6*ru.ru_stime.tv_usec;
+    *maxrss = ru.ru_maxrss;
+
+    *rbytes = *wbytes = -1;
+    nread = 0;
+    fp = fopen("/proc/self/io","r");
+    if (fp) {
+	while (fgets(line, FMSNOWCOVER_MSGLENGTH, fp)) {
+	    sscanf(line,"rchar: %lld", rbytes);
+	    sscanf(line,"wchar: %lld", wbytes);
+	    nread += strlen(line);
+	}
+	fclose(fp);
+	if (start && *rbytes >= 0) *rbytes += nread;
+    }
+}
+
+/*
+ * NAME:
+ * stagestats_init
+ *
+ * PURPOSE:
+ * Initialise an empty record.
+ */
+int stagestats_init(stagestats *s) {
+
+    s->n = 0;
+    s->active = FMFALSE;
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * stagestats_start
+ *
+ * PURPOSE:
+ * Start a stage, a stage already started is stopped first.
+ *
+ * RETURN VALUES:
+ * FM_OK on success and FM_VAROUTOFSCOPE_ERR if there is no room for
+ * more stages, the stage is not recorded then.
+ */
+int stagestats_start(stagestats *s, char *name) {
+
+    char *where="stagestats_start";
+    stagerec *r;
+    long maxrss;
+
+    if (s->active) stagestats_stop(s);
+    if (s->n >= FMSNOWCOVER_MAXSTAGES) {
+	fmerrmsg(where,"No room for stage %s", name);
+	return(FM_VAROUTOFSCOPE_ERR);
+    }
+
+    r = &(s->stage[s->n]);
+    snprintf(r->name, FMSNOWCOVER_STAGENAME, "%s", name);
+    stagestats_now(&(r->wall), &(r->cpu), &(r->rbytes), &(r->wbytes),
+	    &maxrss, FMTRUE);
+    s->active = FMTRUE;
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * stagestats_stop
+ *
+ * PURPOSE:
+ * Stop the stage started last, and record the resources used.
+ */
+int stagestats_stop(stagestats *s) {
+
+    stagerec *r;
+    double wall, cpu;
+    long long rbytes, wbytes;
+
+    if (!s->active) return(FM_OK);
+
+    r = &(s->stage[s->n]);
+    stagestats_now(&wall, &cpu, &rbytes, &wbytes, &(r->maxrss), FMFALSE);
+    r->wall = wall-r->wall;
+    r->cpu = cpu-r->cpu;
+    r->rbytes = (rbytes < 0 || r->rbytes < 0 ? -1 : rbytes-r->rbytes);
+    r->wbytes = (wbytes < 0 || r->wbytes < 0 ? -1 : wbytes-r->wbytes);
+    s->n++;
+    s->active = FMFALSE;
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * stagestats_write
+ *
+ * PURPOSE:
+ * Write the record of scene, processed with the given status, as one
+ * line appended to filename, or to stderr if filename is NULL or empty.
+ * A stage still running is stopped first.
+ *
+ * RETURN VALUES:
+ * FM_OK on success and FM_IO_ERR if the record could not be written.
+ */
+int stagestats_write(stagestats *s, char *filename, char *scene,
+	int status) {
+
+    char *where="stagestats_write";
+    char datestr[25];
+    FILE *fp;
+    stagerec *r;
+    int i;
+
+    stagestats_stop(s);
+
+    fp = stderr;
+    if (filename && filename[0] != '\0') {
+	fp = fopen(filename,"a");
+	if (!fp) {
+	    fmerrmsg(where,"Could not open %s", filename);
+	    return(FM_IO_ERR);
+	}
+    }
+
+    fmsec19702isodatetime((fmsec1970) time(NULL), datestr);
+    fprintf(fp,"time=%s scene=%s status=%d", datestr, scene, status);
+    for (i=0; i<s->n; i++) {
+	r = &(s->stage[i]);
+	fprintf(fp," %s.wall=%.3f %s.cpu=%.3f", r->name, r->wall,
+		r->name, r->cpu);
+	fprintf(fp," %s.rbytes=%lld %s.wbytes=%lld %s.maxrss=%ld",
+		r->name, r->rbytes, r->name, r->wbytes, r->name, r->maxrss);
+    }
+    fprintf(fp,"\n");
+
+    if (fp != stderr) {
+	if (fclose(fp)) {
+	    fmerrmsg(where,"Could not write %s", filename);
+	    return(FM_IO_ERR);
+	}
+    }
+
+    return(FM_OK);
+}
@@ -0,0 +1,644 @@
+/*
+ * NAME:
+ * store_hdf5_product_opts
+ * h5prodopts_init
+ * h5prodbands_create
+ * h5prodbands_open
+ * h5prodbands_read
+ * h5prodbands_write
+ * h5prodbands_close
+ *
+ * PURPOSE:
+ * To write a product as store_hdf5_product does, but with the datasets
+ * of its layers stored in chunks of rows that are compressed by the
+ * shuffle and deflate filters of HDF5. The h5prodbands functions write
+ * the layers of such a product, or read them, a band of rows at a time.
+ *
+ * REQUIREMENTS:
+ * o libosihdf5
+ * o libhdf5 with the deflate filter
+ *
+ * INPUT:
+ * o name of the product file
+ * o the product
+ * o storage options, see h5prodopts in fmaccusnow.h
+ *
+ * OUTPUT:
+ * HDF5 file with the layout of libosihdf5, see h5prod_create. HDF5
+ * decodes the filters when data are read, thus read_hdf5_product and
+ * other readers read the product as before.
+ *
+ * NOTES:
+ * The datasets are created directly with the new storage, no temporary
+ * file is written. h5prodbands_create creates the datasets without
+ * data, their chunks are written by h5prodbands_write. With a negative
+ * deflate level store_hdf5_product_opts writes the product by
+ * store_hdf5_product, and h5prodbands_create stores the layers as
+ * store_hdf5_product does.
+ *
+ * The layers of a product are the datasets of group /Data with as many
+ * elements as the image of the header, in the order of their names.
+ * libosihdf5 gives these datasets the dimensions iw and ih, the rows of
+ * the image are therefore selected as a range of elements.
+ *
+ * BUGS:
+ * The layout is that of libosihdf5 when this was written, a change of
+ * it in libosihdf5 must be repeated in h5prod_create.
+ *
+ * AUTHOR:
+ * METNO/FOU, 17.10.2026
+ *
+ * MODIFIED:
+ * NA
+ *
+ * ID:
+ * $Id$
+ */
+
+#include <fmaccusnow.h>
+#include <unistd.h>
+#include <hdf5.h>
+
+/*
+ * Layout of the products of libosihdf5. The header is the compound
+ * dataset Header of the root group and layer i the dataset data[i] of
+ * group /Data with the attribute Description. Strings are stored in the
+ * sizes of their members of PRODhead and datafield. store_hdf5_product
+ * stores the layers in chunks of 50x50 elements compressed by deflate at
+ * level 6.
+ */
+#define H5PROD_HEADER "Header"
+#define H5PROD_DATA "/Data"
+#define H5PROD_LAYER "data[%02d]"
+#define H5PROD_DESCRIPTION "Description"
+#define H5PROD_STRLEN(type, member) sizeof(((type *) 0)->member)
+#define H5PROD_OSICHUNK 50
+#define H5PROD_OSIDEFLATE 6
+
+/*
+ * Set the options to those of store_hdf5_product.
+ */
+void h5prodopts_init(h5prodopts *opts) {
+
+    opts->deflate = -1;
+    opts->chunkrows = H5PROD_CHUNKROWS;
+    opts->shuffle = FMTRUE;
+}
+
+/*
+ * Null terminated string type of size characters.
+ */
+static hid_t h5prod_string(size_t size) {
+
+    hid_t type;
+
+    type = H5Tcopy(H5T_C_S1);
+    if (type < 0) return(-1);
+    if (H5Tset_size(type, size) < 0 ||
+	    H5Tset_strpad(type, H5T_STR_NULLTERM) < 0) {
+	H5Tclose(type);
+	return(-1);
+    }
+
+    return(type);
+}
+
+/*
+ * Compound type of the header as stored by libosihdf5, the strings are
+ * held whole as readers convert them to their own sizes.
+ */
+static hid_t h5prod_headertype(void) {
+
+    hid_t type, src, prod, area, pstr;
+    int status;
+
+    type = H5Tcreate(H5T_COMPOUND, sizeof(PRODhead));
+    src = h5prod_string(H5PROD_STRLEN(PRODhead, source));
+    prod = h5prod_string(H5PROD_STRLEN(PRODhead, product));
+    area = h5prod_string(H5PROD_STRLEN(PRODhead, area));
+    pstr = h5prod_string(H5PROD_STRLEN(PRODhead, projstr));
+    status = (type < 0 || src < 0 || prod < 0 || area < 0 || pstr < 0 ||
+	    H5Tinsert(type, "source", HOFFSET(PRODhead, source), src) < 0 ||
+	    H5Tinsert(type, "product", HOFFSET(PRODhead, product), prod) < 0 ||
+	    H5Tinsert(type, "area", HOFFSET(PRODhead, area), area) < 0 ||
+	    H5Tinsert(type, "projstr", HOFFSET(PRODhead, projstr), pstr) < 0 ||
+	    H5Tinsert(type, "iw", HOFFSET(PRODhead, iw),
+		H5T_NATIVE_UINT) < 0 ||
+	    H5Tinsert(type, "ih", HOFFSET(PRODhead, ih),
+		H5T_NATIVE_UINT) < 0 ||
+	    H5Tinsert(type, "z", HOFFSET(PRODhead, z),
+		H5T_NATIVE_USHORT) < 0 ||
+	    H5Tinsert(type, "Ax", HOFFSET(PRODhead, Ax),
+		H5T_NATIVE_FLOAT) < 0 ||
+	    H5Tinsert(type, "Ay", HOFFSET(PRODhead, Ay),
+		H5T_NATIVE_FLOAT) < 0 ||
+	    H5Tinsert(type, "Bx", HOFFSET(PRODhead, Bx),
+		H5T_NATIVE_FLOAT) < 0 ||
+	    H5Tinsert(type, "By", HOFFSET(PRODhead, By),
+		H5T_NATIVE_FLOAT) < 0 ||
+	    H5Tinsert(type, "year", HOFFSET(PRODhead, year),
+		H5T_NATIVE_UINT) < 0 ||
+	    H5Tinsert(type, "month", HOFFSET(PRODhead, month),
+		H5T_NATIVE_USHORT) < 0 ||
+	    H5Tinsert(type, "day", HOFFSET(PRODhead, day),
+		H5T_NATIVE_USHORT) < 0 ||
+	    H5Tinsert(type, "hour", HOFFSET(PRODhead, hour),
+		H5T_NATIVE_USHORT) < 0 ||
+	    H5Tinsert(type, "minute", HOFFSET(PRODhead, minute),
+		H5T_NATIVE_USHORT) < 0);
+    if (src >= 0) H5Tclose(src);
+    if (prod >= 0) H5Tclose(prod);
+    if (area >= 0) H5Tclose(area);
+    if (pstr >= 0) H5Tclose(pstr);
+    if (status && type >= 0) {
+	H5Tclose(type);
+	return(-1);
+    }
+
+    return(type);
+}
+
+/*
+ * Native type of the data of a layer of type ositype.
+ */
+static hid_t h5prod_datatype(osi_dtype ositype) {
+
+    switch (ositype) {
+	case OSI_UCHAR:
+	    return(H5Tcopy(H5T_NATIVE_UCHAR));
+	case OSI_CHAR:
+	    return(H5Tcopy(H5T_NATIVE_SCHAR));
+	case OSI_USHORT:
+	    return(H5Tcopy(H5T_NATIVE_USHORT));
+	case OSI_SHORT:
+	    return(H5Tcopy(H5T_NATIVE_SHORT));
+	case OSI_UINT:
+	    return(H5Tcopy(H5T_NATIVE_UINT));
+	case OSI_INT:
+	    return(H5Tcopy(H5T_NATIVE_INT));
+	case OSI_FLOAT:
+	    return(H5Tcopy(H5T_NATIVE_FLOAT));
+	default:
+	    return(-1);
+    }
+}
+
+/*
+ * Creation properties of a layer of dimensions dims. The chunks hold
+ * opts->chunkrows rows of an image of width iw, or the whole layer, or
+ * are those of store_hdf5_product if opts->deflate is negative.
+ */
+static hid_t h5prod_dcpl(hsize_t *dims, int iw, h5prodopts *opts) {
+
+    hid_t dcpl;
+    hsize_t chunk[2];
+    int i, deflate;
+
+    dcpl = H5Pcreate(H5P_DATASET_CREATE);
+    if (dcpl < 0 || dims[0] < 1 || dims[1] < 1) return(dcpl);
+
+    if (opts->deflate < 0) {
+	chunk[0] = chunk[1] = H5PROD_OSICHUNK;
+	deflate = H5PROD_OSIDEFLATE;
+    } else {
+	chunk[0] = dims[0];
+	chunk[1] = dims[1];
+	if (opts->chunkrows > 0) {
+	    chunk[0] = ((hsize_t) opts->chunkrows*iw+dims[1]-1)/dims[1];
+	}
+	deflate = opts->deflate;
+    }
+    for (i=0; i<2; i++) {
+	if (chunk[i] > dims[i]) chunk[i] = dims[i];
+    }
+    if (H5Pset_chunk(dcpl, 2, chunk) < 0 ||
+	    (opts->deflate >= 0 && opts->shuffle && H5Pset_shuffle(dcpl) < 0) ||
+	    H5Pset_deflate(dcpl, deflate) < 0) {
+	H5Pclose(dcpl);
+	return(-1);
+    }
+
+    return(dcpl);
+}
+
+/*
+ * Create filename with the header and layers of f, the datasets of the
+ * layers are created without data with the storage given by opts and
+ * returned open in dset. No file is left on failure.
+ */
+static int h5prod_create(char *filename, osihdf f, h5prodopts *opts,
+	hid_t *file, hid_t *dset) {
+
+    char *where="h5prod_create";
+    char name[FILELEN];
+    hid_t hdr, htype, stype, dtype, space, aspace, dcpl, grp, attr;
+    hsize_t dims[2], one = 1;
+    int i, z, status;
+
+    if (f.h.z < 1 || f.h.z > H5PROD_MAXLAYERS) {
+	fmerrmsg(where,"Can not write %d layers", f.h.z);
+	return(FM_IO_ERR);
+    }
+
+    *file = H5Fcreate(filename, H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+    if (*file < 0) {
+	fmerrmsg(where,"Could not create %s", filename);
+	return(FM_IO_ERR);
+    }
+
+    /*
+     * The header
+     */
+    status = FM_IO_ERR;
+    htype = h5prod_headertype();
+    aspace = H5Screate_simple(1, &one, NULL);
+    if (htype >= 0 && aspace >= 0) {
+	hdr = H5Dcreate(*file, H5PROD_HEADER, htype, aspace, H5P_DEFAULT);
+	if (hdr >= 0) {
+	    if (H5Dwrite(hdr, htype, H5S_ALL, H5S_ALL, H5P_DEFAULT,
+			&(f.h)) >= 0) {
+		status = FM_OK;
+	    }
+	    H5Dclose(hdr);
+	}
+    }
+    if (htype >= 0) H5Tclose(htype);
+    if (status) {
+	fmerrmsg(where,"Could not write the header of %s", filename);
+	if (aspace >= 0) H5Sclose(aspace);
+	H5Fclose(*file);
+	unlink(filename);
+	return(FM_IO_ERR);
+    }
+
+    /*
+     * The layers, with the dimensions given them by libosihdf5
+     */
+    z = 0;
+    dims[0] = f.h.iw;
+    dims[1] = f.h.ih;
+    stype = h5prod_string(H5PROD_STRLEN(datafield, description));
+    space = H5Screate_simple(2, dims, NULL);
+    dcpl = h5prod_dcpl(dims, f.h.iw, opts);
+    grp = H5Gcreate(*file, H5PROD_DATA, 0);
+    if (stype >= 0 && space >= 0 && dcpl >= 0 && grp >= 0) {
+	for (z=0; z<f.h.z; z++) {
+	    snprintf(name, FILELEN, H5PROD_LAYER, z);
+	    dtype = h5prod_datatype(f.d[z].type);
+	    if (dtype < 0) {
+		fmerrmsg(where,"Type %d of layer %d is not known",
+			(int) f.d[z].type, z);
+		break;
+	    }
+	    dset[z] = H5Dcreate(grp, name, dtype, space, dcpl);
+	    H5Tclose(dtype);
+	    if (dset[z] < 0) break;
+	    status = FM_IO_ERR;
+	    attr = H5Acreate(dset[z], H5PROD_DESCRIPTION, stype, aspace,
+		    H5P_DEFAULT);
+	    if (attr >= 0) {
+		if (H5Awrite(attr, stype, f.d[z].description) >= 0) {
+		    status = FM_OK;
+		}
+		H5Aclose(attr);
+	    }
+	    if (status) {
+		H5Dclose(dset[z]);
+		break;
+	    }
+	}
+    }
+    if (grp >= 0) H5Gclose(grp);
+    if (dcpl >= 0) H5Pclose(dcpl);
+    if (space >= 0) H5Sclose(space);
+    if (stype >= 0) H5Tclose(stype);
+    H5Sclose(aspace);
+    if (z < f.h.z) {
+	fmerrmsg(where,"Could not create layer %d of %s", z, filename);
+	for (i=0; i<z; i++) H5Dclose(dset[i]);
+	H5Fclose(*file);
+	unlink(filename);
+	return(FM_IO_ERR);
+    }
+
+    return(FM_OK);
+}
+
+/*
+ * RETURN VALUES:
+ * FM_OK on success, FM_IO_ERR if the product could not be written, no
+ * product file is left then.
+ */
+int store_hdf5_product_opts(char *filename, osihdf f, h5prodopts opts) {
+
+    char *where="store_hdf5_product_opts";
+    hid_t file, mtype, dset[H5PROD_MAXLAYERS];
+    int i, status;
+
+    if (opts.deflate < 0) {
+	return(store_hdf5_product(filename, f) ? FM_IO_ERR : FM_OK);
+    }
+    if (opts.deflate > 9) opts.deflate = 9;
+
+    if (h5prod_create(filename, f, &opts, &file, dset)) return(FM_IO_ERR);
+
+    status = FM_OK;
+    for (i=0; i<f.h.z; i++) {
+	mtype = h5prod_datatype(f.d[i].type);
+	if (status == FM_OK && H5Dwrite(dset[i], mtype, H5S_ALL, H5S_ALL,
+		    H5P_DEFAULT, f.d[i].data) < 0) {
+	    fmerrmsg(where,"Could not write layer %d of %s", i, filename);
+	    status = FM_IO_ERR;
+	}
+	H5Tclose(mtype);
+	H5Dclose(dset[i]);
+    }
+    if (H5Fclose(file) < 0) status = FM_IO_ERR;
+    if (status) {
+	fmerrmsg(where,"Could not write %s", filename);
+	unlink(filename);
+    }
+
+    return(status);
+}
+
+/*
+ * Add the datasets of group loc with as many elements as the image of
+ * the h5prodbands in data to its layers, see H5Giterate.
+ */
+static herr_t h5prodbands_member(hid_t loc, const char *name, void *data) {
+
+    char *where="h5prodbands_member";
+    h5prodbands *b = (h5prodbands *) data;
+    H5G_stat_t sb;
+    hid_t dset, space;
+    hssize_t n;
+
+    if (H5Gget_objinfo(loc, name, 0, &sb) < 0) {
+	fmerrmsg(where,"Could not find the type of %s", name);
+	return(-1);
+    }
+    if (sb.type != H5G_DATASET) return(0);
+
+    dset = H5Dopen(loc, name);
+    if (dset < 0) {
+	fmerrmsg(where,"Could not open dataset %s", name);
+	return(-1);
+    }
+    space = H5Dget_space(dset);
+    if (space < 0) {
+	H5Dclose(dset);
+	return(-1);
+    }
+    n = 0;
+    if (H5Sget_simple_extent_ndims(space) == 2) {
+	n = H5Sget_simple_extent_npoints(space);
+    }
+    H5Sclose(space);
+    if (n != (hssize_t) b->iw*b->ih) {
+	H5Dclose(dset);
+	return(0);
+    }
+    if (b->z >= H5PROD_MAXLAYERS) {
+	fmerrmsg(where,"More than %d layers", H5PROD_MAXLAYERS);
+	H5Dclose(dset);
+	return(-1);
+    }
+    b->dset[b->z++] = dset;
+
+    return(0);
+}
+
+/*
+ * NAME:
+ * h5prodbands_open
+ *
+ * PURPOSE:
+ * Open the layers of an HDF5 product for reading, or for writing if
+ * update is set, by h5prodbands_read and h5prodbands_write.
+ *
+ * RETURN VALUES:
+ * FM_OK, or FM_IO_ERR if the file could not be opened or has no layers.
+ */
+int h5prodbands_open(char *filename, fmbool update, h5prodbands *b) {
+
+    char *where="h5prodbands_open";
+    hid_t dset, htype, grp;
+    herr_t status;
+    PRODhead h;
+
+    b->z = b->iw = b->ih = 0;
+    b->file = H5Fopen(filename, (update ? H5F_ACC_RDWR : H5F_ACC_RDONLY),
+	    H5P_DEFAULT);
+    if (b->file < 0) {
+	fmerrmsg(where,"Could not open %s", filename);
+	return(FM_IO_ERR);
+    }
+
+    /*
+     * The size of the image, from the header
+     */
+    status = -1;
+    dset = H5Dopen(b->file, H5PROD_HEADER);
+    htype = H5Tcreate(H5T_COMPOUND, sizeof(PRODhead));
+    if (dset >= 0 && htype >= 0 &&
+	    H5Tinsert(htype, "iw", HOFFSET(PRODhead, iw),
+		H5T_NATIVE_UINT) >= 0 &&
+	    H5Tinsert(htype, "ih", HOFFSET(PRODhead, ih),
+		H5T_NATIVE_UINT) >= 0) {
+	status = H5Dread(dset, htype, H5S_ALL, H5S_ALL, H5P_DEFAULT, &h);
+    }
+    if (htype >= 0) H5Tclose(htype);
+    if (dset >= 0) H5Dclose(dset);
+    if (status < 0) {
+	fmerrmsg(where,"Could not read the header of %s", filename);
+	h5prodbands_close(b);
+	return(FM_IO_ERR);
+    }
+    b->iw = h.iw;
+    b->ih = h.ih;
+
+    status = -1;
+    grp = H5Gopen(b->file, H5PROD_DATA);
+    if (grp >= 0) {
+	status = H5Giterate(grp, ".", NULL, h5prodbands_member, b);
+	H5Gclose(grp);
+    }
+    if (status < 0 || b->z == 0) {
+	fmerrmsg(where,"Could not find the layers of %s", filename);
+	h5prodbands_close(b);
+	return(FM_IO_ERR);
+    }
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * h5prodbands_create
+ *
+ * PURPOSE:
+ * Create the product f as store_hdf5_product_opts would write it, but
+ * with no data in its layers, and open it for writing by
+ * h5prodbands_write. The data of f are not used.
+ *
+ * RETURN VALUES:
+ * FM_OK, or FM_IO_ERR if the product could not be created, no product
+ * file is left then.
+ */
+int h5prodbands_create(char *filename, osihdf f, h5prodopts opts,
+	h5prodbands *b) {
+
+    b->z = b->iw = b->ih = 0;
+    if (opts.deflate > 9) opts.deflate = 9;
+    if (h5prod_create(filename, f, &opts, &(b->file), b->dset)) {
+	b->file = -1;
+	return(FM_IO_ERR);
+    }
+    b->z = f.h.z;
+    b->iw = f.h.iw;
+    b->ih = f.h.ih;
+
+    return(FM_OK);
+}
+
+/*
+ * Select nrows rows from row0 of layer of b, and the memory space of
+ * these rows. The rows are a range of elements of the dataset, that is
+ * the rest of a row of the dataset, whole rows and the start of a row.
+ */
+static int h5prodbands_select(h5prodbands *b, int layer, int row0,
+	int nrows, hid_t *filespace, hid_t *memspace) {
+
+    char *where="h5prodbands_select";
+    hsize_t dims[2], start[2], count[2], first, last;
+    H5S_seloper_t op;
+
+    if (layer < 0 || layer >= b->z || row0 < 0 || nrows < 1 ||
+	    row0+nrows > b->ih) {
+	fmerrmsg(where,"Rows %d-%d of layer %d are outside the product",
+		row0, row0+nrows-1, layer);
+	return(FM_VAROUTOFSCOPE_ERR);
+    }
+    *filespace = H5Dget_space(b->dset[layer]);
+    if (*filespace < 0) return(FM_IO_ERR);
+    if (H5Sget_simple_extent_ndims(*filespace) != 2 ||
+	    H5Sget_simple_extent_dims(*filespace, dims, NULL) < 0) {
+	H5Sclose(*filespace);
+	return(FM_IO_ERR);
+    }
+
+    first = (hsize_t) row0*b->iw;
+    last = first+(hsize_t) nrows*b->iw;
+    op = H5S_SELECT_SET;
+    while (first < last) {
+	start[0] = first/dims[1];
+	start[1] = first%dims[1];
+	if (start[1] > 0 || last-first < dims[1]) {
+	    count[0] = 1;
+	    count[1] = dims[1]-start[1];
+	    if (count[1] > last-first) count[1] = last-first;
+	} else {
+	    count[0] = (last-first)/dims[1];
+	    count[1] = dims[1];
+	}
+	if (H5Sselect_hyperslab(*filespace, op, start, NULL, count,
+		    NULL) < 0) {
+	    H5Sclose(*filespace);
+	    return(FM_IO_ERR);
+	}
+	op = H5S_SELECT_OR;
+	first += count[0]*count[1];
+    }
+    count[0] = (hsize_t) nrows*b->iw;
+    *memspace = H5Screate_simple(1, count, NULL);
+    if (*memspace < 0) {
+	H5Sclose(*filespace);
+	return(FM_IO_ERR);
+    }
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * h5prodbands_read
+ * h5prodbands_write
+ *
+ * PURPOSE:
+ * Read or write nrows rows of layer from row row0, buf holds the rows
+ * in the native type memtype.
+ *
+ * RETURN VALUES:
+ * FM_OK, FM_VAROUTOFSCOPE_ERR if the rows are outside the product or
+ * FM_IO_ERR.
+ */
+int h5prodbands_read(h5prodbands *b, int layer, hid_t memtype, void *buf,
+	int row0, int nrows) {
+
+    char *where="h5prodbands_read";
+    hid_t filespace, memspace;
+    herr_t status;
+
+    if ((status = h5prodbands_select(b, layer, row0, nrows, &filespace,
+		    &memspace))) {
+	return(status);
+    }
+    status = H5Dread(b->dset[layer], memtype, memspace, filespace,
+	    H5P_DEFAULT, buf);
+    H5Sclose(memspace);
+    H5Sclose(filespace);
+    if (status < 0) {
+	fmerrmsg(where,"Could not read rows %d-%d of layer %d",
+		row0, row0+nrows-1, layer);
+	return(FM_IO_ERR);
+    }
+
+    return(FM_OK);
+}
+
+int h5prodbands_write(h5prodbands *b, int layer, hid_t memtype, void *buf,
+	int row0, int nrows) {
+
+    char *where="h5prodbands_write";
+    hid_t filespace, memspace;
+    herr_t status;
+
+    if ((status = h5prodbands_select(b, layer, row0, nrows, &filespace,
+		    &memspace))) {
+	return(status);
+    }
+    status = H5Dwrite(b->dset[layer], memtype, memspace, filespace,
+	    H5P_DEFAULT, buf);
+    H5Sclose(memspace);
+    H5Sclose(filespace);
+    if (status < 0) {
+	fmerrmsg(where,"Could not write rows %d-%d of layer %d",
+		row0, row0+nrows-1, layer);
+	return(FM_IO_ERR);
+    }
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * h5prodbands_close
+ *
+ * PURPOSE:
+ * Close the layers and file of b.
+ *
+ * RETURN VALUES:
+ * FM_OK, or FM_IO_ERR if the file could not be completed.
+ */
+int h5prodbands_close(h5prodbands *b) {
+
+    int i, status = FM_OK;
+
+    for (i=0; i<b->z; i++) H5Dclose(b->dset[i]);
+    b->z = 0;
+    if (b->file >= 0 && H5Fclose(b->file) < 0) status = FM_IO_ERR;
+    b->file = -1;
+
+    return(status);
+}
@@ -1,10 +1,15 @@
 /*
  * NAME:
  * store_snow
+ * store_snow_opts
+ * store_snow_open
  *
  * PURPOSE:
  * Writes image data on TIFF formatted file, ready for visualization
- * on any standard image viewer. 
+ * on any standard image viewer. store_snow_opts writes the image in
+ * strips compressed as given by opts, see fm_MITIFF_write_imagepal_opts.
+ * store_snow_open opens the file for writing band by band, see
+ * fm_MITIFF_open_imagepal_bands.
  * 
  * REQUIRES:
  * libfmio
@@ -18,6 +23,10 @@
  * Mari Anne Killie, DNMI/FOU, 02/07/2010 Introduced image_type to
  * select between different types. 0: probability for snow/ice (20
  * classes), 1: categorized image (5 classes), 2: SAR testing
+ * METNO/FOU, 17.10.2026: Added store_snow_opts, the status of writing is
+ * returned.
+ * METNO/FOU, 17.10.2026: Added store_snow_open, the header and colour
+ * map are made by store_snow_head.
  *
  * CVS_ID:
  * $Id: store_snow.c,v 1.3 2010-07-02 15:10:27 mariak Exp $
@@ -29,11 +38,24 @@
 
 int store_snow(char *fname,unsigned char *im,fmio_mihead clinfo,int image_type){
 
-  int i, ret, numcat;
-  uint16 cm[3][256];
+  fmio_tiffopts opts;
+
+  fm_tiffopts_init(&opts);
+
+  return(store_snow_opts(fname, im, clinfo, image_type, opts));
+}
+
+/*
+ * Make the MITIFF header satinfo and colour map cm of an image of
+ * image_type.
+ */
+static int store_snow_head(fmio_mihead clinfo, int image_type,
+	char *satinfo, uint16 cm[3][256]){
+
+  int i, numcat;
   char *strclali, *info;   
   char *par="PIXEL CLASSIFICATION\n";
-  char date[17], satinfo[FMIO_TIFFHEAD];
+  char date[17];
   
   if (image_type == 0) {
     numcat = PROBLIMITS;
@@ -136,11 +158,35 @@ int store_snow(char *fname,unsigned char *im,fmio_mihead clinfo,int image_type){
   }
   /*Later: add option for when image_type == 1 and image_type == 2 separately*/
 
-  ret = fm_MITIFF_write_imagepal(fname, im, satinfo, clinfo, cm); 
-  
   free(strclali);
   free(info);
   
   return(FM_OK);
 }
 
+int store_snow_opts(char *fname,unsigned char *im,fmio_mihead clinfo,
+	int image_type, fmio_tiffopts opts){
+
+  int ret;
+  uint16 cm[3][256];
+  char satinfo[FMIO_TIFFHEAD];
+
+  ret = store_snow_head(clinfo, image_type, satinfo, cm);
+  if (ret) return(ret);
+
+  return(fm_MITIFF_write_imagepal_opts(fname, im, satinfo, clinfo, cm, opts));
+}
+
+int store_snow_open(char *fname, fmio_mihead clinfo, int image_type,
+	fmio_tiffopts opts, fmio_tiffband *b){
+
+  int ret;
+  uint16 cm[3][256];
+  char satinfo[FMIO_TIFFHEAD];
+
+  ret = store_snow_head(clinfo, image_type, satinfo, cm);
+  if (ret) return(ret);
+
+  return(fm_MITIFF_open_imagepal_bands(fname, satinfo, clinfo, cm, opts, b));
+}
+
@@ -0,0 +1,171 @@
+/*
+ * NAME:
+ * tilepool_run
+ * tilepool_reserve
+ * tilepool_release
+ *
+ * PURPOSE:
+ * To process the tiles of fmaccusnow concurrently by a pool of workers,
+ * while the memory held by the accumulators of the tiles being processed
+ * is kept within a budget.
+ *
+ * REQUIREMENTS:
+ * o pthreads
+ *
+ * INPUT:
+ * o the number of tiles, workers and the memory budget in bytes
+ * o the function processing a tile
+ *
+ * OUTPUT:
+ * The status of the tiles, returned by tilepool_run.
+ *
+ * NOTES:
+ * Tiles are handed to the workers in order. The function processing a
+ * tile reserves the memory of its accumulators by tilepool_reserve
+ * before allocating them, and returns it by tilepool_release. A
+ * reservation waits while it would bring the memory reserved above the
+ * budget, a tile larger than the budget is thus processed alone. A
+ * budget of 0 sets no limit.
+ *
+ * Once a tile fails no more tiles are started, and reservations waiting
+ * fail. The first error is returned.
+ *
+ * Workers that could not be given a thread, and all tiles if there is
+ * one worker, are run in the calling thread, in the order of the tiles.
+ *
+ * HDF5 calls of the tile function are to be made holding
+ * accusnow_h5lock, as libhdf5 is usually built without thread safety.
+ *
+ * BUGS:
+ * NA
+ *
+ * AUTHOR:
+ * METNO/FOU, 17.10.2026
+ *
+ * MODIFIED:
+ * NA
+ *
+ * ID:
+ * $Id$
+ */
+
+#include <fmaccusnow.h>
+
+/*
+ * Process tiles of p until all are started or a tile fails.
+ */
+static void *tilepool_thread(void *arg) {
+
+    tilepool *p = (tilepool *) arg;
+    int tile, status;
+
+    pthread_mutex_lock(&(p->lock));
+    while (!p->status && p->next < p->ntile) {
+	tile = p->next++;
+	pthread_mutex_unlock(&(p->lock));
+
+	status = p->fn(p, tile);
+
+	pthread_mutex_lock(&(p->lock));
+	if (status && !p->status) {
+	    fmerrmsg("tilepool","Could not process tile %d", tile);
+	    p->status = status;
+	}
+	pthread_cond_broadcast(&(p->cond));
+    }
+    pthread_mutex_unlock(&(p->lock));
+
+    return(NULL);
+}
+
+/*
+ * Call fn with tiles 0 to ntile-1 on nworkers workers, with at most
+ * budget bytes reserved by tilepool_reserve at a time. arg is handed to
+ * fn in the arg of the pool.
+ */
+int tilepool_run(int ntile, int nworkers, long long budget,
+	tilepool_fn fn, void *arg) {
+
+    char *where="tilepool_run";
+    tilepool p;
+    pthread_t *tid;
+    int i, nstarted;
+
+    if (nworkers > FMACCUSNOW_MAXTHREADS) nworkers = FMACCUSNOW_MAXTHREADS;
+    if (nworkers > ntile) nworkers = ntile;
+    if (nworkers < 1) nworkers = 1;
+    p.ntile = ntile;
+    p.next = 0;
+    p.status = FM_OK;
+    p.budget = budget;
+    p.reserved = 0;
+    p.nreserved = 0;
+    p.fn = fn;
+    p.arg = arg;
+    tid = (pthread_t *) malloc(nworkers*sizeof(pthread_t));
+    if (!tid) {
+	fmerrmsg(where,"Could not allocate workers");
+	return(FM_MEMALL_ERR);
+    }
+    pthread_mutex_init(&(p.lock), NULL);
+    pthread_cond_init(&(p.cond), NULL);
+
+    /*
+     * The calling thread is one of the workers.
+     */
+    nstarted = 0;
+    for (i=1; i<nworkers; i++) {
+	if (pthread_create(&tid[nstarted], NULL, tilepool_thread, &p)) {
+	    fmerrmsg(where,
+		    "Could not start worker, processing tiles with %d workers",
+		    nstarted+1);
+	    break;
+	}
+	nstarted++;
+    }
+    fmlogmsg(where,"Processing %d tiles with %d workers", ntile, nstarted+1);
+    tilepool_thread(&p);
+
+    for (i=0; i<nstarted; i++) {
+	pthread_join(tid[i], NULL);
+    }
+    pthread_cond_destroy(&(p.cond));
+    pthread_mutex_destroy(&(p.lock));
+    free(tid);
+
+    return(p.status);
+}
+
+/*
+ * Reserve bytes of the budget of p, waiting for other tiles to release
+ * theirs if needed. Fails if a tile has failed.
+ */
+int tilepool_reserve(tilepool *p, long long bytes) {
+
+    pthread_mutex_lock(&(p->lock));
+    while (!p->status && p->budget > 0 && p->nreserved > 0 &&
+	    p->reserved+bytes > p->budget) {
+	pthread_cond_wait(&(p->cond), &(p->lock));
+    }
+    if (p->status) {
+	pthread_mutex_unlock(&(p->lock));
+	return(FM_OTHER_ERR);
+    }
+    p->reserved += bytes;
+    p->nreserved++;
+    pthread_mutex_unlock(&(p->lock));
+
+    return(FM_OK);
+}
+
+/*
+ * Return bytes reserved by tilepool_reserve to the budget of p.
+ */
+void tilepool_release(tilepool *p, long long bytes) {
+
+    pthread_mutex_lock(&(p->lock));
+    p->reserved -= bytes;
+    p->nreserved--;
+    pthread_cond_broadcast(&(p->cond));
+    pthread_mutex_unlock(&(p->lock));
+}
@@ -0,0 +1,220 @@
+/*
+ * NAME:
+ * test_accuckp_1
+ *
+ * PURPOSE:
+ * Test that average_merge_files gives the same products with an
+ * accumulator checkpoint as without, while the period moves over the
+ * passes, when a pass is reprocessed and with several readers. Slices
+ * of passes that have left the period are to be removed.
+ *
+ * NOTES:
+ * The passes are written to a temporary directory that is removed
+ * afterwards.
+ *
+ * REQUIREMENTS:
+ * o libosihdf5
+ *
+ * AUTHOR:
+ * METNO/FOU, 17.10.2026
+ *
+ * MODIFIED:
+ *
+ * ID:
+ * $Id: $
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <utime.h>
+#include <fmaccusnow.h>
+
+#define NPASS 6
+#define NWIN 4
+#define IW 40
+#define IH 30
+#define CLOUDLIM 0.5
+
+char progname[] = "test_accuckp_1";
+
+typedef struct {
+   unsigned char catclass[IW*IH];
+   unsigned char probclass[IW*IH];
+   float probice[IW*IH];
+   float probclear[IW*IH];
+   int numCloudfree[IW*IH];
+} products;
+
+static char dir[FILELEN];
+static char *passes[NPASS];
+static char ckpfile[FILELEN];
+
+/* Portable pseudo random numbers in [0,1) */
+static unsigned long seed = 12345;
+static double rnd(void) {
+   seed = (seed*1103515245UL+12345UL) % 2147483648UL;
+   return(seed/2147483648.);
+}
+
+/*
+ * Write pass pn, a quarter of the pixels cloudy and a tenth undefined.
+ */
+static int writepass(int pn) {
+   osi_dtype ft[3] = {OSI_FLOAT,OSI_FLOAT,OSI_FLOAT};
+   char *desc[3] = {"P(snow)","P(clear)","P(cloud)"};
+   float *pice, *pclear, *pcloud;
+   osihdf h5p;
+   int i, ret;
+
+   init_osihdf(&h5p);
+   sprintf(h5p.h.source,"NOAA-18");
+   sprintf(h5p.h.product,"fmsnowcover");
+   h5p.h.iw = IW;
+   h5p.h.ih = IH;
+   h5p.h.z = 3;
+   h5p.h.Ax = 1.;
+   h5p.h.Ay = 1.;
+   h5p.h.Bx = 0.;
+   h5p.h.By = 0.;
+   if (malloc_osihdf(&h5p,ft,desc)) return(1);
+   pice = (float *) h5p.d[0].data;
+   pclear = (float *) h5p.d[1].data;
+   pcloud = (float *) h5p.d[2].data;
+   for (i = 0 ; i < IW*IH ; i++) {
+      if (rnd() < 0.1) {
+	 pice[i] = pclear[i] = pcloud[i] = FMACCUSNOWMISVAL_NOCOV;
+	 continue;
+      }
+      pcloud[i] = (rnd() < 0.25 ? 0.6+0.4*rnd() : 0.5*rnd());
+      pice[i] = (1.-pcloud[i])*rnd();
+      pclear[i] = 1.-pcloud[i]-pice[i];
+   }
+   ret = store_hdf5_product(passes[pn],h5p);
+   free_osihdf(&h5p);
+
+   return(ret);
+}
+
+/*
+ * Merge the NWIN passes from first, with the checkpoint if ckp is set.
+ */
+static void merge(int first, int ckp, int nthreads, products *p) {
+   fmucsref ucs;
+
+   memset(p,0,sizeof(products));
+   ucs.iw = IW;
+   ucs.ih = IH;
+   ucs.Ax = 1.;
+   ucs.Ay = 1.;
+   ucs.Bx = 0.;
+   ucs.By = 0.;
+   if (average_merge_files(&passes[first],NWIN,ucs,p->catclass,
+	    p->probclass,p->probice,p->probclear,CLOUDLIM,p->numCloudfree,
+	    nthreads,(ckp ? ckpfile : NULL))) {
+      printf("\t\t(%s) ERROR: average_merge_files failed\n",progname);
+      exit(EXIT_FAILURE);
+   }
+}
+
+/*
+ * Return 1 if the slice of pass pn is in the checkpoint directory.
+ */
+static int hasslice(int pn) {
+   char path[2*FILELEN];
+
+   snprintf(path,2*FILELEN,"%s.%s",ckpfile,strrchr(passes[pn],'/')+1);
+
+   return(access(path,F_OK) == 0);
+}
+
+static void cleanup(void) {
+   char path[2*FILELEN];
+   int i;
+
+   for (i = 0 ; i < NPASS ; i++) {
+      remove(passes[i]);
+      snprintf(path,2*FILELEN,"%s.%s",ckpfile,strrchr(passes[i],'/')+1);
+      remove(path);
+   }
+   remove(ckpfile);
+   rmdir(dir);
+}
+
+int main(void) {
+
+   products ref, p;
+   struct utimbuf ut;
+   int i;
+
+   snprintf(dir,FILELEN,"/tmp/%s.XXXXXX",progname);
+   if (!mkdtemp(dir)) {
+      printf("\t\t(%s) ERROR: could not create %s\n",progname,dir);
+      exit(EXIT_FAILURE);
+   }
+   snprintf(ckpfile,FILELEN,"%s/fmaccusnow_test_tt.ckp",dir);
+   for (i = 0 ; i < NPASS ; i++) {
+      passes[i] = (char *) malloc(FILELEN);
+      if (!passes[i]) {
+	 printf("\t\t(%s) ERROR: could not allocate memory\n",progname);
+	 exit(EXIT_FAILURE);
+      }
+      sprintf(passes[i],"%s/fmsnow_tt_2009041500%02d.hdf5",dir,i);
+      if (writepass(i)) {
+	 printf("\t\t(%s) ERROR: could not write %s\n",progname,passes[i]);
+	 cleanup();
+	 exit(EXIT_FAILURE);
+      }
+   }
+
+   printf("\t(%s) 01. Compare a new checkpoint with a full rebuild:\n",
+	 progname);
+   merge(0,0,1,&ref);
+   merge(0,1,1,&p);
+   if (memcmp(&p,&ref,sizeof(products))) {
+      printf("\t\t(%s) 01. ERROR: products differ\n",progname);
+      cleanup();
+      exit(EXIT_FAILURE);
+   }
+
+   printf("\t(%s) 02. Move the period by two passes:\n",progname);
+   merge(2,0,1,&ref);
+   merge(2,1,1,&p);
+   if (memcmp(&p,&ref,sizeof(products))) {
+      printf("\t\t(%s) 02. ERROR: products differ\n",progname);
+      cleanup();
+      exit(EXIT_FAILURE);
+   }
+   if (hasslice(0) || hasslice(1) || !hasslice(2) || !hasslice(5)) {
+      printf("\t\t(%s) 02. ERROR: slices not updated\n",progname);
+      cleanup();
+      exit(EXIT_FAILURE);
+   }
+
+   printf("\t(%s) 03. Reprocess a pass of the period:\n",progname);
+   if (writepass(3)) {
+      printf("\t\t(%s) 03. ERROR: could not write %s\n",progname,passes[3]);
+      cleanup();
+      exit(EXIT_FAILURE);
+   }
+   ut.actime = ut.modtime = time(NULL)+3600;
+   utime(passes[3],&ut);
+   merge(2,0,1,&ref);
+   merge(2,1,1,&p);
+   if (memcmp(&p,&ref,sizeof(products))) {
+      printf("\t\t(%s) 03. ERROR: products differ\n",progname);
+      cleanup();
+      exit(EXIT_FAILURE);
+   }
+
+   printf("\t(%s) 04. Take all passes from slices with 3 readers:\n",
+	 progname);
+   merge(2,1,3,&p);
+   if (memcmp(&p,&ref,sizeof(products))) {
+      printf("\t\t(%s) 04. ERROR: products differ\n",progname);
+      cleanup();
+      exit(EXIT_FAILURE);
+   }
+
+   cleanup();
+   exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,195 @@
+/*
+ * NAME:
+ * test_bands_1
+ *
+ * PURPOSE:
+ * Test that fmsnowcover_bands gives the products of a synthetic tile
+ * processed in bands, and that it fails without leaving any product when
+ * the classification of a band fails. Classification is made to fail by
+ * a satellite that has no channel 3b constants.
+ *
+ * NOTES:
+ * The tile, its coefficients and products are written to a temporary
+ * directory that is removed afterwards. The tile has no land/sea mask.
+ * The products are only checked for without libusenwp, as no NWP data
+ * are available to the test.
+ *
+ * REQUIREMENTS:
+ * o libfmutil
+ * o libfmio
+ * o libosihdf5
+ * o libtiff
+ *
+ * AUTHOR:
+ * METNO/FOU, 17.10.2026
+ *
+ * MODIFIED:
+ *
+ * ID:
+ * $Id: $
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <fmaccusnow.h>
+#include <bench_scene.h>
+
+#define IW 120
+#define IH 100
+#define BANDROWS 32
+
+char progname[] = "test_bands_1";
+
+static char dir[FILELEN];
+static char cfgfile[FILELEN], scenef[FILELEN], coffile[FILELEN];
+static char lmaskf[FILELEN], indexf[FILELEN], headerf[FILELEN];
+static char prodf[3][FILELEN];
+
+/*
+ * Write the configuration of the test.
+ */
+static int writecfg(void) {
+   FILE *fp;
+
+   fp = fopen(cfgfile,"w");
+   if (!fp) return(1);
+   fprintf(fp,"IMGPATH %s\n",dir);
+   fprintf(fp,"NWPPATH %s\n",dir);
+   fprintf(fp,"LMPATH %s\n",dir);
+   fprintf(fp,"PRODUCTPATH %s\n",dir);
+   fprintf(fp,"PROBTABNAME %s\n",coffile);
+   fprintf(fp,"INDEXFILE %s\n",indexf);
+   fprintf(fp,"NTHREADS 2\n");
+   fprintf(fp,"BANDROWS %d\n",BANDROWS);
+
+   return(fclose(fp) != 0);
+}
+
+/*
+ * Replace the satellite of the tile by satid, of the same length.
+ */
+static int setsatid(char *satid) {
+   char hd[FILELEN];
+   FILE *fp;
+   long pos;
+
+   fp = fopen(scenef,"r+");
+   if (!fp) return(1);
+   pos = 0;
+   while (fgets(hd,FILELEN,fp)) {
+      if (strncmp(hd,"satid = ",8) == 0) {
+	 fseek(fp,pos+8,SEEK_SET);
+	 fputs(satid,fp);
+	 return(fclose(fp) != 0);
+      }
+      pos = ftell(fp);
+   }
+   fclose(fp);
+
+   return(1);
+}
+
+/*
+ * Process the tile, return the status of fmsnowcover_bands.
+ */
+static int process(void) {
+   cfgstruct cfg;
+   stagestats stats;
+
+   if (decode_cfg(cfgfile,&cfg)) {
+      printf("\t\t(%s) ERROR: could not decode %s\n",progname,cfgfile);
+      exit(EXIT_FAILURE);
+   }
+   stagestats_init(&stats);
+
+   return(fmsnowcover_bands(&cfg,"tt_nr.aha",scenef,lmaskf,coffile,"nr",
+	    &stats));
+}
+
+/*
+ * Return the number of products of the tile.
+ */
+static int nproducts(void) {
+   int i, n;
+
+   n = 0;
+   for (i = 0 ; i < 3 ; i++) {
+      if (access(prodf[i],F_OK) == 0) n++;
+   }
+
+   return(n);
+}
+
+static void cleanup(void) {
+   int i;
+
+   for (i = 0 ; i < 3 ; i++) {
+      remove(prodf[i]);
+   }
+   remove(cfgfile);
+   remove(scenef);
+   remove(coffile);
+   remove(indexf);
+   remove(headerf);
+   rmdir(dir);
+}
+
+int main(void) {
+
+   int i, status;
+   char *prefix[3] = {"fmsnow","fmsnow","fmsnow_cat"};
+   char *suffix[3] = {"hdf5","mitiff","mitiff"};
+
+   snprintf(dir,FILELEN,"/tmp/%s.XXXXXX",progname);
+   if (!mkdtemp(dir)) {
+      printf("\t\t(%s) ERROR: could not create %s\n",progname,dir);
+      exit(EXIT_FAILURE);
+   }
+   snprintf(cfgfile,FILELEN,"%s/fmsnowcover.cfg",dir);
+   snprintf(scenef,FILELEN,"%s/tt_nr.aha",dir);
+   snprintf(coffile,FILELEN,"%s/coeffs_tt",dir);
+   snprintf(lmaskf,FILELEN,"%s/physiography.dnnr.hdf5",dir);
+   snprintf(indexf,FILELEN,"%s/index.txt",dir);
+   snprintf(headerf,FILELEN,"%s/%s",dir,HEADERINDEXFILE);
+   for (i = 0 ; i < 3 ; i++) {
+      snprintf(prodf[i],FILELEN,"%s/%s_nr_200904151100.%s",dir,prefix[i],
+	    suffix[i]);
+   }
+   if (writecfg() || bench_write_scene(scenef,IW,IH) ||
+	 bench_write_coeffs(coffile)) {
+      printf("\t\t(%s) ERROR: could not write the input\n",progname);
+      cleanup();
+      exit(EXIT_FAILURE);
+   }
+
+#ifndef FMSNOWCOVER_HAVE_LIBUSENWP
+   printf("\t(%s) 01. Process a tile in bands:\n",progname);
+   status = process();
+   if (status || nproducts() != 3) {
+      printf("\t\t(%s) 01. ERROR: status %d, %d products\n",progname,
+	    status,nproducts());
+      cleanup();
+      exit(EXIT_FAILURE);
+   }
+   for (i = 0 ; i < 3 ; i++) {
+      remove(prodf[i]);
+   }
+#endif
+
+   printf("\t(%s) 02. Fail to classify the bands of a tile:\n",progname);
+   if (setsatid("noaa00")) {
+      printf("\t\t(%s) 02. ERROR: could not change %s\n",progname,scenef);
+      cleanup();
+      exit(EXIT_FAILURE);
+   }
+   status = process();
+   if (!status || nproducts() != 0) {
+      printf("\t\t(%s) 02. ERROR: status %d, %d products\n",progname,
+	    status,nproducts());
+      cleanup();
+      exit(EXIT_FAILURE);
+   }
+
+   cleanup();
+   exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,180 @@
+/*
+ * NAME:
+ * test_h5prod_1
+ *
+ * PURPOSE:
+ * Test that products written by store_hdf5_product_opts are read by
+ * read_hdf5_product with the header and layers they were written with,
+ * for layers in chunks of a few rows with the shuffle filter and in one
+ * chunk without it.
+ *
+ * NOTES:
+ * The strings of the header are within the sizes libosihdf5 reads. The
+ * products are written to a temporary directory that is removed
+ * afterwards.
+ *
+ * REQUIREMENTS:
+ * o libosihdf5
+ *
+ * AUTHOR:
+ * METNO/FOU, 17.10.2026
+ *
+ * MODIFIED:
+ *
+ * ID:
+ * $Id: $
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <fmaccusnow.h>
+
+#define IW 70
+#define IH 45
+#define NLAYERS 3
+
+char progname[] = "test_h5prod_1";
+
+static char dir[FILELEN];
+static char prodf[FILELEN];
+
+/*
+ * Fill the header and layers of the product.
+ */
+static int fillproduct(osihdf *p) {
+   osi_dtype ft[NLAYERS] = {OSI_FLOAT,OSI_UCHAR,OSI_SHORT};
+   char *desc[NLAYERS] = {"P(ice/snow)","class","count"};
+   float *pf;
+   unsigned char *pc;
+   short *ps;
+   int i;
+
+   init_osihdf(p);
+   sprintf(p->h.source,"NOAA-18 AVHRR");
+   sprintf(p->h.product,"fmsnowcover");
+   sprintf(p->h.area,"nr");
+   sprintf(p->h.projstr,
+	 "+proj=stere +lon_0=0 +lat_0=90 +lat_ts=60 +ellps=WGS84 +x_0=0 +y_0=0");
+   p->h.iw = IW;
+   p->h.ih = IH;
+   p->h.z = NLAYERS;
+   p->h.Ax = 1.;
+   p->h.Ay = 1.;
+   p->h.Bx = -100.5;
+   p->h.By = 2000.25;
+   p->h.year = 2009;
+   p->h.month = 4;
+   p->h.day = 15;
+   p->h.hour = 11;
+   p->h.minute = 5;
+   if (malloc_osihdf(p,ft,desc)) return(1);
+   pf = (float *) p->d[0].data;
+   pc = (unsigned char *) p->d[1].data;
+   ps = (short *) p->d[2].data;
+   for (i = 0 ; i < IW*IH ; i++) {
+      pf[i] = (i%101)/100.;
+      pc[i] = (unsigned char) (i%251);
+      ps[i] = (short) (i%601-300);
+   }
+
+   return(0);
+}
+
+/*
+ * Return 0 if the header and layers of a and b are the same.
+ */
+static int cmpproduct(osihdf *a, osihdf *b) {
+   size_t sz[NLAYERS] = {sizeof(float),sizeof(char),sizeof(short)};
+   int i;
+
+   if (strcmp(a->h.source,b->h.source) ||
+	 strcmp(a->h.product,b->h.product) ||
+	 strcmp(a->h.area,b->h.area) ||
+	 strcmp(a->h.projstr,b->h.projstr) ||
+	 a->h.iw != b->h.iw || a->h.ih != b->h.ih || a->h.z != b->h.z ||
+	 a->h.Ax != b->h.Ax || a->h.Ay != b->h.Ay ||
+	 a->h.Bx != b->h.Bx || a->h.By != b->h.By ||
+	 a->h.year != b->h.year || a->h.month != b->h.month ||
+	 a->h.day != b->h.day || a->h.hour != b->h.hour ||
+	 a->h.minute != b->h.minute) {
+      printf("\t\t(%s) ERROR: headers differ\n",progname);
+      return(1);
+   }
+   for (i = 0 ; i < NLAYERS ; i++) {
+      if (a->d[i].type != b->d[i].type ||
+	    strcmp(a->d[i].description,b->d[i].description) ||
+	    memcmp(a->d[i].data,b->d[i].data,IW*IH*sz[i])) {
+	 printf("\t\t(%s) ERROR: layer %d differs\n",progname,i);
+	 return(1);
+      }
+   }
+
+   return(0);
+}
+
+/*
+ * Write the product with opts, read it back and compare.
+ */
+static int roundtrip(osihdf *p, h5prodopts opts) {
+   osihdf r;
+   int status;
+
+   if (store_hdf5_product_opts(prodf,*p,opts)) {
+      printf("\t\t(%s) ERROR: could not write %s\n",progname,prodf);
+      return(1);
+   }
+   init_osihdf(&r);
+   if (read_hdf5_product(prodf,&r,0)) {
+      printf("\t\t(%s) ERROR: could not read %s\n",progname,prodf);
+      remove(prodf);
+      return(1);
+   }
+   status = cmpproduct(p,&r);
+   free_osihdf(&r);
+   remove(prodf);
+
+   return(status);
+}
+
+int main(void) {
+
+   osihdf p;
+   h5prodopts opts;
+
+   snprintf(dir,FILELEN,"/tmp/%s.XXXXXX",progname);
+   if (!mkdtemp(dir)) {
+      printf("\t\t(%s) ERROR: could not create %s\n",progname,dir);
+      exit(EXIT_FAILURE);
+   }
+   snprintf(prodf,FILELEN,"%s/fmsnow_tt_200904151105.hdf5",dir);
+   if (fillproduct(&p)) {
+      printf("\t\t(%s) ERROR: could not allocate memory\n",progname);
+      rmdir(dir);
+      exit(EXIT_FAILURE);
+   }
+
+   printf("\t(%s) 01. Chunks of 16 rows, shuffled and deflated:\n",
+	 progname);
+   h5prodopts_init(&opts);
+   opts.deflate = 4;
+   opts.chunkrows = 16;
+   opts.shuffle = FMTRUE;
+   if (roundtrip(&p,opts)) {
+      free_osihdf(&p);
+      rmdir(dir);
+      exit(EXIT_FAILURE);
+   }
+
+   printf("\t(%s) 02. One chunk, deflated:\n",progname);
+   opts.chunkrows = IH;
+   opts.shuffle = FMFALSE;
+   if (roundtrip(&p,opts)) {
+      free_osihdf(&p);
+      rmdir(dir);
+      exit(EXIT_FAILURE);
+   }
+
+   free_osihdf(&p);
+   rmdir(dir);
+   exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,191 @@
+/*
+ * NAME:
+ * test_probest_1
+ *
+ * PURPOSE:
+ * Test that probest_lazy and probest_batch, which only evaluate the
+ * features needed for the surface of each pixel, give the same
+ * probabilities as probest for sea, coast and land pixels, daytime
+ * channel 3a and 3b and with and without the dT feature.
+ *
+ * NOTES:
+ * The coefficients are those of etc/coeffs_070809.
+ *
+ * REQUIREMENTS:
+ * NA
+ *
+ * AUTHOR:
+ * METNO/FOU, 17.10.2026
+ *
+ * MODIFIED:
+ *
+ * ID:
+ * $Id: $
+ */
+
+#include <stdlib.h>
+#include <fmsnowcover.h>
+
+#define NPIX 20000
+
+char progname[] = "test_probest_1";
+
+static char *coeffs[] = {
+   "ice a1 n 56.28432 10.59245",
+   "ice r21 n 0.849512 0.1035101",
+   "ice r3a1 n 0.1186385 0.05849505",
+   "ice r3b1 n 0.01819690 0.01587715",
+   "ice dt n 4.321039 6.261954",
+   "snow a1 n 49.6754 20.97159",
+   "snow r21 n 0.8754824 0.1555307",
+   "snow r3a1 n 0.1728445 0.07297933",
+   "snow r3b1 n 0.0273016 0.02549709",
+   "snow dt n 4.321039 6.261954",
+   "cloud a1 n 55.85365 14.78555",
+   "cloud r21 n 0.9128154 0.08670341",
+   "cloud r3a1 n 0.6690058 0.2216875",
+   "cloud r3b1 n 0.1901366 0.1331275",
+   "cloud dt n 19.56302 15.36650",
+   "water a1 n 7.552976 2.471333",
+   "water r21 n 0.4639897 0.06464453",
+   "water r3a1 n 0.1169045 0.0906175",
+   "water r3b1 n 0.06353492 0.06767656",
+   "water dt n 19.56302 15.36650",
+   "land a1 n 7.933469 2.125764",
+   "land r21 n 1.889108 0.3935855",
+   "land r3a1 n 1.392030 0.2381562",
+   "land r3b1 n 0.3689924 0.1173226",
+   "land dt n 19.56302 15.36650",
+   NULL
+};
+
+/* Portable pseudo random numbers in [0,1) */
+static unsigned long seed = 12345;
+static double rnd(void) {
+   seed = (seed*1103515245UL+12345UL) % 2147483648UL;
+   return(seed/2147483648.);
+}
+
+static int same(double a, double b) {
+   return((a == b) || (isnan(a) && isnan(b)));
+}
+
+static void setcoeffs(statcoeffstr *cof) {
+   dummystr d;
+   featstr *f;
+   surfstr *s;
+   int i;
+
+   for (i = 0 ; coeffs[i] ; i++) {
+      sscanf(coeffs[i],"%s%s %c%lf%lf",d.surf,d.feat,&d.key,&d.par1,&d.par2);
+      if (!strcmp(d.surf,"ice")) s = &cof->ice;
+      else if (!strcmp(d.surf,"snow")) s = &cof->snow;
+      else if (!strcmp(d.surf,"cloud")) s = &cof->cloud;
+      else if (!strcmp(d.surf,"water")) s = &cof->water;
+      else s = &cof->land;
+      if (!strcmp(d.feat,"a1")) f = &s->a1;
+      else if (!strcmp(d.feat,"r21")) f = &s->r21;
+      else if (!strcmp(d.feat,"r3a1")) f = &s->r3a1;
+      else if (!strcmp(d.feat,"r3b1")) f = &s->r3b1;
+      else f = &s->dt;
+      f->key = d.key;
+      f->par1 = d.par1;
+      f->par2 = d.par2;
+      f->par3 = 0.;
+      f->count = 1;
+      f->tab = NULL;
+   }
+}
+
+int main(void) {
+
+   statcoeffstr cof = {{{0}}};
+   probcoeffs pc;
+   pinpstr *cpa;
+   pinpbatch in;
+   probbatch out;
+   probstr pref, p;
+   short lmasks[3] = {FMSNOWSEA, (FMSNOWSEA+FMSNOWLAND)/2, FMSNOWLAND};
+   int i;
+
+   setcoeffs(&cof);
+
+   cpa = (pinpstr *) calloc(NPIX,sizeof(pinpstr));
+   in.A1 = (float *) malloc(NPIX*sizeof(float));
+   in.A2 = (float *) malloc(NPIX*sizeof(float));
+   in.A3 = (float *) malloc(NPIX*sizeof(float));
+   in.A3b = (float *) malloc(NPIX*sizeof(float));
+   in.T4 = (float *) malloc(NPIX*sizeof(float));
+   in.T5 = (float *) malloc(NPIX*sizeof(float));
+   in.soz = (float *) malloc(NPIX*sizeof(float));
+   in.tdiff = (float *) malloc(NPIX*sizeof(float));
+   in.lmask = (short *) malloc(NPIX*sizeof(short));
+   in.daytime3b = (short *) malloc(NPIX*sizeof(short));
+   out.pice = (double *) malloc(NPIX*sizeof(double));
+   out.pfree = (double *) malloc(NPIX*sizeof(double));
+   out.pcloud = (double *) malloc(NPIX*sizeof(double));
+   if (!cpa || !in.A1 || !in.A2 || !in.A3 || !in.A3b || !in.T4 || !in.T5 ||
+	 !in.soz || !in.tdiff || !in.lmask || !in.daytime3b ||
+	 !out.pice || !out.pfree || !out.pcloud) {
+      printf("\t\t(%s) ERROR: could not allocate memory\n",progname);
+      exit(EXIT_FAILURE);
+   }
+
+   /*
+    * Surfaces change in runs of pixels, as in a tile, every 7th pixel
+    * has no dT.
+    */
+   for (i = 0 ; i < NPIX ; i++) {
+      cpa[i].A1 = 1.+99.*rnd();
+      cpa[i].A2 = cpa[i].A1*(0.3+1.8*rnd());
+      cpa[i].A3 = cpa[i].A1*(1.5*rnd());
+      cpa[i].A3b = 0.5*rnd();
+      cpa[i].T4 = 240.+40.*rnd();
+      cpa[i].T5 = cpa[i].T4-2.*rnd();
+      cpa[i].soz = 85.*rnd();
+      cpa[i].tdiff = (i%7 == 0 ? 0. : -10.+40.*rnd());
+      cpa[i].lmask = lmasks[(i/300)%3];
+      cpa[i].daytime3b = ((i/1000)%2);
+
+      in.A1[i] = cpa[i].A1;
+      in.A2[i] = cpa[i].A2;
+      in.A3[i] = cpa[i].A3;
+      in.A3b[i] = cpa[i].A3b;
+      in.T4[i] = cpa[i].T4;
+      in.T5[i] = cpa[i].T5;
+      in.soz[i] = cpa[i].soz;
+      in.tdiff[i] = cpa[i].tdiff;
+      in.lmask[i] = cpa[i].lmask;
+      in.daytime3b[i] = cpa[i].daytime3b;
+   }
+
+   printf("\t(%s) 01. Compare probest_lazy with probest:\n",progname);
+   for (i = 0 ; i < NPIX ; i++) {
+      probest(cpa[i],&pref,cof);
+      probest_lazy(cpa[i],&p,cof);
+      if (!same(p.pice,pref.pice) || !same(p.pfree,pref.pfree) ||
+	    !same(p.pcloud,pref.pcloud)) {
+	 printf("\t\t(%s) 01. ERROR: pixel %d (lmask %d) differs\n",
+	       progname,i,cpa[i].lmask);
+	 exit(EXIT_FAILURE);
+      }
+   }
+
+   printf("\t(%s) 02. Compare probest_batch with probest:\n",progname);
+   probest_prepare(cof,&pc);
+   if (probest_batch(NPIX,in,out,&pc)) {
+      printf("\t\t(%s) 02. ERROR: probest_batch failed\n",progname);
+      exit(EXIT_FAILURE);
+   }
+   for (i = 0 ; i < NPIX ; i++) {
+      probest(cpa[i],&pref,cof);
+      if (!same(out.pice[i],pref.pice) || !same(out.pfree[i],pref.pfree) ||
+	    !same(out.pcloud[i],pref.pcloud)) {
+	 printf("\t\t(%s) 02. ERROR: pixel %d (lmask %d) differs\n",
+	       progname,i,cpa[i].lmask);
+	 exit(EXIT_FAILURE);
+      }
+   }
+
+   exit(EXIT_SUCCESS);
+}